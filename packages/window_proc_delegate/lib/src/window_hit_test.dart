@@ -0,0 +1,73 @@
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+
+/// Common WM_NCHITTEST results.
+abstract final class WindowsHitTestCode {
+  static const int transparent = -1;
+  static const int nowhere = 0;
+  static const int client = 1;
+  static const int caption = 2;
+  static const int sysMenu = 3;
+  static const int minButton = 8;
+  static const int maxButton = 9;
+  static const int left = 10;
+  static const int right = 11;
+  static const int top = 12;
+  static const int topLeft = 13;
+  static const int topRight = 14;
+  static const int bottom = 15;
+  static const int bottomLeft = 16;
+  static const int bottomRight = 17;
+  static const int close = 20;
+}
+
+/// A rectangle of a window that answers WM_NCHITTEST with [code].
+///
+/// Coordinates are physical pixels relative to the window's client area.
+/// [right] and [bottom] are exclusive.
+class WindowHitTestRegion {
+  const WindowHitTestRegion(
+    this.left,
+    this.top,
+    this.right,
+    this.bottom,
+    this.code,
+  );
+
+  final int left;
+  final int top;
+  final int right;
+  final int bottom;
+
+  /// The WM_NCHITTEST result, usually one of [WindowsHitTestCode].
+  final int code;
+}
+
+/// Answers WM_NCHITTEST for the window [hwnd] natively from [regions].
+///
+/// Hit testing runs on every mouse move, so answering it from a native index
+/// keeps custom title bars and resize borders responsive while Dart is busy.
+/// Regions are given in paint order: where they overlap, the later region
+/// wins. Points outside every region are delivered to the registered
+/// delegates as usual. Call this again after each layout change; the new
+/// regions replace the old ones atomically. Passing an empty list removes
+/// the regions.
+///
+/// Returns false if the plugin is not available for the current engine.
+Future<bool> setWindowHitTestRegions(
+  int hwnd,
+  List<WindowHitTestRegion> regions,
+) async {
+  await internal.ensureInitializeEngineId();
+  final data = Int32List(regions.length * 5);
+  for (var i = 0; i < regions.length; i++) {
+    final region = regions[i];
+    data[i * 5] = region.left;
+    data[i * 5 + 1] = region.top;
+    data[i * 5 + 2] = region.right;
+    data[i * 5 + 3] = region.bottom;
+    data[i * 5 + 4] = region.code;
+  }
+  return internal.setHitTestRegions(hwnd, data, regions.length);
+}
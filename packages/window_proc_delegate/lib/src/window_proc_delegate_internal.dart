@@ -1,9 +1,13 @@
+import 'dart:async';
+import 'dart:convert';
 import 'dart:ffi' as ffi;
 import 'dart:io';
-import 'package:flutter/services.dart';
+import 'dart:isolate';
+import 'dart:typed_data';
+import 'dart:ui' show PlatformDispatcher;
 import 'package:flutter/foundation.dart';
 import 'windows_message.dart';
-import '../window_proc_delegate.dart';
+import 'windows_message_filter.dart';
 
 /// Native callback signature for FFI
 typedef NativeWindowProcCallback =
@@ -32,10 +36,417 @@ external void setCallback(
   callback,
 );
 
-bool _initialized = false;
+/// Set the delegates each message is forwarded to for an engine
+@ffi.Native<ffi.Bool Function(ffi.Int64, ffi.Pointer<ffi.Uint32>, ffi.Int32)>(
+  symbol: 'WindowProcDelegateSetDelegateRoutes',
+  isLeaf: true,
+)
+external bool _setDelegateRoutes(
+  int engineId,
+  ffi.Pointer<ffi.Uint32> program,
+  int wordCount,
+);
+
+/// Look up the handle addressing the plugin of an engine, binding it
+@ffi.Native<ffi.Int64 Function(ffi.Int64)>(
+  symbol: 'WindowProcDelegateGetEngineHandle',
+  isLeaf: true,
+)
+external int _getEngineHandle(int engineId);
+
+/// Bind an engine, or get notified on a native port when a plugin attaches
+@ffi.Native<ffi.Int64 Function(ffi.Int64, ffi.Int64)>(
+  symbol: 'WindowProcDelegateBindEngineOrNotify',
+  isLeaf: true,
+)
+external int _bindEngineOrNotify(int engineId, int port);
+
+/// Add an observer posting message batches to a native port
+@ffi.Native<
+  ffi.Int64 Function(
+    ffi.Int64,
+    ffi.Int64,
+    ffi.Pointer<ffi.Uint32>,
+    ffi.Int32,
+    ffi.Pointer<ffi.Int32>,
+    ffi.Int32,
+  )
+>(symbol: 'WindowProcDelegateAddObserver', isLeaf: true)
+external int _addObserver(
+  int engineHandle,
+  int port,
+  ffi.Pointer<ffi.Uint32> ranges,
+  int rangeCount,
+  ffi.Pointer<ffi.Int32> policies,
+  int policyCount,
+);
+
+/// Add an observer posting WM_COPYDATA payloads to a native port
+@ffi.Native<ffi.Int64 Function(ffi.Int64, ffi.Int64, ffi.IntPtr)>(
+  symbol: 'WindowProcDelegateAddCopyDataObserver',
+  isLeaf: true,
+)
+external int _addCopyDataObserver(
+  int engineHandle,
+  int port,
+  int windowHandle,
+);
+
+/// Remove an observer added with [_addObserver]
+@ffi.Native<ffi.Void Function(ffi.Int64, ffi.Int64)>(
+  symbol: 'WindowProcDelegateRemoveObserver',
+  isLeaf: true,
+)
+external void _removeObserver(int engineHandle, int observerId);
+
+/// Subscribe a native port to broadcasts reaching any engine's window
+@ffi.Native<ffi.Int64 Function(ffi.Int64, ffi.Pointer<ffi.Uint32>, ffi.Int32)>(
+  symbol: 'WindowProcDelegateSubscribeBroadcast',
+  isLeaf: true,
+)
+external int _subscribeBroadcast(
+  int port,
+  ffi.Pointer<ffi.Uint32> ranges,
+  int rangeCount,
+);
+
+/// End a subscription made with [_subscribeBroadcast]
+///
+/// Not a leaf call: it posts null to the subscription's port.
+@ffi.Native<ffi.Void Function(ffi.Int64)>(
+  symbol: 'WindowProcDelegateUnsubscribeBroadcast',
+)
+external void _unsubscribeBroadcast(int subscriptionId);
+
+/// Add an observer appending messages to a native ring
+@ffi.Native<
+  ffi.Pointer<ffi.Void> Function(
+    ffi.Int64,
+    ffi.Int64,
+    ffi.Pointer<ffi.Uint32>,
+    ffi.Int32,
+    ffi.Int32,
+    ffi.Int32,
+    ffi.Pointer<ffi.Int64>,
+  )
+>(symbol: 'WindowProcDelegateAddRingObserver', isLeaf: true)
+external ffi.Pointer<ffi.Void> _addRingObserver(
+  int engineHandle,
+  int wakePort,
+  ffi.Pointer<ffi.Uint32> ranges,
+  int rangeCount,
+  int capacity,
+  int dropPolicy,
+  ffi.Pointer<ffi.Int64> observerId,
+);
+
+/// Ring record storage
+@ffi.Native<ffi.Pointer<ffi.Int64> Function(ffi.Pointer<ffi.Void>)>(
+  symbol: 'WindowProcDelegateRingRecords',
+  isLeaf: true,
+)
+external ffi.Pointer<ffi.Int64> ringRecords(ffi.Pointer<ffi.Void> ring);
+
+/// Ring capacity in records
+@ffi.Native<ffi.Int64 Function(ffi.Pointer<ffi.Void>)>(
+  symbol: 'WindowProcDelegateRingCapacity',
+  isLeaf: true,
+)
+external int ringCapacity(ffi.Pointer<ffi.Void> ring);
+
+/// Store the readable [begin, end) index range of a ring
+@ffi.Native<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Int64>)>(
+  symbol: 'WindowProcDelegateRingBeginRead',
+  isLeaf: true,
+)
+external void ringBeginRead(
+  ffi.Pointer<ffi.Void> ring,
+  ffi.Pointer<ffi.Int64> range,
+);
+
+/// Consume ring records; returns how many leading records were overwritten
+@ffi.Native<ffi.Int64 Function(ffi.Pointer<ffi.Void>, ffi.Int64, ffi.Int64)>(
+  symbol: 'WindowProcDelegateRingEndRead',
+  isLeaf: true,
+)
+external int ringEndRead(ffi.Pointer<ffi.Void> ring, int begin, int count);
+
+/// Re-arm the ring wake-up; returns true if another drain is needed
+@ffi.Native<ffi.Bool Function(ffi.Pointer<ffi.Void>)>(
+  symbol: 'WindowProcDelegateRingFinishDrain',
+  isLeaf: true,
+)
+external bool ringFinishDrain(ffi.Pointer<ffi.Void> ring);
+
+/// Store the dropped-newest and dropped-oldest counters of a ring
+@ffi.Native<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Int64>)>(
+  symbol: 'WindowProcDelegateRingDropCounts',
+  isLeaf: true,
+)
+external void ringDropCounts(
+  ffi.Pointer<ffi.Void> ring,
+  ffi.Pointer<ffi.Int64> counts,
+);
+
+/// Start batching the raw input of every mouse natively
+@ffi.Native<ffi.Pointer<ffi.Void> Function(ffi.Int64, ffi.Int64, ffi.Int32)>(
+  symbol: 'WindowProcDelegateStartRawInput',
+  isLeaf: true,
+)
+external ffi.Pointer<ffi.Void> _startRawInput(
+  int engineHandle,
+  int wakePort,
+  int capacity,
+);
+
+/// Move the raw input batch into a buffer; returns the record count
+@ffi.Native<ffi.Int32 Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Int64>)>(
+  symbol: 'WindowProcDelegateTakeRawInput',
+  isLeaf: true,
+)
+external int _takeRawInput(
+  ffi.Pointer<ffi.Void> accumulator,
+  ffi.Pointer<ffi.Int64> records,
+);
+
+/// Number of raw input reports dropped because the batch was full
+@ffi.Native<ffi.Int64 Function(ffi.Pointer<ffi.Void>)>(
+  symbol: 'WindowProcDelegateRawInputDropped',
+  isLeaf: true,
+)
+external int rawInputDropped(ffi.Pointer<ffi.Void> accumulator);
+
+/// Stop batching raw mouse input into an accumulator
+@ffi.Native<ffi.Bool Function(ffi.Int64, ffi.Pointer<ffi.Void>)>(
+  symbol: 'WindowProcDelegateStopRawInput',
+  isLeaf: true,
+)
+external bool _stopRawInput(
+  int engineHandle,
+  ffi.Pointer<ffi.Void> accumulator,
+);
+
+/// Set the natively answered hit-test regions of a window
+@ffi.Native<
+  ffi.Bool Function(ffi.Int64, ffi.IntPtr, ffi.Pointer<ffi.Int32>, ffi.Int32)
+>(symbol: 'WindowProcDelegateSetHitTestRegions', isLeaf: true)
+external bool _setHitTestRegions(
+  int engineHandle,
+  int windowHandle,
+  ffi.Pointer<ffi.Int32> regions,
+  int regionCount,
+);
+
+/// Replace the natively evaluated reply rules of an engine
+@ffi.Native<ffi.Bool Function(ffi.Int64, ffi.Pointer<ffi.Int64>, ffi.Int32)>(
+  symbol: 'WindowProcDelegateSetReplyRules',
+  isLeaf: true,
+)
+external bool _setReplyRules(
+  int engineHandle,
+  ffi.Pointer<ffi.Int64> program,
+  int wordCount,
+);
+
+/// Replace the natively matched keyboard chords of an engine
+@ffi.Native<
+  ffi.Bool Function(ffi.Int64, ffi.Int64, ffi.Pointer<ffi.Uint32>, ffi.Int32)
+>(symbol: 'WindowProcDelegateSetChords', isLeaf: true)
+external bool _setChords(
+  int engineHandle,
+  int port,
+  ffi.Pointer<ffi.Uint32> program,
+  int wordCount,
+);
+
+/// Start caching the state of a window; returns its state block
+@ffi.Native<ffi.Pointer<ffi.Int64> Function(ffi.Int64, ffi.IntPtr)>(
+  symbol: 'WindowProcDelegateWatchWindowState',
+  isLeaf: true,
+)
+external ffi.Pointer<ffi.Int64> _watchWindowState(
+  int engineHandle,
+  int windowHandle,
+);
+
+/// Copy a consistent window state out of a state block
+@ffi.Native<
+  ffi.Int64 Function(ffi.Pointer<ffi.Int64>, ffi.Pointer<ffi.Int64>)
+>(symbol: 'WindowProcDelegateReadWindowState', isLeaf: true)
+external int _readWindowState(
+  ffi.Pointer<ffi.Int64> block,
+  ffi.Pointer<ffi.Int64> state,
+);
+
+/// Switch dispatch latency tracking of an engine on or off
+@ffi.Native<ffi.Pointer<ffi.Void> Function(ffi.Int64, ffi.Bool)>(
+  symbol: 'WindowProcDelegateSetLatencyTracking',
+  isLeaf: true,
+)
+external ffi.Pointer<ffi.Void> _setLatencyTracking(int engineHandle, bool enabled);
+
+/// Record the time a delegate spent on a message
+@ffi.Native<
+  ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int64, ffi.Int32, ffi.Int64)
+>(symbol: 'WindowProcDelegateRecordDelegateLatency', isLeaf: true)
+external void _recordDelegateLatency(
+  ffi.Pointer<ffi.Void> latency,
+  int delegateId,
+  int message,
+  int nanoseconds,
+);
+
+/// Copy latency summaries; returns the number available
+@ffi.Native<
+  ffi.Int32 Function(
+    ffi.Pointer<ffi.Void>,
+    ffi.Int64,
+    ffi.Pointer<ffi.Int64>,
+    ffi.Int32,
+  )
+>(symbol: 'WindowProcDelegateLatencySnapshot', isLeaf: true)
+external int _latencySnapshot(
+  ffi.Pointer<ffi.Void> latency,
+  int delegateId,
+  ffi.Pointer<ffi.Int64> summaries,
+  int capacity,
+);
+
+/// Copy the latency summaries of a stage; returns the number available
+@ffi.Native<
+  ffi.Int32 Function(
+    ffi.Pointer<ffi.Void>,
+    ffi.Int32,
+    ffi.Pointer<ffi.Int64>,
+    ffi.Int32,
+  )
+>(symbol: 'WindowProcDelegateStageLatencySnapshot', isLeaf: true)
+external int _stageLatencySnapshot(
+  ffi.Pointer<ffi.Void> latency,
+  int stage,
+  ffi.Pointer<ffi.Int64> summaries,
+  int capacity,
+);
+
+/// Record that an observer batch was drained
+@ffi.Native<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int32, ffi.Int64)>(
+  symbol: 'WindowProcDelegateRecordDelivered',
+  isLeaf: true,
+)
+external void _recordDelivered(
+  ffi.Pointer<ffi.Void> latency,
+  int message,
+  int queuedNs,
+);
+
+/// Clear all latency histograms
+@ffi.Native<ffi.Void Function(ffi.Pointer<ffi.Void>)>(
+  symbol: 'WindowProcDelegateResetLatency',
+  isLeaf: true,
+)
+external void _resetLatency(ffi.Pointer<ffi.Void> latency);
+
+/// Clear the latency histograms of one delegate
+@ffi.Native<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int64)>(
+  symbol: 'WindowProcDelegateResetDelegateLatency',
+  isLeaf: true,
+)
+external void _resetDelegateLatency(
+  ffi.Pointer<ffi.Void> latency,
+  int delegateId,
+);
+
+/// Set the delegate time budget of an engine
+@ffi.Native<
+  ffi.Pointer<ffi.Void> Function(ffi.Int64, ffi.Int64, ffi.Int32, ffi.Int32)
+>(symbol: 'WindowProcDelegateSetWatchdog', isLeaf: true)
+external ffi.Pointer<ffi.Void> _setWatchdog(
+  int engineHandle,
+  int budgetNs,
+  int strikes,
+  int window,
+);
+
+/// Account a delegate call; returns true if it demoted the delegate
+@ffi.Native<
+  ffi.Bool Function(
+    ffi.Pointer<ffi.Void>,
+    ffi.Int64,
+    ffi.Int32,
+    ffi.Int64,
+    ffi.Bool,
+  )
+>(symbol: 'WindowProcDelegateRecordDelegateTime', isLeaf: true)
+external bool _recordDelegateTime(
+  ffi.Pointer<ffi.Void> watchdog,
+  int delegateId,
+  int message,
+  int nanoseconds,
+  bool handled,
+);
+
+/// Copy the latest over-budget calls of a delegate; returns the number
+/// available
+@ffi.Native<
+  ffi.Int32 Function(
+    ffi.Pointer<ffi.Void>,
+    ffi.Int64,
+    ffi.Pointer<ffi.Int64>,
+    ffi.Int32,
+  )
+>(symbol: 'WindowProcDelegateDelegateOffenses', isLeaf: true)
+external int _delegateOffenses(
+  ffi.Pointer<ffi.Void> watchdog,
+  int delegateId,
+  ffi.Pointer<ffi.Int64> offenses,
+  int capacity,
+);
+
+/// Clear the watchdog accounting of one delegate
+@ffi.Native<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int64, ffi.Bool)>(
+  symbol: 'WindowProcDelegateResetDelegateWatchdog',
+  isLeaf: true,
+)
+external void _resetDelegateWatchdog(
+  ffi.Pointer<ffi.Void> watchdog,
+  int delegateId,
+  bool exempt,
+);
+
+/// Start or stop recording the dispatch of an engine to the Dart timeline
+@ffi.Native<ffi.Bool Function(ffi.Int64, ffi.Bool)>(
+  symbol: 'WindowProcDelegateSetTimeline',
+  isLeaf: true,
+)
+external bool _setTimeline(int engineHandle, bool enabled);
+
+/// Start recording the messages of an engine to a binary trace file
+///
+/// Not a leaf call: it creates the file and stops any trace in progress.
+@ffi.Native<ffi.Bool Function(ffi.Int64, ffi.Pointer<ffi.Uint8>, ffi.Int32)>(
+  symbol: 'WindowProcDelegateStartTrace',
+)
+external bool _startTrace(
+  int engineHandle,
+  ffi.Pointer<ffi.Uint8> path,
+  int capacity,
+);
+
+/// Stop the trace of an engine; returns the number of records written
+///
+/// Not a leaf call: it waits for the writer thread to flush the file.
+@ffi.Native<ffi.Int64 Function(ffi.Int64)>(
+  symbol: 'WindowProcDelegateStopTrace',
+)
+external int _stopTrace(int engineHandle);
+
+ffi.NativeCallable<NativeWindowProcCallback>? _nativeCallable;
 bool _dartApiInitialized = false;
 bool _engineIdInitialized = false;
-final MethodChannel _channel = MethodChannel('window_proc_delegate');
+
+/// Handle of the current engine's plugin, resolved once the engine ID is
+/// initialized; 0 before that.
+int _engineHandle = 0;
 
 void ensureNativeLibraryInitialized() {
   if (_dartApiInitialized) return;
@@ -56,52 +467,556 @@ void ensureNativeLibraryInitialized() {
 
 /// Ensures the plugin's engine ID is initialized.
 ///
-/// This method registers the current engine ID with the native plugin.
-/// It can be called early in application startup to ensure the plugin
-/// is ready before any delegates are registered.
-///
-/// If not called explicitly, the engine ID will be set automatically
-/// when the first delegate is registered.
-Future<void> ensureInitializeEngineId() async {
-  if (!Platform.isWindows) return;
+/// The native plugin attaches itself when the engine registers its plugins,
+/// and the first call naming the current engine binds it synchronously, so
+/// this normally completes without any round trip. If Dart gets here first,
+/// this waits for the plugin to attach, however long that takes. Registering
+/// a delegate binds the engine as well; the other APIs await this
+/// themselves.
+Future<void> ensureInitializeEngineId() {
+  if (!Platform.isWindows || _tryBindEngine()) return Future.value();
+  return _pluginAttached ??= _waitForPlugin();
+}
 
-  if (_engineIdInitialized) return;
+/// Completes once the current engine is bound; null until Dart first has to
+/// wait for its plugin.
+Future<void>? _pluginAttached;
 
+/// Binds the current engine as soon as its plugin attaches. The plugin
+/// posts to a port on every attach, since any engine's plugin may be the
+/// one Dart is waiting for.
+Future<void> _waitForPlugin() {
+  ensureNativeLibraryInitialized();
+  final attached = Completer<void>();
   final int engineId = PlatformDispatcher.instance.engineId!;
-  try {
-    await _channel.invokeMethod('setEngineId', engineId);
+  late final RawReceivePort port;
+  void bind() {
+    if (_engineIdInitialized) return;
+    _engineHandle = _bindEngineOrNotify(engineId, port.sendPort.nativePort);
+    if (_engineHandle == 0) return;
     _engineIdInitialized = true;
-  } catch (e) {
-    debugPrint('Failed to set engine ID: $e');
-    rethrow;
+    port.close();
+    attached.complete();
   }
+
+  port = RawReceivePort(
+    (Object? _) => bind(),
+    'window_proc_delegate plugin attach',
+  );
+  bind();
+  return attached.future;
 }
 
-void initialize(
-  List<WindowProcDelegateCallback?> delegates,
-  void Function(ffi.Pointer<WindowsMessage>) handleWindowProc,
+/// Binds the current engine to its native plugin. Returns false if the
+/// plugin has not attached yet.
+bool _tryBindEngine() {
+  if (_engineIdInitialized) return true;
+
+  _engineHandle = _getEngineHandle(PlatformDispatcher.instance.engineId!);
+  _engineIdInitialized = _engineHandle != 0;
+  return _engineIdInitialized;
+}
+
+/// The routes program last passed to [setDelegateRoutes].
+Uint32List? _delegateRoutes;
+bool _bindScheduled = false;
+
+/// Binds the engine once its plugin attaches, then applies the routes and
+/// callback set meanwhile.
+void _bindLater() {
+  if (_bindScheduled) return;
+  _bindScheduled = true;
+
+  ensureInitializeEngineId().then((_) {
+    final int engineId = PlatformDispatcher.instance.engineId!;
+    final routes = _delegateRoutes;
+    if (routes != null) {
+      _setDelegateRoutes(engineId, routes.address, routes.length);
+    }
+    final nativeCallable = _nativeCallable;
+    if (nativeCallable != null && nativeCallable.keepIsolateAlive) {
+      setCallback(engineId, nativeCallable.nativeFunction);
+    }
+  });
+}
+
+/// Range count of a delegate subscribed to every message in a routes
+/// program.
+const allMessages = 0xFFFFFFFF;
+
+/// Forwards each message to the native callback with the delegates
+/// subscribed to it, as listed in [program]: per delegate, in call order,
+/// its ID, its range count or [allMessages], then its ranges as inclusive
+/// [first, last] pairs.
+void setDelegateRoutes(Uint32List program) {
+  if (!Platform.isWindows) return;
+
+  _delegateRoutes = program;
+  if (!_tryBindEngine()) {
+    _bindLater();
+    return;
+  }
+  final int engineId = PlatformDispatcher.instance.engineId!;
+  if (!_setDelegateRoutes(engineId, program.address, program.length)) {
+    debugPrint('Failed to set delegate routes');
+  }
+}
+
+/// Starts posting batches of messages within [ranges] to the native [port],
+/// merging messages according to [policies], a map from message identifier
+/// to a native coalescing policy value.
+///
+/// Returns the observer ID, or 0 if the engine's plugin is not registered.
+/// The engine ID must have been initialized with [ensureInitializeEngineId].
+int addObserver(
+  int port,
+  List<WindowsMessageRange> ranges, [
+  Map<int, int> policies = const {},
+]) {
+  if (!Platform.isWindows) return 0;
+
+  ensureNativeLibraryInitialized();
+  final encodedPolicies = Int32List(policies.length * 2);
+  var i = 0;
+  for (final entry in policies.entries) {
+    encodedPolicies[i++] = entry.key;
+    encodedPolicies[i++] = entry.value;
+  }
+  return _addObserver(
+    _engineHandle,
+    port,
+    _encodeRanges(ranges).address,
+    ranges.length,
+    encodedPolicies.address,
+    policies.length,
+  );
+}
+
+/// Starts posting each WM_COPYDATA payload sent to [windowHandle], or to any
+/// window if it is 0, to [port] as `[hwnd, dwData, Uint8List]`. Returns an
+/// observer ID for [removeObserver], or 0 if the plugin is not available.
+int addCopyDataObserver(int port, int windowHandle) {
+  if (!Platform.isWindows) return 0;
+
+  ensureNativeLibraryInitialized();
+  return _addCopyDataObserver(_engineHandle, port, windowHandle);
+}
+
+/// Stops an observer started with [addObserver].
+void removeObserver(int observerId) {
+  if (!Platform.isWindows || observerId == 0) return;
+
+  _removeObserver(_engineHandle, observerId);
+}
+
+/// Starts posting the messages within [ranges] that reach the window of any
+/// engine to [port], once per broadcast. Returns a subscription ID for
+/// [unsubscribeBroadcast], or 0 if the plugin is not available.
+int subscribeBroadcast(int port, List<WindowsMessageRange> ranges) {
+  if (!Platform.isWindows) return 0;
+
+  ensureNativeLibraryInitialized();
+  return _subscribeBroadcast(
+    port,
+    _encodeRanges(ranges).address,
+    ranges.length,
+  );
+}
+
+/// Ends a subscription started with [subscribeBroadcast].
+void unsubscribeBroadcast(int subscriptionId) {
+  if (!Platform.isWindows || subscriptionId == 0) return;
+
+  _unsubscribeBroadcast(subscriptionId);
+}
+
+/// A ring observer created by [addRingObserver].
+class RingObserverHandle {
+  RingObserverHandle(this.ring, this.observerId);
+
+  final ffi.Pointer<ffi.Void> ring;
+  final int observerId;
+}
+
+/// Starts appending messages within [ranges] to a native ring of [capacity]
+/// records, posting the observer ID to [wakePort] when a drain is needed.
+///
+/// Returns null if the engine's plugin is not registered. The engine ID must
+/// have been initialized with [ensureInitializeEngineId].
+RingObserverHandle? addRingObserver(
+  int wakePort,
+  List<WindowsMessageRange> ranges,
+  int capacity,
+  int dropPolicy,
 ) {
-  if (_initialized) return;
+  if (!Platform.isWindows) return null;
 
+  ensureNativeLibraryInitialized();
+  final observerId = Int64List(1);
+  final ring = _addRingObserver(
+    _engineHandle,
+    wakePort,
+    _encodeRanges(ranges).address,
+    ranges.length,
+    capacity,
+    dropPolicy,
+    observerId.address,
+  );
+  if (ring == ffi.nullptr) return null;
+  return RingObserverHandle(ring, observerId[0]);
+}
+
+/// Number of int64 values per raw mouse record. kRawMouseRecordFields in
+/// windows/core/raw_input.h.
+const rawMouseRecordFields = 9;
+
+/// Starts batching the raw input of every mouse natively into up to
+/// [capacity] records, posting to [wakePort] when a batch is ready.
+///
+/// Returns null if the engine's plugin is not registered, raw input is
+/// already started for it, or the mice could not be registered. The engine
+/// ID must have been initialized with [ensureInitializeEngineId].
+ffi.Pointer<ffi.Void>? startRawInput(int wakePort, int capacity) {
+  if (!Platform.isWindows) return null;
+
+  ensureNativeLibraryInitialized();
+  final accumulator = _startRawInput(_engineHandle, wakePort, capacity);
+  return accumulator == ffi.nullptr ? null : accumulator;
+}
+
+/// Moves the batch of [accumulator] into [records], which has room for its
+/// capacity, and returns the number of records.
+int takeRawInput(ffi.Pointer<ffi.Void> accumulator, Int64List records) =>
+    _takeRawInput(accumulator, records.address);
+
+/// Stops batching raw mouse input into [accumulator], which is released.
+void stopRawInput(ffi.Pointer<ffi.Void> accumulator) {
+  if (!Platform.isWindows) return;
+
+  _stopRawInput(_engineHandle, accumulator);
+}
+
+/// Replaces the hit-test regions of [windowHandle] with [regionCount] regions
+/// packed in [regions] as left, top, right, bottom and code values.
+///
+/// Returns false if the engine's plugin is not registered. The engine ID must
+/// have been initialized with [ensureInitializeEngineId].
+bool setHitTestRegions(int windowHandle, Int32List regions, int regionCount) {
+  if (!Platform.isWindows) return false;
+
+  return _setHitTestRegions(
+    _engineHandle,
+    windowHandle,
+    regions.address,
+    regionCount,
+  );
+}
+
+/// Replaces the reply rules of the current engine with [program], a native
+/// rule program of [program.length] words.
+///
+/// Returns false if the program is rejected or the engine's plugin is not
+/// registered. The engine ID must have been initialized with
+/// [ensureInitializeEngineId].
+bool setReplyRules(Int64List program) {
+  if (!Platform.isWindows) return false;
+
+  return _setReplyRules(_engineHandle, program.address, program.length);
+}
+
+/// Replaces the keyboard chords of the current engine with [program], four
+/// words per chord: ID, virtual key, modifiers and flags. Matches are posted
+/// to [port] as `Int64List [id, hwnd, repeat]`.
+///
+/// Returns false if the program is rejected or the engine's plugin is not
+/// registered. The engine ID must have been initialized with
+/// [ensureInitializeEngineId].
+bool setChords(int port, Uint32List program) {
+  if (!Platform.isWindows) return false;
+
+  return _setChords(_engineHandle, port, program.address, program.length);
+}
+
+/// Starts caching the state of [windowHandle] and returns its native state
+/// block: a sequence counter followed by the state words. Returns null if
+/// the engine's plugin is not registered. The engine ID must have been
+/// initialized with [ensureInitializeEngineId].
+ffi.Pointer<ffi.Int64> watchWindowState(int windowHandle) {
+  if (!Platform.isWindows) return ffi.nullptr;
+
+  return _watchWindowState(_engineHandle, windowHandle);
+}
+
+/// Copies the state in [block] into [state] and returns the sequence
+/// counter it was copied at.
+int readWindowState(ffi.Pointer<ffi.Int64> block, Int64List state) =>
+    _readWindowState(block, state.address);
+
+/// Number of int64 values per latency summary: message, count, p50, p99 and
+/// max.
+const latencySummaryFields = 5;
+
+ffi.Pointer<ffi.Void>? _latency;
+bool _latencyEnabled = false;
+
+/// Whether delegates should be timed and reported with
+/// [recordDelegateLatency].
+bool get latencyTrackingEnabled => _latencyEnabled;
+
+/// Switches latency tracking of the current engine on or off.
+///
+/// Returns false if the engine's plugin is not registered. The engine ID must
+/// have been initialized with [ensureInitializeEngineId].
+bool setLatencyTracking(bool enabled) {
+  if (!Platform.isWindows) return false;
+
+  final latency = _setLatencyTracking(_engineHandle, enabled);
+  if (latency == ffi.nullptr) return false;
+  _latency = latency;
+  _latencyEnabled = enabled;
+  return true;
+}
+
+void recordDelegateLatency(int delegateId, int message, int nanoseconds) {
+  final latency = _latency;
+  if (latency == null) return;
+  _recordDelegateLatency(latency, delegateId, message, nanoseconds);
+}
+
+/// Number of int64 values in the queue stamp that ends an observer batch
+/// while latency is tracked: queue time and message. kQueueStampFields in
+/// windows/core/message_observer.h.
+const queueStampFields = 2;
+
+/// Returns the latency summaries of [delegateId], or of the whole dispatch
+/// if [delegateId] is negative, packed as [latencySummaryFields] values each.
+Int64List latencySnapshot(int delegateId) {
+  final latency = _latency;
+  if (latency == null) return Int64List(0);
+
+  return _snapshot(
+    (summaries) => _latencySnapshot(
+      latency,
+      delegateId,
+      summaries.address,
+      summaries.length ~/ latencySummaryFields,
+    ),
+  );
+}
+
+/// Returns the latency summaries of LatencyStage [stage], packed as
+/// [latencySummaryFields] values each.
+Int64List stageLatencySnapshot(int stage) {
+  final latency = _latency;
+  if (latency == null) return Int64List(0);
+
+  return _snapshot(
+    (summaries) => _stageLatencySnapshot(
+      latency,
+      stage,
+      summaries.address,
+      summaries.length ~/ latencySummaryFields,
+    ),
+  );
+}
+
+/// Calls [copy] with ever larger buffers until the summaries fit.
+Int64List _snapshot(int Function(Int64List summaries) copy) {
+  var summaries = Int64List(64 * latencySummaryFields);
+  while (true) {
+    final count = copy(summaries);
+    if (count * latencySummaryFields <= summaries.length) {
+      return Int64List.sublistView(summaries, 0, count * latencySummaryFields);
+    }
+    summaries = Int64List(count * latencySummaryFields);
+  }
+}
+
+/// Records that an observer batch ending in a queue stamp for [message],
+/// queued at [queuedNs], was drained.
+void recordDelivered(int message, int queuedNs) {
+  final latency = _latency;
+  if (latency != null) _recordDelivered(latency, message, queuedNs);
+}
+
+void resetLatency() {
+  final latency = _latency;
+  if (latency != null) _resetLatency(latency);
+}
+
+/// Clears the latency recorded for [delegateId], which is about to be
+/// reused.
+void resetDelegateLatency(int delegateId) {
+  final latency = _latency;
+  if (latency != null) _resetDelegateLatency(latency, delegateId);
+}
+
+/// Number of int64 values per delegate offense: message and nanoseconds.
+const delegateOffenseFields = 2;
+
+/// Most offenses kept per delegate; kMaxOffenses in
+/// windows/core/delegate_watchdog.h.
+const maxDelegateOffenses = 8;
+
+ffi.Pointer<ffi.Void>? _watchdog;
+bool _watchdogEnabled = false;
+
+/// Whether delegates should be timed and reported with
+/// [recordDelegateTime].
+bool get watchdogEnabled => _watchdogEnabled;
+
+/// Sets the delegate time budget of the current engine, or switches the
+/// watchdog off if [budgetNs] is 0.
+///
+/// Returns false if the policy is invalid or the engine's plugin is not
+/// registered. The engine ID must have been initialized with
+/// [ensureInitializeEngineId].
+bool setWatchdog(int budgetNs, int strikes, int window) {
+  if (!Platform.isWindows) return false;
+
+  final watchdog = _setWatchdog(_engineHandle, budgetNs, strikes, window);
+  if (watchdog == ffi.nullptr) return false;
+  _watchdog = watchdog;
+  _watchdogEnabled = budgetNs > 0;
+  return true;
+}
+
+/// Accounts a call of [delegateId]. Returns true if it demoted the delegate.
+bool recordDelegateTime(
+  int delegateId,
+  int message,
+  int nanoseconds,
+  bool handled,
+) {
+  final watchdog = _watchdog;
+  if (watchdog == null) return false;
+  return _recordDelegateTime(
+    watchdog,
+    delegateId,
+    message,
+    nanoseconds,
+    handled,
+  );
+}
+
+/// Returns the latest over-budget calls of [delegateId], oldest first,
+/// packed as [delegateOffenseFields] values each.
+Int64List delegateOffenses(int delegateId) {
+  final watchdog = _watchdog;
+  if (watchdog == null) return Int64List(0);
+
+  final offenses = Int64List(maxDelegateOffenses * delegateOffenseFields);
+  final count = _delegateOffenses(
+    watchdog,
+    delegateId,
+    offenses.address,
+    maxDelegateOffenses,
+  );
+  return Int64List.sublistView(offenses, 0, count * delegateOffenseFields);
+}
+
+/// Clears the watchdog accounting of [delegateId], which is about to be
+/// reused. An [exempt] delegate is never demoted.
+void resetDelegateWatchdog(int delegateId, bool exempt) {
+  final watchdog = _watchdog;
+  if (watchdog != null) _resetDelegateWatchdog(watchdog, delegateId, exempt);
+}
+
+bool _timelineEnabled = false;
+
+/// Whether the dispatch of the current engine is recorded to the timeline.
+bool get timelineEnabled => _timelineEnabled;
+
+/// Starts or stops recording the dispatch of the current engine to the Dart
+/// timeline.
+///
+/// Returns false if the engine's plugin is not registered or, when
+/// starting, the engine does not export the timeline API. The engine ID
+/// must have been initialized with [ensureInitializeEngineId].
+bool setTimeline(bool enabled) {
+  if (!Platform.isWindows) return false;
+
+  if (!_setTimeline(_engineHandle, enabled)) return false;
+  _timelineEnabled = enabled;
+  return true;
+}
+
+/// Starts recording the messages of the current engine to [path], with
+/// [capacity] records buffered for the native writer thread, or the default
+/// if 0.
+///
+/// Returns false if the file cannot be created or the engine's plugin is not
+/// registered. The engine ID must have been initialized with
+/// [ensureInitializeEngineId].
+bool startTrace(String path, int capacity) {
+  if (!Platform.isWindows) return false;
+
+  final encoded = utf8.encode(path);
+  final terminated = Uint8List(encoded.length + 1)..setAll(0, encoded);
+  return _startTrace(_engineHandle, terminated.address, capacity);
+}
+
+/// Stops the trace of the current engine. Returns the number of records
+/// written, or -1 if no trace was running.
+int stopTrace() {
+  if (!Platform.isWindows) return -1;
+
+  return _stopTrace(_engineHandle);
+}
+
+Uint32List _encodeRanges(List<WindowsMessageRange> ranges) {
+  final data = Uint32List(ranges.length * 2);
+  for (var i = 0; i < ranges.length; i++) {
+    data[i * 2] = ranges[i].first;
+    data[i * 2 + 1] = ranges[i].last;
+  }
+  return data;
+}
+
+/// Installs [handleWindowProc] as the native callback of the current engine.
+///
+/// Called when the first delegate registers. The callable is created once
+/// and kept for later [attachCallback] calls.
+void attachCallback(
+  void Function(ffi.Pointer<WindowsMessage>) handleWindowProc,
+) {
   if (!Platform.isWindows) return;
 
   ensureNativeLibraryInitialized();
 
   // Create native callable that dispatches to all delegates
-  final nativeCallable =
+  final nativeCallable = _nativeCallable ??=
       ffi.NativeCallable<NativeWindowProcCallback>.isolateLocal(
         handleWindowProc,
       );
+  nativeCallable.keepIsolateAlive = true;
 
-  // Get the engine ID and register the native callback
+  if (!_tryBindEngine()) {
+    _bindLater();
+    return;
+  }
   try {
-    final int engineId = PlatformDispatcher.instance.engineId!;
-    setCallback(engineId, nativeCallable.nativeFunction);
-
-    // Set engine ID asynchronously (fire-and-forget with error handling)
-    ensureInitializeEngineId();
+    setCallback(
+      PlatformDispatcher.instance.engineId!,
+      nativeCallable.nativeFunction,
+    );
   } catch (e) {
     debugPrint('Failed to set callback: $e');
   }
-  _initialized = true;
+}
+
+/// Removes the native callback of the current engine, so window messages no
+/// longer enter the isolate. Called when the last delegate unregisters.
+void detachCallback() {
+  final nativeCallable = _nativeCallable;
+  if (nativeCallable == null) return;
+
+  try {
+    if (_engineIdInitialized) {
+      setCallback(PlatformDispatcher.instance.engineId!, ffi.nullptr);
+    }
+  } catch (e) {
+    debugPrint('Failed to clear callback: $e');
+  }
+  nativeCallable.keepIsolateAlive = false;
 }
@@ -0,0 +1,142 @@
+import 'dart:async';
+
+import 'window_proc_observer.dart';
+import 'windows_message.dart';
+import 'windows_message_filter.dart';
+
+/// Signature for a WindowProc delegate callback.
+///
+/// The callback receives the window message parameters:
+/// - [hwnd]: Handle to the window
+/// - [message]: The message identifier (WM_* constant)
+/// - [wParam]: Additional message-specific information
+/// - [lParam]: Additional message-specific information
+///
+/// Returns the result value if the message was handled, or null to let other
+/// delegates process the message.
+typedef WindowProcDelegateCallback =
+    int? Function(int hwnd, int message, int wParam, int lParam);
+
+/// Calls a registered delegate with the fields of [message] it takes.
+/// Returns the result, or null if the delegate did not handle the message.
+typedef DelegateHandler = int? Function(WindowsMessage message);
+
+/// Calls a demoted delegate with a message it observed.
+typedef DemotedDelegateHandler = void Function(ObservedWindowsMessage message);
+
+class DelegateEntry {
+  DelegateEntry(this.handler, this.filter, this.priority, [this.onObserved]);
+
+  final DelegateHandler handler;
+  final WindowsMessageFilter? filter;
+
+  /// Delegates with higher priority are called first.
+  final int priority;
+
+  /// Receives the observed messages once the delegate is demoted, or null
+  /// if it must never be demoted.
+  final DemotedDelegateHandler? onObserved;
+
+  /// Whether the watchdog demoted the delegate to [onObserved]. Demoted
+  /// delegates are left out of the native routes and never called
+  /// synchronously again.
+  bool demoted = false;
+
+  /// The observer subscription of a demoted delegate.
+  StreamSubscription<ObservedWindowsMessage>? demotion;
+
+  /// The ID returned when the entry was added.
+  int id = -1;
+
+  /// Index of the slot holding this entry, set when it is added. The
+  /// native routes and delegate latency refer to delegates by slot, so it
+  /// stays small as IDs are reused.
+  int slot = -1;
+}
+
+/// Registered delegates, addressed by generation-checked IDs.
+///
+/// An ID packs a slot index in its low [_slotBits] bits and the slot's
+/// generation above them. Removing an entry frees its slot for reuse and
+/// bumps the generation, so a stale ID never matches the entry that reuses
+/// the slot.
+class DelegateSlotMap {
+  static const _slotBits = 16;
+  static const _slotMask = (1 << _slotBits) - 1;
+
+  final List<DelegateEntry?> _slots = [];
+  final List<int> _generations = [];
+  final List<int> _freeSlots = [];
+  List<DelegateEntry> _entries = const [];
+
+  /// The live entries in call order: by descending priority, then in
+  /// registration order. The list is replaced, never modified, so it can be
+  /// iterated while delegates register and unregister.
+  List<DelegateEntry> get entries => _entries;
+
+  bool get isEmpty => _entries.isEmpty;
+
+  /// Stores [entry] in a free slot and returns its ID.
+  int add(DelegateEntry entry) {
+    final int slot;
+    if (_freeSlots.isNotEmpty) {
+      slot = _freeSlots.removeLast();
+    } else {
+      slot = _slots.length;
+      if (slot > _slotMask) {
+        throw StateError('Too many WindowProc delegates');
+      }
+      _slots.add(null);
+      _generations.add(0);
+    }
+    entry
+      ..slot = slot
+      ..id = _generations[slot] << _slotBits | slot;
+    _slots[slot] = entry;
+    var index = _entries.length;
+    while (index > 0 && _entries[index - 1].priority < entry.priority) {
+      index--;
+    }
+    _entries = List.unmodifiable([
+      ..._entries.take(index),
+      entry,
+      ..._entries.skip(index),
+    ]);
+    return entry.id;
+  }
+
+  /// Removes and returns the entry with ID [id], or null if [id] is stale.
+  DelegateEntry? remove(int id) {
+    final slot = slotOf(id);
+    if (slot < 0) return null;
+
+    final entry = _slots[slot]!;
+    _slots[slot] = null;
+    _generations[slot]++;
+    _freeSlots.add(slot);
+    _entries = List.unmodifiable([
+      for (final live in _entries)
+        if (!identical(live, entry)) live,
+    ]);
+    return entry;
+  }
+
+  /// Returns the entry in [slot], or null if the slot is free.
+  DelegateEntry? entryAt(int slot) =>
+      slot >= 0 && slot < _slots.length ? _slots[slot] : null;
+
+  /// Returns the slot of the entry with ID [id], or -1 if [id] is stale.
+  int slotOf(int id) {
+    if (id < 0) return -1;
+    final slot = id & _slotMask;
+    if (slot >= _slots.length ||
+        _slots[slot] == null ||
+        _generations[slot] != id >> _slotBits) {
+      return -1;
+    }
+    return slot;
+  }
+}
+
+/// The delegates registered in this isolate.
+final DelegateSlotMap delegates = DelegateSlotMap();
@@ -0,0 +1,112 @@
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+import 'window_proc_delegates.dart';
+
+/// Latency statistics of one window message.
+class WindowsMessageLatency {
+  const WindowsMessageLatency({
+    required this.message,
+    required this.count,
+    required this.p50,
+    required this.p99,
+    required this.max,
+  });
+
+  /// The message identifier (WM_* constant).
+  final int message;
+
+  /// Number of samples.
+  final int count;
+
+  /// Median latency.
+  final Duration p50;
+
+  /// 99th percentile latency.
+  final Duration p99;
+
+  /// Highest latency.
+  final Duration max;
+
+  @override
+  String toString() =>
+      'WindowsMessageLatency(0x${message.toRadixString(16)}, count: $count, '
+      'p50: $p50, p99: $p99, max: $max)';
+}
+
+/// A stage of a message's way to Dart, timed per message by
+/// [WindowProcLatency.stage].
+///
+/// The values match LatencyStage in windows/core/latency_histogram.h.
+enum WindowProcLatencyStage {
+  /// From being posted to the message queue to reaching the plugin. Only
+  /// keyboard, mouse and raw input messages are posted; their posting time
+  /// comes from `GetMessageTime`, so this is accurate to a timer tick,
+  /// about 16 ms.
+  queued,
+
+  /// From being posted, or reaching the plugin for messages that are not
+  /// posted input, to the synchronous call into Dart returning.
+  handled,
+
+  /// From being queued for `observeWindowProcMessages` to the batch being
+  /// posted, once the message pump gets to it. Counted from the first
+  /// message queued since the previous batch, and attributed to it.
+  pending,
+
+  /// From being queued for `observeWindowProcMessages` to Dart draining
+  /// the batch, counted and attributed like [pending].
+  delivered,
+}
+
+/// Per-message latency histograms of the synchronous dispatch to Dart.
+///
+/// While enabled, the native window procedure times every call into Dart,
+/// and each delegate registered with `registerWindowProcDelegate` is timed
+/// separately, so a slow delegate can be told apart from a slow message.
+/// The time messages spend waiting for the plugin and for Dart is tracked
+/// as well, per [WindowProcLatencyStage]. Percentiles are accurate to about
+/// 6%. When disabled, the cost is a single flag check per message.
+abstract final class WindowProcLatency {
+  /// Whether latency tracking is on.
+  static bool get enabled => internal.latencyTrackingEnabled;
+
+  /// Switches latency tracking on or off. Histograms are kept while
+  /// tracking is off; use [reset] to clear them.
+  ///
+  /// Returns false if the plugin is not available for the current engine.
+  static Future<bool> setEnabled(bool enabled) async {
+    await internal.ensureInitializeEngineId();
+    return internal.setLatencyTracking(enabled);
+  }
+
+  /// Returns the latency of each message that reached Dart, measured around
+  /// the whole dispatch, or only the time spent in the delegate with ID
+  /// [delegateId]. A delegate that is no longer registered has no samples.
+  static List<WindowsMessageLatency> snapshot({int? delegateId}) {
+    final slot = delegateId == null ? -1 : delegates.slotOf(delegateId);
+    if (delegateId != null && slot < 0) return const [];
+    return _decode(internal.latencySnapshot(slot));
+  }
+
+  /// Returns the latency of each message through [stage].
+  static List<WindowsMessageLatency> stage(WindowProcLatencyStage stage) =>
+      _decode(internal.stageLatencySnapshot(stage.index));
+
+  /// Clears all histograms.
+  static void reset() => internal.resetLatency();
+}
+
+List<WindowsMessageLatency> _decode(Int64List data) {
+  const fields = internal.latencySummaryFields;
+  return [
+    for (var i = 0; i < data.length; i += fields)
+      WindowsMessageLatency(
+        message: data[i],
+        count: data[i + 1],
+        p50: Duration(microseconds: data[i + 2] ~/ 1000),
+        p99: Duration(microseconds: data[i + 3] ~/ 1000),
+        max: Duration(microseconds: data[i + 4] ~/ 1000),
+      ),
+  ];
+}
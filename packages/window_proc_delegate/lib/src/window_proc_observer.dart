@@ -0,0 +1,157 @@
+import 'dart:async';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+import 'windows_message_filter.dart';
+
+/// A window message delivered to an observer.
+///
+/// Observed messages are copies: they are delivered after the window
+/// procedure has returned, so pointer-valued parameters may no longer be
+/// valid and the message can no longer be handled.
+class ObservedWindowsMessage {
+  const ObservedWindowsMessage(
+    this.hwnd,
+    this.message,
+    this.wParam,
+    this.lParam, [
+    this.count = 1,
+  ]);
+
+  /// Handle to the window
+  final int hwnd;
+
+  /// The message identifier (WM_* constant)
+  final int message;
+
+  /// Additional message-specific information
+  final int wParam;
+
+  /// Additional message-specific information
+  final int lParam;
+
+  /// Number of native messages coalesced into this one; 1 if none were
+  /// merged. See [WindowsMessageCoalescing].
+  final int count;
+
+  @override
+  String toString() =>
+      'ObservedWindowsMessage(hwnd: $hwnd, message: $message, '
+      'wParam: $wParam, lParam: $lParam, count: $count)';
+}
+
+/// How an observer merges repeated messages for the same window and message
+/// identifier between two deliveries.
+///
+/// The values match CoalescePolicy in windows/core/message_coalescer.h.
+enum WindowsMessageCoalescing {
+  /// Deliver every message.
+  none,
+
+  /// Deliver only the most recent message. Suits positions and sizes, such
+  /// as WM_MOUSEMOVE, WM_MOVING and WM_SIZING.
+  keepLatest,
+
+  /// Sum the signed wheel delta in the high word of `wParam`, as for
+  /// WM_MOUSEWHEEL and WM_MOUSEHWHEEL. The sum is delivered sign-extended,
+  /// so read it as `wParam >> 16`; the low word and `lParam` come from the
+  /// most recent message.
+  accumulate,
+}
+
+/// Number of int64 fields per record in a native batch. Must match
+/// kObservedMessageFields in windows/core/message_observer.h.
+const int observedMessageFields = 5;
+
+/// Calls [onMessage] with each record of a native observer [batch].
+void decodeObservedMessages(
+  Int64List batch,
+  void Function(ObservedWindowsMessage message) onMessage,
+) {
+  for (
+    var i = 0;
+    i + observedMessageFields <= batch.length;
+    i += observedMessageFields
+  ) {
+    onMessage(
+      ObservedWindowsMessage(
+        batch[i],
+        batch[i + 1],
+        batch[i + 2],
+        batch[i + 3],
+        batch[i + 4],
+      ),
+    );
+  }
+}
+
+/// Observes the window messages accepted by [filter] without intercepting
+/// them.
+///
+/// Unlike [registerWindowProcDelegate], observers never run inside the
+/// window procedure: the native side copies matching messages into a batch
+/// and posts it to Dart once per message pump iteration, so a slow listener
+/// or a garbage collection pause cannot stall the Win32 message loop. Use a
+/// delegate only when the message has to be handled synchronously.
+///
+/// High-frequency messages can be merged natively before delivery with
+/// [coalescing], keyed by message identifier; Dart then receives at most one
+/// record per window and message per batch:
+///
+/// ```dart
+/// observeWindowProcMessages(
+///   const WindowsMessageFilter(messages: [0x0200, 0x020A]),
+///   coalescing: {
+///     0x0200: WindowsMessageCoalescing.keepLatest, // WM_MOUSEMOVE
+///     0x020A: WindowsMessageCoalescing.accumulate, // WM_MOUSEWHEEL
+///   },
+/// );
+/// ```
+///
+/// The native subscription starts when the stream is listened to and ends
+/// when the subscription is cancelled.
+Stream<ObservedWindowsMessage> observeWindowProcMessages(
+  WindowsMessageFilter filter, {
+  Map<int, WindowsMessageCoalescing> coalescing = const {},
+}) {
+  late final StreamController<ObservedWindowsMessage> controller;
+  RawReceivePort? port;
+  var observerId = 0;
+  var cancelled = false;
+
+  void handleBatch(Object? batch) {
+    if (batch is! Int64List) return;
+    decodeObservedMessages(batch, controller.add);
+    // Batches end in a queue stamp while latency is tracked.
+    const stampFields = internal.queueStampFields;
+    if (batch.length % observedMessageFields == stampFields) {
+      internal.recordDelivered(
+        batch[batch.length - 1],
+        batch[batch.length - stampFields],
+      );
+    }
+  }
+
+  controller = StreamController<ObservedWindowsMessage>(
+    onListen: () async {
+      port = RawReceivePort(handleBatch, 'window_proc_delegate observer');
+      await internal.ensureInitializeEngineId();
+      if (cancelled) return;
+      observerId = internal.addObserver(
+        port!.sendPort.nativePort,
+        filter.toRanges().toList(),
+        {
+          for (final entry in coalescing.entries)
+            entry.key: entry.value.index,
+        },
+      );
+    },
+    onCancel: () {
+      cancelled = true;
+      internal.removeObserver(observerId);
+      port?.close();
+    },
+  );
+  return controller.stream;
+}
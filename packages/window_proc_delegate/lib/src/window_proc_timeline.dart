@@ -0,0 +1,30 @@
+import 'window_proc_delegate_internal.dart' as internal;
+
+/// Shows the window procedure's calls into Dart on the DevTools timeline.
+///
+/// While enabled, the plugin records to the Dart timeline, on its Embedder
+/// stream, from the native dispatch path:
+///
+/// * each synchronous call into Dart, as a slice named after its message
+///   (such as `WM_PAINT`), with the window handle, the message and whether
+///   it was handled as arguments, so the time delegates spend on the
+///   platform thread no longer shows as a gap;
+/// * each flush of the asynchronous observers, as a
+///   `WindowProcDelegate flush` slice, with a flow from the message that
+///   scheduled it.
+///
+/// When disabled, the cost is a single flag check per call and per flush.
+abstract final class WindowProcTimeline {
+  /// Whether recording is on.
+  static bool get enabled => internal.timelineEnabled;
+
+  /// Switches recording on or off.
+  ///
+  /// Returns false if the plugin is not available for the current engine,
+  /// or, when switching on, if the Flutter engine does not export the Dart
+  /// timeline API.
+  static Future<bool> setEnabled(bool enabled) async {
+    await internal.ensureInitializeEngineId();
+    return internal.setTimeline(enabled);
+  }
+}
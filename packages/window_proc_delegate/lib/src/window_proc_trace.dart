@@ -0,0 +1,30 @@
+import 'window_proc_delegate_internal.dart' as internal;
+
+/// Records the window messages of this engine to a binary trace file.
+///
+/// Every message reaching the native window procedure is recorded with its
+/// parameters, whether and how it was answered, and how long the dispatch
+/// took. Records are handed to a native writer thread through a bounded
+/// buffer, so the window procedure never waits on the disk; records that do
+/// not fit are counted as dropped in the trace header.
+///
+/// Traces can be replayed on any host with the `trace_replay` tool built
+/// from `windows/test` to reproduce a message storm deterministically.
+abstract final class WindowProcTrace {
+  /// Starts recording to [path], replacing any trace in progress.
+  ///
+  /// [capacity] is the number of records buffered for the writer thread; 0
+  /// selects the default of 65536.
+  ///
+  /// Returns false if the file cannot be created or the plugin is not
+  /// available for the current engine.
+  static Future<bool> start(String path, {int capacity = 0}) async {
+    await internal.ensureInitializeEngineId();
+    return internal.startTrace(path, capacity);
+  }
+
+  /// Stops recording and closes the trace file.
+  ///
+  /// Returns the number of records written, or -1 if no trace was running.
+  static int stop() => internal.stopTrace();
+}
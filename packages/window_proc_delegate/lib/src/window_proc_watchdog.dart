@@ -0,0 +1,107 @@
+import 'dart:async';
+
+import 'window_proc_delegate_internal.dart' as internal;
+import 'window_proc_delegates.dart';
+
+/// A delegate demoted by [WindowProcWatchdog] to asynchronous delivery.
+class WindowProcDelegateDemotion {
+  const WindowProcDelegateDemotion({
+    required this.delegateId,
+    required this.budget,
+    required this.messages,
+    required this.times,
+  });
+
+  /// The ID `registerWindowProcDelegate` returned for the delegate.
+  final int delegateId;
+
+  /// The budget the delegate exceeded.
+  final Duration budget;
+
+  /// The messages of the latest calls that ran over [budget] without being
+  /// handled, oldest first.
+  final List<int> messages;
+
+  /// How long each call in [messages] took.
+  final List<Duration> times;
+
+  /// The slowest call in [times].
+  Duration get worst => times.fold(Duration.zero, (a, b) => a > b ? a : b);
+
+  @override
+  String toString() =>
+      'WindowProcDelegateDemotion($delegateId, budget: $budget, messages: '
+      '[${messages.map((m) => '0x${m.toRadixString(16)}').join(', ')}], '
+      'worst: $worst)';
+}
+
+/// Keeps slow delegates from stalling the window procedure.
+///
+/// While a budget is set, every synchronous delegate call is timed. A call
+/// that runs over budget and returns null is a strike: the window waited
+/// for nothing. A delegate with [strikes] strikes among its last [window]
+/// calls is demoted: it is left out of the native routes, so its messages
+/// no longer enter Dart synchronously on its behalf, and it receives them
+/// asynchronously instead, as with `observeWindowProcMessages`, its return
+/// value ignored. Each demotion is reported on [demotions]. A call's time
+/// includes the delegates of any messages it pumps, so a delegate cannot
+/// hide its time behind a nested message loop.
+///
+/// Pass `allowDemotion: false` to `registerWindowProcDelegate` for
+/// delegates that must run synchronously however slow they are. Copy-data
+/// delegates are never demoted. The accounting is done natively; when no
+/// budget is set, the cost is a single flag check per delegate call.
+abstract final class WindowProcWatchdog {
+  static final StreamController<WindowProcDelegateDemotion> _demotions =
+      StreamController.broadcast();
+  static Duration? _budget;
+
+  /// The current budget, or null if the watchdog is off.
+  static Duration? get budget => _budget;
+
+  /// Reports each demoted delegate.
+  static Stream<WindowProcDelegateDemotion> get demotions =>
+      _demotions.stream;
+
+  /// Sets the budget of each synchronous delegate call, or switches the
+  /// watchdog off if [budget] is null. Demoted delegates stay demoted.
+  ///
+  /// Returns false if the plugin is not available for the current engine,
+  /// or unless 0 < [strikes] <= [window] <= 64.
+  static Future<bool> setBudget(
+    Duration? budget, {
+    int strikes = 3,
+    int window = 20,
+  }) async {
+    await internal.ensureInitializeEngineId();
+    final budgetNs = budget == null ? 0 : budget.inMicroseconds * 1000;
+    if (!internal.setWatchdog(budgetNs, strikes, window)) return false;
+    _budget = budgetNs > 0 ? budget : null;
+    // Delegates registered before the first call were never exempted.
+    for (final entry in delegates.entries) {
+      if (entry.onObserved == null) {
+        internal.resetDelegateWatchdog(entry.slot, true);
+      }
+    }
+    return true;
+  }
+}
+
+/// Posts the demotion of [entry] to [WindowProcWatchdog.demotions].
+void reportDemotion(DelegateEntry entry) {
+  final offenses = internal.delegateOffenses(entry.slot);
+  const fields = internal.delegateOffenseFields;
+  WindowProcWatchdog._demotions.add(
+    WindowProcDelegateDemotion(
+      delegateId: entry.id,
+      budget: WindowProcWatchdog._budget ?? Duration.zero,
+      messages: [
+        for (var i = 0; i < offenses.length; i += fields) offenses[i],
+      ],
+      times: [
+        for (var i = 0; i < offenses.length; i += fields)
+          Duration(microseconds: offenses[i + 1] ~/ 1000),
+      ],
+    ),
+  );
+}
@@ -0,0 +1,154 @@
+import 'dart:async';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+
+import 'window_proc_delegate_internal.dart' as internal;
+import 'window_proc_observer.dart';
+import 'windows_message_filter.dart';
+
+/// Signature of a message handler run on a [WindowProcWorker].
+typedef WindowProcWorkerHandler =
+    void Function(ObservedWindowsMessage message);
+
+/// A helper isolate that runs heavy message handlers, such as parsing
+/// payloads or logging to disk, away from the UI isolate.
+///
+/// Messages subscribed to with [observe] are batched natively, exactly like
+/// [observeWindowProcMessages], but the batches are posted straight to a
+/// port owned by the worker. Neither the window procedure nor the UI
+/// isolate runs the handler or waits for it.
+///
+/// ```dart
+/// final worker = await WindowProcWorker.spawn();
+/// await worker.observe(
+///   const WindowsMessageFilter(messages: [0x001A]), // WM_SETTINGCHANGE
+///   logSettingChange, // A top-level function
+/// );
+/// ```
+///
+/// Each subscription ends when it is cancelled, when the worker is closed,
+/// or when the engine shuts down; the native side then tells the worker to
+/// release its end. The isolate exits once it is closed and every
+/// subscription has ended.
+class WindowProcWorker {
+  WindowProcWorker._(this._control);
+
+  final SendPort _control;
+  final Set<WindowProcWorkerSubscription> _subscriptions = {};
+  bool _closed = false;
+
+  /// Spawns the helper isolate.
+  static Future<WindowProcWorker> spawn({
+    String debugName = 'window_proc_worker',
+  }) async {
+    final ready = ReceivePort();
+    await Isolate.spawn(_workerMain, ready.sendPort, debugName: debugName);
+    final control = await ready.first as SendPort;
+    return WindowProcWorker._(control);
+  }
+
+  /// Runs [handler] on the worker for each window message accepted by
+  /// [filter], merged according to [coalescing] as with
+  /// [observeWindowProcMessages].
+  ///
+  /// [handler] is sent to the worker, so it must be a top-level or static
+  /// function, or a closure capturing only sendable state.
+  ///
+  /// Returns null if the plugin is not available for the current engine.
+  Future<WindowProcWorkerSubscription?> observe(
+    WindowsMessageFilter filter,
+    WindowProcWorkerHandler handler, {
+    Map<int, WindowsMessageCoalescing> coalescing = const {},
+  }) async {
+    if (_closed) throw StateError('The worker is closed');
+
+    final reply = ReceivePort();
+    _control.send(_Subscribe(handler, reply.sendPort));
+    final port = await reply.first as SendPort;
+    await internal.ensureInitializeEngineId();
+
+    final observerId = _closed
+        ? 0
+        : internal.addObserver(port.nativePort, filter.toRanges().toList(), {
+            for (final entry in coalescing.entries)
+              entry.key: entry.value.index,
+          });
+    if (observerId == 0) {
+      // No native observer will close the worker's end; do it here.
+      port.send(null);
+      return null;
+    }
+    final subscription = WindowProcWorkerSubscription._(this, observerId);
+    _subscriptions.add(subscription);
+    return subscription;
+  }
+
+  /// Cancels every subscription and lets the isolate exit once the batches
+  /// already posted to it are handled.
+  void close() {
+    if (_closed) return;
+    _closed = true;
+    for (final subscription in _subscriptions.toList()) {
+      subscription.cancel();
+    }
+    _control.send(null);
+  }
+}
+
+/// A subscription created by [WindowProcWorker.observe].
+class WindowProcWorkerSubscription {
+  WindowProcWorkerSubscription._(this._worker, this._observerId);
+
+  final WindowProcWorker _worker;
+  final int _observerId;
+  bool _cancelled = false;
+
+  /// Stops delivering messages to the worker.
+  void cancel() {
+    if (_cancelled) return;
+    _cancelled = true;
+    _worker._subscriptions.remove(this);
+    internal.removeObserver(_observerId);
+  }
+}
+
+/// Asks the worker for a port running [handler] on every batch it receives.
+class _Subscribe {
+  const _Subscribe(this.handler, this.reply);
+
+  final WindowProcWorkerHandler handler;
+  final SendPort reply;
+}
+
+void _workerMain(SendPort ready) {
+  late final RawReceivePort control;
+  control = RawReceivePort((Object? request) {
+    if (request == null) {
+      control.close();
+      return;
+    }
+    if (request is! _Subscribe) return;
+
+    final handler = request.handler;
+    late final RawReceivePort batches;
+    batches = RawReceivePort((Object? batch) {
+      // Null is the native observer's last message.
+      if (batch == null) {
+        batches.close();
+        return;
+      }
+      if (batch is! Int64List) return;
+      decodeObservedMessages(batch, (message) {
+        try {
+          handler(message);
+        } catch (e, stack) {
+          debugPrint('WindowProcWorker handler failed: $e\n$stack');
+        }
+      });
+    }, 'window_proc_delegate worker subscription');
+    request.reply.send(batches.sendPort);
+  }, 'window_proc_delegate worker');
+  ready.send(control.sendPort);
+}
@@ -0,0 +1,53 @@
+import 'dart:async';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+import 'window_proc_observer.dart';
+import 'windows_message_filter.dart';
+
+/// Observes the system-wide messages accepted by [filter], such as
+/// WM_POWERBROADCAST, WM_SETTINGCHANGE, WM_DISPLAYCHANGE or WM_ENDSESSION,
+/// as they reach the top-level window of any engine using this plugin.
+///
+/// Each engine sees only its own window, so an engine observing through
+/// [observeWindowProcMessages] misses broadcasts once its window is gone
+/// and gets one copy per window otherwise. Broadcast subscriptions are
+/// process-wide instead: the native side posts each broadcast to every
+/// subscriber once, however many windows receive it, and never enters a
+/// foreign isolate. [ObservedWindowsMessage.hwnd] is the first window the
+/// broadcast reached.
+///
+/// The native subscription starts when the stream is listened to and ends
+/// when the subscription is cancelled.
+Stream<ObservedWindowsMessage> observeWindowsBroadcasts(
+  WindowsMessageFilter filter,
+) {
+  late final StreamController<ObservedWindowsMessage> controller;
+  RawReceivePort? port;
+  var subscriptionId = 0;
+  var cancelled = false;
+
+  void handleRecord(Object? record) {
+    if (record is Int64List) decodeObservedMessages(record, controller.add);
+  }
+
+  controller = StreamController<ObservedWindowsMessage>(
+    onListen: () async {
+      port = RawReceivePort(handleRecord, 'window_proc_delegate broadcast');
+      // This engine's window becomes a source as well.
+      await internal.ensureInitializeEngineId();
+      if (cancelled) return;
+      subscriptionId = internal.subscribeBroadcast(
+        port!.sendPort.nativePort,
+        filter.toRanges().toList(),
+      );
+    },
+    onCancel: () {
+      cancelled = true;
+      internal.unsubscribeBroadcast(subscriptionId);
+      port?.close();
+    },
+  );
+  return controller.stream;
+}
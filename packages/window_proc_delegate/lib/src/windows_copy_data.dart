@@ -0,0 +1,80 @@
+import 'dart:async';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+
+/// The WM_COPYDATA message identifier.
+const int wmCopyData = 0x004A;
+
+/// Signature of a delegate registered with [registerCopyDataDelegate].
+///
+/// [data] views the sender's buffer and is only valid until the delegate
+/// returns. Returns the result value if the message was handled (Win32
+/// expects TRUE, 1, for a processed WM_COPYDATA), or null to let other
+/// delegates process the message.
+typedef WindowsCopyDataDelegate =
+    int? Function(int hwnd, int dwData, Uint8List data);
+
+/// A WM_COPYDATA payload delivered by [observeWindowsCopyData].
+class WindowsCopyData {
+  const WindowsCopyData(this.hwnd, this.dwData, this.data);
+
+  /// Handle to the window the payload was sent to
+  final int hwnd;
+
+  /// The `dwData` tag of the sender's COPYDATASTRUCT
+  final int dwData;
+
+  /// The payload bytes
+  final Uint8List data;
+
+  @override
+  String toString() =>
+      'WindowsCopyData(hwnd: $hwnd, dwData: $dwData, '
+      'length: ${data.length})';
+}
+
+/// Observes the WM_COPYDATA payloads sent to [hwnd], or to every window of
+/// this engine if it is null, without intercepting them.
+///
+/// Each payload is copied natively, while the sender's buffer is still
+/// valid, into a pooled buffer that Dart views in place; the buffer goes
+/// back to the pool once the [WindowsCopyData.data] list is garbage
+/// collected. Payloads of several megabytes therefore cost one native copy
+/// and no Dart-side copy. The sender is not told whether the message was
+/// handled; use [registerCopyDataDelegate] to reply.
+///
+/// The native subscription starts when the stream is listened to and ends
+/// when the subscription is cancelled.
+Stream<WindowsCopyData> observeWindowsCopyData({int? hwnd}) {
+  late final StreamController<WindowsCopyData> controller;
+  RawReceivePort? port;
+  var observerId = 0;
+  var cancelled = false;
+
+  void handlePayload(Object? payload) {
+    // Null is the native observer's last message.
+    if (payload case [int window, int dwData, Uint8List data]) {
+      controller.add(WindowsCopyData(window, dwData, data));
+    }
+  }
+
+  controller = StreamController<WindowsCopyData>(
+    onListen: () async {
+      port = RawReceivePort(handlePayload, 'window_proc_delegate copy data');
+      await internal.ensureInitializeEngineId();
+      if (cancelled) return;
+      observerId = internal.addCopyDataObserver(
+        port!.sendPort.nativePort,
+        hwnd ?? 0,
+      );
+    },
+    onCancel: () {
+      cancelled = true;
+      internal.removeObserver(observerId);
+      port?.close();
+    },
+  );
+  return controller.stream;
+}
@@ -0,0 +1,120 @@
+import 'dart:async';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+
+/// A key combination matched natively against WM_KEYDOWN and WM_SYSKEYDOWN.
+///
+/// A chord matches a press of [virtualKey] (a VK_* code up to 0xFF) while
+/// exactly the given modifiers are held; left and right modifier keys are
+/// not distinguished. For example, Ctrl+Shift+S:
+///
+/// ```dart
+/// WindowsKeyboardChord(1, 0x53, control: true, shift: true, consume: true)
+/// ```
+class WindowsKeyboardChord {
+  const WindowsKeyboardChord(
+    this.id,
+    this.virtualKey, {
+    this.shift = false,
+    this.control = false,
+    this.alt = false,
+    this.win = false,
+    this.suppressRepeat = false,
+    this.consume = false,
+  });
+
+  /// Reported in [WindowsKeyboardChordEvent.id] when the chord matches.
+  final int id;
+
+  final int virtualKey;
+  final bool shift;
+  final bool control;
+  final bool alt;
+  final bool win;
+
+  /// Whether autorepeated presses are ignored.
+  final bool suppressRepeat;
+
+  /// Whether the window procedure returns 0 for matching presses, so
+  /// neither delegates nor the window see them.
+  final bool consume;
+
+  // Mirrors ChordModifier and ChordFlag in windows/core/chord_table.h.
+  int get _modifiers =>
+      (shift ? 1 : 0) | (control ? 2 : 0) | (alt ? 4 : 0) | (win ? 8 : 0);
+  int get _flags => (suppressRepeat ? 1 : 0) | (consume ? 2 : 0);
+}
+
+/// A match of a chord set with [setWindowsKeyboardChords].
+class WindowsKeyboardChordEvent {
+  const WindowsKeyboardChordEvent(this.id, this.hwnd, this.repeat);
+
+  /// The [WindowsKeyboardChord.id] of the chord
+  final int id;
+
+  /// Handle to the window the key press was sent to
+  final int hwnd;
+
+  /// Whether the press was an autorepeat
+  final bool repeat;
+
+  @override
+  String toString() =>
+      'WindowsKeyboardChordEvent(id: $id, hwnd: $hwnd, repeat: $repeat)';
+}
+
+final StreamController<WindowsKeyboardChordEvent> _events =
+    StreamController<WindowsKeyboardChordEvent>.broadcast();
+RawReceivePort? _port;
+
+/// The chords matched since the last [setWindowsKeyboardChords] call.
+Stream<WindowsKeyboardChordEvent> get windowsKeyboardChordEvents =>
+    _events.stream;
+
+/// Replaces the chords matched natively for the current engine.
+///
+/// Key presses are looked up in a native table indexed by virtual key and
+/// modifiers, so only presses matching a chord reach Dart, as events on
+/// [windowsKeyboardChordEvents]; typing and autorepeat of other keys never
+/// enter Dart. Chords are matched before any delegate. Passing an empty
+/// list removes the chords.
+///
+/// Throws an [ArgumentError] if a chord is out of range or two chords have
+/// the same key and modifiers. Returns false if the plugin is not available
+/// for the current engine.
+Future<bool> setWindowsKeyboardChords(List<WindowsKeyboardChord> chords) async {
+  final program = Uint32List(chords.length * 4);
+  final seen = <int>{};
+  var i = 0;
+  for (final chord in chords) {
+    if (chord.virtualKey < 0 || chord.virtualKey > 0xFF) {
+      throw ArgumentError.value(chord.virtualKey, 'virtualKey', 'Not a VK_*');
+    }
+    if (chord.id < -0x80000000 || chord.id > 0x7FFFFFFF) {
+      throw ArgumentError.value(chord.id, 'id', 'Not an int32');
+    }
+    if (!seen.add(chord.virtualKey << 4 | chord._modifiers)) {
+      throw ArgumentError('Duplicate chord for key ${chord.virtualKey}');
+    }
+    program
+      ..[i++] = chord.id
+      ..[i++] = chord.virtualKey
+      ..[i++] = chord._modifiers
+      ..[i++] = chord._flags;
+  }
+
+  await internal.ensureInitializeEngineId();
+  final port = _port ??= RawReceivePort((Object? event) {
+    if (event case Int64List(length: 3)) {
+      _events.add(WindowsKeyboardChordEvent(event[0], event[1], event[2] != 0));
+    }
+  }, 'window_proc_delegate chords');
+  final result = internal.setChords(port.sendPort.nativePort, program);
+  if (chords.isEmpty) {
+    _port?.close();
+    _port = null;
+  }
+  return result;
+}
@@ -1,5 +1,7 @@
 import 'dart:ffi' as ffi;
 
+import 'windows_message_payload.dart';
+
 /// Windows message structure passed from native code
 final class WindowsMessage extends ffi.Struct {
   @ffi.IntPtr()
@@ -19,4 +21,25 @@ final class WindowsMessage extends ffi.Struct {
 
   @ffi.Bool()
   external bool handled;
+
+  /// IDs of the delegates subscribed to [message], in call order.
+  external ffi.Pointer<ffi.Int32> candidates;
+
+  /// Number of [candidates], or -1 if delegates are not routed natively.
+  @ffi.Int32()
+  external int candidateCount;
+
+  /// For WM_COPYDATA, the `dwData` of the sender's COPYDATASTRUCT.
+  @ffi.Uint64()
+  external int copyDataTag;
+
+  /// For WM_COPYDATA, the sender's bytes, valid only during the call.
+  external ffi.Pointer<ffi.Uint8> copyData;
+
+  /// Number of [copyData] bytes, or -1 if the message is not WM_COPYDATA.
+  @ffi.Int64()
+  external int copyDataLength;
+
+  /// [lParam] decoded for pointer-carrying messages.
+  external WindowsMessagePayload payload;
 }
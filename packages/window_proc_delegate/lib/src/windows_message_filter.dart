@@ -0,0 +1,59 @@
+/// An inclusive range of window message identifiers.
+class WindowsMessageRange {
+  /// Creates a range covering [first] through [last], both inclusive.
+  const WindowsMessageRange(this.first, this.last);
+
+  /// Creates a range covering the single message [message].
+  const WindowsMessageRange.single(int message)
+    : first = message,
+      last = message;
+
+  /// The first message identifier in the range.
+  final int first;
+
+  /// The last message identifier in the range.
+  final int last;
+
+  /// Whether [message] lies within this range.
+  bool contains(int message) => message >= first && message <= last;
+}
+
+/// The set of window messages a delegate is interested in.
+///
+/// Only messages accepted by the filter of at least one registered delegate
+/// are forwarded from the native window procedure to Dart. For example, to
+/// receive WM_SIZE and every application-defined message:
+///
+/// ```dart
+/// const WindowsMessageFilter(
+///   messages: [0x0005],
+///   ranges: [WindowsMessageRange(0x8000, 0xBFFF)], // WM_APP..0xBFFF
+/// );
+/// ```
+class WindowsMessageFilter {
+  /// Creates a filter accepting [messages] and every message in [ranges].
+  const WindowsMessageFilter({
+    this.messages = const [],
+    this.ranges = const [],
+  });
+
+  /// Individual message identifiers accepted by this filter.
+  final List<int> messages;
+
+  /// Ranges of message identifiers accepted by this filter.
+  final List<WindowsMessageRange> ranges;
+
+  /// Whether [message] is accepted by this filter.
+  bool accepts(int message) {
+    return messages.contains(message) ||
+        ranges.any((range) => range.contains(message));
+  }
+
+  /// The filter as inclusive [first, last] pairs.
+  Iterable<WindowsMessageRange> toRanges() sync* {
+    for (final message in messages) {
+      yield WindowsMessageRange.single(message);
+    }
+    yield* ranges;
+  }
+}
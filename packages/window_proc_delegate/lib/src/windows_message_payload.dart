@@ -0,0 +1,215 @@
+import 'dart:ffi' as ffi;
+
+// Mirrors of the decoded payloads in windows/core/message_payload.h, whose
+// static_asserts pin the sizes and offsets relied on here.
+
+/// Version of the payload layouts below; must match
+/// kMessagePayloadVersion in windows/core/message_payload.h.
+const int windowsMessagePayloadVersion = 1;
+
+/// A RECT.
+final class WindowsRect extends ffi.Struct {
+  @ffi.Int32()
+  external int left;
+
+  @ffi.Int32()
+  external int top;
+
+  @ffi.Int32()
+  external int right;
+
+  @ffi.Int32()
+  external int bottom;
+}
+
+/// A POINT.
+final class WindowsPoint extends ffi.Struct {
+  @ffi.Int32()
+  external int x;
+
+  @ffi.Int32()
+  external int y;
+}
+
+/// The WINDOWPOS of WM_WINDOWPOSCHANGING and WM_WINDOWPOSCHANGED.
+final class WindowPosPayload extends ffi.Struct {
+  /// Handle to the window; read-only.
+  @ffi.Int64()
+  external int window;
+
+  @ffi.Int64()
+  external int insertAfter;
+
+  @ffi.Int32()
+  external int x;
+
+  @ffi.Int32()
+  external int y;
+
+  @ffi.Int32()
+  external int cx;
+
+  @ffi.Int32()
+  external int cy;
+
+  /// SWP_* flags.
+  @ffi.Uint32()
+  external int flags;
+}
+
+/// The MINMAXINFO of WM_GETMINMAXINFO.
+final class MinMaxInfoPayload extends ffi.Struct {
+  external WindowsPoint maxSize;
+
+  external WindowsPoint maxPosition;
+
+  external WindowsPoint minTrackSize;
+
+  external WindowsPoint maxTrackSize;
+}
+
+/// The lParam of WM_NCCALCSIZE.
+final class NcCalcSizePayload extends ffi.Struct {
+  /// With [calcValidRects], NCCALCSIZE_PARAMS.rgrc; otherwise only the
+  /// first rect is used.
+  @ffi.Array(3)
+  external ffi.Array<WindowsRect> rects;
+
+  /// 1 if wParam was TRUE, 0 otherwise.
+  @ffi.Uint32()
+  external int calcValidRects;
+
+  /// With [calcValidRects], NCCALCSIZE_PARAMS.lppos; read-only.
+  external WindowPosPayload windowPos;
+}
+
+/// The new DPI and suggested window rect of WM_DPICHANGED.
+final class DpiChangedPayload extends ffi.Struct {
+  @ffi.Uint32()
+  external int dpiX;
+
+  @ffi.Uint32()
+  external int dpiY;
+
+  external WindowsRect suggested;
+}
+
+/// The wParam and section name of WM_SETTINGCHANGE.
+final class SettingChangePayload extends ffi.Struct {
+  /// The SPI_* action, or 0.
+  @ffi.Uint64()
+  external int action;
+
+  /// Address of the UTF-16 section name, valid only during the call.
+  @ffi.Int64()
+  external int area;
+
+  /// Length of [area] in code units, or -1 if there is none.
+  @ffi.Int32()
+  external int areaLength;
+
+  /// The section name, such as `ImmersiveColorSet`, or null.
+  String? get areaName {
+    if (areaLength < 0) return null;
+    return String.fromCharCodes(
+      ffi.Pointer<ffi.Uint16>.fromAddress(area).asTypedList(areaLength),
+    );
+  }
+}
+
+final class _PayloadData extends ffi.Union {
+  external WindowPosPayload windowPos;
+  external NcCalcSizePayload ncCalcSize;
+  external MinMaxInfoPayload minMaxInfo;
+  external DpiChangedPayload dpiChanged;
+  external SettingChangePayload settingChange;
+}
+
+/// The message a [WindowsMessagePayload] was decoded from. The values match
+/// PayloadKind in windows/core/message_payload.h.
+enum WindowsMessagePayloadKind {
+  none,
+  windowPosChanging,
+  windowPosChanged,
+  ncCalcSize,
+  getMinMaxInfo,
+  dpiChanged,
+  settingChange,
+}
+
+/// The lParam of a pointer-carrying message, decoded once natively.
+///
+/// Read it from a delegate with [currentWindowsMessagePayload]. Fields are
+/// plain struct members; writing them changes the result of messages
+/// whose struct the sender reads back, such as WM_GETMINMAXINFO,
+/// WM_WINDOWPOSCHANGING and WM_NCCALCSIZE. Other writes are ignored.
+final class WindowsMessagePayload extends ffi.Struct {
+  @ffi.Uint32()
+  external int version;
+
+  @ffi.Uint32()
+  external int _kind;
+
+  external _PayloadData _data;
+
+  WindowsMessagePayloadKind get kind =>
+      version == windowsMessagePayloadVersion &&
+          _kind < WindowsMessagePayloadKind.values.length
+      ? WindowsMessagePayloadKind.values[_kind]
+      : WindowsMessagePayloadKind.none;
+
+  /// For WM_WINDOWPOSCHANGING and WM_WINDOWPOSCHANGED.
+  WindowPosPayload? get windowPos => switch (kind) {
+    WindowsMessagePayloadKind.windowPosChanging ||
+    WindowsMessagePayloadKind.windowPosChanged => _data.windowPos,
+    _ => null,
+  };
+
+  /// For WM_NCCALCSIZE.
+  NcCalcSizePayload? get ncCalcSize =>
+      kind == WindowsMessagePayloadKind.ncCalcSize ? _data.ncCalcSize : null;
+
+  /// For WM_GETMINMAXINFO.
+  MinMaxInfoPayload? get minMaxInfo =>
+      kind == WindowsMessagePayloadKind.getMinMaxInfo ? _data.minMaxInfo : null;
+
+  /// For WM_DPICHANGED.
+  DpiChangedPayload? get dpiChanged =>
+      kind == WindowsMessagePayloadKind.dpiChanged ? _data.dpiChanged : null;
+
+  /// For WM_SETTINGCHANGE.
+  SettingChangePayload? get settingChange =>
+      kind == WindowsMessagePayloadKind.settingChange
+      ? _data.settingChange
+      : null;
+}
+
+WindowsMessagePayload? _current;
+
+/// The decoded lParam of the message the running delegate was called with,
+/// or null outside a delegate or for messages without a payload.
+///
+/// ```dart
+/// registerWindowProcDelegate((hwnd, message, wParam, lParam) {
+///   final info = currentWindowsMessagePayload?.minMaxInfo;
+///   if (info == null) return null;
+///   info.minTrackSize
+///     ..x = 640
+///     ..y = 480;
+///   return 0;
+/// }, filter: const WindowsMessageFilter(messages: [0x0024]));
+/// ```
+///
+/// The payload lives in native memory owned by the window procedure and is
+/// only valid until the delegate returns.
+WindowsMessagePayload? get currentWindowsMessagePayload => _current;
+
+/// Sets the payload returned by [currentWindowsMessagePayload] and returns
+/// the previous one, to be restored when the dispatch ends.
+WindowsMessagePayload? swapCurrentWindowsMessagePayload(
+  WindowsMessagePayload? payload,
+) {
+  final previous = _current;
+  _current = payload;
+  return previous;
+}
@@ -0,0 +1,153 @@
+import 'dart:async';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:flutter/scheduler.dart';
+
+import 'window_proc_delegate_internal.dart' as internal;
+import 'window_proc_observer.dart';
+import 'windows_message_filter.dart';
+
+/// What a full [WindowsMessageRing] does with a new message.
+///
+/// The values match RingDropPolicy in windows/core/spsc_ring.h.
+enum WindowsMessageDropPolicy {
+  /// Discard the new message.
+  dropNewest,
+
+  /// Discard the oldest undelivered message to make room.
+  dropOldest,
+}
+
+/// Observes window messages through a fixed-capacity ring shared with
+/// native code, drained once per frame.
+///
+/// This is a zero-copy alternative to [observeWindowProcMessages]: the
+/// window procedure appends matching messages to a single-producer,
+/// single-consumer ring in native memory, and Dart reads them in place from
+/// a [SchedulerBinding] frame callback. Messages that arrive while the ring
+/// is full are dropped according to [dropPolicy] and counted in
+/// [droppedNewest] and [droppedOldest].
+///
+/// The native ring is created when [messages] is listened to and released
+/// from the window procedure when the subscription is cancelled.
+class WindowsMessageRing {
+  WindowsMessageRing(
+    this.filter, {
+    this.capacity = 1024,
+    this.dropPolicy = WindowsMessageDropPolicy.dropOldest,
+  }) {
+    _controller = StreamController<List<ObservedWindowsMessage>>(
+      onListen: _start,
+      onCancel: _stop,
+    );
+  }
+
+  /// The messages appended to the ring.
+  final WindowsMessageFilter filter;
+
+  /// Requested ring capacity, rounded up natively to a power of two.
+  final int capacity;
+
+  /// What happens to messages that arrive while the ring is full.
+  final WindowsMessageDropPolicy dropPolicy;
+
+  late final StreamController<List<ObservedWindowsMessage>> _controller;
+  RawReceivePort? _wakePort;
+  internal.RingObserverHandle? _handle;
+  Int64List? _records;
+  int _mask = 0;
+  bool _drainScheduled = false;
+  bool _stopped = false;
+  final Int64List _range = Int64List(2);
+  final Int64List _dropCounts = Int64List(2);
+
+  /// The messages drained from the ring, one list per frame.
+  Stream<List<ObservedWindowsMessage>> get messages => _controller.stream;
+
+  /// Number of messages discarded because the ring was full, with
+  /// [WindowsMessageDropPolicy.dropNewest].
+  int get droppedNewest => _readDropCounts()[0];
+
+  /// Number of undelivered messages discarded to make room, with
+  /// [WindowsMessageDropPolicy.dropOldest].
+  int get droppedOldest => _readDropCounts()[1];
+
+  Int64List _readDropCounts() {
+    final handle = _handle;
+    if (handle != null) {
+      internal.ringDropCounts(handle.ring, _dropCounts.address);
+    }
+    return _dropCounts;
+  }
+
+  Future<void> _start() async {
+    _wakePort = RawReceivePort(
+      (Object? _) => _scheduleDrain(),
+      'window_proc_delegate ring',
+    );
+    await internal.ensureInitializeEngineId();
+    if (_stopped) return;
+
+    final handle = internal.addRingObserver(
+      _wakePort!.sendPort.nativePort,
+      filter.toRanges().toList(),
+      capacity,
+      dropPolicy.index,
+    );
+    if (handle == null) return;
+    final ringCapacity = internal.ringCapacity(handle.ring);
+    _mask = ringCapacity - 1;
+    _records = internal
+        .ringRecords(handle.ring)
+        .asTypedList(ringCapacity * observedMessageFields);
+    _handle = handle;
+  }
+
+  void _stop() {
+    _stopped = true;
+    final handle = _handle;
+    if (handle != null) {
+      internal.removeObserver(handle.observerId);
+    }
+    _handle = null;
+    _records = null;
+    _wakePort?.close();
+  }
+
+  void _scheduleDrain() {
+    if (_drainScheduled || _stopped) return;
+    _drainScheduled = true;
+    SchedulerBinding.instance.scheduleFrameCallback((_) => _drain());
+  }
+
+  void _drain() {
+    _drainScheduled = false;
+    final handle = _handle;
+    final records = _records;
+    if (handle == null || records == null) return;
+
+    internal.ringBeginRead(handle.ring, _range.address);
+    final begin = _range[0];
+    final count = _range[1] - begin;
+    final messages = List<ObservedWindowsMessage>.generate(count, (i) {
+      final offset = ((begin + i) & _mask) * observedMessageFields;
+      return ObservedWindowsMessage(
+        records[offset],
+        records[offset + 1],
+        records[offset + 2],
+        records[offset + 3],
+        records[offset + 4],
+      );
+    });
+    // Records overwritten while they were being read are discarded.
+    final overwritten = internal.ringEndRead(handle.ring, begin, count);
+    if (overwritten < messages.length) {
+      _controller.add(messages.sublist(overwritten));
+    }
+
+    if (internal.ringFinishDrain(handle.ring)) {
+      _scheduleDrain();
+    }
+  }
+}
@@ -0,0 +1,179 @@
+import 'dart:async';
+import 'dart:ffi' as ffi;
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:flutter/scheduler.dart';
+
+import 'window_proc_delegate_internal.dart' as internal;
+
+/// The raw input of one mouse between two button transitions, within one
+/// frame.
+///
+/// Mirrors RawMouseRecord in windows/core/raw_input.h.
+class WindowsRawMouseRecord {
+  const WindowsRawMouseRecord(
+    this.device,
+    this.firstTimestamp,
+    this.lastTimestamp,
+    this.reports,
+    this.x,
+    this.y,
+    this.wheel,
+    this.horizontalWheel,
+    this.flags,
+  );
+
+  /// Bit of [flags] set when [x] and [y] are absolute coordinates.
+  static const absoluteFlag = 1 << 16;
+
+  /// The device handle (`RAWINPUTHEADER.hDevice`).
+  final int device;
+
+  /// When the first and last reports were read, in monotonic nanoseconds
+  /// (`QueryPerformanceCounter`).
+  final int firstTimestamp;
+  final int lastTimestamp;
+
+  /// Number of reports merged into this record.
+  final int reports;
+
+  /// Sum of the motion deltas, or the last position if [absolute].
+  final int x;
+  final int y;
+
+  /// Sums of the wheel deltas, in `WHEEL_DELTA` (120) units.
+  final int wheel;
+  final int horizontalWheel;
+
+  /// The `RI_MOUSE_*_DOWN`/`UP` button transitions of the last report, and
+  /// [absoluteFlag].
+  final int flags;
+
+  /// The button transitions that ended this record, if any.
+  int get buttonTransitions => flags & 0x03FF;
+
+  bool get absolute => flags & absoluteFlag != 0;
+
+  @override
+  String toString() =>
+      'WindowsRawMouseRecord(device: 0x${device.toRadixString(16)}, '
+      'reports: $reports, x: $x, y: $y, wheel: $wheel, '
+      'horizontalWheel: $horizontalWheel, '
+      'buttons: 0x${buttonTransitions.toRadixString(16)})';
+}
+
+/// Receives the raw input of every mouse (`WM_INPUT`) in per-frame
+/// batches, for high-polling-rate devices.
+///
+/// While [batches] is listened to, the plugin registers the mice for raw
+/// input on the engine's top-level window and reads each report natively.
+/// Reports of a device are merged into one record, summing motion and wheel
+/// deltas, until one with button transitions ends it, so clicks keep their
+/// place in the motion. Dart takes the batch once per frame from a
+/// [SchedulerBinding] frame callback; an 8 kHz mouse moving steadily costs
+/// one record per frame. Reports that find the batch full are dropped and
+/// counted in [dropped].
+///
+/// Mouse `WM_INPUT` messages no longer reach delegates and observers. Raw
+/// input is registered per process, so only one engine receives it, and
+/// only while its window is in the foreground. Only one instance can listen
+/// per engine at a time; the stream of another reports a [StateError].
+class WindowsRawMouseInput {
+  WindowsRawMouseInput({this.capacity = 256}) {
+    _controller = StreamController<List<WindowsRawMouseRecord>>(
+      onListen: _start,
+      onCancel: _stop,
+    );
+  }
+
+  /// Maximum number of records in a batch.
+  final int capacity;
+
+  late final StreamController<List<WindowsRawMouseRecord>> _controller;
+  RawReceivePort? _wakePort;
+  ffi.Pointer<ffi.Void>? _accumulator;
+  Int64List? _records;
+  bool _takeScheduled = false;
+  bool _stopped = false;
+
+  /// The records of each frame.
+  Stream<List<WindowsRawMouseRecord>> get batches => _controller.stream;
+
+  /// Number of reports dropped because the batch was full.
+  int get dropped {
+    final accumulator = _accumulator;
+    return accumulator == null ? 0 : internal.rawInputDropped(accumulator);
+  }
+
+  Future<void> _start() async {
+    _wakePort = RawReceivePort(
+      (Object? _) => _scheduleTake(),
+      'window_proc_delegate raw input',
+    );
+    await internal.ensureInitializeEngineId();
+    if (_stopped) return;
+
+    // Taking writes up to the native capacity, so both must agree.
+    final records = capacity < 1 ? 1 : capacity;
+    final accumulator = internal.startRawInput(
+      _wakePort!.sendPort.nativePort,
+      records,
+    );
+    if (accumulator == null) {
+      _controller.addError(
+        StateError(
+          'Raw mouse input could not be started: another '
+          'WindowsRawMouseInput is listening on this engine, or the mice '
+          'could not be registered',
+        ),
+      );
+      return;
+    }
+    _records = Int64List(records * internal.rawMouseRecordFields);
+    _accumulator = accumulator;
+  }
+
+  void _stop() {
+    _stopped = true;
+    final accumulator = _accumulator;
+    if (accumulator != null) {
+      internal.stopRawInput(accumulator);
+    }
+    _accumulator = null;
+    _records = null;
+    _wakePort?.close();
+  }
+
+  void _scheduleTake() {
+    if (_takeScheduled || _stopped) return;
+    _takeScheduled = true;
+    SchedulerBinding.instance.scheduleFrameCallback((_) => _take());
+  }
+
+  void _take() {
+    _takeScheduled = false;
+    final accumulator = _accumulator;
+    final records = _records;
+    if (accumulator == null || records == null) return;
+
+    final count = internal.takeRawInput(accumulator, records);
+    if (count == 0) return;
+    _controller.add(
+      List<WindowsRawMouseRecord>.generate(count, (i) {
+        final offset = i * internal.rawMouseRecordFields;
+        return WindowsRawMouseRecord(
+          records[offset],
+          records[offset + 1],
+          records[offset + 2],
+          records[offset + 3],
+          records[offset + 4],
+          records[offset + 5],
+          records[offset + 6],
+          records[offset + 7],
+          records[offset + 8],
+        );
+      }),
+    );
+  }
+}
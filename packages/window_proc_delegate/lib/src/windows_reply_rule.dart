@@ -0,0 +1,116 @@
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+
+/// What a [WindowsReplyRule] does with a matching message.
+class WindowsReplyAction {
+  /// Returns [result] from the window procedure.
+  const WindowsReplyAction.reply(this.result) : _kind = 0, fields = const {};
+
+  /// Writes each int32 value of [fields] at its byte offset into the struct
+  /// lParam points to, then returns [result]. For example, to set the
+  /// minimum track size of WM_GETMINMAXINFO to 640x480:
+  ///
+  /// ```dart
+  /// WindowsReplyAction.writeFields({24: 640, 28: 480})
+  /// ```
+  const WindowsReplyAction.writeFields(this.fields, {this.result = 0})
+    : _kind = 1;
+
+  /// Stops evaluating rules and delivers the message to the registered
+  /// delegates. Use it ahead of a broader rule to exempt some messages.
+  const WindowsReplyAction.forwardToDart()
+    : _kind = 2,
+      result = 0,
+      fields = const {};
+
+  final int _kind;
+
+  /// The value returned from the window procedure.
+  final int result;
+
+  /// Byte offsets into the lParam struct and the int32 values written there.
+  final Map<int, int> fields;
+}
+
+/// A message interception answered natively, without calling into Dart.
+///
+/// A rule matches messages with identifier [message], sent to [hwnd] (or to
+/// any window if null), whose wParam and lParam equal [wParamValue] and
+/// [lParamValue] in the bits set in [wParamMask] and [lParamMask]. For
+/// example, to swallow the menu activation triggered by the Alt key:
+///
+/// ```dart
+/// WindowsReplyRule(
+///   message: 0x0112, // WM_SYSCOMMAND
+///   wParamMask: 0xFFF0,
+///   wParamValue: 0xF100, // SC_KEYMENU
+///   action: WindowsReplyAction.reply(0),
+/// )
+/// ```
+class WindowsReplyRule {
+  const WindowsReplyRule({
+    required this.message,
+    required this.action,
+    this.hwnd,
+    this.wParamMask = 0,
+    this.wParamValue = 0,
+    this.lParamMask = 0,
+    this.lParamValue = 0,
+  });
+
+  final int message;
+  final int? hwnd;
+  final int wParamMask;
+  final int wParamValue;
+  final int lParamMask;
+  final int lParamValue;
+  final WindowsReplyAction action;
+}
+
+/// Replaces the rules answered natively for the current engine.
+///
+/// Rules are evaluated before any delegate, so each matching message saves a
+/// round trip into Dart. For each message, rules are tried in list order and
+/// the first match decides; messages no rule matches are delivered to the
+/// delegates as usual. Passing an empty list removes the rules.
+///
+/// Throws an [ArgumentError] if a rule can never match or writes outside the
+/// lParam struct. Returns false if the plugin is not available for the
+/// current engine.
+Future<bool> setWindowsReplyRules(List<WindowsReplyRule> rules) async {
+  final program = <int>[];
+  for (final rule in rules) {
+    if (rule.message < 0 || rule.message > 0xFFFF) {
+      throw ArgumentError.value(rule.message, 'message', 'Not a message ID');
+    }
+    if (rule.wParamValue & ~rule.wParamMask != 0 ||
+        rule.lParamValue & ~rule.lParamMask != 0) {
+      throw ArgumentError('Rule values must lie within their masks');
+    }
+    for (final offset in rule.action.fields.keys) {
+      // Mirrors ReplyRuleTable::kMaxWriteExtent.
+      if (offset < 0 || offset + 4 > 4096) {
+        throw ArgumentError.value(offset, 'offset', 'Out of range');
+      }
+    }
+    program
+      ..add(rule.message)
+      ..add(rule.hwnd ?? 0)
+      ..add(rule.wParamMask)
+      ..add(rule.wParamValue)
+      ..add(rule.lParamMask)
+      ..add(rule.lParamValue)
+      ..add(rule.action._kind)
+      ..add(rule.action.result)
+      ..add(rule.action.fields.length);
+    for (final field in rule.action.fields.entries) {
+      program
+        ..add(field.key)
+        ..add(field.value);
+    }
+  }
+
+  await internal.ensureInitializeEngineId();
+  return internal.setReplyRules(Int64List.fromList(program));
+}
@@ -0,0 +1,144 @@
+import 'dart:ffi' as ffi;
+import 'dart:typed_data';
+
+import 'window_proc_delegate_internal.dart' as internal;
+
+// Word indices of a state block: the sequence counter, then the fields of
+// WindowState in windows/core/window_state.h.
+const int _sequence = 0;
+const int _window = 1;
+const int _x = 2;
+const int _y = 3;
+const int _width = 4;
+const int _height = 5;
+const int _dpi = 6;
+const int _flags = 7;
+const int _monitor = 8;
+const int _blockWords = 9;
+
+// WindowStateFlag bits.
+const int _active = 1 << 0;
+const int _minimized = 1 << 1;
+const int _maximized = 1 << 2;
+
+/// A consistent copy of a window's cached state.
+class WindowsWindowState {
+  const WindowsWindowState({
+    required this.hwnd,
+    required this.x,
+    required this.y,
+    required this.width,
+    required this.height,
+    required this.dpi,
+    required this.active,
+    required this.minimized,
+    required this.maximized,
+    required this.monitor,
+    required this.generation,
+  });
+
+  /// Handle to the window
+  final int hwnd;
+
+  /// Client area origin in screen coordinates
+  final int x;
+  final int y;
+
+  /// Client area size in physical pixels, kept from before minimizing while
+  /// the window is minimized
+  final int width;
+  final int height;
+
+  /// The window's DPI; 96 is 100% scaling
+  final int dpi;
+
+  /// Whether the window is the active top-level window
+  final bool active;
+  final bool minimized;
+  final bool maximized;
+
+  /// Handle to the monitor with the largest part of the window
+  final int monitor;
+
+  /// The [WindowsWindowStateView.generation] this copy was taken at
+  final int generation;
+
+  @override
+  String toString() =>
+      'WindowsWindowState(hwnd: $hwnd, x: $x, y: $y, width: $width, '
+      'height: $height, dpi: $dpi, active: $active, minimized: $minimized, '
+      'maximized: $maximized, monitor: $monitor)';
+}
+
+/// A window's state, cached in native memory and kept current by the
+/// window procedure as WM_MOVE, WM_SIZE, WM_ACTIVATE, WM_DPICHANGED and
+/// WM_DISPLAYCHANGE arrive.
+///
+/// Reads need neither a method channel nor a delegate. [generation] is a
+/// single load from the shared block and changes whenever the state does,
+/// so polling it every frame is cheap:
+///
+/// ```dart
+/// final view = await watchWindowsWindowState(hwnd);
+/// var seen = -1;
+/// // Each frame:
+/// if (view!.generation != seen) {
+///   final state = view.read();
+///   seen = state.generation;
+///   relayout(state.width, state.height, state.dpi);
+/// }
+/// ```
+class WindowsWindowStateView {
+  WindowsWindowStateView._(this._block)
+    : _words = _block.asTypedList(_blockWords);
+
+  final ffi.Pointer<ffi.Int64> _block;
+  final Int64List _words;
+
+  // Reused by read(); the copy is made natively into it.
+  static final Int64List _copy = Int64List(_blockWords - 1);
+
+  /// Handle to the window
+  int get hwnd => _words[_window];
+
+  /// Increases whenever the cached state changes.
+  int get generation => _words[_sequence] >> 1;
+
+  /// Returns a consistent copy of the state.
+  ///
+  /// The block is updated by the window thread while Dart reads it, so the
+  /// copy is taken by a leaf call that validates it against the block's
+  /// sequence counter and retries torn reads. It runs on the calling
+  /// thread, without a round trip.
+  WindowsWindowState read() {
+    final sequence = internal.readWindowState(_block, _copy);
+    final flags = _copy[_flags - 1];
+    return WindowsWindowState(
+      hwnd: _copy[_window - 1],
+      x: _copy[_x - 1],
+      y: _copy[_y - 1],
+      width: _copy[_width - 1],
+      height: _copy[_height - 1],
+      dpi: _copy[_dpi - 1],
+      active: flags & _active != 0,
+      minimized: flags & _minimized != 0,
+      maximized: flags & _maximized != 0,
+      monitor: _copy[_monitor - 1],
+      generation: sequence >> 1,
+    );
+  }
+}
+
+/// Starts caching the state of top-level window [hwnd] natively and
+/// returns a view of it, or null if the plugin is not available for the
+/// current engine.
+///
+/// The cache is seeded from the window when it is first watched and lives
+/// as long as the engine; watching the same window again returns a view of
+/// the same block.
+Future<WindowsWindowStateView?> watchWindowsWindowState(int hwnd) async {
+  await internal.ensureInitializeEngineId();
+  final block = internal.watchWindowState(hwnd);
+  if (block == ffi.nullptr) return null;
+  return WindowsWindowStateView._(block);
+}
@@ -1,65 +1,230 @@
 import 'dart:ffi' as ffi;
+import 'dart:typed_data';
+import 'src/window_proc_observer.dart';
+import 'src/window_proc_watchdog.dart';
+import 'src/windows_copy_data.dart';
 import 'src/windows_message.dart';
+import 'src/windows_message_payload.dart';
+import 'src/windows_message_filter.dart';
 import 'src/window_proc_delegate_internal.dart' as internal;
+import 'src/window_proc_delegates.dart';
 
 export 'src/window_proc_delegate_internal.dart' show ensureInitializeEngineId;
+export 'src/window_proc_delegates.dart' show WindowProcDelegateCallback;
+export 'src/window_hit_test.dart';
+export 'src/window_proc_latency.dart';
+export 'src/window_proc_timeline.dart';
+export 'src/window_proc_trace.dart';
+export 'src/window_proc_observer.dart'
+    hide decodeObservedMessages, observedMessageFields;
+export 'src/window_proc_watchdog.dart' hide reportDemotion;
+export 'src/window_proc_worker.dart';
+export 'src/windows_broadcast.dart';
+export 'src/windows_copy_data.dart';
+export 'src/windows_keyboard_chord.dart';
+export 'src/windows_message_filter.dart';
+export 'src/windows_message_payload.dart'
+    hide swapCurrentWindowsMessagePayload, windowsMessagePayloadVersion;
+export 'src/windows_message_ring.dart';
+export 'src/windows_raw_input.dart';
+export 'src/windows_reply_rule.dart';
+export 'src/windows_window_state.dart';
 
-/// Signature for a WindowProc delegate callback.
+/// Register a WindowProc delegate.
 ///
-/// The callback receives the window message parameters:
-/// - [hwnd]: Handle to the window
-/// - [message]: The message identifier (WM_* constant)
-/// - [wParam]: Additional message-specific information
-/// - [lParam]: Additional message-specific information
+/// The delegate will be called for each WindowProc message accepted by
+/// [filter], or for every message if [filter] is null. Filters are kept
+/// natively: messages that no registered delegate is interested in never
+/// enter Dart, and each message that does is only passed to the delegates
+/// subscribed to it, so passing a filter is strongly recommended.
 ///
-/// Returns the result value if the message was handled, or null to let other
-/// delegates process the message.
-typedef WindowProcDelegateCallback =
-    int? Function(int hwnd, int message, int wParam, int lParam);
-
-final List<WindowProcDelegateCallback?> _delegates = [];
+/// Delegates with a higher [priority] are called first; delegates of equal
+/// priority are called in registration order.
+///
+/// While [WindowProcWatchdog] has a budget set, a delegate that keeps
+/// running over it without handling its messages is demoted to receiving
+/// them asynchronously, unless [allowDemotion] is false.
+///
+/// Returns an ID that can be used to unregister the delegate. IDs of
+/// unregistered delegates are reused, but a stale ID never matches the
+/// delegate that reuses it.
+int registerWindowProcDelegate(
+  WindowProcDelegateCallback delegate, {
+  WindowsMessageFilter? filter,
+  int priority = 0,
+  bool allowDemotion = true,
+}) {
+  return _register(
+    (msg) => delegate(msg.windowHandle, msg.message, msg.wParam, msg.lParam),
+    filter,
+    priority,
+    allowDemotion
+        ? (msg) => delegate(msg.hwnd, msg.message, msg.wParam, msg.lParam)
+        : null,
+  );
+}
 
-/// Register a WindowProc delegate.
+/// Register a delegate for the WM_COPYDATA messages sent to any window of
+/// this engine.
+///
+/// The COPYDATASTRUCT is decoded natively: [delegate] receives the window
+/// handle, the `dwData` tag and the payload. The payload is a view of the
+/// sender's buffer, not a copy, so it is only valid until [delegate]
+/// returns; copy whatever has to outlive the call. To process payloads
+/// later, or off the window procedure, use [observeWindowsCopyData].
 ///
-/// The delegate will be called for each WindowProc message.
-/// Returns an ID that can be used to unregister the delegate.
-int registerWindowProcDelegate(WindowProcDelegateCallback delegate) {
-  internal.initialize(_delegates, _handleWindowProc);
+/// [priority] and the returned ID work as in [registerWindowProcDelegate].
+int registerCopyDataDelegate(
+  WindowsCopyDataDelegate delegate, {
+  int priority = 0,
+}) {
+  return _register(
+    (msg) {
+      final length = msg.copyDataLength;
+      if (length < 0) return null;
+      final data = length == 0
+          ? Uint8List(0)
+          : msg.copyData.asTypedList(length);
+      return delegate(msg.windowHandle, msg.copyDataTag, data);
+    },
+    const WindowsMessageFilter(messages: [wmCopyData]),
+    priority,
+  );
+}
 
-  _delegates.add(delegate);
-  return _delegates.length - 1;
+int _register(
+  DelegateHandler handler,
+  WindowsMessageFilter? filter,
+  int priority, [
+  DemotedDelegateHandler? onObserved,
+]) {
+  final entry = DelegateEntry(handler, filter, priority, onObserved);
+  final id = delegates.add(entry);
+  internal.resetDelegateLatency(entry.slot);
+  internal.resetDelegateWatchdog(entry.slot, onObserved == null);
+  _updateRoutes();
+  if (delegates.entries.length == 1) {
+    internal.attachCallback(_handleWindowProc);
+  }
+  return id;
 }
 
 /// Unregister a WindowProc delegate by its ID.
+///
+/// Once the last delegate is unregistered, the native callback is detached
+/// and window messages no longer enter Dart until a delegate registers
+/// again.
 void unregisterWindowProcDelegate(int id) {
-  if (id >= 0 && id < _delegates.length) {
-    _delegates[id] = null; // Replace with null
+  final entry = delegates.remove(id);
+  if (entry == null) return;
+
+  entry.demotion?.cancel();
+  _updateRoutes();
+  if (delegates.isEmpty) {
+    internal.detachCallback();
   }
+}
 
-  // If all delegates are removed, clear the native callback
-  if (_delegates.every((d) => d == null)) {
-    _delegates.clear();
+/// Pushes the filter of every synchronous delegate, in call order, to the
+/// native side.
+void _updateRoutes() {
+  final program = <int>[];
+  for (final entry in delegates.entries) {
+    if (entry.demoted) continue;
+    program.add(entry.slot);
+    final filter = entry.filter;
+    if (filter == null) {
+      program.add(internal.allMessages);
+      continue;
+    }
+    final ranges = filter.toRanges().toList();
+    program.add(ranges.length);
+    for (final range in ranges) {
+      program
+        ..add(range.first)
+        ..add(range.last);
+    }
   }
+  internal.setDelegateRoutes(Uint32List.fromList(program));
 }
 
 void _handleWindowProc(ffi.Pointer<WindowsMessage> message) {
   final msg = message.ref;
+  final previous = swapCurrentWindowsMessagePayload(msg.payload);
+  try {
+    _dispatch(msg);
+  } finally {
+    swapCurrentWindowsMessagePayload(previous);
+  }
+}
 
-  // Call each delegate until one handles the message
-  for (final delegate in _delegates) {
-    if (delegate != null) {
-      final result = delegate(
-        msg.windowHandle,
-        msg.message,
-        msg.wParam,
-        msg.lParam,
-      );
-      // If any delegate returns a non-null result, the message is handled
-      if (result != null) {
-        msg.lResult = result;
-        msg.handled = true;
-        return;
-      }
+void _dispatch(WindowsMessage msg) {
+  final count = msg.candidateCount;
+
+  // Call each subscribed delegate until one handles the message. Delegates
+  // registered or unregistered by a callback take effect from the next
+  // message.
+  if (count < 0) {
+    for (final entry in delegates.entries) {
+      if (entry.demoted) continue;
+      final filter = entry.filter;
+      if (filter != null && !filter.accepts(msg.message)) continue;
+      if (_callDelegate(entry, msg)) return;
     }
+    return;
+  }
+  final candidates = msg.candidates;
+  for (var i = 0; i < count; i++) {
+    final entry = delegates.entryAt(candidates[i]);
+    if (entry != null && !entry.demoted && _callDelegate(entry, msg)) return;
   }
 }
+
+/// Calls [entry] with [msg]. Returns true if it handled the message.
+bool _callDelegate(DelegateEntry entry, WindowsMessage msg) {
+  final measured = internal.latencyTrackingEnabled;
+  final watched = internal.watchdogEnabled;
+  // Each call has its own stopwatch: a delegate that pumps messages
+  // re-enters here before it returns.
+  final stopwatch = measured || watched ? (Stopwatch()..start()) : null;
+  final result = entry.handler(msg);
+  if (stopwatch != null) {
+    final nanoseconds =
+        stopwatch.elapsedTicks * 1000000000 ~/ Stopwatch.frequency;
+    if (measured) {
+      internal.recordDelegateLatency(entry.slot, msg.message, nanoseconds);
+    }
+    if (watched &&
+        internal.recordDelegateTime(
+          entry.slot,
+          msg.message,
+          nanoseconds,
+          result != null,
+        )) {
+      _demote(entry);
+    }
+  }
+  // If any delegate returns a non-null result, the message is handled
+  if (result == null) return false;
+  msg.lResult = result;
+  msg.handled = true;
+  return true;
+}
+
+/// Moves [entry] from the window procedure to an observer of its messages.
+/// The routes change from the next message.
+void _demote(DelegateEntry entry) {
+  final onObserved = entry.onObserved;
+  if (onObserved == null || entry.demoted) return;
+
+  entry.demoted = true;
+  _updateRoutes();
+  entry.demotion = observeWindowProcMessages(
+    entry.filter ?? _everyMessage,
+  ).listen(onObserved);
+  reportDemotion(entry);
+}
+
+const _everyMessage = WindowsMessageFilter(
+  ranges: [WindowsMessageRange(0, internal.allMessages)],
+);
@@ -0,0 +1,152 @@
+#include "broadcast_hub.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "message_observer.h"
+
+namespace window_proc_delegate {
+
+namespace {
+
+void PostNull(Dart_Port_DL port) {
+  Dart_CObject closed;
+  closed.type = Dart_CObject_kNull;
+  Dart_PostCObject_DL(port, &closed);
+}
+
+}  // namespace
+
+BroadcastHub::BroadcastHub(Clock clock) : clock_(clock) {}
+
+BroadcastHub::~BroadcastHub() {
+  for (const Subscriber& subscriber : subscribers_) {
+    PostNull(subscriber.port);
+  }
+}
+
+// static
+uint64_t BroadcastHub::SteadyNanoseconds() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+int64_t BroadcastHub::Subscribe(Dart_Port_DL port,
+                                std::shared_ptr<const MessageFilter> filter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t id = next_id_++;
+  subscribers_.push_back({id, port, std::move(filter)});
+  UpdateFilterLocked();
+  return id;
+}
+
+bool BroadcastHub::Unsubscribe(int64_t id) {
+  Dart_Port_DL port;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(
+        subscribers_.begin(), subscribers_.end(),
+        [id](const Subscriber& subscriber) { return subscriber.id == id; });
+    if (it == subscribers_.end()) {
+      return false;
+    }
+    port = it->port;
+    subscribers_.erase(it);
+    UpdateFilterLocked();
+  }
+  // Posted after releasing the lock, so the VM is never entered with it held.
+  PostNull(port);
+  return true;
+}
+
+std::shared_ptr<const MessageFilter> BroadcastHub::filter() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return filter_;
+}
+
+size_t BroadcastHub::subscriber_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return subscribers_.size();
+}
+
+void BroadcastHub::Publish(const WindowProcMessage& message) {
+  const uint64_t now_ns = clock_();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (IsDuplicateLocked(message, now_ns)) {
+    return;
+  }
+
+  const ObservedMessage record = {
+      static_cast<int64_t>(message.window),
+      static_cast<int64_t>(message.message),
+      static_cast<int64_t>(message.wparam), message.lparam, 1};
+  Dart_CObject posted;
+  posted.type = Dart_CObject_kTypedData;
+  posted.value.as_typed_data.type = Dart_TypedData_kInt64;
+  posted.value.as_typed_data.length = kObservedMessageFields;
+  posted.value.as_typed_data.values =
+      reinterpret_cast<const uint8_t*>(&record);
+
+  // Subscribers whose port closed, for instance because their isolate
+  // exited, are dropped. Dispatchers may keep publishing what only they
+  // were interested in until the filters are next pushed to them.
+  const size_t count = subscribers_.size();
+  subscribers_.erase(
+      std::remove_if(subscribers_.begin(), subscribers_.end(),
+                     [&](const Subscriber& subscriber) {
+                       return subscriber.filter->Accepts(message.message) &&
+                              !Dart_PostCObject_DL(subscriber.port, &posted);
+                     }),
+      subscribers_.end());
+  if (subscribers_.size() != count) {
+    UpdateFilterLocked();
+  }
+}
+
+bool BroadcastHub::IsDuplicateLocked(const WindowProcMessage& message,
+                                     uint64_t now_ns) {
+  recent_.erase(std::remove_if(recent_.begin(), recent_.end(),
+                               [&](const Recent& recent) {
+                                 return now_ns - recent.posted_ns >=
+                                        kDedupWindowNs;
+                               }),
+                recent_.end());
+  for (Recent& recent : recent_) {
+    if (recent.message != message.message ||
+        recent.wparam != message.wparam || recent.lparam != message.lparam) {
+      continue;
+    }
+    if (std::find(recent.windows.begin(), recent.windows.end(),
+                  message.window) == recent.windows.end()) {
+      recent.windows.push_back(message.window);
+      return true;
+    }
+    // The window already had this one: it is a new broadcast.
+    recent.posted_ns = now_ns;
+    recent.windows.assign(1, message.window);
+    return false;
+  }
+  if (recent_.size() == kMaxRecent) {
+    recent_.erase(recent_.begin());
+  }
+  recent_.push_back({message.message, message.wparam, message.lparam, now_ns,
+                     {message.window}});
+  return false;
+}
+
+void BroadcastHub::UpdateFilterLocked() {
+  if (subscribers_.empty()) {
+    filter_ = nullptr;
+    return;
+  }
+  std::vector<const MessageFilter*> filters;
+  filters.reserve(subscribers_.size());
+  for (const Subscriber& subscriber : subscribers_) {
+    filters.push_back(subscriber.filter.get());
+  }
+  filter_ = MessageFilter::Union(filters.data(), filters.size());
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,97 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_BROADCAST_HUB_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_BROADCAST_HUB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../dart/dart_api_dl.h"
+#include "message_filter.h"
+#include "window_proc_registrar.h"
+
+namespace window_proc_delegate {
+
+// Process-wide fan-out of system messages, such as WM_POWERBROADCAST or
+// WM_SETTINGCHANGE, that every top-level window receives.
+//
+// Each engine's dispatcher publishes the messages the subscribers' filters
+// accept; the hub posts each to every interested subscriber's port as an
+// ObservedMessage record, so observing engines never run Dart inside a
+// window procedure. A message that reaches several windows is posted once:
+// the same (message, wParam, lParam) from another window within
+// kDedupWindowNs is a copy of the same broadcast, while a repeat on a window
+// that already had it is a new one.
+//
+// All methods are thread-safe. Like observers, a subscription posts null as
+// its last message when it ends.
+class BroadcastHub {
+ public:
+  using Clock = uint64_t (*)();
+
+  static constexpr uint64_t kDedupWindowNs = 100000000;  // 100 ms.
+  static constexpr size_t kMaxRecent = 16;
+
+  // |clock| is a monotonic clock in nanoseconds.
+  explicit BroadcastHub(Clock clock = &SteadyNanoseconds);
+  ~BroadcastHub();
+
+  // Disallow copy and assign.
+  BroadcastHub(const BroadcastHub&) = delete;
+  BroadcastHub& operator=(const BroadcastHub&) = delete;
+
+  static uint64_t SteadyNanoseconds();
+
+  // Returns the new subscription's ID.
+  int64_t Subscribe(Dart_Port_DL port,
+                    std::shared_ptr<const MessageFilter> filter);
+
+  // Returns false if |id| is not subscribed.
+  bool Unsubscribe(int64_t id);
+
+  // The union of the subscribers' filters, or null without subscribers.
+  std::shared_ptr<const MessageFilter> filter() const;
+
+  size_t subscriber_count() const;
+
+  // Posts |message| to its subscribers unless it duplicates a broadcast
+  // already posted from another window. Called from window procedures.
+  void Publish(const WindowProcMessage& message);
+
+ private:
+  struct Subscriber {
+    int64_t id;
+    Dart_Port_DL port;
+    std::shared_ptr<const MessageFilter> filter;
+  };
+
+  // A recently posted broadcast and the windows it reached.
+  struct Recent {
+    uint32_t message;
+    uint64_t wparam;
+    int64_t lparam;
+    uint64_t posted_ns;
+    std::vector<intptr_t> windows;
+  };
+
+  // Returns true if |message| was already posted from another window, and
+  // records it either way. Must be called with |mutex_| held.
+  bool IsDuplicateLocked(const WindowProcMessage& message, uint64_t now_ns);
+
+  // Recomputes |filter_|. Must be called with |mutex_| held.
+  void UpdateFilterLocked();
+
+  const Clock clock_;
+
+  // Guarded by |mutex_|.
+  int64_t next_id_ = 1;
+  std::vector<Subscriber> subscribers_;
+  std::shared_ptr<const MessageFilter> filter_;
+  std::vector<Recent> recent_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_BROADCAST_HUB_H_
@@ -0,0 +1,78 @@
+#include "buffer_pool.h"
+
+namespace window_proc_delegate {
+
+PooledBuffer::PooledBuffer(BufferPool* pool, size_t capacity)
+    : pool_(pool), capacity_(capacity), bytes_(new uint8_t[capacity]) {}
+
+void PooledBuffer::Release() {
+  pool_->Release(this);
+}
+
+BufferPool::BufferPool(size_t max_cached_bytes)
+    : max_cached_bytes_(max_cached_bytes) {}
+
+BufferPool::~BufferPool() {
+  for (auto& buffers : free_) {
+    for (PooledBuffer* buffer : buffers) {
+      delete buffer;
+    }
+  }
+}
+
+// static
+BufferPool& BufferPool::Global() {
+  static BufferPool* pool = new BufferPool();
+  return *pool;
+}
+
+// static
+size_t BufferPool::ClassOf(size_t size) {
+  size_t size_class = 0;
+  for (size_t capacity = kMinCapacity; capacity < size; capacity <<= 1) {
+    if (++size_class == kClassCount) {
+      break;
+    }
+  }
+  return size_class;
+}
+
+PooledBuffer* BufferPool::Acquire(size_t size) {
+  outstanding_.fetch_add(1, std::memory_order_relaxed);
+  const size_t size_class = ClassOf(size);
+  if (size_class == kClassCount) {
+    return new PooledBuffer(this, size);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& buffers = free_[size_class];
+    if (!buffers.empty()) {
+      PooledBuffer* buffer = buffers.back();
+      buffers.pop_back();
+      cached_bytes_ -= buffer->capacity();
+      return buffer;
+    }
+  }
+  return new PooledBuffer(this, kMinCapacity << size_class);
+}
+
+void BufferPool::Release(PooledBuffer* buffer) {
+  outstanding_.fetch_sub(1, std::memory_order_relaxed);
+  const size_t size_class = ClassOf(buffer->capacity());
+  if (size_class < kClassCount) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cached_bytes_ + buffer->capacity() <= max_cached_bytes_) {
+      cached_bytes_ += buffer->capacity();
+      free_[size_class].push_back(buffer);
+      return;
+    }
+  }
+  delete buffer;
+}
+
+size_t BufferPool::cached_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cached_bytes_;
+}
+
+}  // namespace window_proc_delegate
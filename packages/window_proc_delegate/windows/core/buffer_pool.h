@@ -0,0 +1,97 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_BUFFER_POOL_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_BUFFER_POOL_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace window_proc_delegate {
+
+class BufferPool;
+
+// A byte buffer borrowed from a BufferPool. Its capacity is the size class
+// it was allocated for, at least the size asked for.
+class PooledBuffer {
+ public:
+  // Disallow copy and assign.
+  PooledBuffer(const PooledBuffer&) = delete;
+  PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+  uint8_t* data() { return bytes_.get(); }
+  size_t capacity() const { return capacity_; }
+
+  // Returns this buffer to the pool it came from. May be called from any
+  // thread, for instance from a Dart finalizer.
+  void Release();
+
+ private:
+  friend class BufferPool;
+
+  PooledBuffer(BufferPool* pool, size_t capacity);
+
+  BufferPool* const pool_;
+  const size_t capacity_;
+  const std::unique_ptr<uint8_t[]> bytes_;
+};
+
+// Thread-safe pool of byte buffers in power-of-two size classes, for
+// payloads that are copied on the window thread and released whenever their
+// consumer is done with them.
+//
+// Released buffers are kept for reuse up to |max_cached_bytes| in total;
+// buffers above kMaxPooledCapacity are never kept. Every buffer must be
+// released before its pool is destroyed.
+class BufferPool {
+ public:
+  static constexpr size_t kMinCapacity = 4096;
+  static constexpr size_t kMaxPooledCapacity = size_t{16} << 20;
+
+  explicit BufferPool(size_t max_cached_bytes = size_t{64} << 20);
+  ~BufferPool();
+
+  // Disallow copy and assign.
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // The pool payloads posted to Dart are copied into. It is never
+  // destroyed, since Dart may release buffers after every engine is gone.
+  static BufferPool& Global();
+
+  // Returns a buffer of at least |size| bytes, reusing a released one of
+  // the same size class if possible.
+  PooledBuffer* Acquire(size_t size);
+
+  size_t cached_bytes() const;
+
+  // Number of buffers acquired and not yet released.
+  size_t outstanding() const {
+    return outstanding_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class PooledBuffer;
+
+  static constexpr size_t kClassCount = 13;  // 4 KiB to 16 MiB.
+
+  void Release(PooledBuffer* buffer);
+
+  // Returns the size class fitting |size|, or kClassCount if it is too
+  // large to pool.
+  static size_t ClassOf(size_t size);
+
+  const size_t max_cached_bytes_;
+  std::atomic<size_t> outstanding_{0};
+
+  // Guarded by |mutex_|.
+  size_t cached_bytes_ = 0;
+  std::array<std::vector<PooledBuffer*>, kClassCount> free_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_BUFFER_POOL_H_
@@ -0,0 +1,48 @@
+#include "chord_table.h"
+
+namespace window_proc_delegate {
+
+// static
+std::unique_ptr<ChordTable> ChordTable::Compile(const uint32_t* program,
+                                                size_t word_count) {
+  if (word_count % kChordWords != 0 ||
+      word_count / kChordWords > UINT16_MAX) {
+    return nullptr;
+  }
+  std::unique_ptr<ChordTable> table(new ChordTable());
+  // Chords by key and modifier combination; only the marked ones are set.
+  std::vector<ChordMatch> slots((kMaxVirtualKey + 1) << 4);
+  for (size_t i = 0; i < word_count; i += kChordWords) {
+    const uint32_t virtual_key = program[i + 1];
+    const uint32_t modifiers = program[i + 2];
+    const uint32_t flags = program[i + 3];
+    if (virtual_key > kMaxVirtualKey || (modifiers & ~kChordModifierMask) ||
+        (flags & ~kChordFlagMask)) {
+      return nullptr;
+    }
+    const uint32_t bit = 1u << modifiers;
+    if (table->combinations_[virtual_key] & bit) {
+      return nullptr;
+    }
+    table->combinations_[virtual_key] =
+        static_cast<uint16_t>(table->combinations_[virtual_key] | bit);
+    slots[virtual_key << 4 | modifiers] = {static_cast<int32_t>(program[i]),
+                                           flags};
+  }
+
+  table->chords_.reserve(word_count / kChordWords);
+  for (uint32_t virtual_key = 0; virtual_key <= kMaxVirtualKey;
+       virtual_key++) {
+    table->first_[virtual_key] =
+        static_cast<uint16_t>(table->chords_.size());
+    for (uint32_t modifiers = 0; modifiers <= kChordModifierMask;
+         modifiers++) {
+      if (table->combinations_[virtual_key] & (1u << modifiers)) {
+        table->chords_.push_back(slots[virtual_key << 4 | modifiers]);
+      }
+    }
+  }
+  return table;
+}
+
+}  // namespace window_proc_delegate
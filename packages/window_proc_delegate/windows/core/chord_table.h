@@ -0,0 +1,99 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_CHORD_TABLE_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_CHORD_TABLE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace window_proc_delegate {
+
+// Modifier keys held with a chord's key, as reported by
+// WindowProcRegistrar::ModifierState().
+enum ChordModifier : uint32_t {
+  kChordShift = 1 << 0,
+  kChordControl = 1 << 1,
+  kChordAlt = 1 << 2,
+  kChordWin = 1 << 3,
+};
+
+constexpr uint32_t kChordModifierMask = 0xF;
+
+enum ChordFlag : uint32_t {
+  // Autorepeated key presses neither reach Dart nor count as a new press.
+  kChordSuppressRepeat = 1 << 0,
+  // The key press is consumed natively instead of reaching the window.
+  kChordConsume = 1 << 1,
+};
+
+constexpr uint32_t kChordFlagMask = kChordSuppressRepeat | kChordConsume;
+
+struct ChordMatch {
+  int32_t id;
+  uint32_t flags;
+};
+
+// Immutable set of keyboard chords, each a virtual key held with an exact
+// set of modifiers.
+//
+// Lookups cost two table loads and a population count: for each virtual
+// key, a 16-bit mask records which modifier combinations have a chord, and
+// the chords are stored by key, then combination, so the rank of a
+// combination in the mask is its index among the key's chords.
+//
+// Programs are flat arrays of uint32 words, kChordWords per chord:
+//
+//   id, virtual key, modifiers, flags
+class ChordTable {
+ public:
+  static constexpr size_t kChordWords = 4;
+  static constexpr uint32_t kMaxVirtualKey = 0xFF;
+
+  // Compiles |word_count| words of |program|. Returns null if the program
+  // is malformed: truncated, a virtual key above kMaxVirtualKey, unknown
+  // modifier or flag bits, or two chords on the same key and modifiers.
+  static std::unique_ptr<ChordTable> Compile(const uint32_t* program,
+                                             size_t word_count);
+
+  // Disallow copy and assign.
+  ChordTable(const ChordTable&) = delete;
+  ChordTable& operator=(const ChordTable&) = delete;
+
+  // Returns the chord of |virtual_key| held with exactly |modifiers|, or
+  // null.
+  const ChordMatch* Find(uint64_t virtual_key, uint32_t modifiers) const {
+    if (virtual_key > kMaxVirtualKey) {
+      return nullptr;
+    }
+    const uint32_t combinations = combinations_[virtual_key];
+    const uint32_t bit = 1u << (modifiers & kChordModifierMask);
+    if (!(combinations & bit)) {
+      return nullptr;
+    }
+    return &chords_[first_[virtual_key] +
+                    PopCount16(combinations & (bit - 1))];
+  }
+
+  size_t chord_count() const { return chords_.size(); }
+
+ private:
+  ChordTable() = default;
+
+  static uint32_t PopCount16(uint32_t value) {
+    value = value - ((value >> 1) & 0x5555);
+    value = (value & 0x3333) + ((value >> 2) & 0x3333);
+    value = (value + (value >> 4)) & 0x0F0F;
+    return (value + (value >> 8)) & 0x1F;
+  }
+
+  // Bit m of combinations_[vk] is set if a chord uses |vk| with modifiers
+  // m; the key's chords start at chords_[first_[vk]].
+  std::array<uint16_t, kMaxVirtualKey + 1> combinations_ = {};
+  std::array<uint16_t, kMaxVirtualKey + 1> first_ = {};
+  std::vector<ChordMatch> chords_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_CHORD_TABLE_H_
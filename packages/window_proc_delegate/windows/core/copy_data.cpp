@@ -0,0 +1,88 @@
+#include "copy_data.h"
+
+#include <cstring>
+
+namespace window_proc_delegate {
+
+namespace {
+
+std::shared_ptr<const MessageFilter> CopyDataFilter() {
+  const uint32_t range[] = {kCopyData, kCopyData};
+  return MessageFilter::FromRanges(range, 1);
+}
+
+}  // namespace
+
+CopyDataObserver::CopyDataObserver(int64_t id,
+                                   Dart_Port_DL port,
+                                   intptr_t window,
+                                   BufferPool* pool)
+    : MessageObserver(id, CopyDataFilter()),
+      port_(port),
+      window_(window),
+      pool_(pool) {}
+
+CopyDataObserver::~CopyDataObserver() {
+  Dart_CObject closed;
+  closed.type = Dart_CObject_kNull;
+  Dart_PostCObject_DL(port_, &closed);
+}
+
+// static
+void CopyDataObserver::ReleaseBuffer(void* isolate_callback_data, void* peer) {
+  static_cast<PooledBuffer*>(peer)->Release();
+}
+
+void CopyDataObserver::Add(const ObservedMessage& message) {
+  if (closed_ || (window_ != 0 && message.windowHandle != window_)) {
+    return;
+  }
+  const CopyDataStruct* copy_data = DecodeCopyData(
+      static_cast<uint32_t>(message.message), message.lParam);
+  if (!copy_data) {
+    return;
+  }
+
+  Dart_CObject hwnd;
+  hwnd.type = Dart_CObject_kInt64;
+  hwnd.value.as_int64 = message.windowHandle;
+
+  Dart_CObject tag;
+  tag.type = Dart_CObject_kInt64;
+  tag.value.as_int64 = static_cast<int64_t>(copy_data->dwData);
+
+  PooledBuffer* buffer = nullptr;
+  Dart_CObject bytes;
+  if (copy_data->cbData == 0 || !copy_data->lpData) {
+    bytes.type = Dart_CObject_kTypedData;
+    bytes.value.as_typed_data.type = Dart_TypedData_kUint8;
+    bytes.value.as_typed_data.length = 0;
+    bytes.value.as_typed_data.values = nullptr;
+  } else {
+    buffer = pool_->Acquire(copy_data->cbData);
+    std::memcpy(buffer->data(), copy_data->lpData, copy_data->cbData);
+    bytes.type = Dart_CObject_kExternalTypedData;
+    bytes.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+    bytes.value.as_external_typed_data.length =
+        static_cast<intptr_t>(copy_data->cbData);
+    bytes.value.as_external_typed_data.data = buffer->data();
+    bytes.value.as_external_typed_data.peer = buffer;
+    bytes.value.as_external_typed_data.callback = &ReleaseBuffer;
+  }
+
+  Dart_CObject* values[] = {&hwnd, &tag, &bytes};
+  Dart_CObject payload;
+  payload.type = Dart_CObject_kArray;
+  payload.value.as_array.length = 3;
+  payload.value.as_array.values = values;
+
+  // Dart owns the buffer only once the post succeeds.
+  if (!Dart_PostCObject_DL(port_, &payload)) {
+    closed_ = true;
+    if (buffer) {
+      buffer->Release();
+    }
+  }
+}
+
+}  // namespace window_proc_delegate
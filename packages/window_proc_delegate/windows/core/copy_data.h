@@ -0,0 +1,67 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_COPY_DATA_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_COPY_DATA_H_
+
+#include <cstdint>
+
+#include "../dart/dart_api_dl.h"
+#include "buffer_pool.h"
+#include "message_observer.h"
+
+namespace window_proc_delegate {
+
+// WM_COPYDATA.
+constexpr uint32_t kCopyData = 0x004A;
+
+// Mirrors COPYDATASTRUCT, which the plugin checks on Windows.
+struct CopyDataStruct {
+  uintptr_t dwData;
+  uint32_t cbData;
+  const void* lpData;
+};
+
+// Returns the COPYDATASTRUCT that |lparam| points to if |message| is
+// WM_COPYDATA, or null. The struct and its bytes belong to the sender and
+// are only valid while the message is being handled.
+inline const CopyDataStruct* DecodeCopyData(uint32_t message,
+                                            int64_t lparam) {
+  if (message != kCopyData || lparam == 0) {
+    return nullptr;
+  }
+  return reinterpret_cast<const CopyDataStruct*>(
+      static_cast<intptr_t>(lparam));
+}
+
+// Posts each WM_COPYDATA payload sent to |window|, or to any window if it is
+// 0, to a Dart port as [hwnd, dwData, bytes].
+//
+// The bytes are copied into a buffer from |pool| while the sender's copy is
+// still valid, and posted as external typed data: Dart views the buffer in
+// place and its finalizer returns it to the pool. Like BatchObserver, the
+// observer posts null as its last message.
+class CopyDataObserver : public MessageObserver {
+ public:
+  CopyDataObserver(int64_t id,
+                   Dart_Port_DL port,
+                   intptr_t window,
+                   BufferPool* pool);
+  ~CopyDataObserver() override;
+
+  // Runs inside the window procedure, while |message.lParam| still points
+  // to the sender's COPYDATASTRUCT.
+  void Add(const ObservedMessage& message) override;
+
+  bool Flush(const QueueStamp* stamp) override { return !closed_; }
+
+  // Finalizer of the posted typed data; |peer| is the PooledBuffer.
+  static void ReleaseBuffer(void* isolate_callback_data, void* peer);
+
+ private:
+  const Dart_Port_DL port_;
+  const intptr_t window_;
+  BufferPool* const pool_;
+  bool closed_ = false;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_COPY_DATA_H_
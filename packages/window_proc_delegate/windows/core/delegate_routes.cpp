@@ -0,0 +1,116 @@
+#include "delegate_routes.h"
+
+#include <algorithm>
+
+namespace window_proc_delegate {
+
+namespace {
+struct ParsedDelegate {
+  int32_t id;
+  bool all_messages;
+  // Index of the delegate's first range in the program, and their count.
+  size_t ranges;
+  size_t range_count;
+};
+}  // namespace
+
+// static
+std::unique_ptr<DelegateRouteTable> DelegateRouteTable::Compile(
+    const uint32_t* program, size_t word_count) {
+  constexpr uint32_t kMessageCount = MessageFilter::kMessageCount;
+
+  // Validate and locate every delegate first.
+  std::vector<ParsedDelegate> parsed;
+  size_t position = 0;
+  while (position < word_count) {
+    if (word_count - position < 2 || program[position] > INT32_MAX) {
+      return nullptr;
+    }
+    const uint32_t range_count = program[position + 1];
+    const bool all_messages = range_count == kAllMessages;
+    position += 2;
+    if (!all_messages && range_count > (word_count - position) / 2) {
+      return nullptr;
+    }
+    parsed.push_back({static_cast<int32_t>(program[position - 2]),
+                      all_messages, position,
+                      all_messages ? 0 : static_cast<size_t>(range_count)});
+    position += all_messages ? 0 : static_cast<size_t>(range_count) * 2;
+  }
+
+  // Cut the message space at every range boundary.
+  std::vector<uint32_t> starts = {0, kMessageCount};
+  std::vector<uint32_t> ranges;
+  bool any_all_messages = false;
+  for (const ParsedDelegate& delegate : parsed) {
+    any_all_messages |= delegate.all_messages;
+    for (size_t i = 0; i < delegate.range_count; i++) {
+      const uint32_t first = program[delegate.ranges + i * 2];
+      const uint32_t last = program[delegate.ranges + i * 2 + 1];
+      if (first > last || first >= kMessageCount) {
+        continue;
+      }
+      starts.push_back(first);
+      starts.push_back(std::min(last, kMessageCount - 1) + 1);
+      ranges.push_back(first);
+      ranges.push_back(last);
+    }
+  }
+  std::sort(starts.begin(), starts.end());
+  starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+  std::unique_ptr<DelegateRouteTable> table(new DelegateRouteTable());
+  std::vector<int32_t> interval;
+  for (const uint32_t start : starts) {
+    interval.clear();
+    for (const ParsedDelegate& delegate : parsed) {
+      // Identifiers above 0xFFFF only reach delegates without a filter, as
+      // with MessageFilter.
+      bool accepts = delegate.all_messages;
+      for (size_t i = 0; !accepts && start < kMessageCount &&
+                         i < delegate.range_count;
+           i++) {
+        accepts = start >= program[delegate.ranges + i * 2] &&
+                  start <= program[delegate.ranges + i * 2 + 1];
+      }
+      if (accepts) {
+        interval.push_back(delegate.id);
+      }
+    }
+
+    // Merge with the previous interval when the candidates are the same,
+    // except into the system range, which Find() expects last.
+    if (!table->interval_starts_.empty() && start != kMessageCount &&
+        std::equal(interval.begin(), interval.end(),
+                   table->candidates_.begin() +
+                       table->candidate_offsets_.back(),
+                   table->candidates_.end())) {
+      continue;
+    }
+    table->interval_starts_.push_back(start);
+    table->candidate_offsets_.push_back(
+        static_cast<uint32_t>(table->candidates_.size()));
+    table->candidates_.insert(table->candidates_.end(), interval.begin(),
+                              interval.end());
+  }
+  table->candidate_offsets_.push_back(
+      static_cast<uint32_t>(table->candidates_.size()));
+
+  table->filter_ = any_all_messages ? MessageFilter::AcceptAll()
+                                    : MessageFilter::FromRanges(
+                                          ranges.data(), ranges.size() / 2);
+  return table;
+}
+
+DelegateRouteTable::Candidates DelegateRouteTable::Find(
+    uint32_t message) const {
+  const auto it = std::upper_bound(interval_starts_.begin(),
+                                   interval_starts_.end(), message);
+  const size_t interval =
+      static_cast<size_t>(it - interval_starts_.begin()) - 1;
+  const uint32_t begin = candidate_offsets_[interval];
+  return {candidates_.data() + begin,
+          candidate_offsets_[interval + 1] - begin};
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,71 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DELEGATE_ROUTES_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DELEGATE_ROUTES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "message_filter.h"
+
+namespace window_proc_delegate {
+
+// Immutable table from message identifier to the Dart delegates subscribed
+// to it, in the order they are called.
+//
+// The message space is cut at every range boundary into intervals whose
+// messages share one candidate list, so a lookup is a binary search over a
+// few dozen interval starts however wide the ranges are. The union of all
+// delegate filters rejects messages without candidates with a bit test.
+//
+// Programs are flat arrays of uint32 words, one delegate after another in
+// call order:
+//
+//   delegate ID, range_count (kAllMessages for every message), then
+//   range_count inclusive [first, last] pairs
+class DelegateRouteTable {
+ public:
+  // range_count of a delegate without a filter.
+  static constexpr uint32_t kAllMessages = 0xFFFFFFFF;
+
+  // The delegates to call for one message.
+  struct Candidates {
+    const int32_t* delegates;
+    size_t count;
+  };
+
+  // Compiles |word_count| words of |program|. Returns null if the program
+  // is truncated or a delegate ID does not fit in an int32.
+  static std::unique_ptr<DelegateRouteTable> Compile(const uint32_t* program,
+                                                     size_t word_count);
+
+  // Disallow copy and assign.
+  DelegateRouteTable(const DelegateRouteTable&) = delete;
+  DelegateRouteTable& operator=(const DelegateRouteTable&) = delete;
+
+  // Accepts the messages with at least one candidate.
+  const std::shared_ptr<const MessageFilter>& filter() const {
+    return filter_;
+  }
+
+  Candidates Find(uint32_t message) const;
+
+  size_t interval_count() const { return interval_starts_.size(); }
+
+ private:
+  DelegateRouteTable() = default;
+
+  std::shared_ptr<const MessageFilter> filter_;
+
+  // Interval i covers [interval_starts_[i], interval_starts_[i + 1]); the
+  // last one starts at MessageFilter::kMessageCount and has the delegates
+  // without a filter. Its candidates are candidates_[candidate_offsets_[i],
+  // candidate_offsets_[i + 1]).
+  std::vector<uint32_t> interval_starts_;
+  std::vector<uint32_t> candidate_offsets_;
+  std::vector<int32_t> candidates_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DELEGATE_ROUTES_H_
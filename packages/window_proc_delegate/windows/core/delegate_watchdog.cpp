@@ -0,0 +1,111 @@
+#include "delegate_watchdog.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace window_proc_delegate {
+
+bool DelegateWatchdog::Configure(uint64_t budget_ns,
+                                 uint32_t strikes,
+                                 uint32_t window) {
+  if (strikes == 0 || strikes > window || window > kMaxWindow) {
+    return false;
+  }
+  budget_ns_ = budget_ns;
+  strikes_ = strikes;
+  window_mask_ = window == kMaxWindow ? ~uint64_t{0}
+                                      : (uint64_t{1} << window) - 1;
+  for (Delegate& delegate : delegates_) {
+    delegate.history = 0;
+    delegate.offense_count = 0;
+    delegate.next_offense = 0;
+  }
+  return true;
+}
+
+bool DelegateWatchdog::Record(int64_t delegate_id,
+                              uint32_t message,
+                              uint64_t nanoseconds,
+                              bool handled) {
+  if (!enabled()) {
+    return false;
+  }
+  const bool strike = !handled && nanoseconds > budget_ns_;
+  // Delegates are only allocated once they strike.
+  Delegate* delegate = Find(delegate_id, strike);
+  if (!delegate || delegate->demoted) {
+    return false;
+  }
+  delegate->history = (delegate->history << 1 | (strike ? 1 : 0)) &
+                      window_mask_;
+  if (!strike) {
+    return false;
+  }
+  delegate->offenses[delegate->next_offense] = {
+      static_cast<int64_t>(message), static_cast<int64_t>(nanoseconds)};
+  delegate->next_offense = (delegate->next_offense + 1) % kMaxOffenses;
+  delegate->offense_count =
+      std::min(delegate->offense_count + 1, kMaxOffenses);
+  if (delegate->exempt ||
+      std::bitset<64>(delegate->history).count() < strikes_) {
+    return false;
+  }
+  delegate->demoted = true;
+  return true;
+}
+
+bool DelegateWatchdog::demoted(int64_t delegate_id) const {
+  const Delegate* delegate = Find(delegate_id);
+  return delegate && delegate->demoted;
+}
+
+size_t DelegateWatchdog::Offenses(int64_t delegate_id,
+                                  DelegateOffense* out,
+                                  size_t capacity) const {
+  const Delegate* delegate = Find(delegate_id);
+  if (!delegate) {
+    return 0;
+  }
+  const size_t count = delegate->offense_count;
+  const size_t first = (delegate->next_offense + kMaxOffenses - count) %
+                       kMaxOffenses;
+  for (size_t i = 0; i < count && i < capacity; i++) {
+    out[i] = delegate->offenses[(first + i) % kMaxOffenses];
+  }
+  return count;
+}
+
+void DelegateWatchdog::ResetDelegate(int64_t delegate_id, bool exempt) {
+  // Exempt delegates are the only state worth allocating for up front.
+  Delegate* delegate = Find(delegate_id, exempt);
+  if (delegate) {
+    *delegate = Delegate();
+    delegate->exempt = exempt;
+  }
+}
+
+DelegateWatchdog::Delegate* DelegateWatchdog::Find(int64_t delegate_id,
+                                                   bool create) {
+  if (delegate_id < 0 || static_cast<uint64_t>(delegate_id) >= kMaxDelegates) {
+    return nullptr;
+  }
+  const size_t index = static_cast<size_t>(delegate_id);
+  if (index >= delegates_.size()) {
+    if (!create) {
+      return nullptr;
+    }
+    delegates_.resize(index + 1);
+  }
+  return &delegates_[index];
+}
+
+const DelegateWatchdog::Delegate* DelegateWatchdog::Find(
+    int64_t delegate_id) const {
+  if (delegate_id < 0 ||
+      static_cast<uint64_t>(delegate_id) >= delegates_.size()) {
+    return nullptr;
+  }
+  return &delegates_[static_cast<size_t>(delegate_id)];
+}
+
+}  // namespace window_proc_delegate
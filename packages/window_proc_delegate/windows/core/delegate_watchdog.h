@@ -0,0 +1,102 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DELEGATE_WATCHDOG_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DELEGATE_WATCHDOG_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace window_proc_delegate {
+
+// A delegate call that ran over budget without handling its message.
+struct DelegateOffense {
+  int64_t message;
+  int64_t nanoseconds;
+};
+
+constexpr size_t kDelegateOffenseFields = 2;
+static_assert(sizeof(DelegateOffense) ==
+                  kDelegateOffenseFields * sizeof(int64_t),
+              "DelegateOffense is read from Dart as packed int64 values");
+
+// Time budget policy for synchronous delegates.
+//
+// Every call a delegate makes (as timed by Dart) is a strike if it ran
+// over the budget and returned null: the window procedure waited without
+// the message being handled, so the delegate would lose nothing by
+// observing it asynchronously instead. A delegate with |strikes| strikes
+// among its last |window| calls is demoted; Record() reports the demotion
+// once, and the delegate's calls are no longer accounted until it is
+// reset. Handled calls are never strikes, however slow.
+//
+// The watchdog keeps the last few strikes of each delegate, so a demotion
+// can name the messages that caused it.
+//
+// Not thread-safe: it is configured and recorded to from the thread that
+// calls the delegates.
+class DelegateWatchdog {
+ public:
+  // Delegates with higher IDs are not accounted.
+  static constexpr size_t kMaxDelegates = 256;
+  static constexpr uint32_t kMaxWindow = 64;
+  static constexpr size_t kMaxOffenses = 8;
+
+  DelegateWatchdog() = default;
+
+  // Disallow copy and assign.
+  DelegateWatchdog(const DelegateWatchdog&) = delete;
+  DelegateWatchdog& operator=(const DelegateWatchdog&) = delete;
+
+  // Sets the policy, or switches the watchdog off if |budget_ns| is 0.
+  // Accounting starts over, but demoted delegates stay demoted. Returns
+  // false, leaving the policy unchanged, unless 0 < strikes <= window <=
+  // kMaxWindow.
+  bool Configure(uint64_t budget_ns, uint32_t strikes, uint32_t window);
+
+  bool enabled() const { return budget_ns_ != 0; }
+  uint64_t budget_ns() const { return budget_ns_; }
+
+  // Accounts a call of |delegate_id| that took |nanoseconds| on |message|.
+  // Returns true if the call demoted the delegate.
+  bool Record(int64_t delegate_id,
+              uint32_t message,
+              uint64_t nanoseconds,
+              bool handled);
+
+  bool demoted(int64_t delegate_id) const;
+
+  // Copies up to |capacity| of the latest strikes of |delegate_id| into
+  // |out|, oldest first. Returns the number available.
+  size_t Offenses(int64_t delegate_id,
+                  DelegateOffense* out,
+                  size_t capacity) const;
+
+  // Forgets |delegate_id|, whose ID is being reused. An |exempt| delegate
+  // is accounted but never demoted.
+  void ResetDelegate(int64_t delegate_id, bool exempt);
+
+ private:
+  struct Delegate {
+    // Bit i is set if the call i calls ago was a strike.
+    uint64_t history = 0;
+    bool exempt = false;
+    bool demoted = false;
+    size_t offense_count = 0;
+    size_t next_offense = 0;
+    std::array<DelegateOffense, kMaxOffenses> offenses;
+  };
+
+  // Returns the state of |delegate_id|, or null if it is out of range or,
+  // unless |create| is set, was never accounted.
+  Delegate* Find(int64_t delegate_id, bool create);
+  const Delegate* Find(int64_t delegate_id) const;
+
+  uint64_t budget_ns_ = 0;
+  uint32_t strikes_ = 3;
+  uint64_t window_mask_ = (uint64_t{1} << 20) - 1;
+  std::vector<Delegate> delegates_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DELEGATE_WATCHDOG_H_
@@ -0,0 +1,54 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCH_RECORD_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCH_RECORD_H_
+
+#include <memory>
+
+#include "../dart/dart_api_dl.h"
+#include "delegate_routes.h"
+#include "message_filter.h"
+#include "windows_message.h"
+
+namespace window_proc_delegate {
+
+// Everything the window procedure needs to forward a message to Dart.
+//
+// Records are immutable once published: a change of callback, isolate,
+// filter or routes publishes a new record, so the dispatch path reads them
+// consistently with a single acquire load and without locking.
+struct DispatchRecord {
+  DartWindowProcCallbackC callback;
+  Dart_Isolate isolate;
+  std::shared_ptr<const MessageFilter> filter;
+  // The delegates to pass along with each message, if routed natively.
+  std::shared_ptr<const DelegateRouteTable> routes;
+};
+
+// Calls |record|'s callback inside its isolate. The isolate is only exited
+// and re-entered when the calling thread currently owns a different one.
+inline void DispatchToDart(const DispatchRecord& record,
+                           WindowsMessage* message) {
+  Dart_Isolate previous = Dart_CurrentIsolate_DL();
+  if (previous == record.isolate) {
+    record.callback(message);
+    return;
+  }
+
+  if (previous) {
+    Dart_ExitIsolate_DL();
+  }
+  Dart_EnterIsolate_DL(record.isolate);
+
+  record.callback(message);
+
+  // Restore previous isolate
+  if (Dart_CurrentIsolate_DL()) {
+    Dart_ExitIsolate_DL();
+  }
+  if (previous) {
+    Dart_EnterIsolate_DL(previous);
+  }
+}
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCH_RECORD_H_
@@ -0,0 +1,207 @@
+#include "dispatch_timeline.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <iterator>
+
+namespace window_proc_delegate {
+
+namespace {
+
+struct NamedMessage {
+  uint32_t message;
+  const char* name;
+};
+
+// Sorted by message. Labels must live until the VM shuts down, so every
+// name is a literal.
+constexpr NamedMessage kMessageNames[] = {
+    {0x0001, "WM_CREATE"},
+    {0x0002, "WM_DESTROY"},
+    {0x0003, "WM_MOVE"},
+    {0x0005, "WM_SIZE"},
+    {0x0006, "WM_ACTIVATE"},
+    {0x0007, "WM_SETFOCUS"},
+    {0x0008, "WM_KILLFOCUS"},
+    {0x000A, "WM_ENABLE"},
+    {0x000B, "WM_SETREDRAW"},
+    {0x000C, "WM_SETTEXT"},
+    {0x000D, "WM_GETTEXT"},
+    {0x000F, "WM_PAINT"},
+    {0x0010, "WM_CLOSE"},
+    {0x0011, "WM_QUERYENDSESSION"},
+    {0x0012, "WM_QUIT"},
+    {0x0014, "WM_ERASEBKGND"},
+    {0x0015, "WM_SYSCOLORCHANGE"},
+    {0x0016, "WM_ENDSESSION"},
+    {0x0018, "WM_SHOWWINDOW"},
+    {0x001A, "WM_SETTINGCHANGE"},
+    {0x001C, "WM_ACTIVATEAPP"},
+    {0x0020, "WM_SETCURSOR"},
+    {0x0021, "WM_MOUSEACTIVATE"},
+    {0x0024, "WM_GETMINMAXINFO"},
+    {0x0046, "WM_WINDOWPOSCHANGING"},
+    {0x0047, "WM_WINDOWPOSCHANGED"},
+    {0x004A, "WM_COPYDATA"},
+    {0x007E, "WM_DISPLAYCHANGE"},
+    {0x0080, "WM_SETICON"},
+    {0x0081, "WM_NCCREATE"},
+    {0x0082, "WM_NCDESTROY"},
+    {0x0083, "WM_NCCALCSIZE"},
+    {0x0084, "WM_NCHITTEST"},
+    {0x0085, "WM_NCPAINT"},
+    {0x0086, "WM_NCACTIVATE"},
+    {0x00A0, "WM_NCMOUSEMOVE"},
+    {0x00A1, "WM_NCLBUTTONDOWN"},
+    {0x00A2, "WM_NCLBUTTONUP"},
+    {0x00A3, "WM_NCLBUTTONDBLCLK"},
+    {0x00FF, "WM_INPUT"},
+    {0x0100, "WM_KEYDOWN"},
+    {0x0101, "WM_KEYUP"},
+    {0x0102, "WM_CHAR"},
+    {0x0104, "WM_SYSKEYDOWN"},
+    {0x0105, "WM_SYSKEYUP"},
+    {0x0106, "WM_SYSCHAR"},
+    {0x0111, "WM_COMMAND"},
+    {0x0112, "WM_SYSCOMMAND"},
+    {0x0113, "WM_TIMER"},
+    {0x0116, "WM_INITMENU"},
+    {0x011F, "WM_MENUSELECT"},
+    {0x0120, "WM_MENUCHAR"},
+    {0x0121, "WM_ENTERIDLE"},
+    {0x0200, "WM_MOUSEMOVE"},
+    {0x0201, "WM_LBUTTONDOWN"},
+    {0x0202, "WM_LBUTTONUP"},
+    {0x0203, "WM_LBUTTONDBLCLK"},
+    {0x0204, "WM_RBUTTONDOWN"},
+    {0x0205, "WM_RBUTTONUP"},
+    {0x0207, "WM_MBUTTONDOWN"},
+    {0x0208, "WM_MBUTTONUP"},
+    {0x020A, "WM_MOUSEWHEEL"},
+    {0x020E, "WM_MOUSEHWHEEL"},
+    {0x0214, "WM_SIZING"},
+    {0x0215, "WM_CAPTURECHANGED"},
+    {0x0216, "WM_MOVING"},
+    {0x0218, "WM_POWERBROADCAST"},
+    {0x0219, "WM_DEVICECHANGE"},
+    {0x0231, "WM_ENTERSIZEMOVE"},
+    {0x0232, "WM_EXITSIZEMOVE"},
+    {0x0233, "WM_DROPFILES"},
+    {0x0281, "WM_IME_SETCONTEXT"},
+    {0x0282, "WM_IME_NOTIFY"},
+    {0x02A1, "WM_MOUSEHOVER"},
+    {0x02A3, "WM_MOUSELEAVE"},
+    {0x02B1, "WM_WTSSESSION_CHANGE"},
+    {0x02E0, "WM_DPICHANGED"},
+    {0x0312, "WM_HOTKEY"},
+    {0x031A, "WM_THEMECHANGED"},
+    {0x031E, "WM_DWMCOMPOSITIONCHANGED"},
+    {0x0320, "WM_DWMCOLORIZATIONCOLORCHANGED"},
+};
+
+constexpr uint32_t kUser = 0x0400;        // WM_USER
+constexpr uint32_t kApp = 0x8000;         // WM_APP
+constexpr uint32_t kRegistered = 0xC000;  // RegisterWindowMessage()
+
+// Flow IDs must be unique across the engines of the process.
+std::atomic<int64_t> g_next_flow_id{1};
+
+const char* const kDispatchArgumentNames[] = {"hwnd", "message"};
+const char* const kHandledArgumentNames[] = {"handled", "lResult"};
+const char* const kFlushArgumentNames[] = {"observers"};
+constexpr char kFlushLabel[] = "WindowProcDelegate flush";
+constexpr char kFlushScheduledLabel[] = "WindowProcDelegate flush scheduled";
+
+}  // namespace
+
+// static
+void DispatchTimeline::BeginDispatch(const TimelineApi& api,
+                                     const WindowsMessage& message) {
+  char window[24];
+  char id[12];
+  std::snprintf(window, sizeof(window), "0x%" PRIxPTR,
+                static_cast<uintptr_t>(message.windowHandle));
+  std::snprintf(id, sizeof(id), "0x%04" PRIX32,
+                static_cast<uint32_t>(message.message));
+  const char* values[] = {window, id};
+  api.record_event(MessageName(static_cast<uint32_t>(message.message)),
+                   api.now_micros(), 0, 0, nullptr, Dart_Timeline_Event_Begin,
+                   2, const_cast<const char**>(kDispatchArgumentNames),
+                   values);
+}
+
+// static
+void DispatchTimeline::EndDispatch(const TimelineApi& api,
+                                   const WindowsMessage& message) {
+  char result[24];
+  std::snprintf(result, sizeof(result), "%" PRId64, message.lResult);
+  const char* values[] = {message.handled ? "true" : "false", result};
+  // The result only means something if the message was handled.
+  api.record_event(MessageName(static_cast<uint32_t>(message.message)),
+                   api.now_micros(), 0, 0, nullptr, Dart_Timeline_Event_End,
+                   message.handled ? 2 : 1,
+                   const_cast<const char**>(kHandledArgumentNames), values);
+}
+
+// static
+int64_t DispatchTimeline::FlushScheduled(const TimelineApi& api,
+                                         uint32_t message) {
+  const int64_t flow_id =
+      g_next_flow_id.fetch_add(1, std::memory_order_relaxed);
+  const int64_t now = api.now_micros();
+  const char* const names[] = {"message"};
+  const char* values[] = {MessageName(message)};
+  // Perfetto links the slices carrying the flow ID; Chrome's format needs
+  // the separate flow events.
+  api.record_event(kFlushScheduledLabel, now, 0, 1, &flow_id,
+                   Dart_Timeline_Event_Instant, 1,
+                   const_cast<const char**>(names), values);
+  api.record_event(kFlushLabel, now, flow_id, 0, nullptr,
+                   Dart_Timeline_Event_Flow_Begin, 0, nullptr, nullptr);
+  return flow_id;
+}
+
+// static
+void DispatchTimeline::BeginFlush(const TimelineApi& api, int64_t flow_id) {
+  const int64_t now = api.now_micros();
+  api.record_event(kFlushLabel, now, 0, flow_id != 0 ? 1 : 0, &flow_id,
+                   Dart_Timeline_Event_Begin, 0, nullptr, nullptr);
+  if (flow_id != 0) {
+    api.record_event(kFlushLabel, now, flow_id, 0, nullptr,
+                     Dart_Timeline_Event_Flow_End, 0, nullptr, nullptr);
+  }
+}
+
+// static
+void DispatchTimeline::EndFlush(const TimelineApi& api, size_t observers) {
+  char count[24];
+  std::snprintf(count, sizeof(count), "%zu", observers);
+  const char* values[] = {count};
+  api.record_event(kFlushLabel, api.now_micros(), 0, 0, nullptr,
+                   Dart_Timeline_Event_End, 1,
+                   const_cast<const char**>(kFlushArgumentNames), values);
+}
+
+// static
+const char* DispatchTimeline::MessageName(uint32_t message) {
+  const NamedMessage* end = std::end(kMessageNames);
+  const NamedMessage* named = std::lower_bound(
+      std::begin(kMessageNames), end, message,
+      [](const NamedMessage& a, uint32_t b) { return a.message < b; });
+  if (named != end && named->message == message) {
+    return named->name;
+  }
+  if (message >= kRegistered) {
+    return "Registered message";
+  }
+  if (message >= kApp) {
+    return "WM_APP message";
+  }
+  if (message >= kUser) {
+    return "WM_USER message";
+  }
+  return "Window message";
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,77 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCH_TIMELINE_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCH_TIMELINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "../dart/dart_tools_api.h"
+#include "windows_message.h"
+
+namespace window_proc_delegate {
+
+// The Dart tools API entry points events are recorded through. They are
+// not part of the API DL table, so the plugin resolves them from the
+// engine, and tests substitute their own.
+struct TimelineApi {
+  decltype(&Dart_RecordTimelineEvent) record_event;
+  decltype(&Dart_TimelineGetMicros) now_micros;
+};
+
+// Records an engine's dispatch path to the Dart timeline, on its Embedder
+// stream, so DevTools shows the time the window thread spends in Dart
+// delegates:
+//
+//  - Each synchronous call into Dart is a slice named after its message,
+//    with the window, the message and whether it was handled as arguments.
+//  - Each observer flush is a slice, with a flow from the message that
+//    scheduled it, so the time a batch waited for the message pump shows.
+//
+// Events are recorded as Begin/End pairs as they happen, which every
+// timeline recorder supports. Recording is switched on and off at runtime;
+// when off, each call into Dart and each flush pays a single relaxed load.
+class DispatchTimeline {
+ public:
+  DispatchTimeline() = default;
+
+  // Disallow copy and assign.
+  DispatchTimeline(const DispatchTimeline&) = delete;
+  DispatchTimeline& operator=(const DispatchTimeline&) = delete;
+
+  // Returns the API to record to, or null while recording is off.
+  const TimelineApi* api() const {
+    return api_.load(std::memory_order_relaxed);
+  }
+
+  // Starts recording to |api|, which must outlive this timeline, or stops
+  // recording if |api| is null.
+  void set_api(const TimelineApi* api) {
+    api_.store(api, std::memory_order_relaxed);
+  }
+
+  // Records the start and end of a call into Dart for |message|.
+  static void BeginDispatch(const TimelineApi& api,
+                            const WindowsMessage& message);
+  static void EndDispatch(const TimelineApi& api,
+                          const WindowsMessage& message);
+
+  // Records that |message| scheduled an observer flush. Returns the ID of
+  // the flow to end in the flush.
+  static int64_t FlushScheduled(const TimelineApi& api, uint32_t message);
+
+  // Records the start and end of an observer flush, ending the flow
+  // |flow_id| unless it is 0.
+  static void BeginFlush(const TimelineApi& api, int64_t flow_id);
+  static void EndFlush(const TimelineApi& api, size_t observers);
+
+  // Returns the name of |message|, such as "WM_PAINT", or of its range if
+  // it is not a well-known message.
+  static const char* MessageName(uint32_t message);
+
+ private:
+  std::atomic<const TimelineApi*> api_{nullptr};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCH_TIMELINE_H_
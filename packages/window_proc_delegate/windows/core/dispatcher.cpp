@@ -0,0 +1,637 @@
+#include "dispatcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "copy_data.h"
+#include "message_payload.h"
+
+namespace window_proc_delegate {
+
+namespace {
+constexpr uint32_t kNcHitTest = 0x0084;   // WM_NCHITTEST
+constexpr uint32_t kInput = 0x00FF;       // WM_INPUT
+constexpr uint32_t kKeyDown = 0x0100;     // WM_KEYDOWN
+constexpr uint32_t kSysKeyDown = 0x0104;  // WM_SYSKEYDOWN
+}  // namespace
+
+Dispatcher::Dispatcher(WindowProcRegistrar* registrar)
+    : registrar_(registrar),
+      filter_(MessageFilter::AcceptAll()),
+      latency_(registrar) {
+  registrar_->SetHandler(this);
+}
+
+Dispatcher::~Dispatcher() {
+  registrar_->SetHandler(nullptr);
+}
+
+std::optional<int64_t> Dispatcher::HandleWindowProc(
+    const WindowProcMessage& message) {
+  // Without delegates, observers, rules or a trace there is nothing to do.
+  const uint32_t routes = routes_.load(std::memory_order_relaxed);
+  if (routes == 0) {
+    return std::nullopt;
+  }
+  if ((routes & kRouteRetiredSnapshots) && call_depth_ == 0) {
+    FreeRetiredSnapshots();
+  }
+  if (latency_.enabled() && IsPostedInputMessage(message.message)) {
+    RecordQueued(message.message);
+  }
+
+  const TraceSession* trace =
+      (routes & kRouteTrace) ? trace_.Load() : nullptr;
+  if (!trace) {
+    return Route(message, routes);
+  }
+
+  const uint64_t start = registrar_->NowNanoseconds();
+  const std::optional<int64_t> result = Route(message, routes);
+  const uint64_t elapsed = registrar_->NowNanoseconds() - start;
+
+  TraceRecord record;
+  record.timestamp_ns = start - trace->recorder->start_ns();
+  record.window = message.window;
+  record.wparam = message.wparam;
+  record.lparam = message.lparam;
+  record.lresult = result.value_or(0);
+  record.dispatch_ns =
+      static_cast<uint32_t>(std::min<uint64_t>(elapsed, UINT32_MAX));
+  record.message = message.message;
+  record.flags = result ? kTraceHandled : 0;
+  record.reserved = 0;
+  trace->recorder->Append(record);
+  return result;
+}
+
+std::optional<int64_t> Dispatcher::Route(const WindowProcMessage& message,
+                                         uint32_t routes) {
+  // Kept current whatever else handles the message.
+  if ((routes & kRouteWindowStates) && IsWindowStateMessage(message.message)) {
+    UpdateWindowState(message);
+  }
+
+  // Raw mouse input arrives too fast to cross into Dart per message; it is
+  // batched natively and hidden from delegates and observers. Leaving it
+  // unhandled lets DefWindowProc free the input.
+  if (message.message == kInput && (routes & kRouteRawInput) &&
+      AccumulateRawInput(message)) {
+    return std::nullopt;
+  }
+
+  if (routes & kRouteBroadcast) {
+    const BroadcastRoute* broadcast = broadcast_.Load();
+    if (broadcast && broadcast->filter->Accepts(message.message)) {
+      broadcast->hub->Publish(message);
+    }
+  }
+
+  if (routes & kRouteObservers) {
+    NotifyObservers(message);
+  }
+
+  // Shortcuts are matched natively, so key presses that are not one never
+  // enter Dart.
+  if ((routes & kRouteChords) &&
+      (message.message == kKeyDown || message.message == kSysKeyDown)) {
+    if (auto result = MatchChord(message)) {
+      return result;
+    }
+  }
+
+  // Hit testing runs on every mouse move; answer it without entering Dart
+  // when the point is in a published region.
+  if (message.message == kNcHitTest && (routes & kRouteHitTests)) {
+    if (auto result = HitTest(message)) {
+      return result;
+    }
+  }
+
+  // Static interceptions declared from Dart are answered without calling it.
+  const ReplyRuleTable* rules =
+      (routes & kRouteReplyRules) ? reply_rules_.Load() : nullptr;
+  if (rules) {
+    const ReplyDecision decision =
+        rules->Evaluate(message.window, message.message, message.wparam,
+                        static_cast<uint64_t>(message.lparam));
+    if (decision.kind == ReplyDecision::Kind::kReply) {
+      return decision.result;
+    }
+  }
+
+  // Handlers of other native plugins run in the same pipeline, ahead of
+  // Dart, and may answer the message for it.
+  if (routes & kRouteNativeHandlers) {
+    if (auto result = CallNativeHandlers(message)) {
+      return result;
+    }
+  }
+
+  // Messages no delegate subscribed to never cross into Dart.
+  const DispatchRecord* record =
+      (routes & kRouteDart) ? dispatch_record_.Load() : nullptr;
+  if (!record || !record->filter->Accepts(message.message)) {
+    return std::nullopt;
+  }
+
+  // Every field is set below; the payload union only for decoded kinds.
+  WindowsMessage msg;
+  msg.windowHandle = message.window;
+  msg.message = static_cast<int32_t>(message.message);
+  msg.wParam = static_cast<int64_t>(message.wparam);
+  msg.lParam = message.lparam;
+  msg.lResult = 0;
+  msg.handled = false;
+  if (record->routes) {
+    // Dart only calls the delegates subscribed to this message.
+    const DelegateRouteTable::Candidates candidates =
+        record->routes->Find(message.message);
+    msg.candidates = candidates.delegates;
+    msg.candidateCount = static_cast<int32_t>(candidates.count);
+  } else {
+    msg.candidates = nullptr;
+    msg.candidateCount = -1;
+  }
+  // The sender's buffer outlives the call, so Dart views it in place.
+  if (const CopyDataStruct* copy_data =
+          DecodeCopyData(message.message, message.lparam)) {
+    msg.copyDataTag = copy_data->dwData;
+    msg.copyData = static_cast<const uint8_t*>(copy_data->lpData);
+    msg.copyDataLength = copy_data->lpData ? copy_data->cbData : 0;
+  } else {
+    msg.copyDataTag = 0;
+    msg.copyData = nullptr;
+    msg.copyDataLength = -1;
+  }
+  DecodePayload(message.message, message.wparam, message.lparam, &msg.payload);
+
+  TimedDispatchToDart(*record, &msg);
+  if (msg.payload.kind != PayloadKind::kNone) {
+    EncodePayload(msg.payload, message.wparam, message.lparam);
+  }
+
+  if (msg.handled) {
+    return msg.lResult;
+  }
+  return std::nullopt;
+}
+
+void Dispatcher::NotifyObservers(const WindowProcMessage& message) {
+  const ObserverList* list = observers_.Load();
+  if (!list || !list->filter->Accepts(message.message)) {
+    return;
+  }
+
+  const ObservedMessage observed = {
+      static_cast<int64_t>(message.window),
+      static_cast<int64_t>(message.message),
+      static_cast<int64_t>(message.wparam), message.lparam, 1};
+  for (const auto& observer : list->observers) {
+    if (observer->filter().Accepts(message.message)) {
+      observer->Add(observed);
+    }
+  }
+
+  // Everything queued until the flush is pumped goes out as one batch per
+  // observer.
+  if (!flush_posted_) {
+    flush_posted_ = registrar_->PostFlush(message.window);
+    if (flush_posted_ && latency_.enabled()) {
+      flush_stamp_ = {static_cast<int64_t>(registrar_->NowNanoseconds()),
+                      static_cast<int64_t>(message.message)};
+    }
+    const TimelineApi* timeline = timeline_.api();
+    if (timeline && flush_posted_) {
+      flush_flow_id_ =
+          DispatchTimeline::FlushScheduled(*timeline, message.message);
+    }
+  }
+}
+
+void Dispatcher::OnFlush() {
+  flush_posted_ = false;
+  const int64_t flow_id = flush_flow_id_;
+  flush_flow_id_ = 0;
+  const QueueStamp stamp = flush_stamp_;
+  flush_stamp_ = {};
+  const ObserverList* list = observers_.Load();
+  if (!list) {
+    return;
+  }
+  // Only stamped if tracking was on when the flush was scheduled.
+  const bool stamped = stamp.queued_ns != 0 && latency_.enabled();
+  if (stamped) {
+    const uint64_t now = registrar_->NowNanoseconds();
+    const uint64_t queued = static_cast<uint64_t>(stamp.queued_ns);
+    latency_.stage(LatencyStage::kPending)
+        .Record(static_cast<uint32_t>(stamp.message),
+                now > queued ? now - queued : 0);
+  }
+  const TimelineApi* timeline = timeline_.api();
+  if (timeline) {
+    DispatchTimeline::BeginFlush(*timeline, flow_id);
+  }
+  std::vector<int64_t> closed;
+  for (const auto& observer : list->observers) {
+    if (!observer->Flush(stamped ? &stamp : nullptr)) {
+      closed.push_back(observer->id());
+    }
+  }
+  if (timeline) {
+    DispatchTimeline::EndFlush(*timeline, list->observers.size());
+  }
+  // |list| stays alive until the next message, even if this replaces it.
+  for (const int64_t observer_id : closed) {
+    RemoveObserver(observer_id);
+  }
+}
+
+void Dispatcher::FreeRetiredSnapshots() {
+  std::vector<std::shared_ptr<const void>> retired;
+  {
+    // Never block the window thread on a setter; try again next message.
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock) {
+      return;
+    }
+    retired.swap(retired_snapshots_);
+    SetRouteLocked(kRouteRetiredSnapshots, false);
+  }
+  // Taking |mutex_| ordered every later Load() after the Publish() calls
+  // that replaced these, so nothing can reach them any more.
+}
+
+std::optional<int64_t> Dispatcher::HitTest(const WindowProcMessage& message) {
+  const WindowHitTests* hit_tests = hit_tests_.Load();
+  if (!hit_tests) {
+    return std::nullopt;
+  }
+  const HitTestIndex* index = hit_tests->Find(message.window);
+  if (!index) {
+    return std::nullopt;
+  }
+
+  // The point is in screen coordinates, as signed 16-bit words.
+  int32_t x = static_cast<int16_t>(message.lparam & 0xFFFF);
+  int32_t y = static_cast<int16_t>((message.lparam >> 16) & 0xFFFF);
+  registrar_->ScreenToClient(message.window, &x, &y);
+  int32_t code = 0;
+  if (!index->Lookup(x, y, &code)) {
+    return std::nullopt;
+  }
+  return code;
+}
+
+std::optional<int64_t> Dispatcher::MatchChord(
+    const WindowProcMessage& message) {
+  const ChordRoute* chords = chords_.Load();
+  if (!chords) {
+    return std::nullopt;
+  }
+  const ChordMatch* chord =
+      chords->table->Find(message.wparam, registrar_->ModifierState());
+  if (!chord) {
+    return std::nullopt;
+  }
+
+  // Bit 30 of lParam is set if the key was already down: an autorepeat.
+  const bool repeat = (message.lparam >> 30) & 1;
+  if (!repeat || !(chord->flags & kChordSuppressRepeat)) {
+    const int64_t values[] = {chord->id, message.window, repeat};
+    Dart_CObject match;
+    match.type = Dart_CObject_kTypedData;
+    match.value.as_typed_data.type = Dart_TypedData_kInt64;
+    match.value.as_typed_data.length = 3;
+    match.value.as_typed_data.values =
+        reinterpret_cast<const uint8_t*>(values);
+    Dart_PostCObject_DL(chords->port, &match);
+  }
+  if (chord->flags & kChordConsume) {
+    return 0;
+  }
+  return std::nullopt;
+}
+
+void Dispatcher::UpdateWindowState(const WindowProcMessage& message) {
+  const WindowStates* states = window_states_.Load();
+  if (!states) {
+    return;
+  }
+  for (const auto& [window, block] : states->windows) {
+    if (window != message.window) {
+      continue;
+    }
+    block->Update([&](WindowState* state) {
+      const WindowState before = *state;
+      if (ApplyWindowStateMessage(message, state)) {
+        state->monitor = registrar_->MonitorFromWindow(window);
+      }
+      return std::memcmp(&before, state, sizeof(WindowState)) != 0;
+    });
+    return;
+  }
+}
+
+bool Dispatcher::AccumulateRawInput(const WindowProcMessage& message) {
+  const RawInputRoute* route = raw_input_.Load();
+  RawMouseReport report;
+  if (!route || !registrar_->ReadRawMouseInput(message.lparam, &report)) {
+    return false;
+  }
+  report.timestamp_ns = registrar_->NowNanoseconds();
+  route->accumulator->Add(report);
+  return true;
+}
+
+std::optional<int64_t> Dispatcher::CallNativeHandlers(
+    const WindowProcMessage& message) {
+  const NativeHandlerTable* table = native_handlers_.Load();
+  if (!table || !table->filter().Accepts(message.message)) {
+    return std::nullopt;
+  }
+  const NativeHandlerTable::Handlers handlers = table->Find(message.message);
+  const NativeMessage native = {message.window, message.message,
+                                message.wparam, message.lparam};
+  std::optional<int64_t> result;
+  call_depth_++;
+  for (size_t i = 0; i < handlers.count; i++) {
+    int64_t value = 0;
+    if (handlers.handlers[i].function(handlers.handlers[i].user_data, &native,
+                                      &value)) {
+      result = value;
+      break;
+    }
+  }
+  call_depth_--;
+  return result;
+}
+
+void Dispatcher::TimedDispatchToDart(const DispatchRecord& record,
+                                     WindowsMessage* message) {
+  const TimelineApi* timeline = timeline_.api();
+  if (timeline) {
+    DispatchTimeline::BeginDispatch(*timeline, *message);
+  }
+  call_depth_++;
+  if (!latency_.enabled()) {
+    DispatchToDart(record, message);
+    call_depth_--;
+  } else {
+    const uint32_t id = static_cast<uint32_t>(message->message);
+    const uint64_t start = registrar_->NowNanoseconds();
+    // Read before the call, which may pump messages.
+    const uint64_t posted =
+        IsPostedInputMessage(id) ? registrar_->PostedNanoseconds() : start;
+    DispatchToDart(record, message);
+    const uint64_t end = registrar_->NowNanoseconds();
+    call_depth_--;
+    latency_.dispatch().Record(id, end - start);
+    latency_.stage(LatencyStage::kHandled)
+        .Record(id, end > posted ? end - posted : 0);
+  }
+  if (timeline) {
+    DispatchTimeline::EndDispatch(*timeline, *message);
+  }
+}
+
+void Dispatcher::RecordQueued(uint32_t message) {
+  const uint64_t now = registrar_->NowNanoseconds();
+  const uint64_t posted = registrar_->PostedNanoseconds();
+  // The posting time is coarser than the clock; it may appear ahead.
+  latency_.stage(LatencyStage::kQueued)
+      .Record(message, now > posted ? now - posted : 0);
+}
+
+void Dispatcher::SetCallback(DartWindowProcCallbackC callback,
+                             Dart_Isolate isolate) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  callback_ = callback;
+  isolate_ = isolate;
+  PublishDispatchRecordLocked();
+}
+
+void Dispatcher::SetMessageFilter(std::unique_ptr<const MessageFilter> filter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  filter_ = std::move(filter);
+  delegate_routes_.reset();
+  PublishDispatchRecordLocked();
+}
+
+void Dispatcher::SetDelegateRoutes(
+    std::unique_ptr<const DelegateRouteTable> routes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  delegate_routes_ = std::move(routes);
+  filter_ = delegate_routes_ ? delegate_routes_->filter()
+                             : MessageFilter::AcceptAll();
+  PublishDispatchRecordLocked();
+}
+
+void Dispatcher::AddObserver(std::shared_ptr<MessageObserver> observer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  observer_entries_.push_back(std::move(observer));
+  PublishObserversLocked();
+}
+
+void Dispatcher::RemoveObserver(int64_t observer_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  observer_entries_.erase(
+      std::remove_if(observer_entries_.begin(), observer_entries_.end(),
+                     [observer_id](const auto& observer) {
+                       return observer->id() == observer_id;
+                     }),
+      observer_entries_.end());
+  PublishObserversLocked();
+}
+
+void Dispatcher::SetHitTestIndex(intptr_t window,
+                                 std::shared_ptr<const HitTestIndex> index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& windows = hit_test_entries_.windows;
+  windows.erase(std::remove_if(windows.begin(), windows.end(),
+                               [window](const auto& entry) {
+                                 return entry.first == window;
+                               }),
+                windows.end());
+  if (index) {
+    windows.emplace_back(window, std::move(index));
+  }
+  PublishLocked(&hit_tests_,
+                windows.empty() ? nullptr
+                                : std::make_unique<const WindowHitTests>(
+                                      hit_test_entries_),
+                kRouteHitTests);
+}
+
+void Dispatcher::SetReplyRules(std::unique_ptr<const ReplyRuleTable> rules) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PublishLocked(&reply_rules_, std::move(rules), kRouteReplyRules);
+}
+
+void Dispatcher::SetNativeHandlers(
+    std::unique_ptr<const NativeHandlerTable> handlers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PublishLocked(&native_handlers_, std::move(handlers), kRouteNativeHandlers);
+}
+
+void Dispatcher::SetChords(std::unique_ptr<const ChordTable> chords,
+                           Dart_Port_DL port) {
+  std::unique_ptr<ChordRoute> route;
+  if (chords) {
+    route = std::make_unique<ChordRoute>();
+    route->table = std::move(chords);
+    route->port = port;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  PublishLocked(&chords_, std::unique_ptr<const ChordRoute>(std::move(route)),
+                kRouteChords);
+}
+
+void Dispatcher::SetBroadcast(BroadcastHub* hub,
+                              std::shared_ptr<const MessageFilter> filter) {
+  std::unique_ptr<BroadcastRoute> route;
+  if (filter) {
+    route = std::make_unique<BroadcastRoute>();
+    route->hub = hub;
+    route->filter = std::move(filter);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  PublishLocked(&broadcast_,
+                std::unique_ptr<const BroadcastRoute>(std::move(route)),
+                kRouteBroadcast);
+}
+
+RawInputAccumulator* Dispatcher::StartRawInput(Dart_Port_DL wake_port,
+                                              size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A second consumer would free the first one's accumulator.
+  if (raw_input_.Load() || !registrar_->SetRawMouseInput(true)) {
+    return nullptr;
+  }
+  auto route = std::make_unique<RawInputRoute>();
+  route->accumulator =
+      std::make_shared<RawInputAccumulator>(wake_port, capacity);
+  RawInputAccumulator* accumulator = route->accumulator.get();
+  PublishLocked(&raw_input_,
+                std::unique_ptr<const RawInputRoute>(std::move(route)),
+                kRouteRawInput);
+  return accumulator;
+}
+
+bool Dispatcher::StopRawInput(const RawInputAccumulator* accumulator) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const RawInputRoute* route = raw_input_.Load();
+  if (!route || route->accumulator.get() != accumulator) {
+    return false;
+  }
+  registrar_->SetRawMouseInput(false);
+  PublishLocked<RawInputRoute>(&raw_input_, nullptr, kRouteRawInput);
+  return true;
+}
+
+const WindowStateBlock* Dispatcher::WatchWindowState(intptr_t window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto states = std::make_unique<WindowStates>();
+  if (const WindowStates* current = window_states_.Load()) {
+    for (const auto& [watched, block] : current->windows) {
+      if (watched == window) {
+        return block;
+      }
+    }
+    states->windows = current->windows;
+  }
+  window_state_blocks_.push_back(std::make_unique<WindowStateBlock>());
+  WindowStateBlock* block = window_state_blocks_.back().get();
+  states->windows.emplace_back(window, block);
+  PublishLocked(&window_states_,
+                std::unique_ptr<const WindowStates>(std::move(states)),
+                kRouteWindowStates);
+
+  // Seeded after publishing and under the block's write lock, so the
+  // window thread either waits for the seed or applies its message on top
+  // of it; a message handled before the query is reflected by the query.
+  block->Update([&](WindowState* state) {
+    registrar_->QueryWindowState(window, state);
+    state->window = window;
+    return true;
+  });
+  return block;
+}
+
+void Dispatcher::StartTrace(std::unique_ptr<TraceRecorder> recorder) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const TraceSession* previous = trace_.Load();
+  auto session = std::make_unique<TraceSession>();
+  session->recorder = std::move(recorder);
+  PublishLocked(&trace_,
+                std::unique_ptr<const TraceSession>(std::move(session)),
+                kRouteTrace);
+  if (previous) {
+    previous->recorder->Stop();
+  }
+}
+
+int64_t Dispatcher::StopTrace() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const TraceSession* session = trace_.Load();
+  if (!session) {
+    return -1;
+  }
+  PublishLocked<TraceSession>(&trace_, nullptr, kRouteTrace);
+  return static_cast<int64_t>(session->recorder->Stop());
+}
+
+template <typename T>
+void Dispatcher::PublishLocked(Published<T>* published,
+                               std::unique_ptr<const T> value,
+                               RouteFlag route) {
+  SetRouteLocked(route, value != nullptr);
+  std::unique_ptr<const T> previous = published->Publish(std::move(value));
+  if (previous) {
+    retired_snapshots_.emplace_back(std::move(previous));
+    SetRouteLocked(kRouteRetiredSnapshots, true);
+  }
+}
+
+void Dispatcher::SetRouteLocked(RouteFlag route, bool active) {
+  // Only writers holding |mutex_| modify |routes_|, so a plain
+  // read-modify-write cannot lose an update.
+  const uint32_t routes = routes_.load(std::memory_order_relaxed);
+  routes_.store(active ? routes | route : routes & ~route,
+                std::memory_order_relaxed);
+}
+
+void Dispatcher::PublishDispatchRecordLocked() {
+  // An empty filter is how Dart unsubscribes; drop the route entirely
+  // rather than testing every message against it.
+  if (!callback_ || !isolate_ || filter_->IsEmpty()) {
+    PublishLocked<DispatchRecord>(&dispatch_record_, nullptr, kRouteDart);
+    return;
+  }
+
+  PublishLocked(&dispatch_record_,
+                std::make_unique<const DispatchRecord>(
+                    DispatchRecord{callback_, isolate_, filter_,
+                                   delegate_routes_}),
+                kRouteDart);
+}
+
+void Dispatcher::PublishObserversLocked() {
+  if (observer_entries_.empty()) {
+    PublishLocked<ObserverList>(&observers_, nullptr, kRouteObservers);
+    return;
+  }
+
+  std::vector<const MessageFilter*> filters;
+  for (const auto& observer : observer_entries_) {
+    filters.push_back(&observer->filter());
+  }
+  auto list = std::make_unique<ObserverList>();
+  list->observers = observer_entries_;
+  list->filter = MessageFilter::Union(filters.data(), filters.size());
+  PublishLocked(&observers_,
+                std::unique_ptr<const ObserverList>(std::move(list)),
+                kRouteObservers);
+}
+
+}  // namespace window_proc_delegate
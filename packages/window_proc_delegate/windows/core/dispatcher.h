@@ -0,0 +1,282 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCHER_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCHER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "../dart/dart_api_dl.h"
+#include "broadcast_hub.h"
+#include "chord_table.h"
+#include "delegate_routes.h"
+#include "delegate_watchdog.h"
+#include "dispatch_record.h"
+#include "dispatch_timeline.h"
+#include "hit_test_index.h"
+#include "latency_histogram.h"
+#include "message_filter.h"
+#include "message_observer.h"
+#include "message_trace.h"
+#include "native_handlers.h"
+#include "published.h"
+#include "raw_input.h"
+#include "reply_rules.h"
+#include "window_proc_registrar.h"
+#include "window_state.h"
+#include "windows_message.h"
+
+namespace window_proc_delegate {
+
+// Routes one engine's top-level window messages: the window state cache,
+// raw mouse input, process-wide broadcasts, native chord matching, hit
+// testing, reply rules and native handlers first, then asynchronous
+// observers and the synchronous Dart callback.
+//
+// Setters may be called from any thread. The message path runs on the
+// window thread and reads immutable snapshots published by the setters,
+// without locking. Since that thread is their only reader, replaced
+// snapshots are freed by it, whenever it is between messages. While nothing
+// is published, a message costs a single relaxed load.
+class Dispatcher : public WindowProcRegistrar::Handler {
+ public:
+  // Starts handling the messages of |registrar|, which must outlive this
+  // dispatcher.
+  explicit Dispatcher(WindowProcRegistrar* registrar);
+  ~Dispatcher() override;
+
+  // Disallow copy and assign.
+  Dispatcher(const Dispatcher&) = delete;
+  Dispatcher& operator=(const Dispatcher&) = delete;
+
+  void SetCallback(DartWindowProcCallbackC callback, Dart_Isolate isolate);
+
+  // Replaces the set of messages forwarded to the Dart callback, and drops
+  // any delegate routes.
+  void SetMessageFilter(std::unique_ptr<const MessageFilter> filter);
+
+  // Forwards the messages some delegate in |routes| is subscribed to, each
+  // with its candidate delegates, or every message if |routes| is null.
+  void SetDelegateRoutes(std::unique_ptr<const DelegateRouteTable> routes);
+
+  void AddObserver(std::shared_ptr<MessageObserver> observer);
+  void RemoveObserver(int64_t observer_id);
+
+  // Observers whose port is found closed on flush, for instance because
+  // the isolate owning it exited, are removed automatically.
+
+  // Replaces the hit-test regions of |window|, or removes them if |index|
+  // is null.
+  void SetHitTestIndex(intptr_t window,
+                       std::shared_ptr<const HitTestIndex> index);
+
+  // Replaces the reply rules, or removes them if |rules| is null.
+  void SetReplyRules(std::unique_ptr<const ReplyRuleTable> rules);
+
+  // Replaces the handlers other native plugins added, or removes them if
+  // |handlers| is null.
+  void SetNativeHandlers(std::unique_ptr<const NativeHandlerTable> handlers);
+
+  // Matches WM_KEYDOWN and WM_SYSKEYDOWN against |chords|, posting each
+  // match to |port| as [chord ID, hwnd, repeat], or stops matching if
+  // |chords| is null.
+  void SetChords(std::unique_ptr<const ChordTable> chords, Dart_Port_DL port);
+
+  // Publishes the messages |filter| accepts to |hub|, or stops publishing
+  // if |filter| is null.
+  void SetBroadcast(BroadcastHub* hub,
+                    std::shared_ptr<const MessageFilter> filter);
+
+  // Starts accumulating the raw input of every mouse into batches of up to
+  // |capacity| records; see RawInputAccumulator. Returns the accumulator,
+  // owned by this dispatcher until StopRawInput(), or null if raw input is
+  // already started or the platform refused.
+  RawInputAccumulator* StartRawInput(Dart_Port_DL wake_port, size_t capacity);
+
+  // Stops raw input if |accumulator| is the current one. Returns false,
+  // leaving it running, otherwise.
+  bool StopRawInput(const RawInputAccumulator* accumulator);
+
+  // Returns the state block of |window|, kept up to date from its messages
+  // until this dispatcher is destroyed. The first call for a window seeds
+  // the block from the platform.
+  const WindowStateBlock* WatchWindowState(intptr_t window);
+
+  DispatchLatency& latency() { return latency_; }
+
+  // Time budget accounting of the delegates, done by Dart on the thread
+  // that calls them.
+  DelegateWatchdog& watchdog() { return watchdog_; }
+
+  // Recording of calls into Dart and observer flushes to the Dart timeline.
+  DispatchTimeline& timeline() { return timeline_; }
+
+  // Starts recording every message, with its outcome and handling time, to
+  // |recorder|, replacing and stopping any current trace.
+  void StartTrace(std::unique_ptr<TraceRecorder> recorder);
+
+  // Stops the current trace. Returns the number of records written, or -1
+  // if no trace was running.
+  int64_t StopTrace();
+
+  // Clock value to start a trace at.
+  uint64_t NowNanoseconds() { return registrar_->NowNanoseconds(); }
+
+  // WindowProcRegistrar::Handler:
+  std::optional<int64_t> HandleWindowProc(
+      const WindowProcMessage& message) override;
+  void OnFlush() override;
+
+ private:
+  // The trace being recorded. A message traced while the trace stops may
+  // still append to the stopped recorder; the session is retired with its
+  // snapshot, so the recorder outlives every such message.
+  struct TraceSession {
+    std::shared_ptr<TraceRecorder> recorder;
+  };
+
+  // The chord table and the port its matches are posted to.
+  struct ChordRoute {
+    std::unique_ptr<const ChordTable> table;
+    Dart_Port_DL port;
+  };
+
+  // The hub broadcasts are published to and the messages it wants.
+  struct BroadcastRoute {
+    BroadcastHub* hub;
+    std::shared_ptr<const MessageFilter> filter;
+  };
+
+  // The accumulator WM_INPUT mouse reports are added to.
+  struct RawInputRoute {
+    std::shared_ptr<RawInputAccumulator> accumulator;
+  };
+
+  // The windows whose state is cached, with their blocks.
+  struct WindowStates {
+    std::vector<std::pair<intptr_t, WindowStateBlock*>> windows;
+  };
+
+  // Handles |message| without tracing it, skipping the snapshots whose bits
+  // are clear in |routes|.
+  std::optional<int64_t> Route(const WindowProcMessage& message,
+                               uint32_t routes);
+
+  // Queues |message| for every observer interested in it, and schedules a
+  // flush for the next message pump iteration.
+  void NotifyObservers(const WindowProcMessage& message);
+
+  // Looks up the WM_NCHITTEST point in the regions published for its
+  // window.
+  std::optional<int64_t> HitTest(const WindowProcMessage& message);
+
+  // Posts the chord a key press matches, if any. Returns the window
+  // procedure result if the chord consumes the key press.
+  std::optional<int64_t> MatchChord(const WindowProcMessage& message);
+
+  // Calls the native handlers of |message| until one handles it. Returns
+  // the window procedure result if one did.
+  std::optional<int64_t> CallNativeHandlers(const WindowProcMessage& message);
+
+  // Adds the mouse report of the WM_INPUT |message| to the raw input
+  // batch. Returns false if it is not mouse input.
+  bool AccumulateRawInput(const WindowProcMessage& message);
+
+  // Applies |message| to the state block of its window, if any.
+  void UpdateWindowState(const WindowProcMessage& message);
+
+  // Records how long |message|, a posted input message, waited in the
+  // queue.
+  void RecordQueued(uint32_t message);
+
+  // Calls into Dart, timing the call if latency tracking is enabled and
+  // recording it if the timeline is.
+  void TimedDispatchToDart(const DispatchRecord& record,
+                           WindowsMessage* message);
+
+  // Bits of |routes_|, one per snapshot the message path may have to read.
+  enum RouteFlag : uint32_t {
+    kRouteDart = 1 << 0,
+    kRouteObservers = 1 << 1,
+    kRouteHitTests = 1 << 2,
+    kRouteReplyRules = 1 << 3,
+    kRouteTrace = 1 << 4,
+    kRouteRetiredSnapshots = 1 << 5,
+    kRouteChords = 1 << 6,
+    kRouteWindowStates = 1 << 7,
+    kRouteBroadcast = 1 << 8,
+    kRouteNativeHandlers = 1 << 9,
+    kRouteRawInput = 1 << 10,
+  };
+
+  // Makes |value| the current snapshot of |published|, with |route| set in
+  // |routes_| while it is non-null, and keeps the previous one until the
+  // window thread is between messages. Must be called with |mutex_| held.
+  template <typename T>
+  void PublishLocked(Published<T>* published,
+                     std::unique_ptr<const T> value,
+                     RouteFlag route);
+
+  // Sets or clears |route| in |routes_|. Must be called with |mutex_| held.
+  void SetRouteLocked(RouteFlag route, bool active);
+
+  // Frees the snapshots replaced since the last call, unless a setter holds
+  // |mutex_|. Must be called on the window thread, outside any message.
+  void FreeRetiredSnapshots();
+
+  // Publishes a new DispatchRecord built from the fields below. Must be
+  // called with |mutex_| held.
+  void PublishDispatchRecordLocked();
+
+  // Publishes a new ObserverList from |observer_entries_|. Must be called
+  // with |mutex_| held.
+  void PublishObserversLocked();
+
+  WindowProcRegistrar* registrar_;
+
+  // Only accessed from the window thread.
+  bool flush_posted_ = false;
+  // Timeline flow from the message that posted the flush, or 0.
+  int64_t flush_flow_id_ = 0;
+  // When the messages of the posted flush started queueing, if latency was
+  // tracked then; zero otherwise.
+  QueueStamp flush_stamp_ = {};
+  // Number of calls into Dart or native handlers in progress. Messages
+  // arriving while it is non-zero are nested in one that may still use its
+  // snapshots.
+  int call_depth_ = 0;
+
+  // Writer-side state, guarded by |mutex_|.
+  DartWindowProcCallbackC callback_ = nullptr;
+  Dart_Isolate isolate_ = nullptr;
+  std::shared_ptr<const MessageFilter> filter_;
+  std::shared_ptr<const DelegateRouteTable> delegate_routes_;
+  std::vector<std::shared_ptr<MessageObserver>> observer_entries_;
+  WindowHitTests hit_test_entries_;
+  std::vector<std::unique_ptr<WindowStateBlock>> window_state_blocks_;
+  std::vector<std::shared_ptr<const void>> retired_snapshots_;
+  std::mutex mutex_;
+
+  // Read on every window message without taking |mutex_|.
+  std::atomic<uint32_t> routes_{0};
+  Published<DispatchRecord> dispatch_record_;
+  Published<ObserverList> observers_;
+  Published<WindowHitTests> hit_tests_;
+  Published<ReplyRuleTable> reply_rules_;
+  Published<TraceSession> trace_;
+  Published<ChordRoute> chords_;
+  Published<WindowStates> window_states_;
+  Published<BroadcastRoute> broadcast_;
+  Published<NativeHandlerTable> native_handlers_;
+  Published<RawInputRoute> raw_input_;
+
+  DispatchLatency latency_;
+  DelegateWatchdog watchdog_;
+  DispatchTimeline timeline_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_DISPATCHER_H_
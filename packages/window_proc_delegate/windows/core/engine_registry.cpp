@@ -0,0 +1,612 @@
+#include "engine_registry.h"
+
+#include <algorithm>
+
+#include "buffer_pool.h"
+#include "copy_data.h"
+
+namespace window_proc_delegate {
+
+namespace {
+
+// Engine IDs handed out by Flutter are non-negative, so the two most
+// negative values can mark free and deleted table entries.
+constexpr int64_t kEmpty = INT64_MIN;
+constexpr int64_t kDeleted = INT64_MIN + 1;
+
+constexpr size_t kInitialTableCapacity = 16;
+
+size_t Hash(int64_t engine_id) {
+  // Fibonacci hashing spreads sequential IDs over the table.
+  return static_cast<size_t>(
+      (static_cast<uint64_t>(engine_id) * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+EngineHandle MakeHandle(size_t index, uint32_t generation) {
+  return static_cast<EngineHandle>(
+      (static_cast<uint64_t>(generation) << 32) | (index + 1));
+}
+
+}  // namespace
+
+EngineRegistry::Table::Table(size_t capacity)
+    : mask(capacity - 1), entries(new Entry[capacity]) {
+  for (size_t i = 0; i < capacity; i++) {
+    entries[i].engine_id.store(kEmpty, std::memory_order_relaxed);
+  }
+}
+
+EngineRegistry::EngineRegistry()
+    : table_(new Table(kInitialTableCapacity)) {}
+
+EngineRegistry::~EngineRegistry() {
+  delete table_.load(std::memory_order_relaxed);
+  for (auto& chunk : chunks_) {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
+}
+
+// static
+EngineRegistry& EngineRegistry::Global() {
+  static EngineRegistry* registry = new EngineRegistry();
+  return *registry;
+}
+
+EngineHandle EngineRegistry::Register(int64_t engine_id,
+                                      Dispatcher* dispatcher) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return RegisterLocked(engine_id, dispatcher);
+}
+
+EngineHandle EngineRegistry::RegisterLocked(int64_t engine_id,
+                                            Dispatcher* dispatcher) {
+  if (auto filter = broadcast_hub_.filter()) {
+    dispatcher->SetBroadcast(&broadcast_hub_, std::move(filter));
+  }
+
+  if (Table::Entry* entry = FindEntryLocked(engine_id)) {
+    const EngineHandle engine = entry->handle.load(std::memory_order_relaxed);
+    SlotAt(static_cast<size_t>(engine & 0xFFFFFFFF) - 1)
+        ->dispatcher.store(dispatcher, std::memory_order_seq_cst);
+    return engine;
+  }
+
+  size_t index;
+  if (!free_slots_.empty()) {
+    index = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    index = slot_count_++;
+    if (index % kSlotsPerChunk == 0) {
+      chunks_[index / kSlotsPerChunk].store(new Slot[kSlotsPerChunk],
+                                            std::memory_order_release);
+    }
+  }
+  Slot* slot = SlotAt(index);
+  const EngineHandle engine = MakeHandle(
+      index, slot->generation.load(std::memory_order_relaxed));
+  slot->dispatcher.store(dispatcher, std::memory_order_release);
+  InsertLocked(engine_id, engine);
+  return engine;
+}
+
+void EngineRegistry::Unregister(int64_t engine_id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Table::Entry* entry = FindEntryLocked(engine_id);
+    if (!entry) {
+      return;
+    }
+    const EngineHandle engine = entry->handle.load(std::memory_order_relaxed);
+    entry->engine_id.store(kDeleted, std::memory_order_seq_cst);
+    table_.load(std::memory_order_relaxed)->live--;
+
+    // Clearing the dispatcher before bumping the generation means a reader
+    // that sees a later engine's dispatcher in this slot also sees the new
+    // generation, and rejects stale handles.
+    const size_t index = static_cast<size_t>(engine & 0xFFFFFFFF) - 1;
+    Slot* slot = SlotAt(index);
+    slot->dispatcher.store(nullptr, std::memory_order_seq_cst);
+    slot->generation.fetch_add(1, std::memory_order_seq_cst);
+    free_slots_.push_back(index);
+  }
+
+  // Calls that resolved the engine before it was removed may still be
+  // running; wait for them, without the lock they may need.
+  EpochDomain::Global().Synchronize();
+}
+
+EngineHandle EngineRegistry::Find(int64_t engine_id) const {
+  EpochGuard guard;
+  const Table* table = table_.load(std::memory_order_acquire);
+  size_t i = Hash(engine_id) & table->mask;
+  for (;;) {
+    const Table::Entry& entry = table->entries[i];
+    const int64_t key = entry.engine_id.load(std::memory_order_acquire);
+    if (key == engine_id) {
+      // InsertLocked() reuses deleted entries in place, storing the handle
+      // before the ID, so the handle may already belong to another engine.
+      // Reading it with acquire orders the second ID check after that store.
+      const EngineHandle engine = entry.handle.load(std::memory_order_acquire);
+      if (entry.engine_id.load(std::memory_order_acquire) == engine_id) {
+        return engine;
+      }
+      // The entry was reused; start over.
+      i = Hash(engine_id) & table->mask;
+      continue;
+    }
+    if (key == kEmpty) {
+      return 0;
+    }
+    i = (i + 1) & table->mask;
+  }
+}
+
+void EngineRegistry::Attach(intptr_t key, Dispatcher* dispatcher) {
+  std::vector<Dart_Port_DL> ports;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    attached_[key] = {dispatcher};
+    PublishNativeHandlersLocked(key);
+    ports.swap(attach_ports_);
+  }
+  for (Dart_Port_DL port : ports) {
+    Dart_PostInteger_DL(port, 0);
+  }
+}
+
+void EngineRegistry::Detach(intptr_t key) {
+  AttachedPlugin plugin;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = attached_.find(key);
+    if (it == attached_.end()) {
+      return;
+    }
+    plugin = it->second;
+    attached_.erase(it);
+    // The engine is going away, and the key with it.
+    native_handlers_.erase(key);
+  }
+  if (plugin.bound) {
+    Unregister(plugin.engine_id);
+  }
+}
+
+void EngineRegistry::SetEngineLocator(EngineLocator locator) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  locator_ = std::move(locator);
+}
+
+int64_t EngineRegistry::AddNativeHandler(
+    intptr_t key,
+    const uint32_t* messages,
+    size_t message_count,
+    int32_t priority,
+    WindowProcDelegateNativeHandlerFunction function,
+    void* user_data) {
+  NativeHandlerTable::Registration registration = {0, priority, function,
+                                                   user_data, {}};
+  for (size_t i = 0; i < message_count; i++) {
+    if (messages[i] < MessageFilter::kMessageCount) {
+      registration.messages.push_back(messages[i]);
+    }
+  }
+  std::sort(registration.messages.begin(), registration.messages.end());
+  registration.messages.erase(std::unique(registration.messages.begin(),
+                                          registration.messages.end()),
+                              registration.messages.end());
+  if (!function || registration.messages.empty()) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t id = next_native_handler_id_++;
+  registration.id = id;
+  native_handlers_[key].push_back(std::move(registration));
+  PublishNativeHandlersLocked(key);
+  return id;
+}
+
+void EngineRegistry::RemoveNativeHandler(intptr_t key, int64_t handler_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = native_handlers_.find(key);
+  if (it == native_handlers_.end()) {
+    return;
+  }
+  std::vector<NativeHandlerTable::Registration>& handlers = it->second;
+  handlers.erase(
+      std::remove_if(handlers.begin(), handlers.end(),
+                     [handler_id](const auto& handler) {
+                       return handler.id == handler_id;
+                     }),
+      handlers.end());
+  PublishNativeHandlersLocked(key);
+  if (handlers.empty()) {
+    native_handlers_.erase(it);
+  }
+}
+
+void EngineRegistry::PublishNativeHandlersLocked(intptr_t key) {
+  auto plugin = attached_.find(key);
+  if (plugin == attached_.end()) {
+    return;
+  }
+  auto handlers = native_handlers_.find(key);
+  plugin->second.dispatcher->SetNativeHandlers(
+      handlers == native_handlers_.end() || handlers->second.empty()
+          ? nullptr
+          : NativeHandlerTable::Build(handlers->second));
+}
+
+EngineHandle EngineRegistry::Bind(int64_t engine_id) {
+  if (EngineHandle engine = Find(engine_id)) {
+    return engine;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return BindLocked(engine_id);
+}
+
+EngineHandle EngineRegistry::BindOrNotify(int64_t engine_id,
+                                          Dart_Port_DL port) {
+  if (EngineHandle engine = Find(engine_id)) {
+    return engine;
+  }
+
+  // The port is queued under the same lock as the failed bind, so an
+  // Attach() cannot slip in between unnoticed.
+  std::lock_guard<std::mutex> lock(mutex_);
+  const EngineHandle engine = BindLocked(engine_id);
+  if (!engine &&
+      std::find(attach_ports_.begin(), attach_ports_.end(), port) ==
+          attach_ports_.end()) {
+    attach_ports_.push_back(port);
+  }
+  return engine;
+}
+
+EngineHandle EngineRegistry::BindLocked(int64_t engine_id) {
+  if (Table::Entry* entry = FindEntryLocked(engine_id)) {
+    return entry->handle.load(std::memory_order_relaxed);
+  }
+  if (!locator_) {
+    return 0;
+  }
+  auto it = attached_.find(locator_(engine_id));
+  // A plugin serves a single engine.
+  if (it == attached_.end() || it->second.bound) {
+    return 0;
+  }
+  it->second.bound = true;
+  it->second.engine_id = engine_id;
+  return RegisterLocked(engine_id, it->second.dispatcher);
+}
+
+bool EngineRegistry::SetCallback(int64_t engine_id,
+                                 DartWindowProcCallbackC callback,
+                                 Dart_Isolate isolate) {
+  const EngineHandle engine = Bind(engine_id);
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return false;
+  }
+  dispatcher->SetCallback(callback, isolate);
+  return true;
+}
+
+bool EngineRegistry::SetDelegateRoutes(
+    int64_t engine_id, std::unique_ptr<const DelegateRouteTable> routes) {
+  const EngineHandle engine = Bind(engine_id);
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return false;
+  }
+  dispatcher->SetDelegateRoutes(std::move(routes));
+  return true;
+}
+
+int64_t EngineRegistry::AddObserver(
+    EngineHandle engine, Dart_Port_DL port,
+    std::unique_ptr<const MessageFilter> filter,
+    const std::vector<std::pair<uint32_t, CoalescePolicy>>& policies) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return 0;
+  }
+  const int64_t observer_id = next_observer_id_.fetch_add(1);
+  auto observer =
+      std::make_shared<BatchObserver>(observer_id, port, std::move(filter));
+  for (const auto& policy : policies) {
+    observer->coalescer().SetPolicy(policy.first, policy.second);
+  }
+  dispatcher->AddObserver(std::move(observer));
+  return observer_id;
+}
+
+RingObserver* EngineRegistry::AddRingObserver(
+    EngineHandle engine, Dart_Port_DL wake_port,
+    std::unique_ptr<const MessageFilter> filter, size_t capacity,
+    RingDropPolicy policy) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return nullptr;
+  }
+  auto observer = std::make_shared<RingObserver>(
+      next_observer_id_.fetch_add(1), wake_port, std::move(filter), capacity,
+      policy);
+  RingObserver* ring = observer.get();
+  dispatcher->AddObserver(std::move(observer));
+  return ring;
+}
+
+int64_t EngineRegistry::AddCopyDataObserver(EngineHandle engine,
+                                            Dart_Port_DL port,
+                                            intptr_t window) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return 0;
+  }
+  const int64_t observer_id = next_observer_id_.fetch_add(1);
+  dispatcher->AddObserver(std::make_shared<CopyDataObserver>(
+      observer_id, port, window, &BufferPool::Global()));
+  return observer_id;
+}
+
+void EngineRegistry::RemoveObserver(EngineHandle engine, int64_t observer_id) {
+  EpochGuard guard;
+  if (Dispatcher* dispatcher = Resolve(engine)) {
+    dispatcher->RemoveObserver(observer_id);
+  }
+}
+
+int64_t EngineRegistry::SubscribeBroadcast(
+    Dart_Port_DL port, std::unique_ptr<const MessageFilter> filter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t id = broadcast_hub_.Subscribe(port, std::move(filter));
+  PublishBroadcastFilterLocked();
+  return id;
+}
+
+void EngineRegistry::UnsubscribeBroadcast(int64_t subscription_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (broadcast_hub_.Unsubscribe(subscription_id)) {
+    PublishBroadcastFilterLocked();
+  }
+}
+
+void EngineRegistry::PublishBroadcastFilterLocked() {
+  // Dispatchers are only destroyed after Unregister() has cleared their
+  // slot, which needs |mutex_|.
+  const std::shared_ptr<const MessageFilter> filter = broadcast_hub_.filter();
+  for (size_t i = 0; i < slot_count_; i++) {
+    if (Dispatcher* dispatcher =
+            SlotAt(i)->dispatcher.load(std::memory_order_relaxed)) {
+      dispatcher->SetBroadcast(&broadcast_hub_, filter);
+    }
+  }
+}
+
+bool EngineRegistry::SetHitTestIndex(
+    EngineHandle engine, intptr_t window,
+    std::shared_ptr<const HitTestIndex> index) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return false;
+  }
+  dispatcher->SetHitTestIndex(window, std::move(index));
+  return true;
+}
+
+bool EngineRegistry::SetReplyRules(
+    EngineHandle engine, std::unique_ptr<const ReplyRuleTable> rules) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return false;
+  }
+  dispatcher->SetReplyRules(std::move(rules));
+  return true;
+}
+
+bool EngineRegistry::SetChords(EngineHandle engine,
+                               std::unique_ptr<const ChordTable> chords,
+                               Dart_Port_DL port) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return false;
+  }
+  dispatcher->SetChords(std::move(chords), port);
+  return true;
+}
+
+const WindowStateBlock* EngineRegistry::WatchWindowState(EngineHandle engine,
+                                                        intptr_t window) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return nullptr;
+  }
+  return dispatcher->WatchWindowState(window);
+}
+
+DispatchLatency* EngineRegistry::SetLatencyTracking(EngineHandle engine,
+                                                    bool enabled) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return nullptr;
+  }
+  dispatcher->latency().set_enabled(enabled);
+  return &dispatcher->latency();
+}
+
+DelegateWatchdog* EngineRegistry::SetWatchdog(EngineHandle engine,
+                                              uint64_t budget_ns,
+                                              uint32_t strikes,
+                                              uint32_t window) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher ||
+      !dispatcher->watchdog().Configure(budget_ns, strikes, window)) {
+    return nullptr;
+  }
+  return &dispatcher->watchdog();
+}
+
+RawInputAccumulator* EngineRegistry::StartRawInput(EngineHandle engine,
+                                                  Dart_Port_DL wake_port,
+                                                  size_t capacity) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return nullptr;
+  }
+  return dispatcher->StartRawInput(wake_port, capacity);
+}
+
+bool EngineRegistry::StopRawInput(EngineHandle engine,
+                                  const RawInputAccumulator* accumulator) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  return dispatcher && dispatcher->StopRawInput(accumulator);
+}
+
+bool EngineRegistry::SetTimeline(EngineHandle engine,
+                                 const TimelineApi* api) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    return false;
+  }
+  dispatcher->timeline().set_api(api);
+  return true;
+}
+
+bool EngineRegistry::StartTrace(EngineHandle engine, std::FILE* file,
+                                size_t capacity) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  if (!dispatcher) {
+    if (file) {
+      std::fclose(file);
+    }
+    return false;
+  }
+  auto recorder =
+      TraceRecorder::Start(file, capacity, dispatcher->NowNanoseconds());
+  if (!recorder) {
+    return false;
+  }
+  dispatcher->StartTrace(std::move(recorder));
+  return true;
+}
+
+int64_t EngineRegistry::StopTrace(EngineHandle engine) {
+  EpochGuard guard;
+  Dispatcher* dispatcher = Resolve(engine);
+  return dispatcher ? dispatcher->StopTrace() : -1;
+}
+
+Dispatcher* EngineRegistry::Resolve(EngineHandle engine) const {
+  const uint64_t bits = static_cast<uint64_t>(engine);
+  const uint64_t index = (bits & 0xFFFFFFFF) - 1;
+  if ((bits & 0xFFFFFFFF) == 0 || index >= kMaxChunks * kSlotsPerChunk) {
+    return nullptr;
+  }
+  const Slot* chunk =
+      chunks_[index / kSlotsPerChunk].load(std::memory_order_acquire);
+  if (!chunk) {
+    return nullptr;
+  }
+  const Slot& slot = chunk[index % kSlotsPerChunk];
+  Dispatcher* dispatcher = slot.dispatcher.load(std::memory_order_seq_cst);
+  if (!dispatcher ||
+      slot.generation.load(std::memory_order_seq_cst) != (bits >> 32)) {
+    return nullptr;
+  }
+  return dispatcher;
+}
+
+EngineRegistry::Slot* EngineRegistry::SlotAt(size_t index) const {
+  return &chunks_[index / kSlotsPerChunk].load(
+      std::memory_order_acquire)[index % kSlotsPerChunk];
+}
+
+void EngineRegistry::InsertLocked(int64_t engine_id, EngineHandle engine) {
+  Table* table = table_.load(std::memory_order_relaxed);
+  if ((table->used + 1) * 2 > table->mask + 1) {
+    // Rebuild without deleted entries, leaving room to grow.
+    size_t capacity = kInitialTableCapacity;
+    while (capacity < (table->live + 1) * 4) {
+      capacity *= 2;
+    }
+    auto* rebuilt = new Table(capacity);
+    for (size_t i = 0; i <= table->mask; i++) {
+      const int64_t key =
+          table->entries[i].engine_id.load(std::memory_order_relaxed);
+      if (key == kEmpty || key == kDeleted) {
+        continue;
+      }
+      size_t j = Hash(key) & rebuilt->mask;
+      while (rebuilt->entries[j].engine_id.load(std::memory_order_relaxed) !=
+             kEmpty) {
+        j = (j + 1) & rebuilt->mask;
+      }
+      rebuilt->entries[j].handle.store(
+          table->entries[i].handle.load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+      rebuilt->entries[j].engine_id.store(key, std::memory_order_relaxed);
+      rebuilt->used++;
+      rebuilt->live++;
+    }
+    table_.store(rebuilt, std::memory_order_release);
+    EpochDomain::Global().Retire(table);
+    table = rebuilt;
+  }
+
+  // Reuse the first deleted entry on the probe path, if any.
+  Table::Entry* target = nullptr;
+  size_t i = Hash(engine_id) & table->mask;
+  for (;; i = (i + 1) & table->mask) {
+    const int64_t key =
+        table->entries[i].engine_id.load(std::memory_order_relaxed);
+    if (key == kDeleted && !target) {
+      target = &table->entries[i];
+    } else if (key == kEmpty) {
+      break;
+    }
+  }
+  if (!target) {
+    target = &table->entries[i];
+    table->used++;
+  }
+  table->live++;
+  // Readers that match the ID must see the handle stored with it.
+  target->handle.store(engine, std::memory_order_release);
+  target->engine_id.store(engine_id, std::memory_order_release);
+}
+
+EngineRegistry::Table::Entry* EngineRegistry::FindEntryLocked(
+    int64_t engine_id) const {
+  Table* table = table_.load(std::memory_order_relaxed);
+  for (size_t i = Hash(engine_id) & table->mask;; i = (i + 1) & table->mask) {
+    const int64_t key =
+        table->entries[i].engine_id.load(std::memory_order_relaxed);
+    if (key == engine_id) {
+      return &table->entries[i];
+    }
+    if (key == kEmpty) {
+      return nullptr;
+    }
+  }
+}
+
+}  // namespace window_proc_delegate
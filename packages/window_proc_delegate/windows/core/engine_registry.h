@@ -0,0 +1,276 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_ENGINE_REGISTRY_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_ENGINE_REGISTRY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../dart/dart_api_dl.h"
+#include "broadcast_hub.h"
+#include "delegate_routes.h"
+#include "dispatcher.h"
+#include "epoch.h"
+#include "message_coalescer.h"
+#include "message_filter.h"
+#include "native_handlers.h"
+#include "ring_observer.h"
+#include "spsc_ring.h"
+
+namespace window_proc_delegate {
+
+// Opaque reference to a registered engine, resolved without a map lookup.
+// A handle stops resolving once its engine unregisters, even if the engine
+// ID or the registry slot is reused later. 0 is never a valid handle.
+using EngineHandle = int64_t;
+
+// Maps engine IDs to their Dispatcher, so calls from Dart, which only know
+// their engine ID, reach the right plugin instance.
+//
+// Engine IDs are kept in an open-addressed table and engines in a slab of
+// generation-checked slots; both are read without locks under an
+// EpochGuard. Register() and Unregister() serialize on a lock, and
+// Unregister() waits until no call can still be using the engine's
+// dispatcher, so the plugin may destroy it right after.
+//
+// Plugins attach their dispatcher as soon as they are created, under a key
+// of their own, and an engine locator maps engine IDs to those keys. The
+// first call from Dart naming an engine ID, which is synchronous, registers
+// the engine with its attached dispatcher, so Dart never waits for the
+// plugin to learn its engine ID. Calls for engines without an attached
+// plugin fail.
+//
+// Other native plugins add handlers under the same key, which is how they
+// name the engine. Since plugins register in no particular order, handlers
+// added before the plugin attaches are kept until it does.
+class EngineRegistry {
+ public:
+  EngineRegistry();
+  ~EngineRegistry();
+
+  // Disallow copy and assign.
+  EngineRegistry(const EngineRegistry&) = delete;
+  EngineRegistry& operator=(const EngineRegistry&) = delete;
+
+  // The registry the plugin's exported functions use.
+  static EngineRegistry& Global();
+
+  // Maps an engine ID to the key its plugin attached under, or to 0 if the
+  // engine is unknown. Called with the registry's lock held.
+  using EngineLocator = std::function<intptr_t(int64_t engine_id)>;
+
+  EngineHandle Register(int64_t engine_id, Dispatcher* dispatcher);
+  void Unregister(int64_t engine_id);
+
+  // Makes |dispatcher| available to the engine the locator maps to |key|.
+  void Attach(intptr_t key, Dispatcher* dispatcher);
+
+  // Forgets |key|, unregistering the engine it was bound to, if any. Like
+  // Unregister(), waits until the dispatcher is no longer in use.
+  void Detach(intptr_t key);
+
+  void SetEngineLocator(EngineLocator locator);
+
+  // Calls |function| with |user_data| for the |message_count| messages in
+  // |messages| that reach the dispatcher attached under |key|, now or once
+  // it attaches, ahead of Dart; see NativeHandlerTable. Returns the
+  // handler's ID, or 0 if |function| is null or no message is below
+  // MessageFilter::kMessageCount.
+  int64_t AddNativeHandler(intptr_t key,
+                           const uint32_t* messages,
+                           size_t message_count,
+                           int32_t priority,
+                           WindowProcDelegateNativeHandlerFunction function,
+                           void* user_data);
+  void RemoveNativeHandler(intptr_t key, int64_t handler_id);
+
+  // Returns the handle of |engine_id|, or 0 if it is not registered.
+  EngineHandle Find(int64_t engine_id) const;
+
+  // Returns the handle of |engine_id|, first registering it with its
+  // attached dispatcher if needed, or 0 if it has none.
+  EngineHandle Bind(int64_t engine_id);
+
+  // Like Bind(), but if |engine_id| has no dispatcher yet, posts 0 to |port|
+  // the next time a plugin attaches, so the caller can try again then.
+  EngineHandle BindOrNotify(int64_t engine_id, Dart_Port_DL port);
+
+  // The setters below bind |engine_id| and return false if it has no
+  // dispatcher.
+  bool SetCallback(int64_t engine_id, DartWindowProcCallbackC callback,
+                   Dart_Isolate isolate);
+  bool SetDelegateRoutes(int64_t engine_id,
+                         std::unique_ptr<const DelegateRouteTable> routes);
+
+  // Returns the new observer's ID, or 0 if |engine| is not registered.
+  int64_t AddObserver(
+      EngineHandle engine, Dart_Port_DL port,
+      std::unique_ptr<const MessageFilter> filter,
+      const std::vector<std::pair<uint32_t, CoalescePolicy>>& policies);
+
+  // Returns the new observer, owned by the engine's dispatcher until it is
+  // removed, or null if |engine| is not registered.
+  RingObserver* AddRingObserver(EngineHandle engine, Dart_Port_DL wake_port,
+                                std::unique_ptr<const MessageFilter> filter,
+                                size_t capacity, RingDropPolicy policy);
+
+  // Posts each WM_COPYDATA payload sent to |window|, or to any window if it
+  // is 0, to |port| as a CopyDataObserver. Returns the new observer's ID, or
+  // 0 if |engine| is not registered.
+  int64_t AddCopyDataObserver(EngineHandle engine, Dart_Port_DL port,
+                              intptr_t window);
+
+  void RemoveObserver(EngineHandle engine, int64_t observer_id);
+
+  // Posts the messages accepted by |filter| that reach the windows of any
+  // registered engine to |port|, once per broadcast; see BroadcastHub.
+  // Returns the subscription's ID.
+  int64_t SubscribeBroadcast(Dart_Port_DL port,
+                             std::unique_ptr<const MessageFilter> filter);
+  void UnsubscribeBroadcast(int64_t subscription_id);
+
+  // The setters below return false if |engine| is not registered.
+  bool SetHitTestIndex(EngineHandle engine, intptr_t window,
+                       std::shared_ptr<const HitTestIndex> index);
+  bool SetReplyRules(EngineHandle engine,
+                     std::unique_ptr<const ReplyRuleTable> rules);
+  bool SetChords(EngineHandle engine, std::unique_ptr<const ChordTable> chords,
+                 Dart_Port_DL port);
+
+  // Starts tracing the engine's messages to |file|, which this takes
+  // ownership of, through a ring of |capacity| records. Returns false if
+  // |engine| is not registered or the trace cannot be started.
+  bool StartTrace(EngineHandle engine, std::FILE* file, size_t capacity);
+
+  // Returns the number of records written, or -1 if |engine| is not
+  // registered or was not tracing.
+  int64_t StopTrace(EngineHandle engine);
+
+  // Returns the cached state of |window|, valid until the engine
+  // unregisters, or null if |engine| is not registered.
+  const WindowStateBlock* WatchWindowState(EngineHandle engine,
+                                           intptr_t window);
+
+  // Starts accumulating the raw mouse input of |engine| into batches of up
+  // to |capacity| records; see Dispatcher::StartRawInput(). Returns the
+  // accumulator, valid until StopRawInput() or until the engine
+  // unregisters, or null if |engine| is not registered or the platform
+  // refused.
+  RawInputAccumulator* StartRawInput(EngineHandle engine,
+                                     Dart_Port_DL wake_port,
+                                     size_t capacity);
+
+  // Stops raw input if |accumulator| is the engine's current one. Returns
+  // false if |engine| is not registered or |accumulator| is not current.
+  bool StopRawInput(EngineHandle engine,
+                    const RawInputAccumulator* accumulator);
+
+  // Returns the engine's latency histograms, valid until it unregisters,
+  // or null if |engine| is not registered.
+  DispatchLatency* SetLatencyTracking(EngineHandle engine, bool enabled);
+
+  // Configures the engine's delegate watchdog; see
+  // DelegateWatchdog::Configure(). Returns the watchdog, valid until the
+  // engine unregisters, or null if |engine| is not registered or the policy
+  // is invalid.
+  DelegateWatchdog* SetWatchdog(EngineHandle engine,
+                                uint64_t budget_ns,
+                                uint32_t strikes,
+                                uint32_t window);
+
+  // Starts recording the engine's dispatch to the Dart timeline through
+  // |api|, or stops if |api| is null. Returns false if |engine| is not
+  // registered.
+  bool SetTimeline(EngineHandle engine, const TimelineApi* api);
+
+ private:
+  // A registered engine. Slots are reused for later engines; the
+  // generation, which is part of the handle, tells them apart.
+  struct Slot {
+    std::atomic<uint32_t> generation{1};
+    std::atomic<Dispatcher*> dispatcher{nullptr};
+  };
+
+  // Open-addressed engine ID -> handle table with linear probing. Kept at
+  // most half full, counting deleted entries, so probes always terminate.
+  struct Table {
+    struct Entry {
+      std::atomic<int64_t> engine_id;
+      std::atomic<EngineHandle> handle{0};
+    };
+
+    explicit Table(size_t capacity);
+
+    const size_t mask;
+    const std::unique_ptr<Entry[]> entries;
+    // Writer-side counts.
+    size_t used = 0;
+    size_t live = 0;
+  };
+
+  // A plugin attached under some key, and the engine it was bound to.
+  struct AttachedPlugin {
+    Dispatcher* dispatcher = nullptr;
+    bool bound = false;
+    int64_t engine_id = 0;
+  };
+
+  static constexpr size_t kSlotsPerChunk = 64;
+  static constexpr size_t kMaxChunks = 1024;
+
+  // Returns the dispatcher |engine| refers to, or null. The caller must
+  // hold an EpochGuard for as long as it uses the dispatcher.
+  Dispatcher* Resolve(EngineHandle engine) const;
+
+  Slot* SlotAt(size_t index) const;
+
+  // Register() with |mutex_| held.
+  EngineHandle RegisterLocked(int64_t engine_id, Dispatcher* dispatcher);
+
+  // Bind() with |mutex_| held.
+  EngineHandle BindLocked(int64_t engine_id);
+
+  // Inserts or replaces the handle of |engine_id|, growing the table if
+  // needed. Must be called with |mutex_| held.
+  void InsertLocked(int64_t engine_id, EngineHandle engine);
+
+  // Pushes the native handlers of |key| to its dispatcher, if attached.
+  // Must be called with |mutex_| held.
+  void PublishNativeHandlersLocked(intptr_t key);
+
+  // Pushes the broadcast hub's filter to every registered engine. Must be
+  // called with |mutex_| held.
+  void PublishBroadcastFilterLocked();
+
+  // Returns the entry of |engine_id| or null. Must be called with |mutex_|
+  // held.
+  Table::Entry* FindEntryLocked(int64_t engine_id) const;
+
+  std::atomic<Table*> table_;
+  std::atomic<Slot*> chunks_[kMaxChunks] = {};
+
+  // Writer-side state, guarded by |mutex_|.
+  size_t slot_count_ = 0;
+  std::vector<size_t> free_slots_;
+  std::map<intptr_t, AttachedPlugin> attached_;
+  std::map<intptr_t, std::vector<NativeHandlerTable::Registration>>
+      native_handlers_;
+  int64_t next_native_handler_id_ = 1;
+  // Ports to post to when the next plugin attaches.
+  std::vector<Dart_Port_DL> attach_ports_;
+  EngineLocator locator_;
+  std::mutex mutex_;
+
+  BroadcastHub broadcast_hub_;
+  std::atomic<int64_t> next_observer_id_{1};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_ENGINE_REGISTRY_H_
@@ -0,0 +1,134 @@
+#include "epoch.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace window_proc_delegate {
+
+namespace {
+
+// Returns the calling thread's participant to the pool when it exits.
+struct ThreadRegistration {
+  ~ThreadRegistration() {
+    if (participant) {
+      participant->in_use.store(false, std::memory_order_release);
+    }
+  }
+
+  EpochDomain::Participant* participant = nullptr;
+};
+
+}  // namespace
+
+// static
+EpochDomain& EpochDomain::Global() {
+  // Leaked: threads may still hold guards during static destruction.
+  static EpochDomain* domain = new EpochDomain();
+  return *domain;
+}
+
+// static
+EpochDomain::Participant* EpochDomain::ThreadParticipant() {
+  thread_local ThreadRegistration registration;
+  if (!registration.participant) {
+    registration.participant = Global().AcquireParticipant();
+  }
+  return registration.participant;
+}
+
+EpochDomain::Participant* EpochDomain::AcquireParticipant() {
+  for (Participant* participant =
+           participants_.load(std::memory_order_acquire);
+       participant; participant = participant->next) {
+    bool in_use = false;
+    if (participant->in_use.compare_exchange_strong(
+            in_use, true, std::memory_order_acquire)) {
+      return participant;
+    }
+  }
+
+  // Participants are never freed, so the list can be walked without locks.
+  auto* participant = new Participant();
+  participant->in_use.store(true, std::memory_order_relaxed);
+  Participant* head = participants_.load(std::memory_order_relaxed);
+  do {
+    participant->next = head;
+  } while (!participants_.compare_exchange_weak(head, participant,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+  return participant;
+}
+
+void EpochDomain::Retire(void* object, void (*deleter)(void*)) {
+  std::vector<Retired> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retired_.push_back(
+        Retired{object, deleter, epoch_.load(std::memory_order_seq_cst)});
+    TryAdvanceLocked();
+    CollectLocked(&ready);
+  }
+  // Deleters may retire further objects.
+  for (const Retired& retired : ready) {
+    retired.deleter(retired.object);
+  }
+}
+
+void EpochDomain::Synchronize() {
+  const Participant* self = ThreadParticipant();
+  for (Participant* participant =
+           participants_.load(std::memory_order_acquire);
+       participant; participant = participant->next) {
+    if (participant == self) {
+      continue;
+    }
+    const uint64_t state = participant->state.load(std::memory_order_seq_cst);
+    if (!(state & kActive)) {
+      continue;
+    }
+    // Any change means that guard was released.
+    while (participant->state.load(std::memory_order_acquire) == state) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void EpochDomain::Collect() {
+  std::vector<Retired> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TryAdvanceLocked();
+    TryAdvanceLocked();
+    CollectLocked(&ready);
+  }
+  for (const Retired& retired : ready) {
+    retired.deleter(retired.object);
+  }
+}
+
+void EpochDomain::TryAdvanceLocked() {
+  const uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+  for (Participant* participant =
+           participants_.load(std::memory_order_acquire);
+       participant; participant = participant->next) {
+    const uint64_t state = participant->state.load(std::memory_order_seq_cst);
+    if ((state & kActive) &&
+        (state >> 32) != static_cast<uint32_t>(epoch)) {
+      return;
+    }
+  }
+  epoch_.store(epoch + 1, std::memory_order_seq_cst);
+}
+
+void EpochDomain::CollectLocked(std::vector<Retired>* ready) {
+  // Guards active now entered at the current epoch or the one before, so
+  // nothing retired before that can still be reachable.
+  const uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+  auto pending = std::partition(
+      retired_.begin(), retired_.end(),
+      [epoch](const Retired& retired) { return retired.epoch + 2 > epoch; });
+  ready->assign(pending, retired_.end());
+  retired_.erase(pending, retired_.end());
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,127 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_EPOCH_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_EPOCH_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace window_proc_delegate {
+
+// Epoch-based reclamation for state read without locks.
+//
+// Readers hold an EpochGuard for as long as they use pointers loaded from
+// shared state. Writers unlink an object, then Retire() it; it is deleted
+// once every guard that might have loaded it has been released. Owners that
+// must destroy an unlinked object themselves call Synchronize() instead.
+//
+// There is one domain per process. Each thread gets a participant record on
+// first use, which is recycled when the thread exits.
+class EpochDomain {
+ public:
+  // Per-thread reader state. Only the owning thread writes it.
+  struct alignas(64) Participant {
+    // Bit 0: inside a guard. Bits 1-31: count of outermost guards entered,
+    // so a re-entered guard is told apart from the one it replaced.
+    // Bits 32-63: the global epoch observed on entry.
+    std::atomic<uint64_t> state{0};
+    std::atomic<bool> in_use{false};
+    uint32_t depth = 0;
+    uint32_t sections = 0;
+    // Immutable once the participant is linked.
+    Participant* next = nullptr;
+  };
+
+  static EpochDomain& Global();
+
+  // Disallow copy and assign.
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  // Deletes |object| once no guard can still be using it.
+  template <typename T>
+  void Retire(const T* object) {
+    Retire(const_cast<T*>(object),
+           [](void* retired) { delete static_cast<T*>(retired); });
+  }
+  void Retire(void* object, void (*deleter)(void*));
+
+  // Blocks until every guard held by another thread when this was called
+  // has been released. Guards held by the calling thread are ignored.
+  void Synchronize();
+
+  // Deletes the retired objects whose grace period has passed. Retire()
+  // does this as well.
+  void Collect();
+
+  Participant* Enter() {
+    Participant* participant = ThreadParticipant();
+    if (participant->depth++ == 0) {
+      participant->sections++;
+      // The read-modify-write orders the announcement before every load
+      // the guard protects.
+      participant->state.exchange(
+          (epoch_.load(std::memory_order_seq_cst) << 32) |
+              (static_cast<uint64_t>(participant->sections & 0x7FFFFFFF)
+               << 1) |
+              kActive,
+          std::memory_order_seq_cst);
+    }
+    return participant;
+  }
+
+  void Exit(Participant* participant) {
+    if (--participant->depth == 0) {
+      participant->state.store(
+          static_cast<uint64_t>(participant->sections & 0x7FFFFFFF) << 1,
+          std::memory_order_release);
+    }
+  }
+
+ private:
+  static constexpr uint64_t kActive = 1;
+
+  struct Retired {
+    void* object;
+    void (*deleter)(void*);
+    uint64_t epoch;
+  };
+
+  EpochDomain() = default;
+
+  static Participant* ThreadParticipant();
+  Participant* AcquireParticipant();
+
+  // Advances the global epoch if every active participant has observed it.
+  // Must be called with |mutex_| held.
+  void TryAdvanceLocked();
+
+  // Moves the objects retired at least two epochs ago to |ready|. Must be
+  // called with |mutex_| held.
+  void CollectLocked(std::vector<Retired>* ready);
+
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<Participant*> participants_{nullptr};
+
+  std::vector<Retired> retired_;
+  std::mutex mutex_;
+};
+
+// Keeps pointers loaded from epoch-protected state valid while alive.
+// Guards nest; only the outermost one costs a fenced store.
+class EpochGuard {
+ public:
+  EpochGuard() : participant_(EpochDomain::Global().Enter()) {}
+  ~EpochGuard() { EpochDomain::Global().Exit(participant_); }
+
+  // Disallow copy and assign.
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+ private:
+  EpochDomain::Participant* const participant_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_EPOCH_H_
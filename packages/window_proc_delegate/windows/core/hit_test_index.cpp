@@ -0,0 +1,115 @@
+#include "hit_test_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace window_proc_delegate {
+
+namespace {
+// Upper bound on grid cells per axis; keeps the grid small for thousands of
+// regions while still separating them.
+constexpr int32_t kMaxCellsPerAxis = 64;
+
+bool Contains(const HitTestRegion& region, int32_t x, int32_t y) {
+  return x >= region.left && x < region.right && y >= region.top &&
+         y < region.bottom;
+}
+
+int32_t CeilDiv(int64_t value, int64_t divisor) {
+  return static_cast<int32_t>((value + divisor - 1) / divisor);
+}
+}  // namespace
+
+HitTestIndex::HitTestIndex(std::vector<HitTestRegion> regions) {
+  regions.erase(std::remove_if(regions.begin(), regions.end(),
+                               [](const HitTestRegion& region) {
+                                 return region.left >= region.right ||
+                                        region.top >= region.bottom;
+                               }),
+                regions.end());
+  regions_ = std::move(regions);
+  if (regions_.empty()) {
+    return;
+  }
+
+  left_ = top_ = std::numeric_limits<int32_t>::max();
+  right_ = bottom_ = std::numeric_limits<int32_t>::min();
+  for (const HitTestRegion& region : regions_) {
+    left_ = std::min(left_, region.left);
+    top_ = std::min(top_, region.top);
+    right_ = std::max(right_, region.right);
+    bottom_ = std::max(bottom_, region.bottom);
+  }
+
+  // Roughly one region per cell on each axis.
+  const int32_t cells_per_axis = std::clamp(
+      static_cast<int32_t>(std::sqrt(static_cast<double>(regions_.size()))) +
+          1,
+      1, kMaxCellsPerAxis);
+  const int64_t width = static_cast<int64_t>(right_) - left_;
+  const int64_t height = static_cast<int64_t>(bottom_) - top_;
+  cell_width_ = std::max(1, CeilDiv(width, cells_per_axis));
+  cell_height_ = std::max(1, CeilDiv(height, cells_per_axis));
+  columns_ = CeilDiv(width, cell_width_);
+  rows_ = CeilDiv(height, cell_height_);
+
+  // Two passes over the regions: count entries per cell, then fill them
+  // from the topmost region down.
+  const size_t cell_count = static_cast<size_t>(columns_) * rows_;
+  cell_offsets_.assign(cell_count + 1, 0);
+  auto for_each_cell = [this](const HitTestRegion& region, auto&& visit) {
+    const int32_t first_column = CellOf(region.left, left_, cell_width_,
+                                        columns_);
+    const int32_t last_column = CellOf(static_cast<int64_t>(region.right) - 1,
+                                       left_, cell_width_, columns_);
+    const int32_t first_row = CellOf(region.top, top_, cell_height_, rows_);
+    const int32_t last_row = CellOf(static_cast<int64_t>(region.bottom) - 1,
+                                    top_, cell_height_, rows_);
+    for (int32_t row = first_row; row <= last_row; row++) {
+      for (int32_t column = first_column; column <= last_column; column++) {
+        visit(static_cast<size_t>(row) * columns_ + column);
+      }
+    }
+  };
+  for (const HitTestRegion& region : regions_) {
+    for_each_cell(region, [this](size_t cell) { cell_offsets_[cell + 1]++; });
+  }
+  for (size_t cell = 0; cell < cell_count; cell++) {
+    cell_offsets_[cell + 1] += cell_offsets_[cell];
+  }
+  cell_regions_.resize(cell_offsets_[cell_count]);
+  std::vector<uint32_t> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+  for (size_t i = regions_.size(); i-- > 0;) {
+    for_each_cell(regions_[i], [&](size_t cell) {
+      cell_regions_[fill[cell]++] = static_cast<uint32_t>(i);
+    });
+  }
+}
+
+bool HitTestIndex::Lookup(int32_t x, int32_t y, int32_t* code) const {
+  if (regions_.empty() || x < left_ || x >= right_ || y < top_ ||
+      y >= bottom_) {
+    return false;
+  }
+
+  const size_t cell =
+      static_cast<size_t>(CellOf(y, top_, cell_height_, rows_)) * columns_ +
+      CellOf(x, left_, cell_width_, columns_);
+  for (uint32_t i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; i++) {
+    const HitTestRegion& region = regions_[cell_regions_[i]];
+    if (Contains(region, x, y)) {
+      *code = region.code;
+      return true;
+    }
+  }
+  return false;
+}
+
+int32_t HitTestIndex::CellOf(int64_t value, int32_t origin, int32_t cell_size,
+                             int32_t cells) const {
+  const int64_t cell = (value - origin) / cell_size;
+  return static_cast<int32_t>(std::clamp<int64_t>(cell, 0, cells - 1));
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,86 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_HIT_TEST_INDEX_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_HIT_TEST_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace window_proc_delegate {
+
+// A rectangle in window client coordinates, right and bottom exclusive,
+// answering WM_NCHITTEST with |code| (HTCAPTION, HTLEFT, HTCLIENT, ...).
+struct HitTestRegion {
+  int32_t left;
+  int32_t top;
+  int32_t right;
+  int32_t bottom;
+  int32_t code;
+};
+
+static_assert(sizeof(HitTestRegion) == 5 * sizeof(int32_t),
+              "HitTestRegion is uploaded from Dart as packed int32 values");
+
+// Immutable spatial index over a window's hit-test regions.
+//
+// Regions are given in paint order: where regions overlap, the later one is
+// on top and wins. The bounding box of all regions is divided into a uniform
+// grid, and each cell lists the regions overlapping it from top to bottom,
+// so a lookup only tests the handful of regions near the point.
+class HitTestIndex {
+ public:
+  explicit HitTestIndex(std::vector<HitTestRegion> regions);
+
+  // Disallow copy and assign.
+  HitTestIndex(const HitTestIndex&) = delete;
+  HitTestIndex& operator=(const HitTestIndex&) = delete;
+
+  // Stores the code of the topmost region containing (x, y) in |code| and
+  // returns true, or returns false if no region contains the point.
+  bool Lookup(int32_t x, int32_t y, int32_t* code) const;
+
+  size_t region_count() const { return regions_.size(); }
+
+ private:
+  // Returns the cell column or row containing |value|, clamped to the grid.
+  int32_t CellOf(int64_t value, int32_t origin, int32_t cell_size,
+                 int32_t cells) const;
+
+  std::vector<HitTestRegion> regions_;
+
+  // Grid over [left_, right_) x [top_, bottom_).
+  int32_t left_ = 0;
+  int32_t top_ = 0;
+  int32_t right_ = 0;
+  int32_t bottom_ = 0;
+  int32_t cell_width_ = 1;
+  int32_t cell_height_ = 1;
+  int32_t columns_ = 0;
+  int32_t rows_ = 0;
+
+  // Region indices per cell, topmost first. Cell c owns
+  // cell_regions_[cell_offsets_[c], cell_offsets_[c + 1]).
+  std::vector<uint32_t> cell_offsets_;
+  std::vector<uint32_t> cell_regions_;
+};
+
+// The hit-test indices of a plugin's windows, keyed by window handle. A
+// plugin serves one top-level window or a few, so a linear scan is enough.
+struct WindowHitTests {
+  std::vector<std::pair<intptr_t, std::shared_ptr<const HitTestIndex>>>
+      windows;
+
+  const HitTestIndex* Find(intptr_t window_handle) const {
+    for (const auto& window : windows) {
+      if (window.first == window_handle) {
+        return window.second.get();
+      }
+    }
+    return nullptr;
+  }
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_HIT_TEST_INDEX_H_
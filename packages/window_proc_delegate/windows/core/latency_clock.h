@@ -0,0 +1,34 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_LATENCY_CLOCK_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_LATENCY_CLOCK_H_
+
+#include <cstdint>
+
+namespace window_proc_delegate {
+
+// Monotonic clock used for latency measurements. The Windows plugin reads
+// QueryPerformanceCounter; tests inject a fake.
+class LatencyClock {
+ public:
+  virtual ~LatencyClock() = default;
+
+  virtual uint64_t NowNanoseconds() = 0;
+
+  // When the message being handled was posted to the thread's queue, on
+  // the NowNanoseconds() clock, as far as the platform can tell. Only
+  // meaningful for posted input messages; see IsPostedInputMessage().
+  virtual uint64_t PostedNanoseconds() = 0;
+};
+
+// Whether |message| is normally posted to the message queue, rather than
+// sent straight to the window procedure, so PostedNanoseconds() tells how
+// long it waited: keyboard, mouse, non-client mouse and raw input.
+constexpr bool IsPostedInputMessage(uint32_t message) {
+  return (message >= 0x0100 && message <= 0x0109) ||  // WM_KEYFIRST..LAST
+         (message >= 0x0200 && message <= 0x020E) ||  // WM_MOUSEFIRST..LAST
+         (message >= 0x00A0 && message <= 0x00AD) ||  // WM_NCMOUSEMOVE..
+         message == 0x00FF;                           // WM_INPUT
+}
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_LATENCY_CLOCK_H_
@@ -0,0 +1,214 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+
+namespace window_proc_delegate {
+
+namespace {
+constexpr int kSubBucketBits = 4;
+
+int HighestBit(uint64_t value) {
+  int bit = 0;
+  while (value >>= 1) {
+    bit++;
+  }
+  return bit;
+}
+}  // namespace
+
+// static
+size_t LatencyHistogram::BucketOf(uint64_t nanoseconds) {
+  if (nanoseconds < 2 * kSubBuckets) {
+    return static_cast<size_t>(nanoseconds);
+  }
+  // Keep the top kSubBucketBits + 1 bits: the mantissa lies in
+  // [kSubBuckets, 2 * kSubBuckets).
+  const int shift = HighestBit(nanoseconds) - kSubBucketBits;
+  return kSubBuckets * static_cast<size_t>(shift) +
+         static_cast<size_t>(nanoseconds >> shift);
+}
+
+// static
+uint64_t LatencyHistogram::BucketHighestValue(size_t bucket) {
+  if (bucket < 2 * kSubBuckets) {
+    return bucket;
+  }
+  const size_t shift = bucket / kSubBuckets - 1;
+  const uint64_t mantissa = bucket % kSubBuckets + kSubBuckets;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+bool LatencyHistogram::Summarize(LatencySummary* summary) const {
+  std::array<uint32_t, kBucketCount> counts;
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBucketCount; i++) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return false;
+  }
+
+  const uint64_t max = max_.load(std::memory_order_relaxed);
+  auto percentile = [&](uint64_t per_mille) {
+    // The smallest value with at least per_mille of the samples at or
+    // below it.
+    const uint64_t rank =
+        std::max<uint64_t>(1, (total * per_mille + 999) / 1000);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        return static_cast<int64_t>(std::min(BucketHighestValue(i), max));
+      }
+    }
+    return static_cast<int64_t>(max);
+  };
+  summary->count = static_cast<int64_t>(total);
+  summary->p50 = percentile(500);
+  summary->p99 = percentile(990);
+  summary->max = static_cast<int64_t>(max);
+  return true;
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  max_.store(0, std::memory_order_relaxed);
+}
+
+LatencyTable::~LatencyTable() {
+  for (auto& page_pointer : pages_) {
+    Page* page = page_pointer.load(std::memory_order_relaxed);
+    if (!page) {
+      continue;
+    }
+    for (auto& histogram : page->histograms) {
+      delete histogram.load(std::memory_order_relaxed);
+    }
+    delete page;
+  }
+}
+
+void LatencyTable::Record(uint32_t message, uint64_t nanoseconds) {
+  message = std::min(message, kMessageCount - 1);
+
+  // Only the recording thread allocates, so a plain load-then-store
+  // publishes each page and histogram exactly once.
+  auto& page_pointer = pages_[message / kPageSize];
+  Page* page = page_pointer.load(std::memory_order_acquire);
+  if (!page) {
+    page = new Page();
+    page_pointer.store(page, std::memory_order_release);
+  }
+  auto& histogram_pointer = page->histograms[message % kPageSize];
+  LatencyHistogram* histogram =
+      histogram_pointer.load(std::memory_order_acquire);
+  if (!histogram) {
+    histogram = new LatencyHistogram();
+    histogram_pointer.store(histogram, std::memory_order_release);
+  }
+  histogram->Record(nanoseconds);
+}
+
+size_t LatencyTable::Snapshot(LatencySummary* out, size_t capacity) const {
+  size_t count = 0;
+  for (uint32_t page_index = 0; page_index < pages_.size(); page_index++) {
+    const Page* page = pages_[page_index].load(std::memory_order_acquire);
+    if (!page) {
+      continue;
+    }
+    for (uint32_t i = 0; i < kPageSize; i++) {
+      const LatencyHistogram* histogram =
+          page->histograms[i].load(std::memory_order_acquire);
+      LatencySummary summary;
+      if (!histogram || !histogram->Summarize(&summary)) {
+        continue;
+      }
+      if (count < capacity) {
+        summary.message = page_index * kPageSize + i;
+        out[count] = summary;
+      }
+      count++;
+    }
+  }
+  return count;
+}
+
+void LatencyTable::Reset() {
+  for (const auto& page_pointer : pages_) {
+    const Page* page = page_pointer.load(std::memory_order_acquire);
+    if (!page) {
+      continue;
+    }
+    for (const auto& histogram_pointer : page->histograms) {
+      if (LatencyHistogram* histogram =
+              histogram_pointer.load(std::memory_order_acquire)) {
+        histogram->Reset();
+      }
+    }
+  }
+}
+
+DispatchLatency::~DispatchLatency() {
+  for (auto& table : delegates_) {
+    delete table.load(std::memory_order_relaxed);
+  }
+}
+
+void DispatchLatency::RecordDelivered(uint32_t message, uint64_t queued_ns) {
+  if (!clock_) {
+    return;
+  }
+  const uint64_t now = clock_->NowNanoseconds();
+  stage(LatencyStage::kDelivered)
+      .Record(message, now > queued_ns ? now - queued_ns : 0);
+}
+
+void DispatchLatency::RecordDelegate(int64_t delegate_id,
+                                     uint32_t message,
+                                     uint64_t nanoseconds) {
+  if (delegate_id < 0 || static_cast<uint64_t>(delegate_id) >= kMaxDelegates) {
+    return;
+  }
+  auto& table_pointer = delegates_[static_cast<size_t>(delegate_id)];
+  LatencyTable* table = table_pointer.load(std::memory_order_acquire);
+  if (!table) {
+    table = new LatencyTable();
+    table_pointer.store(table, std::memory_order_release);
+  }
+  table->Record(message, nanoseconds);
+}
+
+const LatencyTable* DispatchLatency::delegate(int64_t delegate_id) const {
+  if (delegate_id < 0 || static_cast<uint64_t>(delegate_id) >= kMaxDelegates) {
+    return nullptr;
+  }
+  return delegates_[static_cast<size_t>(delegate_id)].load(
+      std::memory_order_acquire);
+}
+
+void DispatchLatency::Reset() {
+  dispatch_.Reset();
+  for (LatencyTable& table : stages_) {
+    table.Reset();
+  }
+  for (const auto& table_pointer : delegates_) {
+    if (LatencyTable* table = table_pointer.load(std::memory_order_acquire)) {
+      table->Reset();
+    }
+  }
+}
+
+void DispatchLatency::ResetDelegate(int64_t delegate_id) {
+  if (delegate_id < 0 || static_cast<uint64_t>(delegate_id) >= kMaxDelegates) {
+    return;
+  }
+  if (LatencyTable* table = delegates_[static_cast<size_t>(delegate_id)].load(
+          std::memory_order_acquire)) {
+    table->Reset();
+  }
+}
+
+}  // namespace window_proc_delegate
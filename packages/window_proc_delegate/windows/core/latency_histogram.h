@@ -0,0 +1,189 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_LATENCY_HISTOGRAM_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "latency_clock.h"
+
+namespace window_proc_delegate {
+
+// Summary of a histogram, in nanoseconds. Percentiles are reported as the
+// highest value of their bucket, capped at |max|.
+struct LatencySummary {
+  int64_t message;
+  int64_t count;
+  int64_t p50;
+  int64_t p99;
+  int64_t max;
+};
+
+constexpr size_t kLatencySummaryFields = 5;
+static_assert(sizeof(LatencySummary) == kLatencySummaryFields * sizeof(int64_t),
+              "LatencySummary is read from Dart as packed int64 values");
+
+// Log-linear latency histogram in the style of HdrHistogram: values below
+// 32 ns are counted exactly, larger values in 16 buckets per power of two,
+// for a relative error below 1/16.
+//
+// Recording is meant for a single thread (the window thread) and uses
+// relaxed atomics, so other threads may read or reset the counts at any
+// time. A Reset() racing a Record() may keep or lose that one sample.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBuckets = 16;
+  static constexpr size_t kBucketCount = 2 * kSubBuckets + kSubBuckets * 59;
+
+  LatencyHistogram() = default;
+
+  // Disallow copy and assign.
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void Record(uint64_t nanoseconds) {
+    auto& bucket = counts_[BucketOf(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    if (nanoseconds > max_.load(std::memory_order_relaxed)) {
+      max_.store(nanoseconds, std::memory_order_relaxed);
+    }
+  }
+
+  // Fills |summary| except for its message field. Returns false, leaving
+  // |summary| untouched, if nothing was recorded.
+  bool Summarize(LatencySummary* summary) const;
+
+  void Reset();
+
+  // Exposed for tests.
+  static size_t BucketOf(uint64_t nanoseconds);
+  static uint64_t BucketHighestValue(size_t bucket);
+
+ private:
+  std::array<std::atomic<uint32_t>, kBucketCount> counts_ = {};
+  std::atomic<uint64_t> max_{0};
+};
+
+// Per-message latency histograms. Histograms are allocated the first time
+// their message is recorded, from a two-level table of pages of 256
+// messages, so tracking a few dozen message kinds costs a few dozen
+// histograms.
+//
+// Same threading contract as LatencyHistogram: one recording thread, any
+// number of readers.
+class LatencyTable {
+ public:
+  static constexpr uint32_t kMessageCount = 0x10000;
+
+  LatencyTable() = default;
+  ~LatencyTable();
+
+  // Disallow copy and assign.
+  LatencyTable(const LatencyTable&) = delete;
+  LatencyTable& operator=(const LatencyTable&) = delete;
+
+  // Records a sample for |message|. Messages above 0xFFFF are counted as
+  // 0xFFFF.
+  void Record(uint32_t message, uint64_t nanoseconds);
+
+  // Writes the summaries of up to |capacity| messages with samples, in
+  // ascending message order, to |out|. Returns the number of such messages,
+  // which may exceed |capacity|.
+  size_t Snapshot(LatencySummary* out, size_t capacity) const;
+
+  void Reset();
+
+ private:
+  static constexpr uint32_t kPageSize = 256;
+
+  struct Page {
+    std::array<std::atomic<LatencyHistogram*>, kPageSize> histograms = {};
+  };
+
+  std::array<std::atomic<Page*>, kMessageCount / kPageSize> pages_ = {};
+};
+
+// Stages of a message's way to Dart, each measured per message from when
+// the message entered the stage.
+enum class LatencyStage : int32_t {
+  // From being posted to reaching the plugin; posted input messages only.
+  kQueued = 0,
+  // From being posted, or reaching the plugin if it was not posted input,
+  // to the synchronous Dart call returning.
+  kHandled = 1,
+  // From being queued for the asynchronous observers to their batches
+  // being posted, once the message pump gets to the flush. Measured from
+  // the first message queued since the previous flush.
+  kPending = 2,
+  // From being queued for the asynchronous observers to Dart draining
+  // their batch, as reported by Dart.
+  kDelivered = 3,
+};
+
+constexpr size_t kLatencyStageCount = 4;
+
+// Latency of a plugin's synchronous dispatch to Dart, per message for the
+// whole round trip and per message for each delegate (as timed by Dart),
+// and of each LatencyStage, per message. Recording is switched on and off
+// at runtime; when off, the window procedure pays a single relaxed load.
+class DispatchLatency {
+ public:
+  // Delegates with higher IDs are not attributed.
+  static constexpr size_t kMaxDelegates = 256;
+
+  // Stages reported by Dart are timed with |clock|, which must outlive
+  // this object; without one they are not recorded.
+  explicit DispatchLatency(LatencyClock* clock = nullptr) : clock_(clock) {}
+  ~DispatchLatency();
+
+  // Disallow copy and assign.
+  DispatchLatency(const DispatchLatency&) = delete;
+  DispatchLatency& operator=(const DispatchLatency&) = delete;
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Time from entering to leaving Dart, per message.
+  LatencyTable& dispatch() { return dispatch_; }
+  const LatencyTable& dispatch() const { return dispatch_; }
+
+  LatencyTable& stage(LatencyStage stage) {
+    return stages_[static_cast<size_t>(stage)];
+  }
+  const LatencyTable& stage(LatencyStage stage) const {
+    return stages_[static_cast<size_t>(stage)];
+  }
+
+  // Records the kDelivered stage of |message|, queued at |queued_ns| on the
+  // clock and drained by Dart now.
+  void RecordDelivered(uint32_t message, uint64_t queued_ns);
+
+  // Records the time delegate |delegate_id| spent on |message|. Must be
+  // called from the recording thread.
+  void RecordDelegate(int64_t delegate_id, uint32_t message,
+                      uint64_t nanoseconds);
+
+  // Returns the table of |delegate_id|, or null if it has no samples.
+  const LatencyTable* delegate(int64_t delegate_id) const;
+
+  // Clears every histogram, keeping their storage.
+  void Reset();
+
+  // Clears the histograms of |delegate_id|, whose ID is being reused.
+  void ResetDelegate(int64_t delegate_id);
+
+ private:
+  LatencyClock* const clock_;
+  std::atomic<bool> enabled_{false};
+  LatencyTable dispatch_;
+  std::array<LatencyTable, kLatencyStageCount> stages_;
+  std::array<std::atomic<LatencyTable*>, kMaxDelegates> delegates_ = {};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_LATENCY_HISTOGRAM_H_
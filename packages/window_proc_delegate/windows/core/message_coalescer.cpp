@@ -0,0 +1,135 @@
+#include "message_coalescer.h"
+
+#include <algorithm>
+
+namespace window_proc_delegate {
+
+namespace {
+constexpr size_t kInitialSlots = 64;
+
+size_t HashKey(int64_t window_handle, int64_t message) {
+  uint64_t hash = static_cast<uint64_t>(window_handle) * 0x9E3779B97F4A7C15ull;
+  hash ^= static_cast<uint64_t>(message) + (hash >> 29);
+  return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+int64_t WheelDelta(int64_t wparam) {
+  return static_cast<int16_t>((static_cast<uint64_t>(wparam) >> 16) & 0xFFFF);
+}
+
+int64_t WithAccumulatedDelta(int64_t wparam, int64_t delta) {
+  return static_cast<int64_t>(static_cast<uint64_t>(delta) << 16) |
+         (wparam & 0xFFFF);
+}
+}  // namespace
+
+MessageCoalescer::MessageCoalescer() : slots_(kInitialSlots) {}
+
+void MessageCoalescer::SetPolicy(uint32_t message, CoalescePolicy policy) {
+  auto it = std::lower_bound(
+      policies_.begin(), policies_.end(), message,
+      [](const auto& entry, uint32_t key) { return entry.first < key; });
+  if (it != policies_.end() && it->first == message) {
+    it->second = policy;
+  } else {
+    policies_.insert(it, std::make_pair(message, policy));
+  }
+}
+
+CoalescePolicy MessageCoalescer::PolicyFor(uint32_t message) const {
+  for (const auto& entry : policies_) {
+    if (entry.first == message) {
+      return entry.second;
+    }
+    if (entry.first > message) {
+      break;
+    }
+  }
+  return CoalescePolicy::kNone;
+}
+
+void MessageCoalescer::Add(const ObservedMessage& message) {
+  const CoalescePolicy policy =
+      PolicyFor(static_cast<uint32_t>(message.message));
+  if (policy == CoalescePolicy::kNone) {
+    pending_.push_back(message);
+    pending_.back().count = 1;
+    return;
+  }
+
+  ObservedMessage merged = message;
+  merged.count = 1;
+  if (policy == CoalescePolicy::kAccumulate) {
+    merged.wParam = WithAccumulatedDelta(message.wParam,
+                                         WheelDelta(message.wParam));
+  }
+
+  Slot& slot = FindSlot(message);
+  if (slot.generation == generation_) {
+    ObservedMessage& previous = pending_[slot.index];
+    merged.count += previous.count;
+    if (policy == CoalescePolicy::kAccumulate) {
+      merged.wParam = WithAccumulatedDelta(
+          message.wParam, (previous.wParam >> 16) + WheelDelta(message.wParam));
+    }
+    // Tombstone the superseded record; the merged one moves to the end.
+    previous.count = 0;
+  } else {
+    slot.generation = generation_;
+    slot.window_handle = message.windowHandle;
+    slot.message = message.message;
+    live_keys_++;
+  }
+  slot.index = static_cast<uint32_t>(pending_.size());
+  pending_.push_back(merged);
+
+  if (live_keys_ * 2 > slots_.size()) {
+    Grow();
+  }
+}
+
+void MessageCoalescer::Flush(std::vector<ObservedMessage>* out) {
+  for (const ObservedMessage& record : pending_) {
+    if (record.count > 0) {
+      out->push_back(record);
+    }
+  }
+  pending_.clear();
+  live_keys_ = 0;
+  if (++generation_ == 0) {
+    // Generation wrapped; make sure no stale slot looks live.
+    std::fill(slots_.begin(), slots_.end(), Slot{});
+    generation_ = 1;
+  }
+}
+
+MessageCoalescer::Slot& MessageCoalescer::FindSlot(
+    const ObservedMessage& message) {
+  const size_t mask = slots_.size() - 1;
+  size_t index = HashKey(message.windowHandle, message.message) & mask;
+  while (true) {
+    Slot& slot = slots_[index];
+    if (slot.generation != generation_ ||
+        (slot.window_handle == message.windowHandle &&
+         slot.message == message.message)) {
+      return slot;
+    }
+    index = (index + 1) & mask;
+  }
+}
+
+void MessageCoalescer::Grow() {
+  std::vector<Slot> old_slots(slots_.size() * 2);
+  old_slots.swap(slots_);
+  for (const Slot& old_slot : old_slots) {
+    if (old_slot.generation != generation_) {
+      continue;
+    }
+    ObservedMessage key = {};
+    key.windowHandle = old_slot.window_handle;
+    key.message = old_slot.message;
+    FindSlot(key) = old_slot;
+  }
+}
+
+}  // namespace window_proc_delegate
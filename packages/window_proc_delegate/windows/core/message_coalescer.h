@@ -0,0 +1,81 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_COALESCER_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_COALESCER_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "message_observer.h"
+
+namespace window_proc_delegate {
+
+// How repeated messages with the same (hwnd, message) key are merged
+// between two flushes. The values match WindowsMessageCoalescing in
+// lib/src/window_proc_observer.dart.
+enum class CoalescePolicy : int32_t {
+  // Deliver every message.
+  kNone = 0,
+  // Deliver only the most recent message, e.g. for positions and sizes.
+  kKeepLatest = 1,
+  // Sum the signed high word of wParam, e.g. for WM_MOUSEWHEEL deltas. The
+  // result is stored sign-extended in wParam >> 16 so it cannot overflow;
+  // the low word and lParam are taken from the most recent message.
+  kAccumulate = 2,
+};
+
+// Merges high-frequency messages so at most one record per key and policy
+// is delivered per flush. A merged record sits at the position of the most
+// recent message it absorbed, and its |count| is the number of messages
+// merged into it.
+//
+// Not thread-safe; owned by a single observer.
+class MessageCoalescer {
+ public:
+  MessageCoalescer();
+
+  // Disallow copy and assign.
+  MessageCoalescer(const MessageCoalescer&) = delete;
+  MessageCoalescer& operator=(const MessageCoalescer&) = delete;
+
+  void SetPolicy(uint32_t message, CoalescePolicy policy);
+  CoalescePolicy PolicyFor(uint32_t message) const;
+
+  void Add(const ObservedMessage& message);
+
+  bool HasPending() const { return !pending_.empty(); }
+
+  // Appends the merged records to |out| in delivery order and starts a new
+  // flush window.
+  void Flush(std::vector<ObservedMessage>* out);
+
+ private:
+  struct Slot {
+    int64_t window_handle;
+    int64_t message;
+    uint32_t generation;
+    uint32_t index;
+  };
+
+  // Returns the slot for the key of |message|, claiming an empty one for it
+  // if the key is not pending.
+  Slot& FindSlot(const ObservedMessage& message);
+  void Grow();
+
+  // Sorted by message; a handful of entries at most.
+  std::vector<std::pair<uint32_t, CoalescePolicy>> policies_;
+
+  // Records in arrival order. Entries superseded by a later message for the
+  // same key are tombstoned with a zero count.
+  std::vector<ObservedMessage> pending_;
+  size_t live_keys_ = 0;
+
+  // Open-addressed (hwnd, message) -> |pending_| index. Slots whose
+  // generation differs from |generation_| are empty, so a flush clears the
+  // table in O(1).
+  std::vector<Slot> slots_;
+  uint32_t generation_ = 1;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_COALESCER_H_
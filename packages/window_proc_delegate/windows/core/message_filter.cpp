@@ -0,0 +1,65 @@
+#include "message_filter.h"
+
+#include <algorithm>
+
+namespace window_proc_delegate {
+
+// static
+std::unique_ptr<MessageFilter> MessageFilter::AcceptAll() {
+  std::unique_ptr<MessageFilter> filter(new MessageFilter());
+  filter->accepts_all_ = true;
+  filter->words_.fill(~uint64_t{0});
+  return filter;
+}
+
+// static
+std::unique_ptr<MessageFilter> MessageFilter::FromRanges(
+    const uint32_t* ranges, size_t range_count) {
+  std::unique_ptr<MessageFilter> filter(new MessageFilter());
+  for (size_t i = 0; i < range_count; i++) {
+    filter->AddRange(ranges[i * 2], ranges[i * 2 + 1]);
+  }
+  return filter;
+}
+
+// static
+std::unique_ptr<MessageFilter> MessageFilter::Union(
+    const MessageFilter* const* filters,
+    size_t count) {
+  std::unique_ptr<MessageFilter> result(new MessageFilter());
+  for (size_t i = 0; i < count; i++) {
+    result->accepts_all_ |= filters[i]->accepts_all_;
+    for (size_t word = 0; word < result->words_.size(); word++) {
+      result->words_[word] |= filters[i]->words_[word];
+    }
+  }
+  return result;
+}
+
+bool MessageFilter::IsEmpty() const {
+  return std::all_of(words_.begin(), words_.end(),
+                     [](uint64_t word) { return word == 0; });
+}
+
+void MessageFilter::AddRange(uint32_t first, uint32_t last) {
+  if (first > last || first >= kMessageCount) {
+    return;
+  }
+  last = std::min(last, kMessageCount - 1);
+
+  const uint32_t first_word = first >> 6;
+  const uint32_t last_word = last >> 6;
+  const uint64_t first_mask = ~uint64_t{0} << (first & 63);
+  const uint64_t last_mask = ~uint64_t{0} >> (63 - (last & 63));
+  if (first_word == last_word) {
+    words_[first_word] |= first_mask & last_mask;
+    return;
+  }
+  words_[first_word] |= first_mask;
+  for (uint32_t word = first_word + 1; word < last_word; word++) {
+    words_[word] = ~uint64_t{0};
+  }
+  words_[last_word] |= last_mask;
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,56 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_FILTER_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_FILTER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace window_proc_delegate {
+
+// Immutable set of window message identifiers, stored as a 64K-bit bitmap.
+//
+// Message identifiers above 0xFFFF are reserved by the system and are only
+// accepted by a filter created with AcceptAll().
+class MessageFilter {
+ public:
+  static constexpr uint32_t kMessageCount = 0x10000;
+
+  // Returns a filter that accepts every message.
+  static std::unique_ptr<MessageFilter> AcceptAll();
+
+  // Returns a filter that accepts the union of |range_count| inclusive
+  // [first, last] ranges stored as consecutive pairs in |ranges|.
+  static std::unique_ptr<MessageFilter> FromRanges(const uint32_t* ranges,
+                                                   size_t range_count);
+
+  bool Accepts(uint32_t message) const {
+    if (message >= kMessageCount) {
+      return accepts_all_;
+    }
+    return (words_[message >> 6] >> (message & 63)) & 1;
+  }
+
+  bool accepts_all() const { return accepts_all_; }
+
+  // Returns a filter that accepts every message accepted by any of
+  // |filters|.
+  static std::unique_ptr<MessageFilter> Union(
+      const MessageFilter* const* filters,
+      size_t count);
+
+  // Returns true if no message passes this filter.
+  bool IsEmpty() const;
+
+ private:
+  MessageFilter() = default;
+
+  void AddRange(uint32_t first, uint32_t last);
+
+  bool accepts_all_ = false;
+  std::array<uint64_t, kMessageCount / 64> words_ = {};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_FILTER_H_
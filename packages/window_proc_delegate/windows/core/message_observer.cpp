@@ -0,0 +1,63 @@
+#include "message_observer.h"
+
+#include <cstring>
+
+#include "message_coalescer.h"
+
+namespace window_proc_delegate {
+
+MessageObserver::MessageObserver(int64_t id,
+                                 std::shared_ptr<const MessageFilter> filter)
+    : id_(id), filter_(std::move(filter)) {}
+
+MessageObserver::~MessageObserver() = default;
+
+BatchObserver::BatchObserver(int64_t id,
+                             Dart_Port_DL port,
+                             std::shared_ptr<const MessageFilter> filter)
+    : MessageObserver(id, std::move(filter)),
+      port_(port),
+      coalescer_(std::make_unique<MessageCoalescer>()) {}
+
+BatchObserver::~BatchObserver() {
+  Dart_CObject closed;
+  closed.type = Dart_CObject_kNull;
+  Dart_PostCObject_DL(port_, &closed);
+}
+
+void BatchObserver::Add(const ObservedMessage& message) {
+  coalescer_->Add(message);
+}
+
+bool BatchObserver::HasPending() const {
+  return coalescer_->HasPending();
+}
+
+bool BatchObserver::Flush(const QueueStamp* stamp) {
+  if (!coalescer_->HasPending()) {
+    return true;
+  }
+  coalescer_->Flush(&batch_);
+  size_t length = batch_.size() * kObservedMessageFields;
+  if (stamp) {
+    // Carried in the unused tail of an extra record.
+    ObservedMessage tail = {};
+    std::memcpy(&tail, stamp, sizeof(*stamp));
+    batch_.push_back(tail);
+    length += kQueueStampFields;
+  }
+
+  Dart_CObject batch;
+  batch.type = Dart_CObject_kTypedData;
+  batch.value.as_typed_data.type = Dart_TypedData_kInt64;
+  batch.value.as_typed_data.length = static_cast<intptr_t>(length);
+  batch.value.as_typed_data.values =
+      reinterpret_cast<const uint8_t*>(batch_.data());
+
+  // The data is copied on send, so the buffer can be reused right away.
+  const bool posted = Dart_PostCObject_DL(port_, &batch);
+  batch_.clear();
+  return posted;
+}
+
+}  // namespace window_proc_delegate
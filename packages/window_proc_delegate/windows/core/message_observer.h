@@ -0,0 +1,118 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_OBSERVER_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_OBSERVER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../dart/dart_api_dl.h"
+#include "message_filter.h"
+
+namespace window_proc_delegate {
+class MessageCoalescer;
+}  // namespace window_proc_delegate
+
+namespace window_proc_delegate {
+
+// Packed record delivered to observers. Mirrors the decoding in
+// lib/src/window_proc_observer.dart.
+struct ObservedMessage {
+  int64_t windowHandle;
+  int64_t message;
+  int64_t wParam;
+  int64_t lParam;
+  // Number of messages coalesced into this record; 1 if none were merged.
+  int64_t count;
+};
+
+constexpr size_t kObservedMessageFields = 5;
+
+static_assert(sizeof(ObservedMessage) ==
+                  kObservedMessageFields * sizeof(int64_t),
+              "ObservedMessage must be tightly packed int64 fields");
+
+// When the messages of a batch started queueing, appended to the batch
+// while latency is tracked so Dart can report the kDelivered stage. Being
+// shorter than a record, it is skipped by decoders that do not expect it.
+struct QueueStamp {
+  int64_t queued_ns;
+  int64_t message;
+};
+
+constexpr size_t kQueueStampFields = 2;
+
+static_assert(sizeof(QueueStamp) == kQueueStampFields * sizeof(int64_t) &&
+                  kQueueStampFields < kObservedMessageFields,
+              "QueueStamp must be a packed, partial record");
+
+// An observe-only subscription to the messages accepted by its filter.
+// Observers never wait on Dart.
+//
+// Add() and Flush() must be called from the same thread, normally the one
+// running the window procedure.
+class MessageObserver {
+ public:
+  MessageObserver(int64_t id, std::shared_ptr<const MessageFilter> filter);
+  virtual ~MessageObserver();
+
+  // Disallow copy and assign.
+  MessageObserver(const MessageObserver&) = delete;
+  MessageObserver& operator=(const MessageObserver&) = delete;
+
+  int64_t id() const { return id_; }
+  const MessageFilter& filter() const { return *filter_; }
+
+  // Delivers, or queues for delivery, a message accepted by the filter.
+  virtual void Add(const ObservedMessage& message) = 0;
+
+  // Delivers queued messages, once per message pump iteration, with
+  // |stamp| if it is non-null. Returns false if the receiving port is
+  // closed.
+  virtual bool Flush(const QueueStamp* stamp) { return true; }
+
+ private:
+  const int64_t id_;
+  const std::shared_ptr<const MessageFilter> filter_;
+};
+
+// Copies messages into a pending batch, which Flush() posts to a Dart port
+// as a single Int64List, followed by the QueueStamp if there is one.
+// Messages with a coalescing policy are merged per (hwnd, message) until
+// the next flush.
+//
+// The port may belong to any isolate. Once destroyed, whether removed or
+// torn down with its engine, the observer posts null to the port as its
+// last message, so the receiving isolate can release its end.
+class BatchObserver : public MessageObserver {
+ public:
+  BatchObserver(int64_t id,
+                Dart_Port_DL port,
+                std::shared_ptr<const MessageFilter> filter);
+  ~BatchObserver() override;
+
+  Dart_Port_DL port() const { return port_; }
+
+  // Must be called before the observer is published.
+  MessageCoalescer& coalescer() { return *coalescer_; }
+
+  void Add(const ObservedMessage& message) override;
+
+  bool HasPending() const;
+
+  bool Flush(const QueueStamp* stamp) override;
+
+ private:
+  const Dart_Port_DL port_;
+  std::unique_ptr<MessageCoalescer> coalescer_;
+  std::vector<ObservedMessage> batch_;
+};
+
+// Immutable set of observers plus the union of their filters.
+struct ObserverList {
+  std::vector<std::shared_ptr<MessageObserver>> observers;
+  std::shared_ptr<const MessageFilter> filter;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_OBSERVER_H_
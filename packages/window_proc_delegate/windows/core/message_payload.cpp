@@ -0,0 +1,147 @@
+#include "message_payload.h"
+
+namespace window_proc_delegate {
+
+namespace {
+
+template <typename T>
+T* Pointee(int64_t lparam) {
+  return reinterpret_cast<T*>(static_cast<intptr_t>(lparam));
+}
+
+// Defines Decode() and Encode() for a payload copied field by field from
+// the Win32 struct lParam points to.
+#define WINDOW_PROC_DELEGATE_STRUCT_CODEC(Payload, Win32, FIELDS)   \
+  void DecodeStruct(const Win32& in, Payload* out) {                \
+    FIELDS(WINDOW_PROC_DELEGATE_DECODE_FIELD)                       \
+  }                                                                 \
+  void EncodeStruct(const Payload& in, Win32* out) {                \
+    FIELDS(WINDOW_PROC_DELEGATE_ENCODE_FIELD)                       \
+  }                                                                 \
+  bool Decode(uint64_t wparam, int64_t lparam, Payload* out) {      \
+    if (lparam == 0) {                                              \
+      return false;                                                 \
+    }                                                               \
+    DecodeStruct(*Pointee<const Win32>(lparam), out);               \
+    return true;                                                    \
+  }                                                                 \
+  void Encode(const Payload& in, uint64_t wparam, int64_t lparam) { \
+    EncodeStruct(in, Pointee<Win32>(lparam));                       \
+  }
+
+#define WINDOW_PROC_DELEGATE_DECODE_FIELD(field, win32_field, writable) \
+  out->field = static_cast<decltype(out->field)>(in.win32_field);
+#define WINDOW_PROC_DELEGATE_ENCODE_FIELD(field, win32_field, writable)   \
+  if (writable) {                                                         \
+    out->win32_field = static_cast<decltype(out->win32_field)>(in.field); \
+  }
+
+WINDOW_PROC_DELEGATE_STRUCT_CODEC(WindowPosPayload,
+                                  win32::WindowPos,
+                                  WINDOW_PROC_DELEGATE_WINDOW_POS_FIELDS)
+WINDOW_PROC_DELEGATE_STRUCT_CODEC(MinMaxInfoPayload,
+                                  win32::MinMaxInfo,
+                                  WINDOW_PROC_DELEGATE_MIN_MAX_INFO_FIELDS)
+
+#undef WINDOW_PROC_DELEGATE_ENCODE_FIELD
+#undef WINDOW_PROC_DELEGATE_DECODE_FIELD
+#undef WINDOW_PROC_DELEGATE_STRUCT_CODEC
+
+bool Decode(uint64_t wparam, int64_t lparam, NcCalcSizePayload* out) {
+  if (lparam == 0) {
+    return false;
+  }
+  out->calcValidRects = wparam != 0;
+  if (!out->calcValidRects) {
+    out->rects[0] = *Pointee<const win32::Rect>(lparam);
+    return true;
+  }
+  const auto& params = *Pointee<const win32::NcCalcSizeParams>(lparam);
+  for (int i = 0; i < 3; i++) {
+    out->rects[i] = params.rgrc[i];
+  }
+  if (params.lppos) {
+    DecodeStruct(*params.lppos, &out->windowPos);
+  }
+  return true;
+}
+
+void Encode(const NcCalcSizePayload& in, uint64_t wparam, int64_t lparam) {
+  if (!in.calcValidRects) {
+    *Pointee<win32::Rect>(lparam) = in.rects[0];
+    return;
+  }
+  auto& params = *Pointee<win32::NcCalcSizeParams>(lparam);
+  for (int i = 0; i < 3; i++) {
+    params.rgrc[i] = in.rects[i];
+  }
+}
+
+bool Decode(uint64_t wparam, int64_t lparam, DpiChangedPayload* out) {
+  if (lparam == 0) {
+    return false;
+  }
+  out->dpiX = static_cast<uint32_t>(wparam & 0xFFFF);
+  out->dpiY = static_cast<uint32_t>((wparam >> 16) & 0xFFFF);
+  out->suggested = *Pointee<const win32::Rect>(lparam);
+  return true;
+}
+
+bool Decode(uint64_t wparam, int64_t lparam, SettingChangePayload* out) {
+  out->action = wparam;
+  out->area = lparam;
+  out->areaLength = -1;
+  if (lparam != 0) {
+    const char16_t* area = Pointee<const char16_t>(lparam);
+    int32_t length = 0;
+    while (area[length] != 0) {
+      length++;
+    }
+    out->areaLength = length;
+  }
+  return true;
+}
+
+template <bool writable, typename Payload>
+void EncodeIfWritable(const Payload& payload, uint64_t wparam, int64_t lparam) {
+  if constexpr (writable) {
+    Encode(payload, wparam, lparam);
+  }
+}
+
+}  // namespace
+
+void DecodeSchemaPayload(uint32_t message,
+                         uint64_t wparam,
+                         int64_t lparam,
+                         MessagePayload* payload) {
+  switch (message) {
+#define WINDOW_PROC_DELEGATE_DECODE(kind_, message_id, member, writable) \
+  case message_id:                                                       \
+    if (Decode(wparam, lparam, &payload->member)) {                      \
+      payload->kind = PayloadKind::kind_;                                \
+    }                                                                    \
+    break;
+    WINDOW_PROC_DELEGATE_MESSAGE_PAYLOADS(WINDOW_PROC_DELEGATE_DECODE)
+#undef WINDOW_PROC_DELEGATE_DECODE
+    default:
+      break;
+  }
+}
+
+void EncodePayload(const MessagePayload& payload,
+                   uint64_t wparam,
+                   int64_t lparam) {
+  switch (payload.kind) {
+#define WINDOW_PROC_DELEGATE_ENCODE(kind_, message_id, member, writable) \
+  case PayloadKind::kind_:                                               \
+    EncodeIfWritable<writable>(payload.member, wparam, lparam);          \
+    break;
+    WINDOW_PROC_DELEGATE_MESSAGE_PAYLOADS(WINDOW_PROC_DELEGATE_ENCODE)
+#undef WINDOW_PROC_DELEGATE_ENCODE
+    case PayloadKind::kNone:
+      break;
+  }
+}
+
+}  // namespace window_proc_delegate
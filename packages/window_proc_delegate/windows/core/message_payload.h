@@ -0,0 +1,215 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_PAYLOAD_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_PAYLOAD_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace window_proc_delegate {
+
+// Portable mirrors of the Win32 structs that pointer-carrying messages pass
+// in lParam, with the Win32 field names. The plugin checks them against
+// windows.h.
+namespace win32 {
+
+struct Rect {
+  int32_t left;
+  int32_t top;
+  int32_t right;
+  int32_t bottom;
+};
+
+struct Point {
+  int32_t x;
+  int32_t y;
+};
+
+struct WindowPos {
+  intptr_t hwnd;
+  intptr_t hwndInsertAfter;
+  int32_t x;
+  int32_t y;
+  int32_t cx;
+  int32_t cy;
+  uint32_t flags;
+};
+
+struct MinMaxInfo {
+  Point ptReserved;
+  Point ptMaxSize;
+  Point ptMaxPosition;
+  Point ptMinTrackSize;
+  Point ptMaxTrackSize;
+};
+
+struct NcCalcSizeParams {
+  Rect rgrc[3];
+  WindowPos* lppos;
+};
+
+}  // namespace win32
+
+// Decoded payloads. Their layout is the same on every platform and is
+// mirrored by lib/src/windows_message_payload.dart.
+
+struct WindowPosPayload {
+  int64_t window;
+  int64_t insertAfter;
+  int32_t x;
+  int32_t y;
+  int32_t cx;
+  int32_t cy;
+  uint32_t flags;
+};
+
+struct MinMaxInfoPayload {
+  win32::Point maxSize;
+  win32::Point maxPosition;
+  win32::Point minTrackSize;
+  win32::Point maxTrackSize;
+};
+
+// With wParam TRUE, |rects| holds NCCALCSIZE_PARAMS.rgrc and |windowPos|
+// its lppos; otherwise only rects[0] is used.
+struct NcCalcSizePayload {
+  win32::Rect rects[3];
+  uint32_t calcValidRects;
+  WindowPosPayload windowPos;
+};
+
+struct DpiChangedPayload {
+  uint32_t dpiX;
+  uint32_t dpiY;
+  win32::Rect suggested;
+};
+
+// |area| is the address of the sender's UTF-16 section name, valid only
+// while the message is handled, and |areaLength| its length in code units,
+// or -1 if there is none.
+struct SettingChangePayload {
+  uint64_t action;
+  int64_t area;
+  int32_t areaLength;
+};
+
+// The message schema. Adding a message takes a row here, plus a payload
+// struct and a Decode() overload if none of the existing ones fit.
+//
+// P(member, Type, size) lists the members of the payload union and the
+// size the Dart mirror expects.
+#define WINDOW_PROC_DELEGATE_PAYLOAD_TYPES(P) \
+  P(windowPos, WindowPosPayload, 40)          \
+  P(ncCalcSize, NcCalcSizePayload, 96)        \
+  P(minMaxInfo, MinMaxInfoPayload, 32)        \
+  P(dpiChanged, DpiChangedPayload, 24)        \
+  P(settingChange, SettingChangePayload, 24)
+
+// M(kind, message, member, writable) maps each message to its payload.
+// Writable payloads are written back to the sender's struct after Dart
+// returns, so delegates can change the results in place.
+#define WINDOW_PROC_DELEGATE_MESSAGE_PAYLOADS(M)  \
+  M(kWindowPosChanging, 0x0046, windowPos, true)  \
+  M(kWindowPosChanged, 0x0047, windowPos, false)  \
+  M(kNcCalcSize, 0x0083, ncCalcSize, true)        \
+  M(kGetMinMaxInfo, 0x0024, minMaxInfo, true)     \
+  M(kDpiChanged, 0x02E0, dpiChanged, false)       \
+  M(kSettingChange, 0x001A, settingChange, false)
+
+// F(payload field, Win32 field, writable) lists the fields copied between
+// a payload and the struct lParam points to.
+#define WINDOW_PROC_DELEGATE_WINDOW_POS_FIELDS(F) \
+  F(window, hwnd, false)                          \
+  F(insertAfter, hwndInsertAfter, true)           \
+  F(x, x, true)                                   \
+  F(y, y, true)                                   \
+  F(cx, cx, true)                                 \
+  F(cy, cy, true)                                 \
+  F(flags, flags, true)
+
+#define WINDOW_PROC_DELEGATE_MIN_MAX_INFO_FIELDS(F) \
+  F(maxSize, ptMaxSize, true)                       \
+  F(maxPosition, ptMaxPosition, true)               \
+  F(minTrackSize, ptMinTrackSize, true)             \
+  F(maxTrackSize, ptMaxTrackSize, true)
+
+// Bumped whenever a payload layout changes; Dart ignores payloads of any
+// other version.
+constexpr uint32_t kMessagePayloadVersion = 1;
+
+enum class PayloadKind : uint32_t {
+  kNone = 0,
+#define WINDOW_PROC_DELEGATE_KIND(kind, message, member, writable) kind,
+  WINDOW_PROC_DELEGATE_MESSAGE_PAYLOADS(WINDOW_PROC_DELEGATE_KIND)
+#undef WINDOW_PROC_DELEGATE_KIND
+};
+
+// A tagged union of the decoded payloads. Mirrors WindowsMessagePayload in
+// lib/src/windows_message_payload.dart.
+struct MessagePayload {
+  uint32_t version;
+  PayloadKind kind;
+  union {
+#define WINDOW_PROC_DELEGATE_MEMBER(member, Type, size) Type member;
+    WINDOW_PROC_DELEGATE_PAYLOAD_TYPES(WINDOW_PROC_DELEGATE_MEMBER)
+#undef WINDOW_PROC_DELEGATE_MEMBER
+  };
+};
+
+#define WINDOW_PROC_DELEGATE_CHECK_SIZE(member, Type, size) \
+  static_assert(sizeof(Type) == (size) &&                   \
+                    offsetof(MessagePayload, member) == 8,  \
+                #Type " must match its Dart mirror");
+WINDOW_PROC_DELEGATE_PAYLOAD_TYPES(WINDOW_PROC_DELEGATE_CHECK_SIZE)
+#undef WINDOW_PROC_DELEGATE_CHECK_SIZE
+
+static_assert(sizeof(MessagePayload) == 104,
+              "MessagePayload must match its Dart mirror");
+static_assert(offsetof(WindowPosPayload, flags) == 32 &&
+                  offsetof(NcCalcSizePayload, calcValidRects) == 48 &&
+                  offsetof(NcCalcSizePayload, windowPos) == 56 &&
+                  offsetof(MinMaxInfoPayload, maxTrackSize) == 24 &&
+                  offsetof(DpiChangedPayload, suggested) == 8 &&
+                  offsetof(SettingChangePayload, areaLength) == 16,
+              "Payload fields must match their Dart mirrors");
+
+// Whether |message| is in the payload schema.
+constexpr bool HasPayload(uint32_t message) {
+  switch (message) {
+#define WINDOW_PROC_DELEGATE_CASE(kind, message_id, member, writable) \
+  case message_id:
+    WINDOW_PROC_DELEGATE_MESSAGE_PAYLOADS(WINDOW_PROC_DELEGATE_CASE)
+#undef WINDOW_PROC_DELEGATE_CASE
+    return true;
+    default:
+      return false;
+  }
+}
+
+// Decodes a message in the payload schema; see DecodePayload().
+void DecodeSchemaPayload(uint32_t message,
+                         uint64_t wparam,
+                         int64_t lparam,
+                         MessagePayload* payload);
+
+// Fills |payload| from a message whose lParam points to a struct in the
+// schema, or sets its kind to kNone. Other messages are rejected inline, as
+// most messages reaching Dart carry no payload.
+inline void DecodePayload(uint32_t message,
+                          uint64_t wparam,
+                          int64_t lparam,
+                          MessagePayload* payload) {
+  payload->version = kMessagePayloadVersion;
+  payload->kind = PayloadKind::kNone;
+  if (HasPayload(message)) {
+    DecodeSchemaPayload(message, wparam, lparam, payload);
+  }
+}
+
+// Writes the writable fields of |payload| back to the struct lParam points
+// to. Does nothing for read-only payloads.
+void EncodePayload(const MessagePayload& payload,
+                   uint64_t wparam,
+                   int64_t lparam);
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_PAYLOAD_H_
@@ -0,0 +1,122 @@
+#include "message_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace window_proc_delegate {
+
+namespace {
+// How long the writer sleeps when the ring is empty. At this interval a
+// 64K-record ring absorbs bursts of over 30 million messages per second.
+constexpr auto kWriterInterval = std::chrono::milliseconds(2);
+}  // namespace
+
+// static
+std::unique_ptr<TraceRecorder> TraceRecorder::Start(std::FILE* file,
+                                                    size_t capacity,
+                                                    uint64_t start_ns) {
+  if (!file) {
+    return nullptr;
+  }
+  TraceHeader header = {};
+  std::memcpy(header.magic, kTraceMagic, sizeof(kTraceMagic));
+  header.version = kTraceVersion;
+  header.record_size = sizeof(TraceRecord);
+  header.start_ns = start_ns;
+  if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+    std::fclose(file);
+    return nullptr;
+  }
+
+  std::unique_ptr<TraceRecorder> recorder(
+      new TraceRecorder(file, capacity, start_ns));
+  recorder->writer_ = std::thread(&TraceRecorder::Run, recorder.get());
+  return recorder;
+}
+
+TraceRecorder::TraceRecorder(std::FILE* file, size_t capacity,
+                             uint64_t start_ns)
+    : file_(file),
+      start_ns_(start_ns),
+      ring_(capacity, RingDropPolicy::kDropNewest),
+      buffer_(ring_.capacity()) {}
+
+TraceRecorder::~TraceRecorder() {
+  Stop();
+}
+
+uint64_t TraceRecorder::Stop() {
+  if (stopped_) {
+    return written_;
+  }
+  stopped_ = true;
+  stopping_.store(true, std::memory_order_release);
+  writer_.join();
+
+  // The writer has exited; finish on this thread.
+  Drain();
+  const uint64_t dropped = ring_.dropped_newest();
+  if (std::fseek(file_, offsetof(TraceHeader, dropped), SEEK_SET) == 0) {
+    std::fwrite(&dropped, sizeof(dropped), 1, file_);
+  }
+  std::fclose(file_);
+  file_ = nullptr;
+  return written_;
+}
+
+void TraceRecorder::Run() {
+  while (!stopping_.load(std::memory_order_acquire)) {
+    if (!Drain()) {
+      return;
+    }
+    std::this_thread::sleep_for(kWriterInterval);
+  }
+}
+
+bool TraceRecorder::Drain() {
+  while (true) {
+    const size_t count = ring_.Pop(buffer_.data(), buffer_.size());
+    if (count == 0) {
+      return true;
+    }
+    const size_t written =
+        std::fwrite(buffer_.data(), sizeof(TraceRecord), count, file_);
+    written_ += written;
+    if (written != count) {
+      return false;
+    }
+  }
+}
+
+bool ReadTrace(const std::string& path, Trace* trace, std::string* error) {
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    *error = "cannot open " + path;
+    return false;
+  }
+  std::unique_ptr<std::FILE, int (*)(std::FILE*)> closer(file, &std::fclose);
+
+  if (std::fread(&trace->header, sizeof(TraceHeader), 1, file) != 1 ||
+      std::memcmp(trace->header.magic, kTraceMagic, sizeof(kTraceMagic)) !=
+          0) {
+    *error = path + " is not a message trace";
+    return false;
+  }
+  if (trace->header.version != kTraceVersion ||
+      trace->header.record_size < sizeof(TraceRecord)) {
+    *error = path + " has an unsupported trace version";
+    return false;
+  }
+
+  trace->records.clear();
+  std::vector<uint8_t> record(trace->header.record_size);
+  while (std::fread(record.data(), record.size(), 1, file) == 1) {
+    TraceRecord parsed;
+    std::memcpy(&parsed, record.data(), sizeof(parsed));
+    trace->records.push_back(parsed);
+  }
+  return true;
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,127 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_TRACE_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+namespace window_proc_delegate {
+
+// Binary message trace format.
+//
+// A trace is a TraceHeader followed by packed TraceRecords, all
+// little-endian, so a trace file can be memory-mapped and indexed directly.
+// Records are appended while tracing; the header's |dropped| count is
+// filled in when the trace is closed.
+constexpr char kTraceMagic[8] = {'W', 'P', 'D', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t kTraceVersion = 2;
+
+struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  // sizeof(TraceRecord), so readers can skip fields added later.
+  uint32_t record_size;
+  // Clock value of the first record's timestamp origin, in nanoseconds.
+  uint64_t start_ns;
+  // Records lost because the writer fell behind.
+  uint64_t dropped;
+  uint64_t reserved[4];
+};
+
+// Set in TraceRecord::flags when the message was handled.
+constexpr uint32_t kTraceHandled = 1;
+
+struct TraceRecord {
+  // Time the message arrived, relative to TraceHeader::start_ns.
+  uint64_t timestamp_ns;
+  int64_t window;
+  uint64_t wparam;
+  int64_t lparam;
+  int64_t lresult;
+  // Time spent handling the message, saturated at UINT32_MAX.
+  uint32_t dispatch_ns;
+  // The full message identifier, so application-defined messages above
+  // 0xFFFF replay as themselves.
+  uint32_t message;
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 64, "TraceHeader layout is fixed");
+static_assert(sizeof(TraceRecord) == 56, "TraceRecord layout is fixed");
+
+// Appends the messages seen by the window procedure to a trace file.
+//
+// Append() only copies the record into a ring; a background thread writes
+// the ring to the file, so the window procedure never waits on I/O. If the
+// writer falls behind, new records are dropped and counted.
+class TraceRecorder {
+ public:
+  // Records per ring when none is specified.
+  static constexpr size_t kDefaultCapacity = 1 << 16;
+
+  // Writes the trace header to |file| and starts the writer thread. Takes
+  // ownership of |file|. Returns null if the header cannot be written.
+  static std::unique_ptr<TraceRecorder> Start(std::FILE* file,
+                                              size_t capacity,
+                                              uint64_t start_ns);
+
+  ~TraceRecorder();
+
+  // Disallow copy and assign.
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  uint64_t start_ns() const { return start_ns_; }
+
+  // Producer: queues |record| for writing. Must only be called from one
+  // thread at a time.
+  void Append(const TraceRecord& record) { ring_.Push(record); }
+
+  // Writes the remaining records, completes the header and closes the
+  // file. Returns the number of records written. Later calls return the
+  // same count; records appended after Stop() are discarded.
+  uint64_t Stop();
+
+  uint64_t dropped() const { return ring_.dropped_newest(); }
+
+ private:
+  TraceRecorder(std::FILE* file, size_t capacity, uint64_t start_ns);
+
+  // Writer thread body.
+  void Run();
+
+  // Writes every record currently in the ring. Returns false once the file
+  // stops accepting writes.
+  bool Drain();
+
+  std::FILE* file_;
+  const uint64_t start_ns_;
+  SpscRing<TraceRecord> ring_;
+  std::vector<TraceRecord> buffer_;
+  uint64_t written_ = 0;
+  std::atomic<bool> stopping_{false};
+  bool stopped_ = false;
+  std::thread writer_;
+};
+
+// A trace read back into memory.
+struct Trace {
+  TraceHeader header;
+  std::vector<TraceRecord> records;
+};
+
+// Reads the trace at |path|. Returns false and sets |error| if the file is
+// missing or not a trace. A truncated last record is ignored.
+bool ReadTrace(const std::string& path, Trace* trace, std::string* error);
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_MESSAGE_TRACE_H_
@@ -0,0 +1,63 @@
+#include "native_handlers.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace window_proc_delegate {
+
+// static
+std::unique_ptr<NativeHandlerTable> NativeHandlerTable::Build(
+    const std::vector<Registration>& registrations) {
+  // Call order first; the stable sort by message below keeps it within
+  // each message.
+  std::vector<const Registration*> ordered;
+  ordered.reserve(registrations.size());
+  for (const Registration& registration : registrations) {
+    ordered.push_back(&registration);
+  }
+  std::stable_sort(ordered.begin(), ordered.end(),
+                   [](const Registration* a, const Registration* b) {
+                     return a->priority > b->priority;
+                   });
+
+  std::vector<std::pair<uint32_t, Handler>> entries;
+  for (const Registration* registration : ordered) {
+    for (const uint32_t message : registration->messages) {
+      entries.push_back(
+          {message, {registration->function, registration->user_data}});
+    }
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.first < b.first;
+                   });
+
+  std::unique_ptr<NativeHandlerTable> table(new NativeHandlerTable());
+  std::vector<uint32_t> ranges;
+  for (const auto& [message, handler] : entries) {
+    if (table->messages_.empty() || table->messages_.back() != message) {
+      table->messages_.push_back(message);
+      table->offsets_.push_back(
+          static_cast<uint32_t>(table->handlers_.size()));
+      ranges.push_back(message);
+      ranges.push_back(message);
+    }
+    table->handlers_.push_back(handler);
+  }
+  table->offsets_.push_back(static_cast<uint32_t>(table->handlers_.size()));
+  table->filter_ = MessageFilter::FromRanges(ranges.data(), ranges.size() / 2);
+  return table;
+}
+
+NativeHandlerTable::Handlers NativeHandlerTable::Find(uint32_t message) const {
+  const auto it =
+      std::lower_bound(messages_.begin(), messages_.end(), message);
+  if (it == messages_.end() || *it != message) {
+    return {nullptr, 0};
+  }
+  const size_t index = static_cast<size_t>(it - messages_.begin());
+  return {handlers_.data() + offsets_[index],
+          offsets_[index + 1] - offsets_[index]};
+}
+
+}  // namespace window_proc_delegate
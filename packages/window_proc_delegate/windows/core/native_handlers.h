@@ -0,0 +1,72 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_NATIVE_HANDLERS_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_NATIVE_HANDLERS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../include/window_proc_delegate/native_handler.h"
+#include "message_filter.h"
+
+namespace window_proc_delegate {
+
+// Immutable jump table from message identifier to the native handlers
+// added for it, in the order they are called: by descending priority, then
+// in the order they were added.
+//
+// Handled messages are kept sorted, each with a contiguous run of
+// handlers, so a lookup is a binary search; the union of their messages
+// rejects everything else with a bit test.
+class NativeHandlerTable {
+ public:
+  // A handler as added by a native plugin.
+  struct Registration {
+    int64_t id;
+    int32_t priority;
+    WindowProcDelegateNativeHandlerFunction function;
+    void* user_data;
+    // Sorted, without duplicates, all below MessageFilter::kMessageCount.
+    std::vector<uint32_t> messages;
+  };
+
+  struct Handler {
+    WindowProcDelegateNativeHandlerFunction function;
+    void* user_data;
+  };
+
+  // The handlers to call for one message.
+  struct Handlers {
+    const Handler* handlers;
+    size_t count;
+  };
+
+  // Builds the table of |registrations|, given in the order they were
+  // added.
+  static std::unique_ptr<NativeHandlerTable> Build(
+      const std::vector<Registration>& registrations);
+
+  // Disallow copy and assign.
+  NativeHandlerTable(const NativeHandlerTable&) = delete;
+  NativeHandlerTable& operator=(const NativeHandlerTable&) = delete;
+
+  // Accepts the messages with at least one handler.
+  const MessageFilter& filter() const { return *filter_; }
+
+  Handlers Find(uint32_t message) const;
+
+ private:
+  NativeHandlerTable() = default;
+
+  std::unique_ptr<const MessageFilter> filter_;
+
+  // The handlers of messages_[i] are handlers_[offsets_[i],
+  // offsets_[i + 1]).
+  std::vector<uint32_t> messages_;
+  std::vector<uint32_t> offsets_;
+  std::vector<Handler> handlers_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_NATIVE_HANDLERS_H_
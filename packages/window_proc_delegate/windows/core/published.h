@@ -0,0 +1,41 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_PUBLISHED_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_PUBLISHED_H_
+
+#include <atomic>
+#include <memory>
+
+namespace window_proc_delegate {
+
+// An immutable snapshot of T that the window procedure reads lock-free.
+//
+// Writers must be serialized by the owner. Publish() hands back the
+// replaced snapshot, which the owner must keep alive until no reader can
+// still be using it.
+template <typename T>
+class Published {
+ public:
+  Published() = default;
+  ~Published() { delete current_.load(std::memory_order_relaxed); }
+
+  // Disallow copy and assign.
+  Published(const Published&) = delete;
+  Published& operator=(const Published&) = delete;
+
+  // Returns the current snapshot, or nullptr if none is published.
+  const T* Load() const { return current_.load(std::memory_order_acquire); }
+
+  // Makes |value| the current snapshot and returns the previous one. A null
+  // |value| clears it.
+  [[nodiscard]] std::unique_ptr<const T> Publish(
+      std::unique_ptr<const T> value) {
+    return std::unique_ptr<const T>(
+        current_.exchange(value.release(), std::memory_order_acq_rel));
+  }
+
+ private:
+  std::atomic<const T*> current_{nullptr};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_PUBLISHED_H_
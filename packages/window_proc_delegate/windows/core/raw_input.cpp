@@ -0,0 +1,86 @@
+#include "raw_input.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace window_proc_delegate {
+
+RawInputAccumulator::RawInputAccumulator(Dart_Port_DL wake_port,
+                                         size_t capacity)
+    : wake_port_(wake_port), capacity_(capacity) {
+  records_.reserve(capacity_);
+}
+
+RawInputAccumulator::~RawInputAccumulator() = default;
+
+void RawInputAccumulator::Add(const RawMouseReport& report) {
+  const int64_t device = static_cast<int64_t>(report.device);
+  const int64_t timestamp = static_cast<int64_t>(report.timestamp_ns);
+  const int64_t absolute =
+      (report.flags & kRawMouseAbsolute) ? kRawMouseRecordAbsolute : 0;
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto open = std::find_if(
+        open_.begin(), open_.end(),
+        [device](const auto& entry) { return entry.first == device; });
+    // Switching between relative and absolute reports starts a new record.
+    if (open != open_.end() &&
+        (records_[open->second].flags & kRawMouseRecordAbsolute) != absolute) {
+      open_.erase(open);
+      open = open_.end();
+    }
+    if (open == open_.end()) {
+      if (records_.size() == capacity_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      records_.push_back(
+          {device, timestamp, timestamp, 0, 0, 0, 0, 0, absolute});
+      open_.emplace_back(device, records_.size() - 1);
+      open = open_.end() - 1;
+    }
+
+    RawMouseRecord& record = records_[open->second];
+    record.last_timestamp_ns = timestamp;
+    record.reports++;
+    if (absolute) {
+      record.x = report.x;
+      record.y = report.y;
+    } else {
+      record.x += report.x;
+      record.y += report.y;
+    }
+    if (report.button_flags & kRawMouseWheel) {
+      record.wheel += report.button_data;
+    }
+    if (report.button_flags & kRawMouseHorizontalWheel) {
+      record.horizontal_wheel += report.button_data;
+    }
+    if (const uint16_t transitions =
+            report.button_flags & kRawMouseButtonTransitions) {
+      record.flags |= transitions;
+      open_.erase(open);
+    }
+
+    wake = !wake_pending_;
+    wake_pending_ = true;
+  }
+  if (wake) {
+    Dart_PostInteger_DL(wake_port_, 0);
+  }
+}
+
+size_t RawInputAccumulator::Take(RawMouseRecord* records) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t count = records_.size();
+  if (count > 0) {
+    std::memcpy(records, records_.data(), count * sizeof(RawMouseRecord));
+  }
+  records_.clear();
+  open_.clear();
+  wake_pending_ = false;
+  return count;
+}
+
+}  // namespace window_proc_delegate
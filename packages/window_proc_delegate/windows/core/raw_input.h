@@ -0,0 +1,114 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_RAW_INPUT_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_RAW_INPUT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../dart/dart_api_dl.h"
+
+namespace window_proc_delegate {
+
+// RAWMOUSE.usFlags bit set when x and y are absolute coordinates.
+constexpr uint16_t kRawMouseAbsolute = 0x0001;  // MOUSE_MOVE_ABSOLUTE
+
+// RAWMOUSE.usButtonFlags bits.
+constexpr uint16_t kRawMouseButtonTransitions = 0x03FF;  // RI_MOUSE_*_DOWN/UP
+constexpr uint16_t kRawMouseWheel = 0x0400;              // RI_MOUSE_WHEEL
+constexpr uint16_t kRawMouseHorizontalWheel = 0x0800;    // RI_MOUSE_HWHEEL
+
+// One raw input report of a mouse, independent of the Win32 headers.
+struct RawMouseReport {
+  // RAWINPUTHEADER.hDevice.
+  intptr_t device;
+  // When the report was read, on the LatencyClock.
+  uint64_t timestamp_ns;
+  // RAWMOUSE.lLastX and lLastY: a motion delta, or a position if |flags|
+  // has kRawMouseAbsolute.
+  int32_t x;
+  int32_t y;
+  // RAWMOUSE.usFlags, usButtonFlags and usButtonData, the wheel delta.
+  uint16_t flags;
+  uint16_t button_flags;
+  int16_t button_data;
+};
+
+// Packed record of the reports of one device that Dart receives. Mirrors
+// the decoding in lib/src/windows_raw_input.dart.
+struct RawMouseRecord {
+  int64_t device;
+  int64_t first_timestamp_ns;
+  int64_t last_timestamp_ns;
+  // Number of reports merged into this record.
+  int64_t reports;
+  // Sum of the motion deltas, or the last position if absolute.
+  int64_t x;
+  int64_t y;
+  // Sums of the wheel deltas, in WHEEL_DELTA units.
+  int64_t wheel;
+  int64_t horizontal_wheel;
+  // The button transitions of the last report (kRawMouseButtonTransitions
+  // bits), and kRawMouseRecordAbsolute.
+  int64_t flags;
+};
+
+constexpr size_t kRawMouseRecordFields = 9;
+constexpr int64_t kRawMouseRecordAbsolute = 1 << 16;
+
+static_assert(sizeof(RawMouseRecord) ==
+                  kRawMouseRecordFields * sizeof(int64_t),
+              "RawMouseRecord must be tightly packed int64 fields");
+
+// Folds high-rate raw mouse input into a compact batch of per-device
+// records, which Dart takes once per frame.
+//
+// Reports of a device are merged into its open record, summing motion and
+// wheel deltas, until one has button transitions: that report closes the
+// record, so a click keeps its place in the motion and its position is
+// the sum up to it. A steadily moving mouse therefore costs one record per
+// frame whatever its polling rate.
+//
+// Add() is called on the window thread and Take() on the consumer's; both
+// hold a lock for a few stores. When a report lands while no take is
+// pending, 0 is posted to |wake_port| so Dart can schedule a frame.
+// Reports that find the batch full are dropped and counted.
+class RawInputAccumulator {
+ public:
+  RawInputAccumulator(Dart_Port_DL wake_port, size_t capacity);
+  ~RawInputAccumulator();
+
+  // Disallow copy and assign.
+  RawInputAccumulator(const RawInputAccumulator&) = delete;
+  RawInputAccumulator& operator=(const RawInputAccumulator&) = delete;
+
+  // The most records a batch holds.
+  size_t capacity() const { return capacity_; }
+
+  void Add(const RawMouseReport& report);
+
+  // Moves the batch to |records|, which has room for capacity() records,
+  // and re-arms the wake-up. Returns the number of records moved.
+  size_t Take(RawMouseRecord* records);
+
+  // Number of reports dropped because the batch was full.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  const Dart_Port_DL wake_port_;
+  const size_t capacity_;
+
+  std::mutex mutex_;
+  std::vector<RawMouseRecord> records_;
+  // The devices with an open record, and its index in |records_|.
+  std::vector<std::pair<int64_t, size_t>> open_;
+  bool wake_pending_ = false;
+
+  std::atomic<uint64_t> dropped_{0};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_RAW_INPUT_H_
@@ -0,0 +1,125 @@
+#include "reply_rules.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace window_proc_delegate {
+
+namespace {
+struct ParsedRule {
+  uint32_t message;
+  size_t header;  // Index of the rule's first word in the program.
+};
+}  // namespace
+
+// static
+std::unique_ptr<ReplyRuleTable> ReplyRuleTable::Compile(const int64_t* program,
+                                                        size_t word_count) {
+  // Validate and locate every rule first.
+  std::vector<ParsedRule> parsed;
+  size_t position = 0;
+  while (position < word_count) {
+    if (word_count - position < kRuleHeaderWords) {
+      return nullptr;
+    }
+    const int64_t* words = program + position;
+    const int64_t message = words[0];
+    const int64_t action = words[6];
+    const int64_t write_count = words[8];
+    if (message < 0 || message >= MessageFilter::kMessageCount ||
+        action < static_cast<int64_t>(ReplyAction::kReply) ||
+        action > static_cast<int64_t>(ReplyAction::kForward) ||
+        write_count < 0 ||
+        static_cast<uint64_t>(write_count) >
+            (word_count - position - kRuleHeaderWords) / 2) {
+      return nullptr;
+    }
+    for (int64_t i = 0; i < write_count; i++) {
+      const int64_t offset = words[kRuleHeaderWords + i * 2];
+      if (offset < 0 || offset + static_cast<int64_t>(sizeof(int32_t)) >
+                            kMaxWriteExtent) {
+        return nullptr;
+      }
+    }
+    parsed.push_back({static_cast<uint32_t>(message), position});
+    position += kRuleHeaderWords + static_cast<size_t>(write_count) * 2;
+  }
+
+  // Group by message, keeping declaration order within each message.
+  std::stable_sort(parsed.begin(), parsed.end(),
+                   [](const ParsedRule& a, const ParsedRule& b) {
+                     return a.message < b.message;
+                   });
+
+  std::unique_ptr<ReplyRuleTable> table(new ReplyRuleTable());
+  std::vector<uint32_t> ranges;
+  for (const ParsedRule& rule : parsed) {
+    const int64_t* words = program + rule.header;
+    if (table->messages_.empty() || table->messages_.back() != rule.message) {
+      table->messages_.push_back(rule.message);
+      table->rule_offsets_.push_back(
+          static_cast<uint32_t>(table->rules_.size()));
+      ranges.push_back(rule.message);
+      ranges.push_back(rule.message);
+    }
+    const auto write_count = static_cast<uint32_t>(words[8]);
+    table->rules_.push_back({static_cast<intptr_t>(words[1]),
+                             static_cast<uint64_t>(words[2]),
+                             static_cast<uint64_t>(words[3]),
+                             static_cast<uint64_t>(words[4]),
+                             static_cast<uint64_t>(words[5]),
+                             static_cast<ReplyAction>(words[6]), words[7],
+                             static_cast<uint32_t>(table->writes_.size()),
+                             write_count});
+    for (uint32_t i = 0; i < write_count; i++) {
+      table->writes_.push_back(
+          {static_cast<int32_t>(words[kRuleHeaderWords + i * 2]),
+           static_cast<int32_t>(words[kRuleHeaderWords + i * 2 + 1])});
+    }
+  }
+  table->rule_offsets_.push_back(static_cast<uint32_t>(table->rules_.size()));
+  table->filter_ = MessageFilter::FromRanges(ranges.data(), ranges.size() / 2);
+  return table;
+}
+
+ReplyDecision ReplyRuleTable::EvaluateMatching(intptr_t hwnd,
+                                               uint32_t message,
+                                               uint64_t wparam,
+                                               uint64_t lparam) const {
+  const auto it = std::lower_bound(messages_.begin(), messages_.end(), message);
+  const size_t group = static_cast<size_t>(it - messages_.begin());
+  for (uint32_t i = rule_offsets_[group]; i < rule_offsets_[group + 1]; i++) {
+    const Rule& rule = rules_[i];
+    if ((rule.hwnd != 0 && rule.hwnd != hwnd) ||
+        (wparam & rule.wparam_mask) != rule.wparam_value ||
+        (lparam & rule.lparam_mask) != rule.lparam_value) {
+      continue;
+    }
+
+    ReplyDecision decision;
+    if (rule.action == ReplyAction::kForward) {
+      decision.kind = ReplyDecision::Kind::kForward;
+      return decision;
+    }
+    if (rule.action == ReplyAction::kWriteAndReply) {
+      if (lparam == 0) {
+        // Nothing to write into; leave the message to Dart.
+        decision.kind = ReplyDecision::Kind::kForward;
+        return decision;
+      }
+      auto* target =
+          reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(lparam));
+      const uint32_t write_end = rule.write_begin + rule.write_count;
+      for (uint32_t w = rule.write_begin; w < write_end; w++) {
+        std::memcpy(target + writes_[w].offset, &writes_[w].value,
+                    sizeof(int32_t));
+      }
+    }
+    decision.kind = ReplyDecision::Kind::kReply;
+    decision.result = rule.result;
+    return decision;
+  }
+  return ReplyDecision();
+}
+
+}  // namespace window_proc_delegate
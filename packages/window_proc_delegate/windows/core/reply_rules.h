@@ -0,0 +1,109 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_REPLY_RULES_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_REPLY_RULES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "message_filter.h"
+
+namespace window_proc_delegate {
+
+// What a matching rule does with the message.
+enum class ReplyAction : int32_t {
+  // Returns the rule's result from the window procedure.
+  kReply = 0,
+  // Writes the rule's int32 fields into the struct lParam points to, then
+  // returns the rule's result.
+  kWriteAndReply = 1,
+  // Stops evaluating rules and delivers the message to Dart as usual.
+  kForward = 2,
+};
+
+// Outcome of evaluating a ReplyRuleTable against a message.
+struct ReplyDecision {
+  enum class Kind { kNoMatch, kReply, kForward };
+
+  Kind kind = Kind::kNoMatch;
+  int64_t result = 0;
+};
+
+// Immutable, compiled set of declarative reply rules.
+//
+// A rule matches a message identifier, optionally a window handle, and
+// masked wParam and lParam values. For each message, rules are tried in
+// the order they were declared and the first match decides. Rules are
+// grouped by message behind a MessageFilter, so messages without rules are
+// rejected with a single bit test.
+//
+// Programs are flat arrays of int64 words, one rule after another:
+//
+//   message, hwnd (0 for any), wparam_mask, wparam_value, lparam_mask,
+//   lparam_value, action, result, write_count, then write_count pairs of
+//   (byte offset, int32 value)
+class ReplyRuleTable {
+ public:
+  // Number of int64 words in a rule before its writes.
+  static constexpr size_t kRuleHeaderWords = 9;
+  // Writes must land within this many bytes of the lParam pointer.
+  static constexpr int64_t kMaxWriteExtent = 4096;
+
+  // Compiles |word_count| words of |program|. Returns null if the program
+  // is malformed: truncated, an unknown action, a message identifier above
+  // 0xFFFF, or a write outside [0, kMaxWriteExtent).
+  static std::unique_ptr<ReplyRuleTable> Compile(const int64_t* program,
+                                                 size_t word_count);
+
+  // Disallow copy and assign.
+  ReplyRuleTable(const ReplyRuleTable&) = delete;
+  ReplyRuleTable& operator=(const ReplyRuleTable&) = delete;
+
+  // Evaluates the rules for a message. For kWriteAndReply rules, writes
+  // into the struct at |lparam| before returning.
+  ReplyDecision Evaluate(intptr_t hwnd, uint32_t message, uint64_t wparam,
+                         uint64_t lparam) const {
+    if (!filter_->Accepts(message)) {
+      return ReplyDecision();
+    }
+    return EvaluateMatching(hwnd, message, wparam, lparam);
+  }
+
+  size_t rule_count() const { return rules_.size(); }
+
+ private:
+  struct Rule {
+    intptr_t hwnd;
+    uint64_t wparam_mask;
+    uint64_t wparam_value;
+    uint64_t lparam_mask;
+    uint64_t lparam_value;
+    ReplyAction action;
+    int64_t result;
+    uint32_t write_begin;
+    uint32_t write_count;
+  };
+
+  struct Write {
+    int32_t offset;
+    int32_t value;
+  };
+
+  ReplyRuleTable() = default;
+
+  ReplyDecision EvaluateMatching(intptr_t hwnd, uint32_t message,
+                                 uint64_t wparam, uint64_t lparam) const;
+
+  std::unique_ptr<MessageFilter> filter_;
+
+  // Distinct messages with rules, ascending. The rules of messages_[i] are
+  // rules_[rule_offsets_[i], rule_offsets_[i + 1]), in declaration order.
+  std::vector<uint32_t> messages_;
+  std::vector<uint32_t> rule_offsets_;
+  std::vector<Rule> rules_;
+  std::vector<Write> writes_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_REPLY_RULES_H_
@@ -0,0 +1,36 @@
+#include "ring_observer.h"
+
+namespace window_proc_delegate {
+
+RingObserver::RingObserver(int64_t id,
+                           Dart_Port_DL wake_port,
+                           std::shared_ptr<const MessageFilter> filter,
+                           size_t capacity,
+                           RingDropPolicy policy)
+    : MessageObserver(id, std::move(filter)),
+      wake_port_(wake_port),
+      ring_(capacity, policy) {}
+
+RingObserver::~RingObserver() = default;
+
+void RingObserver::Add(const ObservedMessage& message) {
+  ring_.Push(message);
+  // Both sides update the flag with read-modify-writes, which are totally
+  // ordered: either FinishDrain() re-arms it first and this posts a wake-up,
+  // or it reads this exchange and therefore sees the record.
+  if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+    Dart_PostInteger_DL(wake_port_, id());
+  }
+}
+
+bool RingObserver::FinishDrain() {
+  wake_pending_.exchange(false, std::memory_order_acq_rel);
+  const MessageRing::ReadRange range = ring_.BeginRead();
+  if (range.begin == range.end) {
+    return false;
+  }
+  // Claim the wake-up unless the producer already posted one.
+  return !wake_pending_.exchange(true, std::memory_order_acq_rel);
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,49 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_RING_OBSERVER_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_RING_OBSERVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "../dart/dart_api_dl.h"
+#include "message_filter.h"
+#include "message_observer.h"
+#include "spsc_ring.h"
+
+namespace window_proc_delegate {
+
+using MessageRing = SpscRing<ObservedMessage>;
+
+// Appends messages to a ring that Dart drains in place once per frame,
+// instead of posting a copy of every batch.
+//
+// When a message lands while no drain is pending, the observer ID is posted
+// to |wake_port| so Dart can schedule a frame. At most one wake-up is
+// outstanding until the consumer calls FinishDrain().
+class RingObserver : public MessageObserver {
+ public:
+  RingObserver(int64_t id,
+               Dart_Port_DL wake_port,
+               std::shared_ptr<const MessageFilter> filter,
+               size_t capacity,
+               RingDropPolicy policy);
+  ~RingObserver() override;
+
+  MessageRing& ring() { return ring_; }
+
+  void Add(const ObservedMessage& message) override;
+
+  // Called by the consumer after draining; re-arms the wake-up. Returns true
+  // if records arrived during the drain without posting a wake-up, in which
+  // case the consumer must schedule another drain itself.
+  bool FinishDrain();
+
+ private:
+  const Dart_Port_DL wake_port_;
+  MessageRing ring_;
+  std::atomic<bool> wake_pending_{false};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_RING_OBSERVER_H_
@@ -0,0 +1,152 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_SEQLOCK_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_SEQLOCK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace window_proc_delegate {
+
+// A value that readers copy without blocking the writer, validated by a
+// sequence counter.
+//
+// The counter and the value are stored as consecutive 64-bit words, so the
+// block can be shared with Dart as an external Int64List: word 0 is the
+// counter and the value follows. The counter is odd while a write is in
+// progress and grows by 2 with every write that changes the value, so
+// counter / 2 doubles as a change generation for pollers.
+//
+// Writers serialize on the counter itself, by moving it from even to odd
+// with a compare-and-swap, so any thread may write. Readers retry while a
+// write is in progress or if the counter moved during their copy. As in
+// SpscRing, value words are accessed atomically so a torn read is
+// well-defined and then discarded.
+template <typename T>
+class SeqLock {
+ public:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock values must be trivially copyable");
+  static_assert(sizeof(T) % sizeof(uint64_t) == 0,
+                "SeqLock values must be a whole number of 64-bit words");
+  static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                    sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "SeqLock words must be viewable as plain 64-bit integers");
+
+  static constexpr size_t kValueWords = sizeof(T) / sizeof(uint64_t);
+
+  explicit SeqLock(const T& value = T()) {
+    words_[0].store(0, std::memory_order_relaxed);
+    StoreValue(value);
+  }
+
+  // Disallow copy and assign.
+  SeqLock(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  // The counter followed by the value, for sharing with Dart. Reads
+  // through it must be validated against the counter.
+  const std::atomic<uint64_t>* words() const { return words_; }
+
+  uint64_t sequence() const {
+    return words_[0].load(std::memory_order_acquire);
+  }
+
+  // Copies the value into |out|, and the counter it was copied at into
+  // |sequence| if it is not null, unless a write is in progress or happens
+  // during the copy. Returns false if the copy must be retried.
+  bool TryRead(T* out, uint64_t* sequence = nullptr) const {
+    const uint64_t before = words_[0].load(std::memory_order_acquire);
+    if (before & 1) {
+      return false;
+    }
+    uint64_t words[kValueWords];
+    // Acquire loads keep the counter reload below from moving up; if any of
+    // them saw a newer write, the reload sees at least its odd counter.
+    for (size_t i = 0; i < kValueWords; i++) {
+      words[i] = words_[1 + i].load(std::memory_order_acquire);
+    }
+    if (words_[0].load(std::memory_order_relaxed) != before) {
+      return false;
+    }
+    std::memcpy(out, words, sizeof(T));
+    if (sequence) {
+      *sequence = before;
+    }
+    return true;
+  }
+
+  T Read(uint64_t* sequence = nullptr) const {
+    T value;
+    while (!TryRead(&value, sequence)) {
+    }
+    return value;
+  }
+
+  void Write(const T& value) {
+    Update([&](T* current) {
+      *current = value;
+      return true;
+    });
+  }
+
+  // Calls |update| with a copy of the value while holding the write side,
+  // and publishes the result if |update| returns true. Returns what
+  // |update| returned; when it returns false, the counter is restored, so
+  // pollers see no change.
+  template <typename F>
+  bool Update(F&& update) {
+    const uint64_t sequence = Lock();
+    T value = LoadValue();
+    const bool changed = update(&value);
+    if (changed) {
+      StoreValue(value);
+    }
+    words_[0].store(changed ? sequence + 2 : sequence,
+                    std::memory_order_release);
+    return changed;
+  }
+
+ private:
+  // Moves the counter from even to odd and returns its even value.
+  uint64_t Lock() {
+    uint64_t sequence = words_[0].load(std::memory_order_relaxed);
+    for (;;) {
+      if (!(sequence & 1) &&
+          words_[0].compare_exchange_weak(sequence, sequence + 1,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+        return sequence;
+      }
+      sequence = words_[0].load(std::memory_order_relaxed);
+    }
+  }
+
+  // Only called by the writer holding the lock, or before publication.
+  T LoadValue() const {
+    uint64_t words[kValueWords];
+    for (size_t i = 0; i < kValueWords; i++) {
+      words[i] = words_[1 + i].load(std::memory_order_relaxed);
+    }
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  // Release stores order the odd counter before each word, pairing with the
+  // acquire loads in TryRead(). They compile to plain stores on x86-64.
+  void StoreValue(const T& value) {
+    uint64_t words[kValueWords];
+    std::memcpy(words, &value, sizeof(T));
+    for (size_t i = 0; i < kValueWords; i++) {
+      words_[1 + i].store(words[i], std::memory_order_release);
+    }
+  }
+
+  alignas(64) std::atomic<uint64_t> words_[1 + kValueWords];
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_SEQLOCK_H_
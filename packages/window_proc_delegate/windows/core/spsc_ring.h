@@ -0,0 +1,206 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_SPSC_RING_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_SPSC_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace window_proc_delegate {
+
+// What a full ring does with a new record.
+enum class RingDropPolicy : int32_t {
+  // Reject the new record.
+  kDropNewest = 0,
+  // Discard the oldest unread record to make room.
+  kDropOldest = 1,
+};
+
+// Fixed-capacity single-producer/single-consumer ring of packed records.
+//
+// Records are stored as consecutive 64-bit words so the storage can be
+// shared with Dart as an external Int64List; record |index| lives at word
+// (index & (capacity - 1)) * kRecordWords. Indices grow monotonically and
+// never wrap in practice.
+//
+// The producer publishes records with a release store of the head index.
+// With RingDropPolicy::kDropOldest the producer may also advance the tail
+// over an unread record and overwrite its slot while the consumer is reading
+// it. Consumers therefore read in two steps: BeginRead() returns the
+// readable index range, and EndRead() reports how many records at the start
+// of that range were overwritten in the meantime and must be discarded.
+// Record words are accessed atomically so this validation is well-defined.
+template <typename Record>
+class SpscRing {
+ public:
+  static_assert(std::is_trivially_copyable<Record>::value,
+                "Ring records must be trivially copyable");
+  static_assert(sizeof(Record) % sizeof(uint64_t) == 0,
+                "Ring records must be a whole number of 64-bit words");
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                    sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "Ring words must be viewable as plain 64-bit integers");
+
+  static constexpr size_t kRecordWords = sizeof(Record) / sizeof(uint64_t);
+
+  // Readable index range [begin, end) returned by BeginRead().
+  struct ReadRange {
+    uint64_t begin;
+    uint64_t end;
+  };
+
+  // |capacity| is rounded up to a power of two, with a minimum of 2.
+  SpscRing(size_t capacity, RingDropPolicy policy)
+      : capacity_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2))),
+        mask_(capacity_ - 1),
+        policy_(policy),
+        words_(new std::atomic<uint64_t>[capacity_ * kRecordWords]) {
+    for (size_t i = 0; i < capacity_ * kRecordWords; i++) {
+      words_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Disallow copy and assign.
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  size_t capacity() const { return capacity_; }
+  RingDropPolicy policy() const { return policy_; }
+
+  // Record storage, for sharing with Dart. Reads through it must be
+  // validated with BeginRead()/EndRead().
+  const std::atomic<uint64_t>* words() const { return words_.get(); }
+
+  // Number of records rejected because the ring was full.
+  uint64_t dropped_newest() const {
+    return dropped_newest_.load(std::memory_order_relaxed);
+  }
+
+  // Number of unread records discarded to make room.
+  uint64_t dropped_oldest() const {
+    return dropped_oldest_.load(std::memory_order_relaxed);
+  }
+
+  // Producer: appends |record|. Returns false if it was dropped.
+  bool Push(const Record& record) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= capacity_) {
+      if (policy_ == RingDropPolicy::kDropNewest) {
+        dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      // The consumer only ever advances the tail, so if this fails there is
+      // room now.
+      if (tail_.compare_exchange_strong(tail, tail + 1,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+        dropped_oldest_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    // Release stores order the tail update above before the slot overwrite,
+    // pairing with the acquire loads in Read(). They compile to plain stores
+    // on x86-64.
+    uint64_t words[kRecordWords];
+    std::memcpy(words, &record, sizeof(Record));
+    std::atomic<uint64_t>* slot = Slot(head);
+    for (size_t i = 0; i < kRecordWords; i++) {
+      slot[i].store(words[i], std::memory_order_release);
+    }
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: returns the range of published, unconsumed records.
+  ReadRange BeginRead() const {
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    // The tail may have been advanced past |tail| since it was loaded; older
+    // records would be reported as overwritten by EndRead() anyway.
+    return ReadRange{std::max(tail, head - std::min<uint64_t>(head, capacity_)),
+                     head};
+  }
+
+  // Consumer: reads record |index| from a range returned by BeginRead().
+  Record Read(uint64_t index) const {
+    uint64_t words[kRecordWords];
+    const std::atomic<uint64_t>* slot = Slot(index);
+    for (size_t i = 0; i < kRecordWords; i++) {
+      words[i] = slot[i].load(std::memory_order_acquire);
+    }
+    Record record;
+    std::memcpy(&record, words, sizeof(Record));
+    return record;
+  }
+
+  // Consumer: marks the |count| records starting at |begin| as consumed.
+  // Returns how many of them, from the start, were overwritten by the
+  // producer after BeginRead() and must be discarded.
+  uint64_t EndRead(uint64_t begin, uint64_t count) {
+    // If Read() saw any overwritten word, its acquire load synchronized with
+    // the producer, so this load observes the tail advance that preceded the
+    // overwrite.
+    // A failed exchange means the producer dropped the oldest record in the
+    // meantime and counted it, so the overwritten count is taken from the
+    // tail the final exchange compared against.
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    const uint64_t new_tail = begin + count;
+    while (tail < new_tail &&
+           !tail_.compare_exchange_weak(tail, new_tail,
+                                        std::memory_order_release,
+                                        std::memory_order_acquire)) {
+    }
+    return tail > begin ? std::min(tail - begin, count) : 0;
+  }
+
+  // Consumer: copies up to |max_count| unread records into |out|. Returns
+  // the number of records copied.
+  size_t Pop(Record* out, size_t max_count) {
+    const ReadRange range = BeginRead();
+    const uint64_t count =
+        std::min<uint64_t>(range.end - range.begin, max_count);
+    for (uint64_t i = 0; i < count; i++) {
+      out[i] = Read(range.begin + i);
+    }
+    const uint64_t overwritten = EndRead(range.begin, count);
+    if (overwritten > 0) {
+      std::memmove(out, out + overwritten,
+                   (count - overwritten) * sizeof(Record));
+    }
+    return static_cast<size_t>(count - overwritten);
+  }
+
+ private:
+  static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  std::atomic<uint64_t>* Slot(uint64_t index) const {
+    return &words_[(index & mask_) * kRecordWords];
+  }
+
+  const size_t capacity_;
+  const uint64_t mask_;
+  const RingDropPolicy policy_;
+  const std::unique_ptr<std::atomic<uint64_t>[]> words_;
+
+  // Written by the producer; kept on its own cache line.
+  alignas(64) std::atomic<uint64_t> head_{0};
+  // Written by the consumer, and by the producer when dropping the oldest.
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  alignas(64) std::atomic<uint64_t> dropped_newest_{0};
+  std::atomic<uint64_t> dropped_oldest_{0};
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_SPSC_RING_H_
@@ -0,0 +1,80 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOW_PROC_REGISTRAR_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOW_PROC_REGISTRAR_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "latency_clock.h"
+
+namespace window_proc_delegate {
+
+struct RawMouseReport;
+struct WindowState;
+
+// A top-level window message, independent of the Win32 headers.
+struct WindowProcMessage {
+  intptr_t window;
+  uint32_t message;
+  uint64_t wparam;
+  int64_t lparam;
+};
+
+// The window procedure hook and window services of the host platform.
+//
+// The Windows plugin implements this on top of
+// flutter::PluginRegistrarWindows; tests and benchmarks use an in-process
+// fake, so everything above it runs on any platform. It is also the clock
+// latency is measured with.
+class WindowProcRegistrar : public LatencyClock {
+ public:
+  // Receives the top-level window messages of one engine.
+  class Handler {
+   public:
+    virtual ~Handler() = default;
+
+    // Returns the window procedure result if |message| was handled.
+    virtual std::optional<int64_t> HandleWindowProc(
+        const WindowProcMessage& message) = 0;
+
+    // Called from the message pump iteration after a PostFlush().
+    virtual void OnFlush() = 0;
+  };
+
+  virtual ~WindowProcRegistrar() = default;
+
+  // Starts delivering top-level window messages to |handler|, or stops if
+  // |handler| is null.
+  virtual void SetHandler(Handler* handler) = 0;
+
+  // Asks for Handler::OnFlush() to be called once the messages queued for
+  // |window| ahead of it are processed. Returns false if it could not be
+  // scheduled.
+  virtual bool PostFlush(intptr_t window) = 0;
+
+  // Converts a point from screen to |window| client coordinates, in place.
+  virtual void ScreenToClient(intptr_t window, int32_t* x, int32_t* y) = 0;
+
+  // The modifier keys held while the current message was generated, as
+  // ChordModifier bits.
+  virtual uint32_t ModifierState() = 0;
+
+  // Reads the current state of |window| from the platform. May be called
+  // from any thread.
+  virtual void QueryWindowState(intptr_t window, WindowState* state) = 0;
+
+  // Returns the monitor with the largest part of |window|.
+  virtual intptr_t MonitorFromWindow(intptr_t window) = 0;
+
+  // Starts or stops delivering the raw input of every mouse to the
+  // engine's top-level window as WM_INPUT. Returns false if it could not be
+  // changed.
+  virtual bool SetRawMouseInput(bool enabled) = 0;
+
+  // Reads the report the WM_INPUT |lparam| refers to into |report|, except
+  // its timestamp. Returns false if it is not mouse input.
+  virtual bool ReadRawMouseInput(int64_t lparam, RawMouseReport* report) = 0;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOW_PROC_REGISTRAR_H_
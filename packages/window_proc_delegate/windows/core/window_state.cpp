@@ -0,0 +1,59 @@
+#include "window_state.h"
+
+namespace window_proc_delegate {
+
+namespace {
+
+constexpr uint32_t kMove = 0x0003;
+constexpr uint32_t kSize = 0x0005;
+constexpr uint32_t kActivate = 0x0006;
+constexpr uint32_t kDisplayChange = 0x007E;
+constexpr uint32_t kDpiChanged = 0x02E0;
+
+constexpr uint64_t kSizeMinimized = 1;
+constexpr uint64_t kSizeMaximized = 2;
+
+// GET_X_LPARAM and GET_Y_LPARAM: signed screen coordinates.
+int64_t LowSigned(int64_t value) {
+  return static_cast<int16_t>(value & 0xFFFF);
+}
+int64_t HighSigned(int64_t value) {
+  return static_cast<int16_t>((value >> 16) & 0xFFFF);
+}
+
+void SetFlag(WindowState* state, int64_t flag, bool set) {
+  state->flags = set ? state->flags | flag : state->flags & ~flag;
+}
+
+}  // namespace
+
+bool ApplyWindowStateMessage(const WindowProcMessage& message,
+                             WindowState* state) {
+  switch (message.message) {
+    case kMove:
+      state->x = LowSigned(message.lparam);
+      state->y = HighSigned(message.lparam);
+      return true;
+    case kSize:
+      SetFlag(state, kWindowMinimized, message.wparam == kSizeMinimized);
+      SetFlag(state, kWindowMaximized, message.wparam == kSizeMaximized);
+      if (message.wparam != kSizeMinimized) {
+        state->width = message.lparam & 0xFFFF;
+        state->height = (message.lparam >> 16) & 0xFFFF;
+      }
+      return true;
+    case kActivate:
+      // WA_INACTIVE is 0; the high word is set if the window is minimized.
+      SetFlag(state, kWindowActive, (message.wparam & 0xFFFF) != 0);
+      return false;
+    case kDisplayChange:
+      return true;
+    case kDpiChanged:
+      state->dpi = static_cast<int64_t>(message.wparam & 0xFFFF);
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace window_proc_delegate
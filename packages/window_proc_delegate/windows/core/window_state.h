@@ -0,0 +1,65 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOW_STATE_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOW_STATE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "seqlock.h"
+#include "window_proc_registrar.h"
+
+namespace window_proc_delegate {
+
+// Bits of WindowState::flags.
+enum WindowStateFlag : int64_t {
+  // The window is the active top-level window.
+  kWindowActive = 1 << 0,
+  kWindowMinimized = 1 << 1,
+  kWindowMaximized = 1 << 2,
+};
+
+// The state of a top-level window that Dart keeps asking for. Every field
+// is 64 bits wide so the block is an Int64List in Dart; the layout is
+// mirrored by lib/src/windows_window_state.dart.
+struct WindowState {
+  int64_t window;
+  // Client area origin in screen coordinates.
+  int64_t x;
+  int64_t y;
+  // Client area size, kept from before minimizing while minimized.
+  int64_t width;
+  int64_t height;
+  int64_t dpi;
+  // WindowStateFlag bits.
+  int64_t flags;
+  // Handle to the monitor with the largest part of the window.
+  int64_t monitor;
+};
+
+static_assert(sizeof(WindowState) == 64,
+              "WindowState must match its Dart mirror");
+
+// A window's state as Dart views it: the SeqLock counter, then the state.
+using WindowStateBlock = SeqLock<WindowState>;
+
+// Whether |message| may change a WindowState.
+constexpr bool IsWindowStateMessage(uint32_t message) {
+  switch (message) {
+    case 0x0003:  // WM_MOVE
+    case 0x0005:  // WM_SIZE
+    case 0x0006:  // WM_ACTIVATE
+    case 0x007E:  // WM_DISPLAYCHANGE
+    case 0x02E0:  // WM_DPICHANGED
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Applies |message| to |state|. Returns true if the message may have moved
+// the window to another monitor, which the caller has to look up.
+bool ApplyWindowStateMessage(const WindowProcMessage& message,
+                             WindowState* state);
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOW_STATE_H_
@@ -0,0 +1,38 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOWS_MESSAGE_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOWS_MESSAGE_H_
+
+#include <cstdint>
+
+#include "message_payload.h"
+
+namespace window_proc_delegate {
+
+// Mirrors the WindowsMessage struct in lib/src/windows_message.dart.
+struct WindowsMessage {
+  intptr_t windowHandle;
+  int32_t message;
+  int64_t wParam;
+  int64_t lParam;
+  int64_t lResult;
+  bool handled;
+  // IDs of the delegates subscribed to |message|, in call order, or null
+  // with a count of -1 if delegates are not routed natively.
+  const int32_t* candidates;
+  int32_t candidateCount;
+  // For WM_COPYDATA, the COPYDATASTRUCT's dwData and a view of the sender's
+  // bytes, valid only for the duration of the call. Otherwise the length
+  // is -1.
+  uint64_t copyDataTag;
+  const uint8_t* copyData;
+  int64_t copyDataLength;
+  // |lParam| decoded for the messages in the payload schema. Writable
+  // payloads are written back after the callback returns.
+  MessagePayload payload;
+};
+
+}  // namespace window_proc_delegate
+
+typedef void (*DartWindowProcCallbackC)(
+    window_proc_delegate::WindowsMessage* message);
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_CORE_WINDOWS_MESSAGE_H_
@@ -0,0 +1,161 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_NATIVE_HANDLER_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_NATIVE_HANDLER_H_
+
+// Native window procedure handlers, which other plugins add to an engine so
+// they run in the same pipeline as its Dart delegates, ahead of them.
+//
+// This header is self-contained and platform-neutral; the functions adding
+// and removing handlers are declared in
+// window_proc_delegate_plugin_c_api.h.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(__cplusplus)
+#include <stdbool.h>
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// A top-level window message, as passed to native handlers.
+typedef struct {
+  intptr_t window;
+  uint32_t message;
+  uint64_t wparam;
+  int64_t lparam;
+} WindowProcDelegateNativeMessage;
+
+// Called on the platform thread for each message the handler was added
+// for. Returns true, with the window procedure result in |*result|, to
+// handle |message|, in which case no later handler and no Dart delegate
+// sees it; returns false to pass it on.
+typedef bool (*WindowProcDelegateNativeHandlerFunction)(
+    void* user_data,
+    const WindowProcDelegateNativeMessage* message,
+    int64_t* result);
+
+#if defined(__cplusplus)
+}  // extern "C"
+
+#include <array>
+#include <optional>
+
+namespace window_proc_delegate {
+
+using NativeMessage = WindowProcDelegateNativeMessage;
+
+namespace internal {
+
+template <size_t N>
+constexpr std::array<uint32_t, N> SortMessages(
+    std::array<uint32_t, N> messages) {
+  for (size_t i = 1; i < N; i++) {
+    const uint32_t message = messages[i];
+    size_t j = i;
+    for (; j > 0 && messages[j - 1] > message; j--) {
+      messages[j] = messages[j - 1];
+    }
+    messages[j] = message;
+  }
+  return messages;
+}
+
+template <size_t N>
+constexpr bool IsStrictlyAscending(const std::array<uint32_t, N>& messages) {
+  for (size_t i = 1; i < N; i++) {
+    if (messages[i - 1] >= messages[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Handler>
+bool CallNativeHandler(void* user_data,
+                       const WindowProcDelegateNativeMessage* message,
+                       int64_t* result) {
+  const std::optional<int64_t> handled =
+      (*static_cast<Handler*>(user_data))(*message);
+  if (handled) {
+    *result = *handled;
+  }
+  return handled.has_value();
+}
+
+}  // namespace internal
+
+// The messages a native handler handles, sorted and checked for duplicates
+// at compile time. The plugin merges the lists of every handler into one
+// jump table when a handler is added, so a message costs a bit test if no
+// handler wants it and a binary search otherwise.
+template <uint32_t... Messages>
+struct MessageList {
+  static_assert(sizeof...(Messages) > 0,
+                "A native handler must handle at least one message.");
+  static_assert(((Messages < 0x10000) && ...),
+                "Message identifiers above 0xFFFF are reserved.");
+
+  static constexpr size_t kCount = sizeof...(Messages);
+
+  // The messages in ascending order.
+  static constexpr std::array<uint32_t, kCount> kSorted =
+      internal::SortMessages<kCount>({{Messages...}});
+
+  static_assert(internal::IsStrictlyAscending(kSorted),
+                "A message is listed more than once.");
+
+  // Returns the position of |message| in kSorted, or kCount if it is not
+  // listed, so handlers can switch on it.
+  static constexpr size_t IndexOf(uint32_t message) {
+    size_t low = 0;
+    size_t high = kCount;
+    while (low < high) {
+      const size_t middle = low + (high - low) / 2;
+      if (kSorted[middle] < message) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return low < kCount && kSorted[low] == message ? low : kCount;
+  }
+
+  static constexpr bool Contains(uint32_t message) {
+    return IndexOf(message) != kCount;
+  }
+};
+
+// What the plugin needs to call a native handler.
+struct NativeHandlerBinding {
+  // Sorted, without duplicates.
+  const uint32_t* messages;
+  size_t message_count;
+  WindowProcDelegateNativeHandlerFunction function;
+};
+
+// Returns the binding of |Handler|, a class naming its messages and
+// answering them:
+//
+//   struct DpiHandler {
+//     using Messages = MessageList<WM_DPICHANGED, WM_GETDPISCALEDSIZE>;
+//
+//     // Returns the window procedure result to handle |message|, or
+//     // nothing to pass it on.
+//     std::optional<int64_t> operator()(const NativeMessage& message);
+//   };
+//
+// The handler object is the binding's user data.
+template <typename Handler>
+constexpr NativeHandlerBinding BindNativeHandler() {
+  using Messages = typename Handler::Messages;
+  return {Messages::kSorted.data(), Messages::kCount,
+          &internal::CallNativeHandler<Handler>};
+}
+
+}  // namespace window_proc_delegate
+
+#endif  // defined(__cplusplus)
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_NATIVE_HANDLER_H_
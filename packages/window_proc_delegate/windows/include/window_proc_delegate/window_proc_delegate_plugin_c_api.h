@@ -3,6 +3,8 @@
 
 #include <flutter_plugin_registrar.h>
 
+#include "native_handler.h"
+
 #ifdef FLUTTER_PLUGIN_IMPL
 #define FLUTTER_PLUGIN_EXPORT __declspec(dllexport)
 #else
@@ -16,8 +18,86 @@ extern "C" {
 FLUTTER_PLUGIN_EXPORT void WindowProcDelegatePluginCApiRegisterWithRegistrar(
     FlutterDesktopPluginRegistrarRef registrar);
 
+// Calls |function| with |user_data| for the |message_count| messages in
+// |messages| that reach the top-level windows of the engine |registrar|
+// belongs to, ahead of its Dart delegates. Handlers of higher |priority|
+// run first; equal priorities run in the order they were added. Returns
+// the handler's ID, or 0 if |function| is null or no message is below
+// 0x10000.
+//
+// May be called before this plugin registers with the engine.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateAddNativeHandler(
+    FlutterDesktopPluginRegistrarRef registrar,
+    const uint32_t* messages,
+    size_t message_count,
+    int32_t priority,
+    WindowProcDelegateNativeHandlerFunction function,
+    void* user_data);
+
+// Removes handler |handler_id|. Once this returns on the platform thread,
+// the handler is not called again.
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateRemoveNativeHandler(
+    FlutterDesktopPluginRegistrarRef registrar,
+    int64_t handler_id);
+
 #if defined(__cplusplus)
 }  // extern "C"
+
+#include <windows.h>
+
+namespace window_proc_delegate {
+
+namespace internal {
+
+// Looks |name| up in this plugin's DLL, which the runner loads at startup
+// with every other plugin, so callers of the helpers below need not link
+// against it. Returns null if the plugin is not part of the app.
+template <typename Function>
+Function ResolvePluginFunction(const char* name) {
+  HMODULE plugin = GetModuleHandleW(L"window_proc_delegate_plugin.dll");
+  return plugin ? reinterpret_cast<Function>(reinterpret_cast<void*>(
+                      GetProcAddress(plugin, name)))
+                : nullptr;
+}
+
+}  // namespace internal
+
+// Adds |handler|, which must stay alive until it is removed or the engine
+// shuts down, as a native handler of the engine |registrar| belongs to; see
+// BindNativeHandler(). Returns the handler's ID, or 0 if this plugin is not
+// loaded.
+//
+// Unlike the C entry points above, this and RemoveNativeHandler() resolve
+// them at runtime: plugins using them only need this header.
+template <typename Handler>
+int64_t AddNativeHandler(FlutterDesktopPluginRegistrarRef registrar,
+                         Handler* handler,
+                         int32_t priority = 0) {
+  static const auto add =
+      internal::ResolvePluginFunction<decltype(
+          &WindowProcDelegateAddNativeHandler)>(
+          "WindowProcDelegateAddNativeHandler");
+  if (!add) {
+    return 0;
+  }
+  constexpr NativeHandlerBinding binding = BindNativeHandler<Handler>();
+  return add(registrar, binding.messages, binding.message_count, priority,
+             binding.function, handler);
+}
+
+// Removes a handler added with AddNativeHandler().
+inline void RemoveNativeHandler(FlutterDesktopPluginRegistrarRef registrar,
+                                int64_t handler_id) {
+  static const auto remove =
+      internal::ResolvePluginFunction<decltype(
+          &WindowProcDelegateRemoveNativeHandler)>(
+          "WindowProcDelegateRemoveNativeHandler");
+  if (remove) {
+    remove(registrar, handler_id);
+  }
+}
+
+}  // namespace window_proc_delegate
 #endif
 
 #endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_PLUGIN_C_API_H_
@@ -0,0 +1,55 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_BENCHMARK_BENCHMARK_UTIL_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_BENCHMARK_BENCHMARK_UTIL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace window_proc_delegate {
+namespace benchmark {
+
+// Number of iterations to run, scaled down by passing --quick so the
+// benchmarks can double as smoke tests under ctest.
+inline int64_t Iterations(int argc, char** argv, int64_t full) {
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--quick") == 0) {
+      return full / 100 > 0 ? full / 100 : 1;
+    }
+  }
+  return full;
+}
+
+// Runs |body| |iterations| times and prints the time per iteration and the
+// resulting rate. |body| receives the iteration index.
+template <typename Body>
+double Measure(const char* name, int64_t iterations, Body&& body) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < iterations; i++) {
+    body(i);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const double ns =
+      std::chrono::duration<double, std::nano>(end - start).count();
+  const double ns_per_op = ns / static_cast<double>(iterations);
+  std::printf("%-48s %10.2f ns/msg %14.0f msg/s\n", name, ns_per_op,
+              1e9 / ns_per_op);
+  return ns_per_op;
+}
+
+// Keeps the compiler from optimizing away |value|.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+  static volatile const T* sink;
+  sink = &value;
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+}  // namespace benchmark
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_BENCHMARK_BENCHMARK_UTIL_H_
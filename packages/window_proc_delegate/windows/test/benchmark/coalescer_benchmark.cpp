@@ -0,0 +1,78 @@
+// Replays synthetic 1 kHz mouse streams (moves and high-resolution wheel
+// ticks over several windows) through MessageCoalescer, flushing at 60 Hz
+// like a message pump that keeps up with the display, and reports the
+// per-message cost and how many records reach Dart.
+
+#include <vector>
+
+#include "../../core/message_coalescer.h"
+#include "benchmark_util.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int64_t kMouseMove = 0x0200;
+constexpr int64_t kMouseWheel = 0x020A;
+constexpr int64_t kLeftButtonDown = 0x0201;
+constexpr int kWindows = 4;
+// Messages per 60 Hz frame for a 1 kHz device, per window.
+constexpr int kMessagesPerFrame = 1000 / 60;
+
+std::vector<ObservedMessage> MakeStream(int64_t frames) {
+  std::vector<ObservedMessage> stream;
+  for (int64_t frame = 0; frame < frames; frame++) {
+    for (int i = 0; i < kMessagesPerFrame; i++) {
+      for (int64_t hwnd = 1; hwnd <= kWindows; hwnd++) {
+        const int64_t tick = frame * kMessagesPerFrame + i;
+        stream.push_back(
+            {hwnd, kMouseMove, 0, ((tick & 0x7FF) << 16) | (tick & 0x7FF), 1});
+        if (i % 2 == 0) {
+          // 0xFFF8 is a -8 high-resolution wheel delta.
+          stream.push_back({hwnd, kMouseWheel, 0xFFF80000, 0, 1});
+        }
+        if (i == 0 && frame % 30 == 0) {
+          stream.push_back({hwnd, kLeftButtonDown, 1, 0, 1});
+        }
+      }
+    }
+  }
+  return stream;
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  const int64_t frames = benchmark::Iterations(argc, argv, 60 * 600);
+  const std::vector<ObservedMessage> stream = MakeStream(frames);
+  const size_t per_frame = stream.size() / static_cast<size_t>(frames);
+
+  for (bool coalesce : {false, true}) {
+    MessageCoalescer coalescer;
+    if (coalesce) {
+      coalescer.SetPolicy(kMouseMove, CoalescePolicy::kKeepLatest);
+      coalescer.SetPolicy(kMouseWheel, CoalescePolicy::kAccumulate);
+    }
+    std::vector<ObservedMessage> out;
+    out.reserve(per_frame);
+    int64_t delivered = 0;
+
+    benchmark::Measure(
+        coalesce ? "keep-latest moves, accumulated wheel" : "no coalescing",
+        static_cast<int64_t>(stream.size()), [&](int64_t i) {
+          coalescer.Add(stream[static_cast<size_t>(i)]);
+          if ((i + 1) % static_cast<int64_t>(per_frame) == 0) {
+            coalescer.Flush(&out);
+            delivered += static_cast<int64_t>(out.size());
+            out.clear();
+          }
+        });
+    std::printf("  %lld messages in, %lld records delivered (%.1f%%)\n",
+                static_cast<long long>(stream.size()),
+                static_cast<long long>(delivered),
+                100.0 * static_cast<double>(delivered) /
+                    static_cast<double>(stream.size()));
+  }
+  return 0;
+}
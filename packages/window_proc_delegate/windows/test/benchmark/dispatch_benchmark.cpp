@@ -0,0 +1,113 @@
+// Compares the cost of forwarding one window message to the Dart callback
+// through the legacy GetCallback() path (mutex + std::function per message)
+// and through the atomically published DispatchRecord.
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "../../core/dispatch_record.h"
+#include "../fake_dart_api.h"
+#include "benchmark_util.h"
+
+namespace window_proc_delegate {
+namespace {
+
+int64_t g_handled = 0;
+
+void CountingCallback(WindowsMessage* message) {
+  g_handled += message->message;
+}
+
+// Verbatim shape of WindowProcDelegatePlugin::GetCallback() before the
+// dispatch record was introduced.
+class LegacyDispatcher {
+ public:
+  void SetCallback(DartWindowProcCallbackC callback, Dart_Isolate isolate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = callback;
+    isolate_ = isolate;
+  }
+
+  std::function<void(WindowsMessage*)> GetCallback() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!callback_ || !isolate_) {
+      return nullptr;
+    }
+    return [callback = callback_, isolate = isolate_](WindowsMessage* message) {
+      Dart_Isolate previous = Dart_CurrentIsolate_DL();
+      if (previous != isolate) {
+        if (previous) {
+          Dart_ExitIsolate_DL();
+        }
+        Dart_EnterIsolate_DL(isolate);
+      }
+      callback(message);
+      Dart_Isolate current = Dart_CurrentIsolate_DL();
+      if (previous != isolate) {
+        if (current) {
+          Dart_ExitIsolate_DL();
+        }
+        if (previous) {
+          Dart_EnterIsolate_DL(previous);
+        }
+      }
+    };
+  }
+
+ private:
+  DartWindowProcCallbackC callback_ = nullptr;
+  Dart_Isolate isolate_ = nullptr;
+  std::mutex mutex_;
+};
+
+WindowsMessage MakeMessage(int64_t i) {
+  WindowsMessage msg = {};
+  msg.windowHandle = 0x1234;
+  msg.message = static_cast<int32_t>(i & 0x3FF);
+  return msg;
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  testing::InstallFakeDartApi();
+  const int64_t iterations = benchmark::Iterations(argc, argv, 20000000);
+  const Dart_Isolate isolate = testing::FakeIsolate(0);
+
+  LegacyDispatcher legacy;
+  legacy.SetCallback(&CountingCallback, isolate);
+
+  DispatchRecord record{&CountingCallback, isolate,
+                        std::shared_ptr<const MessageFilter>(
+                            MessageFilter::AcceptAll())};
+  std::atomic<const DispatchRecord*> published{&record};
+
+  for (bool isolate_current : {true, false}) {
+    Dart_EnterIsolate_DL(isolate_current ? isolate : nullptr);
+    std::printf("isolate %s current:\n", isolate_current ? "already" : "not");
+
+    benchmark::Measure("  legacy GetCallback()", iterations, [&](int64_t i) {
+      WindowsMessage msg = MakeMessage(i);
+      auto callback = legacy.GetCallback();
+      if (callback) {
+        callback(&msg);
+      }
+    });
+
+    benchmark::Measure("  DispatchRecord", iterations, [&](int64_t i) {
+      WindowsMessage msg = MakeMessage(i);
+      const DispatchRecord* current =
+          published.load(std::memory_order_acquire);
+      if (current && current->filter->Accepts(msg.message)) {
+        DispatchToDart(*current, &msg);
+      }
+    });
+  }
+
+  benchmark::DoNotOptimize(g_handled);
+  return 0;
+}
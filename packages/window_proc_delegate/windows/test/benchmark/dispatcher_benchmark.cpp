@@ -0,0 +1,131 @@
+// Drives the full Dispatcher message path for 1 to 8 engines attached to the
+// same window, as with several Flutter engines in one process. Traffic is
+// either unfiltered (every message reaches Dart) or filtered (one message
+// kind in sixteen does), and delivery is either synchronous through the
+// Dart callback or asynchronous through a batch observer flushed every 16
+// messages, like a message pump. Idle engines, whose last delegate went
+// away, give the floor every window message pays. Costs are per window
+// message, summed over all engines.
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "../../core/dispatcher.h"
+#include "../fake_dart_api.h"
+#include "../fake_window_proc_registrar.h"
+#include "benchmark_util.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kFilteredMessage = 0x0200;
+constexpr int kMessagesPerPump = 16;
+
+int64_t g_handled = 0;
+
+// Like a Dart delegate that looks at the message but does not handle it.
+void ObservingCallback(WindowsMessage* message) {
+  g_handled += message->message;
+}
+
+std::unique_ptr<MessageFilter> MakeFilter(bool filtered) {
+  if (!filtered) {
+    return MessageFilter::AcceptAll();
+  }
+  const uint32_t range[] = {kFilteredMessage, kFilteredMessage};
+  return MessageFilter::FromRanges(range, 1);
+}
+
+struct Engine {
+  testing::FakeWindowProcRegistrar registrar;
+  Dispatcher dispatcher{&registrar};
+};
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  testing::InstallFakeDartApi();
+  const int64_t iterations = benchmark::Iterations(argc, argv, 4000000);
+  Dart_EnterIsolate_DL(testing::FakeIsolate(0));
+
+  // One message in sixteen is the filtered message kind.
+  std::vector<WindowProcMessage> stream;
+  for (uint32_t i = 0; i < 1024; i++) {
+    const uint32_t message = i % 16 == 0 ? kFilteredMessage : 0x0100 + i % 16;
+    stream.push_back({0x1234, message, i, static_cast<int64_t>(i)});
+  }
+
+  for (int engine_count : {1, 2, 4, 8}) {
+    std::vector<std::unique_ptr<Engine>> engines;
+    for (int e = 0; e < engine_count; e++) {
+      auto engine = std::make_unique<Engine>();
+      // Subscribed once, then unsubscribed, as Dart does.
+      engine->dispatcher.SetCallback(&ObservingCallback,
+                                     testing::FakeIsolate(0));
+      engine->dispatcher.SetCallback(nullptr, nullptr);
+      engine->registrar.Send(stream[0]);
+      engines.push_back(std::move(engine));
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "idle, %d engine%s", engine_count,
+                  engine_count == 1 ? "" : "s");
+    benchmark::Measure(name, iterations, [&](int64_t i) {
+      const WindowProcMessage& message = stream[static_cast<size_t>(i) & 1023];
+      for (const auto& engine : engines) {
+        if (engine->registrar.Send(message)) {
+          break;
+        }
+      }
+    });
+  }
+
+  for (bool async : {false, true}) {
+    for (bool filtered : {false, true}) {
+      for (int engine_count : {1, 2, 4, 8}) {
+        std::vector<std::unique_ptr<Engine>> engines;
+        for (int e = 0; e < engine_count; e++) {
+          auto engine = std::make_unique<Engine>();
+          if (async) {
+            engine->dispatcher.AddObserver(std::make_shared<BatchObserver>(
+                e + 1, e + 1, MakeFilter(filtered)));
+          } else {
+            engine->dispatcher.SetCallback(&ObservingCallback,
+                                           testing::FakeIsolate(0));
+            engine->dispatcher.SetMessageFilter(MakeFilter(filtered));
+          }
+          engines.push_back(std::move(engine));
+        }
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s %s, %d engine%s",
+                      async ? "async" : "sync",
+                      filtered ? "filtered" : "unfiltered", engine_count,
+                      engine_count == 1 ? "" : "s");
+        benchmark::Measure(name, iterations, [&](int64_t i) {
+          const WindowProcMessage& message =
+              stream[static_cast<size_t>(i) & 1023];
+          // Like the Flutter registrar: each engine's delegate in turn,
+          // until one handles the message.
+          for (const auto& engine : engines) {
+            if (engine->registrar.Send(message)) {
+              break;
+            }
+          }
+          if (async && (i + 1) % kMessagesPerPump == 0) {
+            for (const auto& engine : engines) {
+              engine->registrar.PumpFlushes();
+            }
+          }
+        });
+        testing::TakeFakePostedMessages();
+      }
+    }
+  }
+
+  benchmark::DoNotOptimize(g_handled);
+  return 0;
+}
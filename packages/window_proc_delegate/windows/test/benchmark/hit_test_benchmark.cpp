@@ -0,0 +1,102 @@
+// Answers WM_NCHITTEST-style lookups over synthetic layouts of tens to
+// thousands of regions (a title bar, resize borders, and a grid of
+// interactive tiles), comparing HitTestIndex with a linear scan of the
+// region list, and reports how long building each index takes.
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "../../core/hit_test_index.h"
+#include "benchmark_util.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int32_t kWidth = 1920;
+constexpr int32_t kHeight = 1080;
+constexpr int32_t kHtClient = 1;
+constexpr int32_t kHtCaption = 2;
+
+std::vector<HitTestRegion> MakeLayout(int tiles) {
+  std::vector<HitTestRegion> regions = {
+      {0, 0, kWidth, 32, kHtCaption},
+      {-8, 0, 0, kHeight, 10},
+      {kWidth, 0, kWidth + 8, kHeight, 11},
+      {0, kHeight, kWidth, kHeight + 8, 15},
+  };
+  int columns = 1;
+  while (columns * columns < tiles) {
+    columns++;
+  }
+  const int32_t tile_width = kWidth / columns;
+  const int32_t tile_height = (kHeight - 32) / columns;
+  for (int i = 0; i < tiles; i++) {
+    const int32_t left = (i % columns) * tile_width;
+    const int32_t top = 32 + (i / columns) * tile_height;
+    // Tiles are draggable caption areas with a clickable button inset.
+    regions.push_back({left, top, left + tile_width, top + tile_height,
+                       kHtCaption});
+    regions.push_back({left + 2, top + 2, left + tile_width / 2,
+                       top + tile_height / 2, kHtClient});
+  }
+  return regions;
+}
+
+int32_t LinearLookup(const std::vector<HitTestRegion>& regions, int32_t x,
+                     int32_t y) {
+  for (size_t i = regions.size(); i-- > 0;) {
+    const HitTestRegion& region = regions[i];
+    if (x >= region.left && x < region.right && y >= region.top &&
+        y < region.bottom) {
+      return region.code;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  const int64_t iterations = benchmark::Iterations(argc, argv, 10000000);
+
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int32_t> x_distribution(-8, kWidth + 8);
+  std::uniform_int_distribution<int32_t> y_distribution(0, kHeight + 8);
+  std::vector<std::pair<int32_t, int32_t>> points(4096);
+  for (auto& point : points) {
+    point = {x_distribution(random), y_distribution(random)};
+  }
+
+  for (int tiles : {16, 256, 2500}) {
+    const std::vector<HitTestRegion> regions = MakeLayout(tiles);
+    std::printf("%zu regions\n", regions.size());
+
+    const auto build_start = std::chrono::steady_clock::now();
+    HitTestIndex index(regions);
+    const auto build_end = std::chrono::steady_clock::now();
+    std::printf("  build %.1f us\n",
+                std::chrono::duration<double, std::micro>(build_end -
+                                                          build_start)
+                    .count());
+
+    // Fewer linear iterations for large layouts, so full runs stay short.
+    const int64_t linear_iterations = std::max<int64_t>(
+        1, iterations / static_cast<int64_t>(regions.size() / 16 + 1));
+    benchmark::Measure("  linear scan", linear_iterations, [&](int64_t i) {
+      const auto& point = points[static_cast<size_t>(i) & 4095];
+      benchmark::DoNotOptimize(
+          LinearLookup(regions, point.first, point.second));
+    });
+    benchmark::Measure("  HitTestIndex", iterations, [&](int64_t i) {
+      const auto& point = points[static_cast<size_t>(i) & 4095];
+      int32_t code = 0;
+      benchmark::DoNotOptimize(index.Lookup(point.first, point.second, &code));
+      benchmark::DoNotOptimize(code);
+    });
+  }
+  return 0;
+}
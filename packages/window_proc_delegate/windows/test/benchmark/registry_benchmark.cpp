@@ -0,0 +1,162 @@
+// Measures calls from Dart into a dozen registered engines, as with
+// desktop_multi_window, on 1 to 8 calling threads, each calling into its own
+// engine like one isolate per window, with and without another thread
+// registering and unregistering engines. Compares the registry before
+// it became lock-free (one mutex and a std::map) against lookups by engine
+// ID and by cached handle. Costs are per call; rates are summed over the
+// calling threads.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../core/engine_registry.h"
+#include "../fake_dart_api.h"
+#include "../fake_window_proc_registrar.h"
+#include "benchmark_util.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int64_t kEngines = 12;
+constexpr int64_t kChurnEngines = 4;
+
+// Shape of EngineRegistry before it became lock-free.
+class LockedRegistry {
+ public:
+  void Register(int64_t engine_id, Dispatcher* dispatcher) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dispatchers_[engine_id] = dispatcher;
+  }
+
+  void Unregister(int64_t engine_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dispatchers_.erase(engine_id);
+  }
+
+  DispatchLatency* SetLatencyTracking(int64_t engine_id, bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = dispatchers_.find(engine_id);
+    if (it == dispatchers_.end()) {
+      return nullptr;
+    }
+    it->second->latency().set_enabled(enabled);
+    return &it->second->latency();
+  }
+
+ private:
+  std::map<int64_t, Dispatcher*> dispatchers_;
+  std::mutex mutex_;
+};
+
+struct Engine {
+  testing::FakeWindowProcRegistrar registrar;
+  Dispatcher dispatcher{&registrar};
+};
+
+// Runs |call| |iterations| times on each of |threads| threads while
+// |churn| runs on another thread if set, and prints the cost per call.
+template <typename Call, typename Churn>
+void Run(const char* name, int threads, bool churning, int64_t iterations,
+         Call call, Churn churn) {
+  std::atomic<bool> done{false};
+  std::thread churn_thread;
+  if (churning) {
+    churn_thread = std::thread([&] {
+      for (int64_t i = 0; !done.load(std::memory_order_relaxed); i++) {
+        churn(i);
+      }
+    });
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> callers;
+  for (int t = 0; t < threads; t++) {
+    callers.emplace_back([&call, iterations, t] {
+      for (int64_t i = 0; i < iterations; i++) {
+        benchmark::DoNotOptimize(call(t, i));
+      }
+    });
+  }
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  done = true;
+  if (churn_thread.joinable()) {
+    churn_thread.join();
+  }
+
+  const double ns =
+      std::chrono::duration<double, std::nano>(end - start).count();
+  const double calls = static_cast<double>(iterations) * threads;
+  char label[96];
+  std::snprintf(label, sizeof(label), "  %s, %d thread%s%s", name, threads,
+                threads == 1 ? "" : "s", churning ? ", churn" : "");
+  std::printf("%-48s %10.2f ns/call %14.0f calls/s\n", label,
+              ns * threads / calls, calls * 1e9 / ns);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  testing::InstallFakeDartApi();
+  const int64_t iterations = benchmark::Iterations(argc, argv, 2000000);
+
+  std::vector<std::unique_ptr<Engine>> engines;
+  for (int64_t i = 0; i < kEngines + kChurnEngines; i++) {
+    engines.push_back(std::make_unique<Engine>());
+  }
+
+  LockedRegistry locked;
+  EngineRegistry registry;
+  std::vector<EngineHandle> handles;
+  for (int64_t i = 0; i < kEngines; i++) {
+    locked.Register(i, &engines[i]->dispatcher);
+    handles.push_back(registry.Register(i, &engines[i]->dispatcher));
+  }
+
+  // Churn engines live after the stable ones.
+  auto locked_churn = [&](int64_t i) {
+    const int64_t engine_id = kEngines + i % kChurnEngines;
+    locked.Register(engine_id, &engines[engine_id]->dispatcher);
+    locked.Unregister(engine_id);
+  };
+  auto registry_churn = [&](int64_t i) {
+    const int64_t engine_id = kEngines + i % kChurnEngines;
+    registry.Register(engine_id, &engines[engine_id]->dispatcher);
+    registry.Unregister(engine_id);
+  };
+
+  for (bool churning : {false, true}) {
+    for (int threads : {1, 2, 4, 8}) {
+      Run(
+          "mutex + std::map", threads, churning, iterations,
+          [&](int t, int64_t i) {
+            return locked.SetLatencyTracking(t % kEngines, i < 0);
+          },
+          locked_churn);
+      Run(
+          "lock-free, by engine ID", threads, churning, iterations,
+          [&](int t, int64_t i) {
+            return registry.SetLatencyTracking(registry.Find(t % kEngines),
+                                               i < 0);
+          },
+          registry_churn);
+      Run(
+          "lock-free, by handle", threads, churning, iterations,
+          [&](int t, int64_t i) {
+            return registry.SetLatencyTracking(handles[t % kEngines], i < 0);
+          },
+          registry_churn);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Evaluates a typical set of static interceptions (background erasing,
+// SC_KEYMENU, minimum window size, a few per-window replies) against a
+// message mix dominated by mouse and paint traffic, comparing the compiled
+// ReplyRuleTable with interpreting the rule program in declaration order.
+
+#include <vector>
+
+#include "../../core/reply_rules.h"
+#include "benchmark_util.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int64_t kRuleWords = ReplyRuleTable::kRuleHeaderWords;
+
+std::vector<int64_t> MakeProgram() {
+  std::vector<int64_t> program;
+  auto add = [&program](int64_t message, int64_t hwnd, int64_t wparam_mask,
+                        int64_t wparam_value, ReplyAction action,
+                        int64_t result) {
+    program.insert(program.end(), {message, hwnd, wparam_mask, wparam_value, 0,
+                                   0, static_cast<int64_t>(action), result, 0});
+  };
+  // WM_ERASEBKGND, then WM_SYSCOMMAND SC_KEYMENU and SC_CLOSE.
+  add(0x0014, 0, 0, 0, ReplyAction::kReply, 1);
+  add(0x0112, 0, 0xFFF0, 0xF100, ReplyAction::kReply, 0);
+  add(0x0112, 0, 0xFFF0, 0xF060, ReplyAction::kForward, 0);
+  // Application messages answered for one window.
+  for (int64_t message = 0x8000; message < 0x8010; message++) {
+    add(message, 0x100, 0, 0, ReplyAction::kReply, message);
+  }
+  // WM_GETMINMAXINFO with a 640x480 minimum track size.
+  program.insert(program.end(),
+                 {0x0024, 0, 0, 0, 0, 0,
+                  static_cast<int64_t>(ReplyAction::kWriteAndReply), 0, 2, 24,
+                  640, 28, 480});
+  return program;
+}
+
+// Walks the program for every message, like an uncompiled interpreter.
+ReplyDecision Interpret(const std::vector<int64_t>& program, int64_t hwnd,
+                        int64_t message, int64_t wparam, int64_t lparam) {
+  for (size_t i = 0; i < program.size();
+       i += kRuleWords + static_cast<size_t>(program[i + 8]) * 2) {
+    const int64_t* rule = &program[i];
+    if (rule[0] != message || (rule[1] != 0 && rule[1] != hwnd) ||
+        (wparam & rule[2]) != rule[3] || (lparam & rule[4]) != rule[5]) {
+      continue;
+    }
+    ReplyDecision decision;
+    decision.kind = rule[6] == static_cast<int64_t>(ReplyAction::kForward)
+                        ? ReplyDecision::Kind::kForward
+                        : ReplyDecision::Kind::kReply;
+    decision.result = rule[7];
+    return decision;
+  }
+  return ReplyDecision();
+}
+
+struct Message {
+  int64_t hwnd;
+  int64_t message;
+  int64_t wparam;
+};
+
+std::vector<Message> MakeStream() {
+  std::vector<Message> stream;
+  for (int i = 0; i < 1024; i++) {
+    // Mostly WM_MOUSEMOVE, with WM_NCHITTEST, WM_PAINT, WM_ERASEBKGND,
+    // WM_SYSCOMMAND and an application message mixed in.
+    int64_t message = 0x0200;
+    if (i % 8 == 0) message = 0x0084;
+    if (i % 16 == 1) message = 0x000F;
+    if (i % 32 == 2) message = 0x0014;
+    if (i % 64 == 3) message = 0x0112;
+    if (i % 128 == 4) message = 0x8003;
+    stream.push_back({i % 3 == 0 ? 0x100 : 0x200, message, 0xF100});
+  }
+  return stream;
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  const int64_t iterations = benchmark::Iterations(argc, argv, 20000000);
+  const std::vector<int64_t> program = MakeProgram();
+  const std::vector<Message> stream = MakeStream();
+  auto table = ReplyRuleTable::Compile(program.data(), program.size());
+
+  benchmark::Measure("interpreted program", iterations, [&](int64_t i) {
+    const Message& message = stream[static_cast<size_t>(i) & 1023];
+    benchmark::DoNotOptimize(Interpret(program, message.hwnd, message.message,
+                                       message.wparam, 0)
+                                 .kind);
+  });
+  benchmark::Measure("compiled ReplyRuleTable", iterations, [&](int64_t i) {
+    const Message& message = stream[static_cast<size_t>(i) & 1023];
+    benchmark::DoNotOptimize(
+        table
+            ->Evaluate(message.hwnd, static_cast<uint32_t>(message.message),
+                       static_cast<uint64_t>(message.wparam), 0)
+            .kind);
+  });
+  return 0;
+}
@@ -0,0 +1,194 @@
+// Measures the time from engine start to the first window message delivered
+// to Dart, and how many messages the window received before then.
+//
+// A platform thread stands in for the Flutter Windows platform thread. It
+// first sends the window's startup messages (sizing, showing, activation),
+// each after some window setup work, without running posted tasks, as
+// Win32 sends them synchronously; then it runs the message loop, sending a
+// message per iteration and running the tasks posted to it, such as method
+// channel calls. A UI thread stands in for the isolate setting its callback
+// as soon as it starts:
+//
+//  - Before, the callback was kept pending until a setEngineId method
+//    channel call, handled by a task on the platform thread, registered the
+//    engine. The thread hop is the only part of the channel modelled here;
+//    the codec and the engine's task runners add to it on a real engine.
+//  - Now, the plugin attaches itself when the engine starts and setting the
+//    callback binds the engine synchronously through FFI.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../core/engine_registry.h"
+#include "../fake_dart_api.h"
+#include "../fake_window_proc_registrar.h"
+#include "benchmark_util.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int64_t kEngineId = 1;
+constexpr intptr_t kPluginKey = 0x1000;
+constexpr uint32_t kStartupMessages[] = {
+    0x0024,  // WM_GETMINMAXINFO
+    0x0046,  // WM_WINDOWPOSCHANGING
+    0x0083,  // WM_NCCALCSIZE
+    0x0047,  // WM_WINDOWPOSCHANGED
+    0x0005,  // WM_SIZE
+    0x0003,  // WM_MOVE
+    0x0018,  // WM_SHOWWINDOW
+    0x001C,  // WM_ACTIVATEAPP
+    0x0086,  // WM_NCACTIVATE
+    0x0006,  // WM_ACTIVATE
+    0x0007,  // WM_SETFOCUS
+    0x02E0,  // WM_DPICHANGED
+};
+constexpr uint32_t kTimer = 0x0113;
+// Window setup work between two startup messages.
+constexpr std::chrono::microseconds kSetupStep{100};
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> g_delivered{false};
+Clock::time_point g_first_delivery;
+
+void RecordingCallback(WindowsMessage* message) {
+  if (!g_delivered.load(std::memory_order_relaxed)) {
+    g_first_delivery = Clock::now();
+    g_delivered.store(true, std::memory_order_release);
+  }
+}
+
+// Tasks posted to the platform thread, run between window messages.
+class TaskQueue {
+ public:
+  void Post(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+
+  void RunPending() {
+    std::deque<std::function<void()>> tasks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks.swap(tasks_);
+    }
+    for (auto& task : tasks) {
+      task();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<std::function<void()>> tasks_;
+};
+
+struct Startup {
+  double microseconds;
+  // Startup messages sent before the first delivery.
+  int64_t missed;
+};
+
+// Starts an engine, with |set_callback| run on the UI thread, and returns
+// how long the first message took to reach the callback.
+template <typename Attach, typename SetCallback>
+Startup Start(Attach attach, SetCallback set_callback) {
+  testing::FakeWindowProcRegistrar registrar;
+  Dispatcher dispatcher(&registrar);
+  EngineRegistry registry;
+  registry.SetEngineLocator([](int64_t engine_id) -> intptr_t {
+    return engine_id == kEngineId ? kPluginKey : 0;
+  });
+  TaskQueue platform_tasks;
+  g_delivered = false;
+
+  const Clock::time_point start = Clock::now();
+  int64_t missed = 0;
+  std::thread platform([&] {
+    attach(registry, dispatcher);
+    for (uint32_t message : kStartupMessages) {
+      std::this_thread::sleep_for(kSetupStep);
+      registrar.Send({1, message, 0, 0});
+      if (!g_delivered.load(std::memory_order_acquire)) {
+        missed++;
+      }
+    }
+    while (!g_delivered.load(std::memory_order_acquire)) {
+      platform_tasks.RunPending();
+      registrar.Send({1, kTimer, 0, 0});
+      // A message loop waits for the next message here.
+      std::this_thread::yield();
+    }
+  });
+  std::thread ui([&] { set_callback(registry, dispatcher, platform_tasks); });
+  ui.join();
+  platform.join();
+  registry.Detach(kPluginKey);
+  registry.Unregister(kEngineId);
+
+  return {std::chrono::duration<double, std::micro>(g_first_delivery - start)
+              .count(),
+          missed};
+}
+
+void Report(const char* name, std::vector<Startup> runs) {
+  std::sort(runs.begin(), runs.end(), [](const Startup& a, const Startup& b) {
+    return a.microseconds < b.microseconds;
+  });
+  double missed = 0;
+  for (const Startup& run : runs) {
+    missed += static_cast<double>(run.missed);
+  }
+  std::printf("%-28s p50 %8.1f us  p99 %8.1f us  %5.2f of %zu missed\n", name,
+              runs[runs.size() / 2].microseconds,
+              runs[runs.size() * 99 / 100].microseconds,
+              missed / static_cast<double>(runs.size()),
+              std::size(kStartupMessages));
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  testing::InstallFakeDartApi();
+  const int64_t iterations = benchmark::Iterations(argc, argv, 2000);
+
+  std::vector<Startup> channel;
+  std::vector<Startup> ffi;
+  for (int64_t i = 0; i < iterations; i++) {
+    channel.push_back(Start(
+        [](EngineRegistry&, Dispatcher&) {},
+        [](EngineRegistry& registry, Dispatcher& dispatcher,
+           TaskQueue& platform_tasks) {
+          // The pending callback was applied when the engine registered.
+          platform_tasks.Post([&registry, &dispatcher] {
+            registry.Register(kEngineId, &dispatcher);
+            registry.SetCallback(kEngineId, &RecordingCallback,
+                                 testing::FakeIsolate(1));
+          });
+        }));
+    ffi.push_back(Start(
+        [](EngineRegistry& registry, Dispatcher& dispatcher) {
+          registry.Attach(kPluginKey, &dispatcher);
+        },
+        [](EngineRegistry& registry, Dispatcher&, TaskQueue&) {
+          // Dart retries if it got there before the plugin attached.
+          while (!registry.SetCallback(kEngineId, &RecordingCallback,
+                                       testing::FakeIsolate(1))) {
+            std::this_thread::yield();
+          }
+        }));
+  }
+  Report("setEngineId method channel", channel);
+  Report("FFI binding", ffi);
+  return 0;
+}
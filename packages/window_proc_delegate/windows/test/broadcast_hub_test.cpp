@@ -0,0 +1,101 @@
+#include "../core/broadcast_hub.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "fake_dart_api.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kSettingChange = 0x001A;
+constexpr uint32_t kPowerBroadcast = 0x0218;
+constexpr Dart_Port_DL kPort = 40;
+constexpr Dart_Port_DL kOtherPort = 41;
+// Closed ports stay closed for the rest of the run.
+constexpr Dart_Port_DL kClosedPort = 49;
+
+uint64_t g_now = 0;
+uint64_t FakeClock() {
+  return g_now;
+}
+
+std::shared_ptr<const MessageFilter> Only(uint32_t message) {
+  const uint32_t range[] = {message, message};
+  return MessageFilter::FromRanges(range, 1);
+}
+
+class BroadcastHubTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testing::InstallFakeDartApi();
+    testing::TakeFakePostedMessages();
+    g_now = 1000;
+  }
+
+  BroadcastHub hub_{&FakeClock};
+};
+
+TEST_F(BroadcastHubTest, PostsToInterestedSubscribers) {
+  EXPECT_EQ(hub_.filter(), nullptr);
+  hub_.Subscribe(kPort, Only(kPowerBroadcast));
+  hub_.Subscribe(kOtherPort, Only(kSettingChange));
+  ASSERT_NE(hub_.filter(), nullptr);
+  EXPECT_TRUE(hub_.filter()->Accepts(kPowerBroadcast));
+  EXPECT_TRUE(hub_.filter()->Accepts(kSettingChange));
+  EXPECT_FALSE(hub_.filter()->Accepts(0x0200));
+
+  hub_.Publish({1, kPowerBroadcast, 0x000A, 0});
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].port, kPort);
+  EXPECT_EQ(posted[0].int64s,
+            (std::vector<int64_t>{1, kPowerBroadcast, 0x000A, 0, 1}));
+}
+
+TEST_F(BroadcastHubTest, PostsEachBroadcastOnce) {
+  hub_.Subscribe(kPort, Only(kSettingChange));
+  for (intptr_t window = 1; window <= 3; window++) {
+    hub_.Publish({window, kSettingChange, 0, 0x5000});
+  }
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+
+  // A window seeing it again means it was sent again.
+  hub_.Publish({2, kSettingChange, 0, 0x5000});
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+  hub_.Publish({1, kSettingChange, 0, 0x5000});
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+
+  // Other parameters are another broadcast.
+  hub_.Publish({3, kSettingChange, 1, 0x5000});
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+
+  g_now += BroadcastHub::kDedupWindowNs;
+  hub_.Publish({3, kSettingChange, 0, 0x5000});
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+}
+
+TEST_F(BroadcastHubTest, UnsubscribePostsNull) {
+  const int64_t id = hub_.Subscribe(kPort, Only(kPowerBroadcast));
+  EXPECT_TRUE(hub_.Unsubscribe(id));
+  EXPECT_FALSE(hub_.Unsubscribe(id));
+  EXPECT_EQ(hub_.filter(), nullptr);
+
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_TRUE(posted[0].is_null);
+}
+
+TEST_F(BroadcastHubTest, DropsSubscribersWithClosedPorts) {
+  hub_.Subscribe(kClosedPort, Only(kPowerBroadcast));
+  hub_.Subscribe(kOtherPort, Only(kSettingChange));
+  testing::CloseFakePort(kClosedPort);
+
+  hub_.Publish({1, kPowerBroadcast, 0, 0});
+  EXPECT_EQ(hub_.subscriber_count(), 1u);
+  EXPECT_FALSE(hub_.filter()->Accepts(kPowerBroadcast));
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
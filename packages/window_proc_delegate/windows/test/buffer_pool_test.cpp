@@ -0,0 +1,80 @@
+#include "../core/buffer_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+TEST(BufferPoolTest, RoundsUpToSizeClasses) {
+  BufferPool pool;
+  PooledBuffer* small = pool.Acquire(1);
+  PooledBuffer* medium = pool.Acquire(BufferPool::kMinCapacity + 1);
+  PooledBuffer* large = pool.Acquire(3 << 20);
+  EXPECT_EQ(small->capacity(), BufferPool::kMinCapacity);
+  EXPECT_EQ(medium->capacity(), 2 * BufferPool::kMinCapacity);
+  EXPECT_EQ(large->capacity(), size_t{4} << 20);
+  EXPECT_EQ(pool.outstanding(), 3u);
+  small->Release();
+  medium->Release();
+  large->Release();
+  EXPECT_EQ(pool.outstanding(), 0u);
+}
+
+TEST(BufferPoolTest, ReusesReleasedBuffersOfTheSameClass) {
+  BufferPool pool;
+  PooledBuffer* first = pool.Acquire(5000);
+  first->Release();
+  EXPECT_EQ(pool.cached_bytes(), 2 * BufferPool::kMinCapacity);
+
+  EXPECT_NE(pool.Acquire(100), first);
+  PooledBuffer* second = pool.Acquire(8000);
+  EXPECT_EQ(second, first);
+  EXPECT_EQ(pool.cached_bytes(), 0u);
+  second->Release();
+}
+
+TEST(BufferPoolTest, CachesUpToItsLimit) {
+  BufferPool pool(2 * BufferPool::kMinCapacity);
+  PooledBuffer* buffers[3] = {pool.Acquire(1), pool.Acquire(1),
+                              pool.Acquire(1)};
+  for (PooledBuffer* buffer : buffers) {
+    buffer->Release();
+  }
+  EXPECT_EQ(pool.cached_bytes(), 2 * BufferPool::kMinCapacity);
+}
+
+TEST(BufferPoolTest, NeverCachesOversizeBuffers) {
+  BufferPool pool(size_t{1} << 30);
+  PooledBuffer* buffer = pool.Acquire(BufferPool::kMaxPooledCapacity + 1);
+  EXPECT_EQ(buffer->capacity(), BufferPool::kMaxPooledCapacity + 1);
+  buffer->Release();
+  EXPECT_EQ(pool.cached_bytes(), 0u);
+  EXPECT_EQ(pool.outstanding(), 0u);
+}
+
+TEST(BufferPoolTest, ReleasesFromOtherThreads) {
+  BufferPool pool;
+  constexpr int kBuffers = 1000;
+  std::vector<PooledBuffer*> acquired;
+  for (int i = 0; i < kBuffers; i++) {
+    acquired.push_back(pool.Acquire(static_cast<size_t>(i) * 64));
+  }
+  // Finalizers run on whichever thread the Dart GC uses, while the window
+  // thread keeps acquiring.
+  std::thread releaser([&acquired] {
+    for (PooledBuffer* buffer : acquired) {
+      buffer->Release();
+    }
+  });
+  for (int i = 0; i < kBuffers; i++) {
+    pool.Acquire(4096)->Release();
+  }
+  releaser.join();
+  EXPECT_EQ(pool.outstanding(), 0u);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
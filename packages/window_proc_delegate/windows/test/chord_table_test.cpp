@@ -0,0 +1,77 @@
+#include "../core/chord_table.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kKeyS = 0x53;
+constexpr uint32_t kF5 = 0x74;
+
+TEST(ChordTableTest, MatchesExactModifiers) {
+  const uint32_t program[] = {
+      1, kKeyS, kChordControl, 0,                              //
+      2, kKeyS, kChordControl | kChordShift, kChordConsume,    //
+      3, kF5, 0, kChordSuppressRepeat,                         //
+  };
+  auto table = ChordTable::Compile(program, 12);
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table->chord_count(), 3u);
+
+  ASSERT_NE(table->Find(kKeyS, kChordControl), nullptr);
+  EXPECT_EQ(table->Find(kKeyS, kChordControl)->id, 1);
+  const ChordMatch* save_as = table->Find(kKeyS, kChordControl | kChordShift);
+  ASSERT_NE(save_as, nullptr);
+  EXPECT_EQ(save_as->id, 2);
+  EXPECT_EQ(save_as->flags, kChordConsume);
+  EXPECT_EQ(table->Find(kF5, 0)->id, 3);
+
+  EXPECT_EQ(table->Find(kKeyS, 0), nullptr);
+  EXPECT_EQ(table->Find(kKeyS, kChordControl | kChordAlt), nullptr);
+  EXPECT_EQ(table->Find(kF5, kChordShift), nullptr);
+  EXPECT_EQ(table->Find(0x1FF, 0), nullptr);
+}
+
+TEST(ChordTableTest, RanksEveryModifierCombination) {
+  std::vector<uint32_t> program;
+  int32_t id = 0;
+  for (uint32_t key = 0x41; key <= 0x5A; key += 3) {
+    for (uint32_t modifiers = 0; modifiers <= kChordModifierMask;
+         modifiers += 1 + key % 3) {
+      program.insert(program.end(),
+                     {static_cast<uint32_t>(id++), key, modifiers, 0});
+    }
+  }
+  auto table = ChordTable::Compile(program.data(), program.size());
+  ASSERT_NE(table, nullptr);
+  for (size_t i = 0; i < program.size(); i += ChordTable::kChordWords) {
+    const ChordMatch* chord = table->Find(program[i + 1], program[i + 2]);
+    ASSERT_NE(chord, nullptr);
+    EXPECT_EQ(chord->id, static_cast<int32_t>(program[i]));
+  }
+}
+
+TEST(ChordTableTest, AcceptsEmptyProgram) {
+  auto table = ChordTable::Compile(nullptr, 0);
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table->Find(kKeyS, 0), nullptr);
+}
+
+TEST(ChordTableTest, RejectsMalformedPrograms) {
+  const uint32_t truncated[] = {1, kKeyS, 0};
+  EXPECT_EQ(ChordTable::Compile(truncated, 3), nullptr);
+  const uint32_t large_key[] = {1, 0x100, 0, 0};
+  EXPECT_EQ(ChordTable::Compile(large_key, 4), nullptr);
+  const uint32_t bad_modifiers[] = {1, kKeyS, 0x10, 0};
+  EXPECT_EQ(ChordTable::Compile(bad_modifiers, 4), nullptr);
+  const uint32_t bad_flags[] = {1, kKeyS, 0, 0x4};
+  EXPECT_EQ(ChordTable::Compile(bad_flags, 4), nullptr);
+  const uint32_t duplicate[] = {1, kKeyS, kChordControl, 0,
+                                2, kKeyS, kChordControl, 0};
+  EXPECT_EQ(ChordTable::Compile(duplicate, 8), nullptr);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,124 @@
+#include "../core/copy_data.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fake_dart_api.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr Dart_Port_DL kPort = 21;
+constexpr int64_t kWindow = 0x1000;
+
+class CopyDataObserverTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testing::InstallFakeDartApi();
+    testing::TakeFakePostedMessages();
+  }
+
+  // Sends WM_COPYDATA to |window| with |payload|, which, like the sender's
+  // buffer, is only valid during the call.
+  void Send(CopyDataObserver* observer,
+            int64_t window,
+            uintptr_t tag,
+            const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> sender_buffer = payload;
+    const CopyDataStruct copy_data = {
+        tag, static_cast<uint32_t>(sender_buffer.size()),
+        sender_buffer.empty() ? nullptr : sender_buffer.data()};
+    observer->Add(ObservedMessage{
+        window, kCopyData, 0,
+        static_cast<int64_t>(reinterpret_cast<intptr_t>(&copy_data)), 1});
+    std::memset(sender_buffer.data(), 0xFF, sender_buffer.size());
+  }
+
+  BufferPool pool_;
+};
+
+TEST(CopyDataTest, DecodesOnlyCopyDataMessages) {
+  const CopyDataStruct copy_data = {7, 0, nullptr};
+  const int64_t lparam =
+      static_cast<int64_t>(reinterpret_cast<intptr_t>(&copy_data));
+  EXPECT_EQ(DecodeCopyData(kCopyData, lparam), &copy_data);
+  EXPECT_EQ(DecodeCopyData(kCopyData + 1, lparam), nullptr);
+  EXPECT_EQ(DecodeCopyData(kCopyData, 0), nullptr);
+}
+
+TEST_F(CopyDataObserverTest, PostsPooledCopyReleasedByFinalizer) {
+  {
+    CopyDataObserver observer(1, kPort, 0, &pool_);
+    EXPECT_TRUE(observer.filter().Accepts(kCopyData));
+    EXPECT_FALSE(observer.filter().Accepts(kCopyData + 1));
+    Send(&observer, kWindow, 42, {1, 2, 3});
+  }
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 2u);
+  ASSERT_EQ(posted[0].elements.size(), 3u);
+  EXPECT_EQ(posted[0].elements[0].integer, kWindow);
+  EXPECT_EQ(posted[0].elements[1].integer, 42);
+  const auto& bytes = posted[0].elements[2];
+  EXPECT_EQ(bytes.bytes, (std::vector<uint8_t>{1, 2, 3}));
+  EXPECT_TRUE(posted[1].is_null);
+
+  // Dart owns the buffer, even after the observer is gone, until its
+  // finalizer runs.
+  ASSERT_NE(bytes.finalizer, nullptr);
+  EXPECT_EQ(pool_.outstanding(), 1u);
+  bytes.finalizer(nullptr, bytes.peer);
+  EXPECT_EQ(pool_.outstanding(), 0u);
+  EXPECT_EQ(pool_.cached_bytes(), BufferPool::kMinCapacity);
+}
+
+TEST_F(CopyDataObserverTest, CopiesLargePayloadsIntoReusedBuffers) {
+  CopyDataObserver observer(1, kPort, 0, &pool_);
+  std::vector<uint8_t> payload(size_t{3} << 20);
+  for (size_t i = 0; i < payload.size(); i++) {
+    payload[i] = static_cast<uint8_t>(i * 7);
+  }
+  for (int i = 0; i < 3; i++) {
+    Send(&observer, kWindow, 1, payload);
+    auto posted = testing::TakeFakePostedMessages();
+    ASSERT_EQ(posted.size(), 1u);
+    const auto& bytes = posted[0].elements[2];
+    EXPECT_EQ(bytes.bytes, payload);
+    bytes.finalizer(nullptr, bytes.peer);
+  }
+  EXPECT_EQ(pool_.cached_bytes(), size_t{4} << 20);
+}
+
+TEST_F(CopyDataObserverTest, PostsEmptyPayloadsWithoutBuffers) {
+  CopyDataObserver observer(1, kPort, 0, &pool_);
+  Send(&observer, kWindow, 9, {});
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_TRUE(posted[0].elements[2].bytes.empty());
+  EXPECT_EQ(posted[0].elements[2].finalizer, nullptr);
+  EXPECT_EQ(pool_.outstanding(), 0u);
+}
+
+TEST_F(CopyDataObserverTest, IgnoresOtherWindows) {
+  CopyDataObserver observer(1, kPort, kWindow, &pool_);
+  Send(&observer, kWindow + 1, 1, {1});
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+  Send(&observer, kWindow, 1, {1});
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  posted[0].elements[2].finalizer(nullptr, posted[0].elements[2].peer);
+}
+
+TEST_F(CopyDataObserverTest, ReleasesBufferIfPortIsClosed) {
+  constexpr Dart_Port_DL kClosedPort = 22;
+  testing::CloseFakePort(kClosedPort);
+  CopyDataObserver observer(1, kClosedPort, 0, &pool_);
+  Send(&observer, kWindow, 1, {1, 2});
+  EXPECT_EQ(pool_.outstanding(), 0u);
+  EXPECT_FALSE(observer.Flush(nullptr));
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,83 @@
+#include "../core/delegate_routes.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kAll = DelegateRouteTable::kAllMessages;
+
+std::unique_ptr<DelegateRouteTable> Compile(
+    const std::vector<uint32_t>& program) {
+  return DelegateRouteTable::Compile(program.data(), program.size());
+}
+
+std::vector<int32_t> Find(const DelegateRouteTable& table, uint32_t message) {
+  const DelegateRouteTable::Candidates candidates = table.Find(message);
+  return std::vector<int32_t>(candidates.delegates,
+                              candidates.delegates + candidates.count);
+}
+
+TEST(DelegateRoutesTest, EmptyProgramRoutesNothing) {
+  auto table = Compile({});
+  ASSERT_NE(table, nullptr);
+  EXPECT_TRUE(table->filter()->IsEmpty());
+  EXPECT_TRUE(Find(*table, 0x0200).empty());
+  EXPECT_TRUE(Find(*table, 0x10000).empty());
+}
+
+TEST(DelegateRoutesTest, RejectsMalformedPrograms) {
+  // Truncated header.
+  EXPECT_EQ(Compile({1}), nullptr);
+  // Fewer ranges than declared.
+  EXPECT_EQ(Compile({1, 2, 0x0005, 0x0005}), nullptr);
+  // Delegate ID out of int32 range.
+  EXPECT_EQ(Compile({0x80000000u, kAll}), nullptr);
+}
+
+TEST(DelegateRoutesTest, KeepsCallOrderPerMessage) {
+  // 7 takes WM_SIZE and WM_MOUSEMOVE, 2 takes every message, 4 takes the
+  // mouse range.
+  auto table = Compile({7, 2, 0x0005, 0x0005, 0x0200, 0x0200,  //
+                        2, kAll,                                //
+                        4, 1, 0x0200, 0x020E});
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(Find(*table, 0x0005), (std::vector<int32_t>{7, 2}));
+  EXPECT_EQ(Find(*table, 0x0200), (std::vector<int32_t>{7, 2, 4}));
+  EXPECT_EQ(Find(*table, 0x0201), (std::vector<int32_t>{2, 4}));
+  EXPECT_EQ(Find(*table, 0x0006), (std::vector<int32_t>{2}));
+  EXPECT_TRUE(table->filter()->accepts_all());
+  // System messages above 0xFFFF only reach delegates without a filter.
+  EXPECT_EQ(Find(*table, 0x10000), (std::vector<int32_t>{2}));
+}
+
+TEST(DelegateRoutesTest, FilterIsUnionOfRanges) {
+  auto table = Compile({1, 1, 0x8000, 0xBFFF,  //
+                        3, 1, 0x0010, 0x0010});
+  ASSERT_NE(table, nullptr);
+  EXPECT_TRUE(table->filter()->Accepts(0x0010));
+  EXPECT_TRUE(table->filter()->Accepts(0x9000));
+  EXPECT_FALSE(table->filter()->Accepts(0x0200));
+  EXPECT_EQ(Find(*table, 0xBFFF), (std::vector<int32_t>{1}));
+  EXPECT_TRUE(Find(*table, 0xC000).empty());
+  // Ranges reaching past 0xFFFF stop there.
+  auto wide = Compile({5, 1, 0xFFF0, 0xFFFFFFFF});
+  EXPECT_EQ(Find(*wide, 0xFFFF), (std::vector<int32_t>{5}));
+  EXPECT_TRUE(Find(*wide, 0x10000).empty());
+}
+
+TEST(DelegateRoutesTest, MergesIntervalsWithSameCandidates) {
+  // Adjacent and overlapping ranges of one delegate make one interval.
+  auto table = Compile({1, 3, 0x0100, 0x01FF, 0x0200, 0x02FF, 0x0150, 0x0250});
+  ASSERT_NE(table, nullptr);
+  // [0, 0x100), [0x100, 0x300), [0x300, 0x10000) and the system range.
+  EXPECT_EQ(table->interval_count(), 4u);
+  EXPECT_EQ(Find(*table, 0x0180), (std::vector<int32_t>{1}));
+  EXPECT_EQ(Find(*table, 0x02FF), (std::vector<int32_t>{1}));
+  EXPECT_TRUE(Find(*table, 0x0300).empty());
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
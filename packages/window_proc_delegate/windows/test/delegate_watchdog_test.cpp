@@ -0,0 +1,106 @@
+#include "../core/delegate_watchdog.h"
+
+#include <gtest/gtest.h>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint64_t kBudget = 1000000;  // 1 ms
+constexpr uint32_t kPaint = 0x000F;
+constexpr uint32_t kSize = 0x0005;
+
+TEST(DelegateWatchdogTest, DisabledUntilConfigured) {
+  DelegateWatchdog watchdog;
+  EXPECT_FALSE(watchdog.enabled());
+  for (int i = 0; i < 100; i++) {
+    EXPECT_FALSE(watchdog.Record(0, kPaint, kBudget * 10, false));
+  }
+  EXPECT_EQ(watchdog.Offenses(0, nullptr, 0), 0u);
+
+  EXPECT_FALSE(watchdog.Configure(kBudget, 0, 20));
+  EXPECT_FALSE(watchdog.Configure(kBudget, 4, 3));
+  EXPECT_FALSE(watchdog.Configure(kBudget, 3, 65));
+  EXPECT_FALSE(watchdog.enabled());
+  EXPECT_TRUE(watchdog.Configure(kBudget, 3, 64));
+  EXPECT_TRUE(watchdog.enabled());
+  EXPECT_EQ(watchdog.budget_ns(), kBudget);
+}
+
+TEST(DelegateWatchdogTest, DemotesAfterStrikesWithinWindow) {
+  DelegateWatchdog watchdog;
+  ASSERT_TRUE(watchdog.Configure(kBudget, 3, 5));
+
+  EXPECT_FALSE(watchdog.Record(2, kPaint, kBudget + 1, false));
+  EXPECT_FALSE(watchdog.Record(2, kSize, kBudget, false));
+  EXPECT_FALSE(watchdog.Record(2, kSize, kBudget * 50, true));
+  EXPECT_FALSE(watchdog.Record(2, kSize, kBudget * 2, false));
+  EXPECT_FALSE(watchdog.demoted(2));
+  // Other delegates are accounted separately.
+  EXPECT_FALSE(watchdog.Record(3, kPaint, kBudget * 3, false));
+  EXPECT_TRUE(watchdog.Record(2, kPaint, kBudget * 3, false));
+  EXPECT_TRUE(watchdog.demoted(2));
+  EXPECT_FALSE(watchdog.demoted(3));
+
+  // Demotion is reported once.
+  EXPECT_FALSE(watchdog.Record(2, kPaint, kBudget * 3, false));
+
+  DelegateOffense offenses[DelegateWatchdog::kMaxOffenses];
+  ASSERT_EQ(watchdog.Offenses(2, offenses, 8), 3u);
+  EXPECT_EQ(offenses[0].message, kPaint);
+  EXPECT_EQ(offenses[0].nanoseconds, static_cast<int64_t>(kBudget + 1));
+  EXPECT_EQ(offenses[1].message, kSize);
+  EXPECT_EQ(offenses[2].message, kPaint);
+  EXPECT_EQ(offenses[2].nanoseconds, static_cast<int64_t>(kBudget * 3));
+}
+
+TEST(DelegateWatchdogTest, StrikesAgeOutOfWindow) {
+  DelegateWatchdog watchdog;
+  ASSERT_TRUE(watchdog.Configure(kBudget, 2, 4));
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_FALSE(watchdog.Record(0, kPaint, kBudget * 2, false));
+    for (int j = 0; j < 3; j++) {
+      EXPECT_FALSE(watchdog.Record(0, kPaint, kBudget / 2, false));
+    }
+  }
+  EXPECT_FALSE(watchdog.demoted(0));
+
+  // The latest strikes are kept, oldest first.
+  DelegateOffense offenses[2];
+  EXPECT_EQ(watchdog.Offenses(0, offenses, 2), DelegateWatchdog::kMaxOffenses);
+
+  // Reconfiguring starts the accounting over.
+  EXPECT_FALSE(watchdog.Record(0, kPaint, kBudget * 2, false));
+  ASSERT_TRUE(watchdog.Configure(kBudget, 2, 4));
+  EXPECT_EQ(watchdog.Offenses(0, offenses, 2), 0u);
+  EXPECT_FALSE(watchdog.Record(0, kPaint, kBudget * 2, false));
+  EXPECT_TRUE(watchdog.Record(0, kPaint, kBudget * 2, false));
+}
+
+TEST(DelegateWatchdogTest, ExemptDelegatesAreNeverDemoted) {
+  DelegateWatchdog watchdog;
+  ASSERT_TRUE(watchdog.Configure(kBudget, 1, 1));
+  watchdog.ResetDelegate(7, true);
+
+  for (int i = 0; i < 10; i++) {
+    EXPECT_FALSE(watchdog.Record(7, kPaint, kBudget * 2, false));
+  }
+  EXPECT_FALSE(watchdog.demoted(7));
+  EXPECT_EQ(watchdog.Offenses(7, nullptr, 0), DelegateWatchdog::kMaxOffenses);
+
+  // A reused ID starts out clean and demotable.
+  EXPECT_TRUE(watchdog.Record(1, kPaint, kBudget * 2, false));
+  watchdog.ResetDelegate(1, false);
+  EXPECT_FALSE(watchdog.demoted(1));
+  EXPECT_EQ(watchdog.Offenses(1, nullptr, 0), 0u);
+  watchdog.ResetDelegate(7, false);
+  EXPECT_TRUE(watchdog.Record(7, kPaint, kBudget * 2, false));
+
+  // Out of range IDs are ignored.
+  EXPECT_FALSE(watchdog.Record(-1, kPaint, kBudget * 2, false));
+  EXPECT_FALSE(watchdog.Record(DelegateWatchdog::kMaxDelegates, kPaint,
+                               kBudget * 2, false));
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
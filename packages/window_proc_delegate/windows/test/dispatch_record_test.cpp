@@ -0,0 +1,69 @@
+#include "../core/dispatch_record.h"
+
+#include <gtest/gtest.h>
+
+#include "fake_dart_api.h"
+
+namespace window_proc_delegate {
+namespace {
+
+Dart_Isolate g_isolate_in_callback = nullptr;
+
+void RecordIsolateCallback(WindowsMessage* message) {
+  g_isolate_in_callback = Dart_CurrentIsolate_DL();
+  message->handled = true;
+}
+
+class DispatchRecordTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testing::InstallFakeDartApi();
+    Dart_ExitIsolate_DL();
+    testing::ResetFakeIsolateEnterCount();
+    g_isolate_in_callback = nullptr;
+  }
+
+  DispatchRecord MakeRecord(Dart_Isolate isolate) {
+    return DispatchRecord{&RecordIsolateCallback, isolate,
+                          MessageFilter::AcceptAll()};
+  }
+};
+
+TEST_F(DispatchRecordTest, SkipsIsolateSwitchWhenAlreadyCurrent) {
+  const Dart_Isolate isolate = testing::FakeIsolate(1);
+  Dart_EnterIsolate_DL(isolate);
+  testing::ResetFakeIsolateEnterCount();
+
+  WindowsMessage msg = {};
+  DispatchToDart(MakeRecord(isolate), &msg);
+
+  EXPECT_TRUE(msg.handled);
+  EXPECT_EQ(g_isolate_in_callback, isolate);
+  EXPECT_EQ(testing::FakeIsolateEnterCount(), 0);
+  EXPECT_EQ(Dart_CurrentIsolate_DL(), isolate);
+}
+
+TEST_F(DispatchRecordTest, EntersAndExitsWhenNoIsolateIsCurrent) {
+  const Dart_Isolate isolate = testing::FakeIsolate(1);
+
+  WindowsMessage msg = {};
+  DispatchToDart(MakeRecord(isolate), &msg);
+
+  EXPECT_EQ(g_isolate_in_callback, isolate);
+  EXPECT_EQ(Dart_CurrentIsolate_DL(), nullptr);
+}
+
+TEST_F(DispatchRecordTest, RestoresPreviousIsolate) {
+  const Dart_Isolate previous = testing::FakeIsolate(1);
+  const Dart_Isolate target = testing::FakeIsolate(2);
+  Dart_EnterIsolate_DL(previous);
+
+  WindowsMessage msg = {};
+  DispatchToDart(MakeRecord(target), &msg);
+
+  EXPECT_EQ(g_isolate_in_callback, target);
+  EXPECT_EQ(Dart_CurrentIsolate_DL(), previous);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
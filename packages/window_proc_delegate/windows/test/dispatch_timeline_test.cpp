@@ -0,0 +1,165 @@
+#include "../core/dispatch_timeline.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../core/dispatcher.h"
+#include "fake_dart_api.h"
+#include "fake_window_proc_registrar.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kPaint = 0x000F;
+constexpr uint32_t kMouseMove = 0x0200;
+constexpr Dart_Port_DL kPort = 31;
+
+struct RecordedEvent {
+  std::string label;
+  int64_t timestamp;
+  int64_t id;
+  std::vector<int64_t> flow_ids;
+  Dart_Timeline_Event_Type type;
+  std::map<std::string, std::string> arguments;
+};
+
+std::vector<RecordedEvent> g_events;
+int64_t g_now = 0;
+
+void RecordEvent(const char* label,
+                 int64_t timestamp0,
+                 int64_t timestamp1_or_id,
+                 intptr_t flow_id_count,
+                 const int64_t* flow_ids,
+                 Dart_Timeline_Event_Type type,
+                 intptr_t argument_count,
+                 const char** argument_names,
+                 const char** argument_values) {
+  RecordedEvent event;
+  event.label = label;
+  event.timestamp = timestamp0;
+  event.id = timestamp1_or_id;
+  event.flow_ids.assign(flow_ids, flow_ids + flow_id_count);
+  event.type = type;
+  for (intptr_t i = 0; i < argument_count; i++) {
+    event.arguments[argument_names[i]] = argument_values[i];
+  }
+  g_events.push_back(std::move(event));
+}
+
+int64_t NowMicros() {
+  return g_now++;
+}
+
+const TimelineApi kFakeApi = {&RecordEvent, &NowMicros};
+
+// Handles WM_PAINT with 7, leaving every other message unhandled.
+void PaintingCallback(WindowsMessage* message) {
+  if (message->message == static_cast<int32_t>(kPaint)) {
+    message->lResult = 7;
+    message->handled = true;
+  }
+}
+
+class DispatchTimelineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testing::InstallFakeDartApi();
+    testing::TakeFakePostedMessages();
+    g_events.clear();
+    g_now = 0;
+  }
+
+  testing::FakeWindowProcRegistrar registrar_;
+  Dispatcher dispatcher_{&registrar_};
+};
+
+TEST_F(DispatchTimelineTest, NamesMessages) {
+  EXPECT_STREQ(DispatchTimeline::MessageName(0x0001), "WM_CREATE");
+  EXPECT_STREQ(DispatchTimeline::MessageName(kPaint), "WM_PAINT");
+  EXPECT_STREQ(DispatchTimeline::MessageName(0x02E0), "WM_DPICHANGED");
+  EXPECT_STREQ(DispatchTimeline::MessageName(0x0320),
+               "WM_DWMCOLORIZATIONCOLORCHANGED");
+  EXPECT_STREQ(DispatchTimeline::MessageName(0x0000), "Window message");
+  EXPECT_STREQ(DispatchTimeline::MessageName(0x0401), "WM_USER message");
+  EXPECT_STREQ(DispatchTimeline::MessageName(0x8001), "WM_APP message");
+  EXPECT_STREQ(DispatchTimeline::MessageName(0xC123), "Registered message");
+}
+
+TEST_F(DispatchTimelineTest, RecordsCallsIntoDartWhileEnabled) {
+  dispatcher_.SetCallback(&PaintingCallback, testing::FakeIsolate(1));
+  registrar_.Send({0x1F0, kPaint, 0, 0});
+  EXPECT_TRUE(g_events.empty());
+
+  dispatcher_.timeline().set_api(&kFakeApi);
+  EXPECT_EQ(registrar_.Send({0x1F0, kPaint, 0, 0}), 7);
+  EXPECT_EQ(registrar_.Send({0x1F0, kMouseMove, 0, 0}), std::nullopt);
+  ASSERT_EQ(g_events.size(), 4u);
+
+  EXPECT_EQ(g_events[0].label, "WM_PAINT");
+  EXPECT_EQ(g_events[0].type, Dart_Timeline_Event_Begin);
+  EXPECT_EQ(g_events[0].arguments["hwnd"], "0x1f0");
+  EXPECT_EQ(g_events[0].arguments["message"], "0x000F");
+  EXPECT_EQ(g_events[1].label, "WM_PAINT");
+  EXPECT_EQ(g_events[1].type, Dart_Timeline_Event_End);
+  EXPECT_GT(g_events[1].timestamp, g_events[0].timestamp);
+  EXPECT_EQ(g_events[1].arguments["handled"], "true");
+  EXPECT_EQ(g_events[1].arguments["lResult"], "7");
+
+  EXPECT_EQ(g_events[2].label, "WM_MOUSEMOVE");
+  EXPECT_EQ(g_events[3].arguments["handled"], "false");
+  EXPECT_EQ(g_events[3].arguments.count("lResult"), 0u);
+
+  dispatcher_.timeline().set_api(nullptr);
+  registrar_.Send({0x1F0, kPaint, 0, 0});
+  EXPECT_EQ(g_events.size(), 4u);
+}
+
+TEST_F(DispatchTimelineTest, LinksObserverFlushToScheduler) {
+  const uint32_t range[] = {kMouseMove, kMouseMove};
+  dispatcher_.AddObserver(std::make_shared<BatchObserver>(
+      1, kPort, MessageFilter::FromRanges(range, 1)));
+  dispatcher_.timeline().set_api(&kFakeApi);
+
+  registrar_.Send({1, kMouseMove, 0, 0});
+  registrar_.Send({1, kMouseMove, 0, 1});
+  ASSERT_EQ(g_events.size(), 2u);
+  EXPECT_EQ(g_events[0].type, Dart_Timeline_Event_Instant);
+  EXPECT_EQ(g_events[0].arguments["message"], "WM_MOUSEMOVE");
+  ASSERT_EQ(g_events[0].flow_ids.size(), 1u);
+  const int64_t flow_id = g_events[0].flow_ids[0];
+  EXPECT_NE(flow_id, 0);
+  EXPECT_EQ(g_events[1].type, Dart_Timeline_Event_Flow_Begin);
+  EXPECT_EQ(g_events[1].id, flow_id);
+
+  ASSERT_TRUE(registrar_.PumpFlushes());
+  ASSERT_EQ(g_events.size(), 5u);
+  EXPECT_EQ(g_events[2].type, Dart_Timeline_Event_Begin);
+  EXPECT_EQ(g_events[2].flow_ids, std::vector<int64_t>{flow_id});
+  EXPECT_EQ(g_events[3].type, Dart_Timeline_Event_Flow_End);
+  EXPECT_EQ(g_events[3].id, flow_id);
+  EXPECT_EQ(g_events[4].type, Dart_Timeline_Event_End);
+  EXPECT_EQ(g_events[4].arguments["observers"], "1");
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+
+  // Each flush gets its own flow; a flush scheduled before recording
+  // started has none.
+  registrar_.Send({1, kMouseMove, 0, 0});
+  ASSERT_EQ(g_events.size(), 7u);
+  EXPECT_NE(g_events[5].flow_ids[0], flow_id);
+  dispatcher_.timeline().set_api(nullptr);
+  ASSERT_TRUE(registrar_.PumpFlushes());
+  registrar_.Send({1, kMouseMove, 0, 0});
+  dispatcher_.timeline().set_api(&kFakeApi);
+  g_events.clear();
+  ASSERT_TRUE(registrar_.PumpFlushes());
+  ASSERT_EQ(g_events.size(), 2u);
+  EXPECT_TRUE(g_events[0].flow_ids.empty());
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
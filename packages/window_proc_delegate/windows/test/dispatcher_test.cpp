@@ -0,0 +1,536 @@
+#include "../core/dispatcher.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../core/copy_data.h"
+#include "fake_dart_api.h"
+#include "fake_window_proc_registrar.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kNcHitTest = 0x0084;
+constexpr uint32_t kEraseBackground = 0x0014;
+constexpr uint32_t kMouseMove = 0x0200;
+constexpr uint32_t kInput = 0x00FF;
+constexpr Dart_Port_DL kPort = 11;
+
+int g_callback_calls = 0;
+std::vector<int32_t> g_candidates;
+
+// Handles every message, replying with twice its identifier.
+void HandlingCallback(WindowsMessage* message) {
+  g_callback_calls++;
+  message->lResult = message->message * 2;
+  message->handled = true;
+}
+
+// Leaves every message unhandled, remembering its candidate delegates.
+void CandidateCallback(WindowsMessage* message) {
+  g_callback_calls++;
+  g_candidates.assign(message->candidates,
+                      message->candidates +
+                          std::max<int32_t>(message->candidateCount, 0));
+}
+
+// Leaves every message unhandled, remembering the WM_COPYDATA view.
+uint64_t g_copy_data_tag = 0;
+const uint8_t* g_copy_data = nullptr;
+int64_t g_copy_data_length = 0;
+
+void CopyDataCallback(WindowsMessage* message) {
+  g_callback_calls++;
+  g_copy_data_tag = message->copyDataTag;
+  g_copy_data = message->copyData;
+  g_copy_data_length = message->copyDataLength;
+}
+
+// Grows the minimum track size of WM_GETMINMAXINFO in place.
+void MinMaxInfoCallback(WindowsMessage* message) {
+  g_callback_calls++;
+  if (message->payload.kind == PayloadKind::kGetMinMaxInfo) {
+    message->payload.minMaxInfo.minTrackSize = {640, 480};
+  }
+}
+
+// Used by NestingCallback, which removes an observer and sends a nested
+// message while the observer list it was notified from may still be in use.
+Dispatcher* g_nesting_dispatcher = nullptr;
+testing::FakeWindowProcRegistrar* g_nesting_registrar = nullptr;
+std::weak_ptr<BatchObserver> g_removed_observer;
+bool g_alive_after_nested_message = false;
+
+void NestingCallback(WindowsMessage* message) {
+  g_nesting_dispatcher->RemoveObserver(5);
+  g_nesting_registrar->Send({1, kEraseBackground, 0, 0});
+  g_alive_after_nested_message = !g_removed_observer.expired();
+}
+
+// Replies to WM_ERASEBKGND with its wParam and passes everything else on.
+int g_native_calls = 0;
+
+bool ErasingHandler(void* user_data,
+                    const WindowProcDelegateNativeMessage* message,
+                    int64_t* result) {
+  g_native_calls++;
+  if (message->message != kEraseBackground) {
+    return false;
+  }
+  *result = static_cast<int64_t>(message->wparam);
+  return true;
+}
+
+std::unique_ptr<MessageFilter> Only(uint32_t message) {
+  const uint32_t range[] = {message, message};
+  return MessageFilter::FromRanges(range, 1);
+}
+
+class DispatcherTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testing::InstallFakeDartApi();
+    testing::TakeFakePostedMessages();
+    g_callback_calls = 0;
+    g_candidates.clear();
+  }
+
+  std::optional<int64_t> Send(uint32_t message, int64_t lparam = 0) {
+    return registrar_.Send({1, message, 0, lparam});
+  }
+
+  testing::FakeWindowProcRegistrar registrar_;
+  Dispatcher dispatcher_{&registrar_};
+};
+
+TEST_F(DispatcherTest, AttachesToRegistrarForItsLifetime) {
+  testing::FakeWindowProcRegistrar registrar;
+  {
+    Dispatcher dispatcher(&registrar);
+    EXPECT_EQ(registrar.handler(), &dispatcher);
+  }
+  EXPECT_EQ(registrar.handler(), nullptr);
+}
+
+TEST_F(DispatcherTest, LeavesMessagesUnhandledWithoutCallback) {
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+}
+
+TEST_F(DispatcherTest, DispatchesFilteredMessagesToDart) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  EXPECT_EQ(Send(kMouseMove), kMouseMove * 2);
+
+  dispatcher_.SetMessageFilter(Only(kEraseBackground));
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+  EXPECT_EQ(Send(kEraseBackground), kEraseBackground * 2);
+  EXPECT_EQ(g_callback_calls, 2);
+
+  dispatcher_.SetCallback(nullptr, nullptr);
+  EXPECT_EQ(Send(kEraseBackground), std::nullopt);
+}
+
+TEST_F(DispatcherTest, EmptyFilterUnsubscribesFromDart) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  const uint32_t none[] = {0, 0};
+  dispatcher_.SetMessageFilter(MessageFilter::FromRanges(none, 0));
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+  EXPECT_EQ(g_callback_calls, 0);
+
+  // Re-armed by the next subscription.
+  dispatcher_.SetMessageFilter(Only(kMouseMove));
+  EXPECT_EQ(Send(kMouseMove), kMouseMove * 2);
+}
+
+TEST_F(DispatcherTest, IdleDispatcherSkipsEveryRoute) {
+  auto observer = std::make_shared<BatchObserver>(5, kPort, Only(kMouseMove));
+  std::weak_ptr<BatchObserver> weak = observer;
+  dispatcher_.AddObserver(std::move(observer));
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  dispatcher_.RemoveObserver(5);
+  dispatcher_.SetCallback(nullptr, nullptr);
+
+  // The first message after going idle still frees the replaced snapshots.
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+  EXPECT_TRUE(weak.expired());
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+  EXPECT_FALSE(registrar_.PumpFlushes());
+  EXPECT_EQ(g_callback_calls, 0);
+
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  EXPECT_EQ(Send(kMouseMove), kMouseMove * 2);
+}
+
+TEST_F(DispatcherTest, PassesDelegateRoutesToDart) {
+  dispatcher_.SetCallback(&CandidateCallback, testing::FakeIsolate(1));
+  const uint32_t program[] = {4, 1, kMouseMove, kMouseMove,  //
+                              1, 1, kMouseMove, kNcHitTest + 0x200};
+  dispatcher_.SetDelegateRoutes(DelegateRouteTable::Compile(program, 8));
+
+  Send(kMouseMove);
+  EXPECT_EQ(g_candidates, (std::vector<int32_t>{4, 1}));
+  Send(kEraseBackground);
+  EXPECT_EQ(g_callback_calls, 1);
+
+  // A plain filter drops the routes.
+  dispatcher_.SetMessageFilter(MessageFilter::AcceptAll());
+  Send(kEraseBackground);
+  EXPECT_EQ(g_callback_calls, 2);
+  EXPECT_TRUE(g_candidates.empty());
+}
+
+TEST_F(DispatcherTest, ViewsCopyDataInPlace) {
+  dispatcher_.SetCallback(&CopyDataCallback, testing::FakeIsolate(1));
+  const uint8_t payload[] = {1, 2, 3, 4};
+  const CopyDataStruct copy_data = {99, sizeof(payload), payload};
+
+  Send(kCopyData, reinterpret_cast<intptr_t>(&copy_data));
+  EXPECT_EQ(g_copy_data_tag, 99u);
+  EXPECT_EQ(g_copy_data, payload);
+  EXPECT_EQ(g_copy_data_length, 4);
+
+  Send(kMouseMove, reinterpret_cast<intptr_t>(&copy_data));
+  EXPECT_EQ(g_copy_data, nullptr);
+  EXPECT_EQ(g_copy_data_length, -1);
+}
+
+TEST_F(DispatcherTest, WritesBackDecodedPayloads) {
+  constexpr uint32_t kGetMinMaxInfo = 0x0024;
+  dispatcher_.SetCallback(&MinMaxInfoCallback, testing::FakeIsolate(1));
+  win32::MinMaxInfo info = {};
+  Send(kGetMinMaxInfo, reinterpret_cast<intptr_t>(&info));
+  EXPECT_EQ(g_callback_calls, 1);
+  EXPECT_EQ(info.ptMinTrackSize.x, 640);
+  EXPECT_EQ(info.ptMinTrackSize.y, 480);
+}
+
+TEST_F(DispatcherTest, CachesWatchedWindowState) {
+  constexpr uint32_t kSize = 0x0005;
+  WindowState seed = {};
+  seed.x = 10;
+  seed.width = 640;
+  seed.dpi = 96;
+  registrar_.set_window_state(seed);
+  registrar_.set_monitor(77);
+
+  const WindowStateBlock* block = dispatcher_.WatchWindowState(1);
+  ASSERT_NE(block, nullptr);
+  EXPECT_EQ(dispatcher_.WatchWindowState(1), block);
+  EXPECT_EQ(block->sequence(), 2u);
+  EXPECT_EQ(block->Read().window, 1);
+  EXPECT_EQ(block->Read().width, 640);
+
+  // SIZE_MAXIMIZED, 1920x1040.
+  const int64_t maximized = int64_t{1040} << 16 | 1920;
+  EXPECT_EQ(registrar_.Send({1, kSize, 2, maximized}), std::nullopt);
+  WindowState state = block->Read();
+  EXPECT_EQ(state.width, 1920);
+  EXPECT_EQ(state.height, 1040);
+  EXPECT_EQ(state.flags, kWindowMaximized);
+  EXPECT_EQ(state.monitor, 77);
+  EXPECT_EQ(state.dpi, 96);
+  EXPECT_EQ(block->sequence(), 4u);
+
+  // Repeats and other windows leave the generation alone.
+  registrar_.Send({1, kSize, 2, maximized});
+  registrar_.Send({2, kSize, 0, 0});
+  EXPECT_EQ(block->sequence(), 4u);
+}
+
+TEST_F(DispatcherTest, PostsMatchingChords) {
+  constexpr uint32_t kKeyDown = 0x0100;
+  constexpr uint64_t kKeyS = 0x53;
+  constexpr uint64_t kF5 = 0x74;
+  constexpr int64_t kRepeat = int64_t{1} << 30;
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  dispatcher_.SetMessageFilter(Only(kMouseMove));
+  const uint32_t program[] = {7, kKeyS, kChordControl, kChordConsume,  //
+                              8, kF5, 0, kChordSuppressRepeat};
+  dispatcher_.SetChords(ChordTable::Compile(program, 8), kPort);
+
+  registrar_.set_modifier_state(kChordControl);
+  EXPECT_EQ(registrar_.Send({1, kKeyDown, kKeyS, 0}), 0);
+  registrar_.set_modifier_state(0);
+  EXPECT_EQ(registrar_.Send({1, kKeyDown, kKeyS, 0}), std::nullopt);
+  EXPECT_EQ(registrar_.Send({1, kKeyDown, kF5, 0}), std::nullopt);
+  EXPECT_EQ(registrar_.Send({1, kKeyDown, kF5, kRepeat}), std::nullopt);
+  EXPECT_EQ(g_callback_calls, 0);
+
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 2u);
+  EXPECT_EQ(posted[0].port, kPort);
+  EXPECT_EQ(posted[0].int64s, (std::vector<int64_t>{7, 1, 0}));
+  EXPECT_EQ(posted[1].int64s, (std::vector<int64_t>{8, 1, 0}));
+
+  dispatcher_.SetChords(nullptr, kPort);
+  registrar_.set_modifier_state(kChordControl);
+  EXPECT_EQ(registrar_.Send({1, kKeyDown, kKeyS, 0}), std::nullopt);
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+}
+
+TEST_F(DispatcherTest, FlushesObserverBatchOnNextPump) {
+  dispatcher_.AddObserver(
+      std::make_shared<BatchObserver>(5, kPort, Only(kMouseMove)));
+  Send(kMouseMove, 10);
+  Send(kEraseBackground);
+  Send(kMouseMove, 20);
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+
+  ASSERT_TRUE(registrar_.PumpFlushes());
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].port, kPort);
+  EXPECT_EQ(posted[0].int64s.size(), 2 * kObservedMessageFields);
+  EXPECT_FALSE(registrar_.PumpFlushes());
+
+  dispatcher_.RemoveObserver(5);
+  Send(kMouseMove);
+  EXPECT_FALSE(registrar_.PumpFlushes());
+}
+
+TEST_F(DispatcherTest, RemovesObserversWithClosedPorts) {
+  constexpr Dart_Port_DL kClosedPort = 12;
+  auto observer =
+      std::make_shared<BatchObserver>(6, kClosedPort, Only(kMouseMove));
+  std::weak_ptr<BatchObserver> weak = observer;
+  dispatcher_.AddObserver(std::move(observer));
+  testing::CloseFakePort(kClosedPort);
+
+  Send(kMouseMove);
+  ASSERT_TRUE(registrar_.PumpFlushes());
+  Send(kMouseMove);
+  EXPECT_TRUE(weak.expired());
+  EXPECT_FALSE(registrar_.PumpFlushes());
+}
+
+TEST_F(DispatcherTest, ObserversPostNullWhenDestroyed) {
+  constexpr Dart_Port_DL kRemovedPort = 13;
+  constexpr Dart_Port_DL kShutdownPort = 14;
+  testing::FakeWindowProcRegistrar registrar;
+  {
+    Dispatcher dispatcher(&registrar);
+    dispatcher.AddObserver(
+        std::make_shared<BatchObserver>(1, kRemovedPort, Only(kMouseMove)));
+    dispatcher.AddObserver(
+        std::make_shared<BatchObserver>(2, kShutdownPort, Only(kMouseMove)));
+    dispatcher.RemoveObserver(1);
+    registrar.Send({1, kEraseBackground, 0, 0});
+    auto posted = testing::TakeFakePostedMessages();
+    ASSERT_EQ(posted.size(), 1u);
+    EXPECT_EQ(posted[0].port, kRemovedPort);
+    EXPECT_TRUE(posted[0].is_null);
+  }
+  // The engine went away with the observer still subscribed.
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].port, kShutdownPort);
+  EXPECT_TRUE(posted[0].is_null);
+}
+
+TEST_F(DispatcherTest, FreesReplacedSnapshotsBetweenMessages) {
+  auto observer = std::make_shared<BatchObserver>(5, kPort, Only(kMouseMove));
+  std::weak_ptr<BatchObserver> weak = observer;
+  dispatcher_.AddObserver(std::move(observer));
+  dispatcher_.RemoveObserver(5);
+  // The replaced observer list still references it.
+  EXPECT_FALSE(weak.expired());
+  Send(kEraseBackground);
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST_F(DispatcherTest, KeepsReplacedSnapshotsDuringNestedMessages) {
+  auto observer = std::make_shared<BatchObserver>(5, kPort, Only(kMouseMove));
+  g_removed_observer = observer;
+  g_nesting_dispatcher = &dispatcher_;
+  g_nesting_registrar = &registrar_;
+  dispatcher_.AddObserver(std::move(observer));
+  dispatcher_.SetCallback(&NestingCallback, testing::FakeIsolate(1));
+  dispatcher_.SetMessageFilter(Only(kMouseMove));
+
+  Send(kMouseMove);
+  EXPECT_TRUE(g_alive_after_nested_message);
+  Send(kEraseBackground);
+  EXPECT_TRUE(g_removed_observer.expired());
+}
+
+TEST_F(DispatcherTest, AnswersHitTestsInClientCoordinates) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  dispatcher_.SetHitTestIndex(
+      1, std::make_shared<const HitTestIndex>(
+             std::vector<HitTestRegion>{{0, 0, 100, 30, 2}}));
+  registrar_.set_client_origin(500, 400);
+
+  // Screen point (550, 410) is client point (50, 10).
+  EXPECT_EQ(Send(kNcHitTest, (410 << 16) | 550), 2);
+  EXPECT_EQ(g_callback_calls, 0);
+
+  // Outside every region: falls through to Dart.
+  EXPECT_EQ(Send(kNcHitTest, (500 << 16) | 550), kNcHitTest * 2);
+
+  dispatcher_.SetHitTestIndex(1, nullptr);
+  EXPECT_EQ(Send(kNcHitTest, (410 << 16) | 550), kNcHitTest * 2);
+}
+
+TEST_F(DispatcherTest, ReplyRulesPreemptDart) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  const int64_t program[] = {kEraseBackground, 0, 0, 0, 0, 0,
+                             static_cast<int64_t>(ReplyAction::kReply), 1, 0};
+  dispatcher_.SetReplyRules(ReplyRuleTable::Compile(program, 9));
+
+  EXPECT_EQ(Send(kEraseBackground), 1);
+  EXPECT_EQ(g_callback_calls, 0);
+  EXPECT_EQ(Send(kMouseMove), kMouseMove * 2);
+}
+
+TEST_F(DispatcherTest, NativeHandlersPreemptDart) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  g_native_calls = 0;
+  dispatcher_.SetNativeHandlers(NativeHandlerTable::Build(
+      {{1, 0, &ErasingHandler, nullptr, {kEraseBackground, kMouseMove}}}));
+
+  EXPECT_EQ(registrar_.Send({1, kEraseBackground, 9, 0}), 9);
+  EXPECT_EQ(g_callback_calls, 0);
+  // Passed on to Dart; other messages never reach the handler.
+  EXPECT_EQ(Send(kMouseMove), kMouseMove * 2);
+  EXPECT_EQ(Send(kNcHitTest), kNcHitTest * 2);
+  EXPECT_EQ(g_native_calls, 2);
+  EXPECT_EQ(g_callback_calls, 2);
+
+  dispatcher_.SetNativeHandlers(nullptr);
+  EXPECT_EQ(Send(kEraseBackground), kEraseBackground * 2);
+  EXPECT_EQ(g_native_calls, 2);
+}
+
+TEST_F(DispatcherTest, BatchesRawMouseInputWithoutDart) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  registrar_.set_clock(5000, 125000);
+  const int64_t report = registrar_.AddRawMouseReport({7, 0, 3, -1, 0, 0, 0});
+
+  // Passed to Dart until raw input is started.
+  EXPECT_EQ(Send(kInput, report), kInput * 2);
+  RawInputAccumulator* accumulator = dispatcher_.StartRawInput(kPort, 8);
+  ASSERT_NE(accumulator, nullptr);
+  EXPECT_TRUE(registrar_.raw_mouse_input());
+  for (int i = 0; i < 64; i++) {
+    EXPECT_EQ(Send(kInput, report), std::nullopt);
+  }
+  EXPECT_EQ(g_callback_calls, 1);
+  // Raw input that is not from a mouse still reaches Dart.
+  EXPECT_EQ(Send(kInput, 0), kInput * 2);
+
+  RawMouseRecord records[8];
+  ASSERT_EQ(accumulator->Take(records), 1u);
+  EXPECT_EQ(records[0].device, 7);
+  EXPECT_EQ(records[0].reports, 64);
+  EXPECT_EQ(records[0].x, 192);
+  EXPECT_EQ(records[0].first_timestamp_ns, 5000);
+  EXPECT_EQ(records[0].last_timestamp_ns, 5000 + 63 * 125000);
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+
+  EXPECT_TRUE(dispatcher_.StopRawInput(accumulator));
+  EXPECT_FALSE(registrar_.raw_mouse_input());
+  EXPECT_EQ(Send(kInput, report), kInput * 2);
+
+  registrar_.set_raw_mouse_input_fails(true);
+  EXPECT_EQ(dispatcher_.StartRawInput(kPort, 8), nullptr);
+}
+
+TEST_F(DispatcherTest, RefusesASecondRawInputConsumer) {
+  const int64_t report = registrar_.AddRawMouseReport({7, 0, 1, 0, 0, 0, 0});
+  RawInputAccumulator* accumulator = dispatcher_.StartRawInput(kPort, 8);
+  ASSERT_NE(accumulator, nullptr);
+  // The first consumer's accumulator stays in place.
+  EXPECT_EQ(dispatcher_.StartRawInput(kPort + 1, 8), nullptr);
+  EXPECT_EQ(Send(kInput, report), std::nullopt);
+  RawMouseRecord records[8];
+  EXPECT_EQ(accumulator->Take(records), 1u);
+
+  // Only the owner of the accumulator can stop it.
+  RawInputAccumulator other(kPort + 1, 8);
+  EXPECT_FALSE(dispatcher_.StopRawInput(&other));
+  EXPECT_TRUE(registrar_.raw_mouse_input());
+  EXPECT_TRUE(dispatcher_.StopRawInput(accumulator));
+  EXPECT_FALSE(registrar_.raw_mouse_input());
+  EXPECT_FALSE(dispatcher_.StopRawInput(accumulator));
+  EXPECT_NE(dispatcher_.StartRawInput(kPort, 8), nullptr);
+  testing::TakeFakePostedMessages();
+}
+
+TEST_F(DispatcherTest, RecordsDispatchLatencyWhenEnabled) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  registrar_.set_clock(1000, 250);
+
+  Send(kMouseMove);
+  LatencySummary summary = {};
+  EXPECT_EQ(dispatcher_.latency().dispatch().Snapshot(&summary, 1), 0u);
+
+  dispatcher_.latency().set_enabled(true);
+  Send(kMouseMove);
+  ASSERT_EQ(dispatcher_.latency().dispatch().Snapshot(&summary, 1), 1u);
+  EXPECT_EQ(summary.message, kMouseMove);
+  EXPECT_EQ(summary.max, 250);
+}
+
+TEST_F(DispatcherTest, RecordsQueueingStagesWhenEnabled) {
+  dispatcher_.SetCallback(&HandlingCallback, testing::FakeIsolate(1));
+  dispatcher_.AddObserver(
+      std::make_shared<BatchObserver>(5, kPort, Only(kEraseBackground)));
+  dispatcher_.latency().set_enabled(true);
+  registrar_.set_clock(10000, 100);
+  registrar_.set_posted(4000);
+
+  // Posted input waits from its posting; other messages from their entry.
+  Send(kMouseMove);
+  ASSERT_TRUE(testing::TakeFakePostedMessages().empty());
+  LatencySummary summaries[2] = {};
+  const LatencyTable& queued =
+      dispatcher_.latency().stage(LatencyStage::kQueued);
+  ASSERT_EQ(queued.Snapshot(summaries, 2), 1u);
+  EXPECT_EQ(summaries[0].message, kMouseMove);
+  EXPECT_EQ(summaries[0].max, 6000);
+
+  Send(kEraseBackground);
+  EXPECT_EQ(queued.Snapshot(summaries, 2), 1u);
+  ASSERT_EQ(dispatcher_.latency()
+                .stage(LatencyStage::kHandled)
+                .Snapshot(summaries, 2),
+            2u);
+  EXPECT_EQ(summaries[0].message, kEraseBackground);
+  EXPECT_EQ(summaries[0].max, 100);
+  EXPECT_EQ(summaries[1].message, kMouseMove);
+  EXPECT_EQ(summaries[1].max, 6200);
+
+  // The batch is stamped with when its first message was queued.
+  ASSERT_TRUE(registrar_.PumpFlushes());
+  ASSERT_EQ(dispatcher_.latency()
+                .stage(LatencyStage::kPending)
+                .Snapshot(summaries, 2),
+            1u);
+  EXPECT_EQ(summaries[0].message, kEraseBackground);
+  EXPECT_EQ(summaries[0].max, 300);
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  ASSERT_EQ(posted[0].int64s.size(),
+            kObservedMessageFields + kQueueStampFields);
+  EXPECT_EQ(posted[0].int64s[kObservedMessageFields], 10300);
+  EXPECT_EQ(posted[0].int64s[kObservedMessageFields + 1], kEraseBackground);
+
+  dispatcher_.latency().RecordDelivered(kEraseBackground, 10300);
+  ASSERT_EQ(dispatcher_.latency()
+                .stage(LatencyStage::kDelivered)
+                .Snapshot(summaries, 2),
+            1u);
+  EXPECT_EQ(summaries[0].max, 400);
+
+  // Untracked batches are not stamped.
+  dispatcher_.latency().set_enabled(false);
+  Send(kEraseBackground);
+  ASSERT_TRUE(registrar_.PumpFlushes());
+  posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].int64s.size(), kObservedMessageFields);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,407 @@
+#include "../core/engine_registry.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "fake_dart_api.h"
+#include "fake_window_proc_registrar.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int64_t kEngine = 3;
+constexpr uint32_t kMouseMove = 0x0200;
+
+void HandlingCallback(WindowsMessage* message) {
+  message->lResult = 7;
+  message->handled = true;
+}
+
+// Replies to every message with 9.
+bool ReplyingHandler(void*, const WindowProcDelegateNativeMessage*,
+                     int64_t* result) {
+  *result = 9;
+  return true;
+}
+
+class EngineRegistryTest : public ::testing::Test {
+ protected:
+  void SetUp() override { testing::InstallFakeDartApi(); }
+
+  std::optional<int64_t> Send(uint32_t message) {
+    return registrar_.Send({1, message, 0, 0});
+  }
+
+  EngineRegistry registry_;
+  testing::FakeWindowProcRegistrar registrar_;
+  Dispatcher dispatcher_{&registrar_};
+};
+
+TEST_F(EngineRegistryTest, BindsAttachedPluginOnFirstCall) {
+  constexpr intptr_t kKey = 0x1000;
+  registry_.Attach(kKey, &dispatcher_);
+  // Nothing is registered until an engine ID can be located.
+  EXPECT_FALSE(registry_.SetCallback(kEngine, &HandlingCallback,
+                                     testing::FakeIsolate(1)));
+  EXPECT_EQ(registry_.Find(kEngine), 0);
+
+  registry_.SetEngineLocator(
+      [](int64_t engine_id) -> intptr_t {
+        return engine_id == kEngine ? kKey : 0;
+      });
+  EXPECT_FALSE(registry_.SetCallback(kEngine + 1, &HandlingCallback,
+                                     testing::FakeIsolate(1)));
+  // The callback is live as soon as it is set.
+  EXPECT_TRUE(registry_.SetCallback(kEngine, &HandlingCallback,
+                                    testing::FakeIsolate(1)));
+  EXPECT_EQ(Send(kMouseMove), 7);
+  const EngineHandle engine = registry_.Find(kEngine);
+  EXPECT_NE(engine, 0);
+  EXPECT_EQ(registry_.Bind(kEngine), engine);
+
+  const uint32_t program[] = {0, 1, kMouseMove + 1, kMouseMove + 1};
+  EXPECT_TRUE(registry_.SetDelegateRoutes(
+      kEngine, DelegateRouteTable::Compile(program, 4)));
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+  EXPECT_EQ(Send(kMouseMove + 1), 7);
+
+  registry_.Detach(kKey);
+  EXPECT_EQ(registry_.Find(kEngine), 0);
+  EXPECT_EQ(registry_.SetLatencyTracking(engine, true), nullptr);
+  EXPECT_FALSE(registry_.SetDelegateRoutes(
+      kEngine, DelegateRouteTable::Compile(program, 4)));
+}
+
+TEST_F(EngineRegistryTest, BindsEachPluginToOneEngine) {
+  constexpr intptr_t kKey = 0x2000;
+  registry_.Attach(kKey, &dispatcher_);
+  // A locator that maps every engine to the same plugin.
+  registry_.SetEngineLocator([](int64_t) -> intptr_t { return kKey; });
+  EXPECT_NE(registry_.Bind(kEngine), 0);
+  EXPECT_EQ(registry_.Bind(kEngine + 1), 0);
+  registry_.Detach(kKey);
+  registry_.Detach(kKey);
+}
+
+TEST_F(EngineRegistryTest, NotifiesWhenPluginAttaches) {
+  constexpr intptr_t kKey = 0x3000;
+  constexpr Dart_Port_DL kPort = 17;
+  registry_.SetEngineLocator(
+      [](int64_t engine_id) -> intptr_t {
+        return engine_id == kEngine ? kKey : 0;
+      });
+  testing::TakeFakePostedMessages();
+  // Dart got here before the engine registered its plugins.
+  EXPECT_EQ(registry_.BindOrNotify(kEngine, kPort), 0);
+  EXPECT_EQ(registry_.BindOrNotify(kEngine, kPort), 0);
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+
+  registry_.Attach(kKey, &dispatcher_);
+  const auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].port, kPort);
+  const EngineHandle engine = registry_.BindOrNotify(kEngine, kPort);
+  EXPECT_NE(engine, 0);
+  EXPECT_EQ(registry_.Find(kEngine), engine);
+
+  // Later attaches have nobody left to notify.
+  registry_.Detach(kKey);
+  registry_.Attach(kKey, &dispatcher_);
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+  registry_.Detach(kKey);
+}
+
+TEST_F(EngineRegistryTest, KeepsNativeHandlersUntilPluginAttaches) {
+  constexpr intptr_t kKey = 0x3000;
+  const uint32_t messages[] = {kMouseMove, 0x10000};
+  EXPECT_EQ(registry_.AddNativeHandler(kKey, messages + 1, 1, 0,
+                                       &ReplyingHandler, nullptr),
+            0);
+  const int64_t handler = registry_.AddNativeHandler(
+      kKey, messages, 2, 0, &ReplyingHandler, nullptr);
+  EXPECT_NE(handler, 0);
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+
+  // Other plugins may register before this one attaches.
+  registry_.Attach(kKey, &dispatcher_);
+  EXPECT_EQ(Send(kMouseMove), 9);
+  registry_.RemoveNativeHandler(kKey, handler);
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+
+  // Handlers go away with the engine.
+  registry_.AddNativeHandler(kKey, messages, 1, 0, &ReplyingHandler, nullptr);
+  registry_.Detach(kKey);
+  registry_.Attach(kKey, &dispatcher_);
+  EXPECT_EQ(Send(kMouseMove), std::nullopt);
+  registry_.Detach(kKey);
+}
+
+TEST_F(EngineRegistryTest, FansBroadcastsOutAcrossEngines) {
+  constexpr uint32_t kPowerBroadcast = 0x0218;
+  constexpr Dart_Port_DL kPort = 30;
+  testing::TakeFakePostedMessages();
+  registry_.Register(kEngine, &dispatcher_);
+  const uint32_t range[] = {kPowerBroadcast, kPowerBroadcast};
+  const int64_t id =
+      registry_.SubscribeBroadcast(kPort, MessageFilter::FromRanges(range, 1));
+
+  // An engine registered after the subscription publishes as well.
+  testing::FakeWindowProcRegistrar other_registrar;
+  Dispatcher other_dispatcher(&other_registrar);
+  registry_.Register(kEngine + 1, &other_dispatcher);
+
+  EXPECT_EQ(registrar_.Send({1, kPowerBroadcast, 0x000A, 0}), std::nullopt);
+  EXPECT_EQ(other_registrar.Send({2, kPowerBroadcast, 0x000A, 0}),
+            std::nullopt);
+  other_registrar.Send({2, kMouseMove, 0, 0});
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].port, kPort);
+  EXPECT_EQ(posted[0].int64s,
+            (std::vector<int64_t>{1, kPowerBroadcast, 0x000A, 0, 1}));
+
+  registry_.UnsubscribeBroadcast(id);
+  testing::TakeFakePostedMessages();
+  other_registrar.Send({2, kPowerBroadcast, 0x0007, 0});
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+  registry_.Unregister(kEngine + 1);
+}
+
+TEST_F(EngineRegistryTest, RejectsCallsForUnregisteredEngines) {
+  const EngineHandle engine = registry_.Find(kEngine);
+  EXPECT_EQ(engine, 0);
+  EXPECT_EQ(registry_.AddObserver(engine, 1, MessageFilter::AcceptAll(), {}),
+            0);
+  EXPECT_EQ(registry_.AddRingObserver(engine, 1, MessageFilter::AcceptAll(),
+                                      8, RingDropPolicy::kDropNewest),
+            nullptr);
+  EXPECT_FALSE(registry_.SetHitTestIndex(engine, 1, nullptr));
+  EXPECT_FALSE(registry_.SetReplyRules(engine, nullptr));
+  EXPECT_EQ(registry_.SetLatencyTracking(engine, true), nullptr);
+  // Made-up handles are rejected as well.
+  EXPECT_EQ(registry_.SetLatencyTracking(0x100000001, true), nullptr);
+  EXPECT_EQ(registry_.SetLatencyTracking(-1, true), nullptr);
+}
+
+TEST_F(EngineRegistryTest, RoutesCallsToRegisteredEngine) {
+  const EngineHandle engine = registry_.Register(kEngine, &dispatcher_);
+  EXPECT_EQ(registry_.Find(kEngine), engine);
+  const int64_t first =
+      registry_.AddObserver(engine, 1, MessageFilter::AcceptAll(), {});
+  const int64_t second =
+      registry_.AddObserver(engine, 1, MessageFilter::AcceptAll(), {});
+  EXPECT_NE(first, 0);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(registry_.SetLatencyTracking(engine, true),
+            &dispatcher_.latency());
+  EXPECT_TRUE(dispatcher_.latency().enabled());
+  EXPECT_EQ(registry_.SetWatchdog(engine, 1000, 3, 20),
+            &dispatcher_.watchdog());
+  EXPECT_EQ(dispatcher_.watchdog().budget_ns(), 1000u);
+  EXPECT_EQ(registry_.SetWatchdog(engine, 1000, 30, 20), nullptr);
+  const TimelineApi api = {};
+  EXPECT_TRUE(registry_.SetTimeline(engine, &api));
+  EXPECT_EQ(dispatcher_.timeline().api(), &api);
+  EXPECT_TRUE(registry_.SetTimeline(engine, nullptr));
+
+  registry_.Unregister(kEngine);
+  EXPECT_EQ(registry_.Find(kEngine), 0);
+  EXPECT_EQ(registry_.SetLatencyTracking(engine, false), nullptr);
+  EXPECT_EQ(registry_.SetWatchdog(engine, 1000, 3, 20), nullptr);
+  EXPECT_FALSE(registry_.SetTimeline(engine, nullptr));
+}
+
+TEST_F(EngineRegistryTest, StaleHandleDoesNotReachReusedSlot) {
+  const EngineHandle stale = registry_.Register(kEngine, &dispatcher_);
+  registry_.Unregister(kEngine);
+
+  testing::FakeWindowProcRegistrar other_registrar;
+  Dispatcher other{&other_registrar};
+  const EngineHandle current = registry_.Register(kEngine + 1, &other);
+  EXPECT_NE(current, stale);
+  EXPECT_EQ(registry_.SetLatencyTracking(stale, true), nullptr);
+  EXPECT_FALSE(other.latency().enabled());
+  EXPECT_EQ(registry_.SetLatencyTracking(current, true), &other.latency());
+  registry_.Unregister(kEngine + 1);
+}
+
+TEST_F(EngineRegistryTest, FindsEnginesAcrossTableGrowth) {
+  constexpr int64_t kEngines = 1000;
+  std::vector<EngineHandle> handles;
+  for (int64_t id = 0; id < kEngines; id++) {
+    handles.push_back(registry_.Register(id, &dispatcher_));
+  }
+  for (int64_t id = 0; id < kEngines; id += 2) {
+    registry_.Unregister(id);
+  }
+  for (int64_t id = 0; id < kEngines; id++) {
+    if (id % 2) {
+      EXPECT_EQ(registry_.Find(id), handles[id]) << id;
+    } else {
+      EXPECT_EQ(registry_.Find(id), 0) << id;
+    }
+  }
+  // Deleted entries are reused or dropped on rebuild.
+  for (int64_t id = kEngines; id < kEngines * 3; id++) {
+    registry_.Register(id, &dispatcher_);
+    registry_.Unregister(id);
+  }
+  EXPECT_EQ(registry_.Find(kEngines - 1), handles[kEngines - 1]);
+}
+
+TEST_F(EngineRegistryTest, UnregisterWaitsForCallsInFlight) {
+  const EngineHandle engine = registry_.Register(kEngine, &dispatcher_);
+  std::atomic<bool> resolved{false};
+  std::atomic<bool> release{false};
+  std::atomic<bool> unregistered{false};
+
+  // Stands in for a call that resolved the engine and is still using it.
+  std::thread call([&] {
+    EpochGuard guard;
+    EXPECT_NE(registry_.SetLatencyTracking(engine, true), nullptr);
+    resolved = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+    EXPECT_FALSE(unregistered);
+  });
+  while (!resolved) {
+    std::this_thread::yield();
+  }
+  std::thread unregister([&] {
+    registry_.Unregister(kEngine);
+    unregistered = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(unregistered);
+  release = true;
+  call.join();
+  unregister.join();
+  EXPECT_TRUE(unregistered);
+}
+
+// Engines register and unregister on churn threads while other threads
+// keep calling into them through stale and current handles. Run under
+// ThreadSanitizer, a call reaching a destroyed dispatcher is reported.
+TEST(EngineRegistryStressTest, ChurnWithConcurrentCalls) {
+  testing::InstallFakeDartApi();
+  EngineRegistry registry;
+  constexpr int kChurnThreads = 2;
+  constexpr int kCallThreads = 4;
+  constexpr int kIterations = 2000;
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> churn;
+  for (int t = 0; t < kChurnThreads; t++) {
+    churn.emplace_back([&registry, t] {
+      for (int i = 0; i < kIterations; i++) {
+        const int64_t engine_id = t * 4 + i % 4;
+        testing::FakeWindowProcRegistrar registrar;
+        auto dispatcher = std::make_unique<Dispatcher>(&registrar);
+        registry.Register(engine_id, dispatcher.get());
+        registry.SetCallback(engine_id, &HandlingCallback,
+                             testing::FakeIsolate(1));
+        registrar.Send({1, kMouseMove, 0, 0});
+        registry.Unregister(engine_id);
+        dispatcher.reset();
+      }
+    });
+  }
+
+  std::vector<std::thread> calls;
+  for (int t = 0; t < kCallThreads; t++) {
+    calls.emplace_back([&registry, &done, t] {
+      std::vector<EngineHandle> seen;
+      for (uint32_t i = 0; !done; i++) {
+        const int64_t engine_id = (t + i) % (kChurnThreads * 4);
+        if (EngineHandle engine = registry.Find(engine_id)) {
+          seen.push_back(engine);
+        }
+        // Mix current and stale handles.
+        for (EngineHandle engine : seen) {
+          registry.SetLatencyTracking(engine, i % 2);
+        }
+        if (seen.size() > 8) {
+          seen.erase(seen.begin());
+        }
+        const int64_t observer = registry.AddObserver(
+            seen.empty() ? 0 : seen.back(), 1, MessageFilter::AcceptAll(), {});
+        registry.RemoveObserver(seen.empty() ? 0 : seen.back(), observer);
+        const uint32_t program[] = {0, 1, kMouseMove, kMouseMove};
+        registry.SetDelegateRoutes(engine_id,
+                                   DelegateRouteTable::Compile(program, 4));
+      }
+    });
+  }
+
+  for (auto& thread : churn) {
+    thread.join();
+  }
+  done = true;
+  for (auto& thread : calls) {
+    thread.join();
+  }
+  for (int64_t engine_id = 0; engine_id < kChurnThreads * 4; engine_id++) {
+    EXPECT_EQ(registry.Find(engine_id), 0);
+  }
+}
+
+// Two engine IDs hash to the same table entry, so each registration reuses
+// the entry the other left deleted. Lookups of one must never return the
+// other's handle, which would pass the generation check.
+TEST(EngineRegistryStressTest, FindNeverReturnsAnotherEnginesHandle) {
+  testing::InstallFakeDartApi();
+  EngineRegistry registry;
+  // Both start probing at the same entry of a 16-entry table.
+  constexpr int64_t kFirst = 3;
+  constexpr int64_t kSecond = 30;
+  constexpr int kIterations = 5000;
+  testing::FakeWindowProcRegistrar first_registrar;
+  testing::FakeWindowProcRegistrar second_registrar;
+  Dispatcher first(&first_registrar);
+  Dispatcher second(&second_registrar);
+  std::atomic<bool> done{false};
+  std::atomic<int> started{0};
+
+  std::vector<std::thread> lookups;
+  std::atomic<int> mismatches{0};
+  for (int t = 0; t < 4; t++) {
+    lookups.emplace_back([&] {
+      started++;
+      while (!done) {
+        for (const auto& [engine_id, dispatcher] :
+             {std::make_pair(kFirst, &first),
+              std::make_pair(kSecond, &second)}) {
+          const EngineHandle engine = registry.Find(engine_id);
+          DispatchLatency* latency = registry.SetLatencyTracking(engine, false);
+          if (latency && latency != &dispatcher->latency()) {
+            mismatches++;
+          }
+        }
+      }
+    });
+  }
+
+  while (started < 4) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < kIterations; i++) {
+    registry.Register(kFirst, &first);
+    registry.Unregister(kFirst);
+    registry.Register(kSecond, &second);
+    registry.Unregister(kSecond);
+  }
+  done = true;
+  for (auto& thread : lookups) {
+    thread.join();
+  }
+  EXPECT_EQ(mismatches, 0);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,164 @@
+#include "../core/epoch.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+// Sets a flag when deleted.
+struct Tracked {
+  explicit Tracked(std::atomic<int>* deleted) : deleted(deleted) {}
+  ~Tracked() { deleted->fetch_add(1); }
+  std::atomic<int>* deleted;
+};
+
+// Runs Collect() until |deleted| reaches |count| or a deadline passes.
+bool CollectUntil(const std::atomic<int>& deleted, int count) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (deleted.load() < count) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    EpochDomain::Global().Collect();
+  }
+  return true;
+}
+
+TEST(EpochTest, RetiredObjectIsDeletedWithoutReaders) {
+  std::atomic<int> deleted{0};
+  EpochDomain::Global().Retire(new Tracked(&deleted));
+  EXPECT_TRUE(CollectUntil(deleted, 1));
+}
+
+TEST(EpochTest, GuardDelaysDeletion) {
+  std::atomic<int> deleted{0};
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+  std::thread reader([&] {
+    EpochGuard guard;
+    entered = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  while (!entered) {
+    std::this_thread::yield();
+  }
+
+  EpochDomain::Global().Retire(new Tracked(&deleted));
+  for (int i = 0; i < 10; i++) {
+    EpochDomain::Global().Collect();
+  }
+  EXPECT_EQ(deleted.load(), 0);
+
+  release = true;
+  reader.join();
+  EXPECT_TRUE(CollectUntil(deleted, 1));
+}
+
+TEST(EpochTest, NestedGuardsProtectUntilOutermostExits) {
+  std::atomic<int> deleted{0};
+  std::atomic<int> stage{0};
+  std::thread reader([&] {
+    EpochGuard outer;
+    {
+      EpochGuard inner;
+      stage = 1;
+      while (stage != 2) {
+        std::this_thread::yield();
+      }
+    }
+    stage = 3;
+    while (stage != 4) {
+      std::this_thread::yield();
+    }
+  });
+  while (stage != 1) {
+    std::this_thread::yield();
+  }
+  EpochDomain::Global().Retire(new Tracked(&deleted));
+  stage = 2;
+  while (stage != 3) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < 10; i++) {
+    EpochDomain::Global().Collect();
+  }
+  EXPECT_EQ(deleted.load(), 0);
+  stage = 4;
+  reader.join();
+  EXPECT_TRUE(CollectUntil(deleted, 1));
+}
+
+TEST(EpochTest, SynchronizeWaitsForOtherThreadsOnly) {
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+  std::atomic<bool> synchronized{false};
+  std::thread reader([&] {
+    EpochGuard guard;
+    entered = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  while (!entered) {
+    std::this_thread::yield();
+  }
+
+  std::thread writer([&] {
+    // A guard held by the synchronizing thread itself is ignored.
+    EpochGuard own;
+    EpochDomain::Global().Synchronize();
+    synchronized = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(synchronized);
+  release = true;
+  reader.join();
+  writer.join();
+  EXPECT_TRUE(synchronized);
+}
+
+// Readers follow a shared pointer that writers keep replacing and retiring.
+// Run under ThreadSanitizer, reading a deleted value is reported.
+TEST(EpochTest, ConcurrentReadersAndRetirement) {
+  struct Value {
+    explicit Value(int64_t value) : value(value) {}
+    int64_t value;
+  };
+  std::atomic<const Value*> current{new Value(0)};
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      int64_t last = 0;
+      while (!done) {
+        EpochGuard guard;
+        const int64_t value = current.load(std::memory_order_acquire)->value;
+        EXPECT_GE(value, last);
+        last = value;
+      }
+    });
+  }
+
+  for (int64_t i = 1; i <= 20000; i++) {
+    const Value* previous =
+        current.exchange(new Value(i), std::memory_order_acq_rel);
+    EpochDomain::Global().Retire(previous);
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  delete current.load();
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,124 @@
+#include "fake_dart_api.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace window_proc_delegate {
+namespace testing {
+
+namespace {
+constexpr int kMaxFakeIsolates = 64;
+char g_isolates[kMaxFakeIsolates];
+thread_local Dart_Isolate t_current_isolate = nullptr;
+std::atomic<int64_t> g_enter_count{0};
+
+Dart_Isolate FakeCurrentIsolate() {
+  return t_current_isolate;
+}
+
+void FakeExitIsolate() {
+  t_current_isolate = nullptr;
+}
+
+void FakeEnterIsolate(Dart_Isolate isolate) {
+  g_enter_count.fetch_add(1, std::memory_order_relaxed);
+  t_current_isolate = isolate;
+}
+
+std::mutex g_posted_mutex;
+std::vector<FakePostedMessage> g_posted;
+std::vector<Dart_Port_DL> g_closed_ports;
+
+bool IsClosedLocked(Dart_Port_DL port) {
+  return std::find(g_closed_ports.begin(), g_closed_ports.end(), port) !=
+         g_closed_ports.end();
+}
+
+bool FakePostInteger(Dart_Port_DL port, int64_t message) {
+  std::lock_guard<std::mutex> lock(g_posted_mutex);
+  if (IsClosedLocked(port)) {
+    return false;
+  }
+  g_posted.push_back(FakePostedMessage{port, message, {}});
+  return true;
+}
+
+FakePostedMessage Decode(Dart_Port_DL port, const Dart_CObject* message) {
+  FakePostedMessage posted{port, 0, {}};
+  if (message->type == Dart_CObject_kNull) {
+    posted.is_null = true;
+  } else if (message->type == Dart_CObject_kInt64) {
+    posted.integer = message->value.as_int64;
+  } else if (message->type == Dart_CObject_kTypedData &&
+             message->value.as_typed_data.type == Dart_TypedData_kInt64) {
+    posted.int64s.resize(message->value.as_typed_data.length);
+    std::memcpy(posted.int64s.data(), message->value.as_typed_data.values,
+                posted.int64s.size() * sizeof(int64_t));
+  } else if (message->type == Dart_CObject_kTypedData &&
+             message->value.as_typed_data.type == Dart_TypedData_kUint8) {
+    const auto& typed_data = message->value.as_typed_data;
+    posted.bytes.assign(typed_data.values,
+                        typed_data.values + typed_data.length);
+  } else if (message->type == Dart_CObject_kExternalTypedData &&
+             message->value.as_external_typed_data.type ==
+                 Dart_TypedData_kUint8) {
+    const auto& external = message->value.as_external_typed_data;
+    posted.bytes.assign(external.data, external.data + external.length);
+    posted.peer = external.peer;
+    posted.finalizer = external.callback;
+  } else if (message->type == Dart_CObject_kArray) {
+    for (intptr_t i = 0; i < message->value.as_array.length; i++) {
+      posted.elements.push_back(
+          Decode(port, message->value.as_array.values[i]));
+    }
+  }
+  return posted;
+}
+
+bool FakePostCObject(Dart_Port_DL port, Dart_CObject* message) {
+  FakePostedMessage posted = Decode(port, message);
+  std::lock_guard<std::mutex> lock(g_posted_mutex);
+  if (IsClosedLocked(port)) {
+    return false;
+  }
+  g_posted.push_back(std::move(posted));
+  return true;
+}
+}  // namespace
+
+void InstallFakeDartApi() {
+  Dart_CurrentIsolate_DL = &FakeCurrentIsolate;
+  Dart_ExitIsolate_DL = &FakeExitIsolate;
+  Dart_EnterIsolate_DL = &FakeEnterIsolate;
+  Dart_PostInteger_DL = &FakePostInteger;
+  Dart_PostCObject_DL = &FakePostCObject;
+}
+
+Dart_Isolate FakeIsolate(int index) {
+  return reinterpret_cast<Dart_Isolate>(&g_isolates[index % kMaxFakeIsolates]);
+}
+
+int64_t FakeIsolateEnterCount() {
+  return g_enter_count.load(std::memory_order_relaxed);
+}
+
+void ResetFakeIsolateEnterCount() {
+  g_enter_count.store(0, std::memory_order_relaxed);
+}
+
+std::vector<FakePostedMessage> TakeFakePostedMessages() {
+  std::lock_guard<std::mutex> lock(g_posted_mutex);
+  std::vector<FakePostedMessage> posted;
+  posted.swap(g_posted);
+  return posted;
+}
+
+void CloseFakePort(Dart_Port_DL port) {
+  std::lock_guard<std::mutex> lock(g_posted_mutex);
+  g_closed_ports.push_back(port);
+}
+
+}  // namespace testing
+}  // namespace window_proc_delegate
@@ -0,0 +1,48 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_FAKE_DART_API_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_FAKE_DART_API_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "../dart/dart_api_dl.h"
+
+namespace window_proc_delegate {
+namespace testing {
+
+// Points the Dart_*_DL entry points used by the plugin at in-process fakes,
+// so the dispatch code can run without a Dart VM. The fake tracks the
+// current isolate per thread, like the VM does.
+void InstallFakeDartApi();
+
+// Returns a distinct fake isolate handle for |index|.
+Dart_Isolate FakeIsolate(int index);
+
+// Number of Dart_EnterIsolate_DL calls since the last reset.
+int64_t FakeIsolateEnterCount();
+void ResetFakeIsolateEnterCount();
+
+// A message posted through Dart_PostInteger_DL or Dart_PostCObject_DL.
+// Int64 typed data is copied into |int64s| and Uint8 typed data into
+// |bytes|, like the VM does on send. External typed data keeps its peer and
+// finalizer, which the test runs in place of the Dart GC.
+struct FakePostedMessage {
+  Dart_Port_DL port;
+  int64_t integer;
+  std::vector<int64_t> int64s;
+  bool is_null = false;
+  std::vector<uint8_t> bytes;
+  void* peer = nullptr;
+  Dart_HandleFinalizer finalizer = nullptr;
+  std::vector<FakePostedMessage> elements;
+};
+
+// Returns and clears the messages posted since the last call.
+std::vector<FakePostedMessage> TakeFakePostedMessages();
+
+// Makes posts to |port| fail, as if the port were closed.
+void CloseFakePort(Dart_Port_DL port);
+
+}  // namespace testing
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_FAKE_DART_API_H_
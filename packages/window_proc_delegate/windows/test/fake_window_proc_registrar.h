@@ -0,0 +1,139 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_FAKE_WINDOW_PROC_REGISTRAR_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_FAKE_WINDOW_PROC_REGISTRAR_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../core/raw_input.h"
+#include "../core/window_proc_registrar.h"
+#include "../core/window_state.h"
+
+namespace window_proc_delegate {
+namespace testing {
+
+// In-process WindowProcRegistrar. Messages are delivered with Send(), and
+// flushes requested with PostFlush() run on the next PumpFlushes(), like a
+// posted message on the next message pump iteration.
+class FakeWindowProcRegistrar : public WindowProcRegistrar {
+ public:
+  FakeWindowProcRegistrar() = default;
+
+  // Disallow copy and assign.
+  FakeWindowProcRegistrar(const FakeWindowProcRegistrar&) = delete;
+  FakeWindowProcRegistrar& operator=(const FakeWindowProcRegistrar&) = delete;
+
+  // Delivers a message to the handler, if any.
+  std::optional<int64_t> Send(const WindowProcMessage& message) {
+    if (!handler_) {
+      return std::nullopt;
+    }
+    return handler_->HandleWindowProc(message);
+  }
+
+  // Runs the pending flush, if any. Returns true if one ran.
+  bool PumpFlushes() {
+    if (!flush_pending_ || !handler_) {
+      return false;
+    }
+    flush_pending_ = false;
+    handler_->OnFlush();
+    return true;
+  }
+
+  Handler* handler() const { return handler_; }
+
+  // Client area origin in screen coordinates, used by ScreenToClient().
+  void set_client_origin(int32_t x, int32_t y) {
+    client_x_ = x;
+    client_y_ = y;
+  }
+
+  // Value returned by NowNanoseconds(); advanced by |clock_step| per call.
+  void set_clock(uint64_t now, uint64_t clock_step) {
+    now_ = now;
+    clock_step_ = clock_step;
+  }
+
+  // Value returned by PostedNanoseconds().
+  void set_posted(uint64_t posted) { posted_ = posted; }
+
+  // ChordModifier bits returned by ModifierState().
+  void set_modifier_state(uint32_t modifiers) { modifiers_ = modifiers; }
+
+  // State returned by QueryWindowState(), with the queried window.
+  void set_window_state(const WindowState& state) { window_state_ = state; }
+
+  // Value returned by MonitorFromWindow().
+  void set_monitor(intptr_t monitor) { monitor_ = monitor; }
+
+  // Whether raw mouse input is delivered, as set by SetRawMouseInput().
+  bool raw_mouse_input() const { return raw_mouse_input_; }
+
+  // Makes SetRawMouseInput() fail.
+  void set_raw_mouse_input_fails(bool fails) { raw_mouse_input_fails_ = fails; }
+
+  // Stores |report| and returns the WM_INPUT lParam that reads it.
+  int64_t AddRawMouseReport(const RawMouseReport& report) {
+    raw_mouse_reports_.push_back(report);
+    return static_cast<int64_t>(raw_mouse_reports_.size());
+  }
+
+  // WindowProcRegistrar:
+  void SetHandler(Handler* handler) override { handler_ = handler; }
+  bool PostFlush(intptr_t window) override {
+    flush_pending_ = true;
+    return true;
+  }
+  void ScreenToClient(intptr_t window, int32_t* x, int32_t* y) override {
+    *x -= client_x_;
+    *y -= client_y_;
+  }
+  uint64_t NowNanoseconds() override {
+    const uint64_t now = now_;
+    now_ += clock_step_;
+    return now;
+  }
+  uint64_t PostedNanoseconds() override { return posted_; }
+  uint32_t ModifierState() override { return modifiers_; }
+  void QueryWindowState(intptr_t window, WindowState* state) override {
+    *state = window_state_;
+    state->window = window;
+  }
+  intptr_t MonitorFromWindow(intptr_t window) override { return monitor_; }
+  bool SetRawMouseInput(bool enabled) override {
+    if (raw_mouse_input_fails_) {
+      return false;
+    }
+    raw_mouse_input_ = enabled;
+    return true;
+  }
+  bool ReadRawMouseInput(int64_t lparam, RawMouseReport* report) override {
+    if (lparam <= 0 ||
+        static_cast<size_t>(lparam) > raw_mouse_reports_.size()) {
+      return false;
+    }
+    *report = raw_mouse_reports_[static_cast<size_t>(lparam) - 1];
+    return true;
+  }
+
+ private:
+  Handler* handler_ = nullptr;
+  bool flush_pending_ = false;
+  int32_t client_x_ = 0;
+  int32_t client_y_ = 0;
+  uint64_t now_ = 0;
+  uint64_t clock_step_ = 0;
+  uint64_t posted_ = 0;
+  uint32_t modifiers_ = 0;
+  WindowState window_state_ = {};
+  intptr_t monitor_ = 0;
+  bool raw_mouse_input_ = false;
+  bool raw_mouse_input_fails_ = false;
+  std::vector<RawMouseReport> raw_mouse_reports_;
+};
+
+}  // namespace testing
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_TEST_FAKE_WINDOW_PROC_REGISTRAR_H_
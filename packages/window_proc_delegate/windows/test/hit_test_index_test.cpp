@@ -0,0 +1,117 @@
+#include "../core/hit_test_index.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int32_t kHtClient = 1;
+constexpr int32_t kHtCaption = 2;
+constexpr int32_t kHtLeft = 10;
+constexpr int32_t kHtTop = 12;
+
+// Reference answer: the last region containing the point.
+bool LinearLookup(const std::vector<HitTestRegion>& regions, int32_t x,
+                  int32_t y, int32_t* code) {
+  for (size_t i = regions.size(); i-- > 0;) {
+    const HitTestRegion& region = regions[i];
+    if (x >= region.left && x < region.right && y >= region.top &&
+        y < region.bottom) {
+      *code = region.code;
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST(HitTestIndexTest, EmptyIndexMissesEverything) {
+  HitTestIndex index({});
+  int32_t code = -1;
+  EXPECT_FALSE(index.Lookup(0, 0, &code));
+  EXPECT_EQ(code, -1);
+}
+
+TEST(HitTestIndexTest, RightAndBottomAreExclusive) {
+  HitTestIndex index({{0, 0, 100, 30, kHtCaption}});
+  int32_t code = 0;
+  EXPECT_TRUE(index.Lookup(0, 0, &code));
+  EXPECT_EQ(code, kHtCaption);
+  EXPECT_TRUE(index.Lookup(99, 29, &code));
+  EXPECT_FALSE(index.Lookup(100, 0, &code));
+  EXPECT_FALSE(index.Lookup(0, 30, &code));
+  EXPECT_FALSE(index.Lookup(-1, 0, &code));
+}
+
+TEST(HitTestIndexTest, LaterRegionsAreOnTop) {
+  // A caption bar with a button on it, inside a client area.
+  HitTestIndex index({{0, 0, 800, 600, kHtClient},
+                      {0, 0, 800, 32, kHtCaption},
+                      {760, 0, 800, 32, kHtClient}});
+  int32_t code = 0;
+  ASSERT_TRUE(index.Lookup(10, 10, &code));
+  EXPECT_EQ(code, kHtCaption);
+  ASSERT_TRUE(index.Lookup(780, 10, &code));
+  EXPECT_EQ(code, kHtClient);
+  ASSERT_TRUE(index.Lookup(400, 300, &code));
+  EXPECT_EQ(code, kHtClient);
+}
+
+TEST(HitTestIndexTest, AcceptsNegativeCoordinates) {
+  // Resize borders of a frameless window extend past the client origin.
+  HitTestIndex index({{-8, 0, 0, 600, kHtLeft}, {0, -8, 800, 0, kHtTop}});
+  int32_t code = 0;
+  ASSERT_TRUE(index.Lookup(-4, 300, &code));
+  EXPECT_EQ(code, kHtLeft);
+  ASSERT_TRUE(index.Lookup(400, -1, &code));
+  EXPECT_EQ(code, kHtTop);
+  EXPECT_FALSE(index.Lookup(-4, -4, &code));
+}
+
+TEST(HitTestIndexTest, IgnoresEmptyRegions) {
+  HitTestIndex index({{10, 10, 10, 20, kHtCaption}, {0, 0, 5, 5, kHtLeft}});
+  EXPECT_EQ(index.region_count(), 1u);
+  int32_t code = 0;
+  EXPECT_FALSE(index.Lookup(10, 15, &code));
+}
+
+TEST(HitTestIndexTest, MatchesLinearScanOnRandomLayouts) {
+  std::mt19937 random(42);
+  for (int layout = 0; layout < 20; layout++) {
+    std::uniform_int_distribution<int32_t> position(-50, 2000);
+    std::uniform_int_distribution<int32_t> size(1, layout % 2 ? 40 : 800);
+    std::vector<HitTestRegion> regions;
+    for (int i = 0; i < 50 * (layout + 1); i++) {
+      const int32_t left = position(random);
+      const int32_t top = position(random);
+      regions.push_back({left, top, left + size(random), top + size(random),
+                         static_cast<int32_t>(i)});
+    }
+    HitTestIndex index(regions);
+
+    std::uniform_int_distribution<int32_t> point(-100, 3000);
+    for (int i = 0; i < 2000; i++) {
+      const int32_t x = point(random);
+      const int32_t y = point(random);
+      int32_t expected = -1;
+      int32_t actual = -1;
+      ASSERT_EQ(index.Lookup(x, y, &actual),
+                LinearLookup(regions, x, y, &expected))
+          << "at " << x << "," << y;
+      ASSERT_EQ(actual, expected) << "at " << x << "," << y;
+    }
+  }
+}
+
+TEST(WindowHitTestsTest, FindsIndexByWindow) {
+  WindowHitTests hit_tests;
+  auto index = std::make_shared<const HitTestIndex>(
+      std::vector<HitTestRegion>{{0, 0, 10, 10, kHtCaption}});
+  hit_tests.windows.emplace_back(0x1234, index);
+  EXPECT_EQ(hit_tests.Find(0x1234), index.get());
+  EXPECT_EQ(hit_tests.Find(0x5678), nullptr);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
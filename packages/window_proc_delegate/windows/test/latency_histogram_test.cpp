@@ -0,0 +1,166 @@
+#include "../core/latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+TEST(LatencyHistogramTest, BucketsAreMonotonicWithBoundedError) {
+  size_t previous = 0;
+  for (uint64_t value = 0; value < 1000000; value += 1 + value / 100) {
+    const size_t bucket = LatencyHistogram::BucketOf(value);
+    ASSERT_GE(bucket, previous) << value;
+    ASSERT_LT(bucket, LatencyHistogram::kBucketCount) << value;
+    const uint64_t highest = LatencyHistogram::BucketHighestValue(bucket);
+    ASSERT_GE(highest, value);
+    ASSERT_LE(highest - value, value / 16) << value;
+    previous = bucket;
+  }
+  EXPECT_EQ(LatencyHistogram::BucketOf(UINT64_MAX),
+            LatencyHistogram::kBucketCount - 1);
+}
+
+TEST(LatencyHistogramTest, EmptyHistogramHasNoSummary) {
+  LatencyHistogram histogram;
+  LatencySummary summary = {};
+  EXPECT_FALSE(histogram.Summarize(&summary));
+}
+
+TEST(LatencyHistogramTest, SummarizesPercentiles) {
+  LatencyHistogram histogram;
+  // 1..1000 us.
+  for (uint64_t us = 1; us <= 1000; us++) {
+    histogram.Record(us * 1000);
+  }
+  LatencySummary summary = {};
+  ASSERT_TRUE(histogram.Summarize(&summary));
+  EXPECT_EQ(summary.count, 1000);
+  EXPECT_EQ(summary.max, 1000000);
+  EXPECT_GE(summary.p50, 500000);
+  EXPECT_LE(summary.p50, 500000 + 500000 / 16);
+  EXPECT_GE(summary.p99, 990000);
+  EXPECT_LE(summary.p99, 1000000);
+}
+
+TEST(LatencyHistogramTest, ResetClearsSamples) {
+  LatencyHistogram histogram;
+  histogram.Record(100);
+  histogram.Reset();
+  LatencySummary summary = {};
+  EXPECT_FALSE(histogram.Summarize(&summary));
+  histogram.Record(7);
+  ASSERT_TRUE(histogram.Summarize(&summary));
+  EXPECT_EQ(summary.max, 7);
+}
+
+TEST(LatencyTableTest, SnapshotListsRecordedMessagesInOrder) {
+  LatencyTable table;
+  table.Record(0x0200, 1000);
+  table.Record(0x0084, 500);
+  table.Record(0x0200, 3000);
+  table.Record(0x12345, 10);
+
+  LatencySummary summaries[4] = {};
+  ASSERT_EQ(table.Snapshot(summaries, 4), 3u);
+  EXPECT_EQ(summaries[0].message, 0x0084);
+  EXPECT_EQ(summaries[0].count, 1);
+  EXPECT_EQ(summaries[1].message, 0x0200);
+  EXPECT_EQ(summaries[1].count, 2);
+  EXPECT_EQ(summaries[1].max, 3000);
+  EXPECT_EQ(summaries[2].message, 0xFFFF);
+
+  // A short buffer still reports the total.
+  EXPECT_EQ(table.Snapshot(summaries, 1), 3u);
+  EXPECT_EQ(table.Snapshot(nullptr, 0), 3u);
+
+  table.Reset();
+  EXPECT_EQ(table.Snapshot(summaries, 4), 0u);
+}
+
+TEST(DispatchLatencyTest, AttributesDelegates) {
+  DispatchLatency latency;
+  EXPECT_FALSE(latency.enabled());
+  latency.RecordDelegate(3, 0x0084, 2000);
+  latency.RecordDelegate(-1, 0x0084, 2000);
+  latency.RecordDelegate(DispatchLatency::kMaxDelegates, 0x0084, 2000);
+
+  EXPECT_EQ(latency.delegate(0), nullptr);
+  EXPECT_EQ(latency.delegate(-1), nullptr);
+  const LatencyTable* table = latency.delegate(3);
+  ASSERT_NE(table, nullptr);
+  LatencySummary summary = {};
+  ASSERT_EQ(table->Snapshot(&summary, 1), 1u);
+  EXPECT_EQ(summary.message, 0x0084);
+  EXPECT_EQ(summary.max, 2000);
+
+  latency.Reset();
+  EXPECT_EQ(table->Snapshot(&summary, 1), 0u);
+}
+
+TEST(DispatchLatencyTest, ResetsOneDelegate) {
+  DispatchLatency latency;
+  latency.RecordDelegate(1, 0x0084, 2000);
+  latency.RecordDelegate(2, 0x0084, 2000);
+  latency.ResetDelegate(1);
+  latency.ResetDelegate(-1);
+  latency.ResetDelegate(DispatchLatency::kMaxDelegates);
+
+  LatencySummary summary = {};
+  EXPECT_EQ(latency.delegate(1)->Snapshot(&summary, 1), 0u);
+  EXPECT_EQ(latency.delegate(2)->Snapshot(&summary, 1), 1u);
+}
+
+class StepClock : public LatencyClock {
+ public:
+  uint64_t NowNanoseconds() override { return now += 1000; }
+  uint64_t PostedNanoseconds() override { return 0; }
+  uint64_t now = 0;
+};
+
+TEST(DispatchLatencyTest, RecordsDeliveryOnItsClock) {
+  StepClock clock;
+  DispatchLatency latency(&clock);
+  latency.RecordDelivered(0x0200, 500);
+  latency.RecordDelivered(0x0200, 5000);  // Queued ahead of the clock.
+  LatencySummary summary = {};
+  const LatencyTable& delivered = latency.stage(LatencyStage::kDelivered);
+  ASSERT_EQ(delivered.Snapshot(&summary, 1), 1u);
+  EXPECT_EQ(summary.count, 2);
+  EXPECT_EQ(summary.max, 500);
+  latency.Reset();
+  EXPECT_EQ(delivered.Snapshot(&summary, 1), 0u);
+
+  // Without a clock there is nothing to measure against.
+  DispatchLatency unclocked;
+  unclocked.RecordDelivered(0x0200, 500);
+  EXPECT_EQ(unclocked.stage(LatencyStage::kDelivered).Snapshot(&summary, 1),
+            0u);
+}
+
+TEST(LatencyTableTest, SnapshotsWhileRecording) {
+  LatencyTable table;
+  std::atomic<bool> done{false};
+  std::thread recorder([&] {
+    for (uint32_t i = 0; i < 200000; i++) {
+      table.Record(i % 512, i % 10000);
+    }
+    done = true;
+  });
+  std::vector<LatencySummary> summaries(512);
+  while (!done) {
+    const size_t count = table.Snapshot(summaries.data(), summaries.size());
+    ASSERT_LE(count, summaries.size());
+    for (size_t i = 1; i < count; i++) {
+      ASSERT_LT(summaries[i - 1].message, summaries[i].message);
+    }
+    table.Reset();
+  }
+  recorder.join();
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
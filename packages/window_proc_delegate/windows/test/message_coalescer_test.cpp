@@ -0,0 +1,132 @@
+#include "../core/message_coalescer.h"
+
+#include <gtest/gtest.h>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr int64_t kMouseMove = 0x0200;
+constexpr int64_t kMouseWheel = 0x020A;
+constexpr int64_t kLeftButtonDown = 0x0201;
+
+ObservedMessage Message(int64_t hwnd, int64_t message, int64_t wparam,
+                        int64_t lparam) {
+  return ObservedMessage{hwnd, message, wparam, lparam, 1};
+}
+
+// Builds a WM_MOUSEWHEEL wParam the way Windows does: the signed delta in
+// the high word, key state in the low word, zero-extended to 64 bits.
+int64_t WheelWParam(int16_t delta, uint16_t keys) {
+  return static_cast<int64_t>(
+      (static_cast<uint32_t>(static_cast<uint16_t>(delta)) << 16) | keys);
+}
+
+std::vector<ObservedMessage> Flush(MessageCoalescer& coalescer) {
+  std::vector<ObservedMessage> out;
+  coalescer.Flush(&out);
+  return out;
+}
+
+TEST(MessageCoalescerTest, PassesThroughMessagesWithoutPolicy) {
+  MessageCoalescer coalescer;
+  coalescer.Add(Message(1, kMouseMove, 0, 10));
+  coalescer.Add(Message(1, kMouseMove, 0, 20));
+
+  auto out = Flush(coalescer);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].lParam, 10);
+  EXPECT_EQ(out[1].lParam, 20);
+  EXPECT_EQ(out[1].count, 1);
+}
+
+TEST(MessageCoalescerTest, KeepLatestPerWindowAndMessage) {
+  MessageCoalescer coalescer;
+  coalescer.SetPolicy(kMouseMove, CoalescePolicy::kKeepLatest);
+  coalescer.Add(Message(1, kMouseMove, 0, 10));
+  coalescer.Add(Message(2, kMouseMove, 0, 100));
+  coalescer.Add(Message(1, kMouseMove, 0, 20));
+  coalescer.Add(Message(1, kMouseMove, 0, 30));
+
+  auto out = Flush(coalescer);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].windowHandle, 2);
+  EXPECT_EQ(out[0].count, 1);
+  EXPECT_EQ(out[1].windowHandle, 1);
+  EXPECT_EQ(out[1].lParam, 30);
+  EXPECT_EQ(out[1].count, 3);
+}
+
+TEST(MessageCoalescerTest, MergedRecordKeepsPositionOfLatestMessage) {
+  MessageCoalescer coalescer;
+  coalescer.SetPolicy(kMouseMove, CoalescePolicy::kKeepLatest);
+  coalescer.Add(Message(1, kMouseMove, 0, 10));
+  coalescer.Add(Message(1, kLeftButtonDown, 1, 10));
+  coalescer.Add(Message(1, kMouseMove, 0, 20));
+
+  auto out = Flush(coalescer);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].message, kLeftButtonDown);
+  EXPECT_EQ(out[1].message, kMouseMove);
+  EXPECT_EQ(out[1].lParam, 20);
+}
+
+TEST(MessageCoalescerTest, AccumulatesSignedWheelDeltas) {
+  MessageCoalescer coalescer;
+  coalescer.SetPolicy(kMouseWheel, CoalescePolicy::kAccumulate);
+  for (int i = 0; i < 300; i++) {
+    coalescer.Add(Message(1, kMouseWheel, WheelWParam(-120, 0x0008), i));
+  }
+  coalescer.Add(Message(1, kMouseWheel, WheelWParam(40, 0x0004), 999));
+
+  auto out = Flush(coalescer);
+  ASSERT_EQ(out.size(), 1u);
+  // -36000 does not fit the 16-bit delta field; it is kept sign-extended.
+  EXPECT_EQ(out[0].wParam >> 16, -120 * 300 + 40);
+  EXPECT_EQ(out[0].wParam & 0xFFFF, 0x0004);
+  EXPECT_EQ(out[0].lParam, 999);
+  EXPECT_EQ(out[0].count, 301);
+}
+
+TEST(MessageCoalescerTest, SingleAccumulatedMessageIsSignExtended) {
+  MessageCoalescer coalescer;
+  coalescer.SetPolicy(kMouseWheel, CoalescePolicy::kAccumulate);
+  coalescer.Add(Message(1, kMouseWheel, WheelWParam(-120, 0), 0));
+
+  auto out = Flush(coalescer);
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].wParam >> 16, -120);
+}
+
+TEST(MessageCoalescerTest, FlushStartsNewWindow) {
+  MessageCoalescer coalescer;
+  coalescer.SetPolicy(kMouseMove, CoalescePolicy::kKeepLatest);
+  coalescer.Add(Message(1, kMouseMove, 0, 10));
+  EXPECT_EQ(Flush(coalescer).size(), 1u);
+  EXPECT_FALSE(coalescer.HasPending());
+
+  coalescer.Add(Message(1, kMouseMove, 0, 20));
+  auto out = Flush(coalescer);
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].lParam, 20);
+  EXPECT_EQ(out[0].count, 1);
+}
+
+TEST(MessageCoalescerTest, HandlesManyKeys) {
+  MessageCoalescer coalescer;
+  coalescer.SetPolicy(kMouseMove, CoalescePolicy::kKeepLatest);
+  for (int round = 0; round < 3; round++) {
+    for (int64_t hwnd = 0; hwnd < 1000; hwnd++) {
+      coalescer.Add(Message(hwnd, kMouseMove, 0, round));
+    }
+  }
+
+  auto out = Flush(coalescer);
+  ASSERT_EQ(out.size(), 1000u);
+  for (const auto& record : out) {
+    EXPECT_EQ(record.lParam, 2);
+    EXPECT_EQ(record.count, 3);
+  }
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
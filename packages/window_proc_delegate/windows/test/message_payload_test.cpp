@@ -0,0 +1,120 @@
+#include "../core/message_payload.h"
+
+#include <gtest/gtest.h>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kWindowPosChanging = 0x0046;
+constexpr uint32_t kWindowPosChanged = 0x0047;
+constexpr uint32_t kNcCalcSize = 0x0083;
+constexpr uint32_t kGetMinMaxInfo = 0x0024;
+constexpr uint32_t kDpiChanged = 0x02E0;
+constexpr uint32_t kSettingChange = 0x001A;
+
+template <typename T>
+int64_t Address(T* value) {
+  return static_cast<int64_t>(reinterpret_cast<intptr_t>(value));
+}
+
+TEST(MessagePayloadTest, LeavesOtherMessagesUndecoded) {
+  MessagePayload payload = {};
+  win32::Rect rect = {};
+  DecodePayload(0x0200, 0, Address(&rect), &payload);
+  EXPECT_EQ(payload.version, kMessagePayloadVersion);
+  EXPECT_EQ(payload.kind, PayloadKind::kNone);
+  DecodePayload(kWindowPosChanging, 0, 0, &payload);
+  EXPECT_EQ(payload.kind, PayloadKind::kNone);
+}
+
+TEST(MessagePayloadTest, WritesBackWindowPosChanging) {
+  win32::WindowPos pos = {0x10, 0x20, 1, 2, 300, 400, 0x4};
+  MessagePayload payload = {};
+  DecodePayload(kWindowPosChanging, 0, Address(&pos), &payload);
+  ASSERT_EQ(payload.kind, PayloadKind::kWindowPosChanging);
+  EXPECT_EQ(payload.windowPos.window, 0x10);
+  EXPECT_EQ(payload.windowPos.cx, 300);
+  EXPECT_EQ(payload.windowPos.flags, 0x4u);
+
+  payload.windowPos.window = 0x99;  // Read-only.
+  payload.windowPos.cx = 640;
+  payload.windowPos.cy = 480;
+  EncodePayload(payload, 0, Address(&pos));
+  EXPECT_EQ(pos.hwnd, 0x10);
+  EXPECT_EQ(pos.cx, 640);
+  EXPECT_EQ(pos.cy, 480);
+}
+
+TEST(MessagePayloadTest, NeverWritesBackReadOnlyPayloads) {
+  win32::WindowPos pos = {0x10, 0, 1, 2, 300, 400, 0};
+  MessagePayload payload = {};
+  DecodePayload(kWindowPosChanged, 0, Address(&pos), &payload);
+  ASSERT_EQ(payload.kind, PayloadKind::kWindowPosChanged);
+  payload.windowPos.cx = 640;
+  EncodePayload(payload, 0, Address(&pos));
+  EXPECT_EQ(pos.cx, 300);
+}
+
+TEST(MessagePayloadTest, DecodesBothNcCalcSizeForms) {
+  win32::WindowPos pos = {0x10, 0, 5, 6, 70, 80, 0};
+  win32::NcCalcSizeParams params = {
+      {{0, 0, 100, 100}, {1, 1, 99, 99}, {2, 2, 98, 98}}, &pos};
+  MessagePayload payload = {};
+  DecodePayload(kNcCalcSize, 1, Address(&params), &payload);
+  ASSERT_EQ(payload.kind, PayloadKind::kNcCalcSize);
+  EXPECT_EQ(payload.ncCalcSize.calcValidRects, 1u);
+  EXPECT_EQ(payload.ncCalcSize.rects[2].right, 98);
+  EXPECT_EQ(payload.ncCalcSize.windowPos.cx, 70);
+  payload.ncCalcSize.rects[0].top = 30;
+  EncodePayload(payload, 1, Address(&params));
+  EXPECT_EQ(params.rgrc[0].top, 30);
+
+  win32::Rect rect = {0, 0, 100, 100};
+  DecodePayload(kNcCalcSize, 0, Address(&rect), &payload);
+  EXPECT_EQ(payload.ncCalcSize.calcValidRects, 0u);
+  payload.ncCalcSize.rects[0].bottom = 90;
+  EncodePayload(payload, 0, Address(&rect));
+  EXPECT_EQ(rect.bottom, 90);
+}
+
+TEST(MessagePayloadTest, WritesBackMinMaxInfo) {
+  win32::MinMaxInfo info = {{7, 7}, {1920, 1080}, {0, 0}, {100, 100},
+                            {4000, 4000}};
+  MessagePayload payload = {};
+  DecodePayload(kGetMinMaxInfo, 0, Address(&info), &payload);
+  ASSERT_EQ(payload.kind, PayloadKind::kGetMinMaxInfo);
+  EXPECT_EQ(payload.minMaxInfo.maxSize.x, 1920);
+  payload.minMaxInfo.minTrackSize = {400, 300};
+  EncodePayload(payload, 0, Address(&info));
+  EXPECT_EQ(info.ptMinTrackSize.x, 400);
+  EXPECT_EQ(info.ptMinTrackSize.y, 300);
+  EXPECT_EQ(info.ptReserved.x, 7);
+}
+
+TEST(MessagePayloadTest, DecodesDpiChanged) {
+  win32::Rect suggested = {10, 20, 810, 620};
+  MessagePayload payload = {};
+  DecodePayload(kDpiChanged, (144u << 16) | 120u, Address(&suggested),
+                &payload);
+  ASSERT_EQ(payload.kind, PayloadKind::kDpiChanged);
+  EXPECT_EQ(payload.dpiChanged.dpiX, 120u);
+  EXPECT_EQ(payload.dpiChanged.dpiY, 144u);
+  EXPECT_EQ(payload.dpiChanged.suggested.right, 810);
+}
+
+TEST(MessagePayloadTest, MeasuresSettingChangeArea) {
+  const char16_t area[] = u"ImmersiveColorSet";
+  MessagePayload payload = {};
+  DecodePayload(kSettingChange, 0x2F, Address(area), &payload);
+  ASSERT_EQ(payload.kind, PayloadKind::kSettingChange);
+  EXPECT_EQ(payload.settingChange.action, 0x2Fu);
+  EXPECT_EQ(payload.settingChange.area, Address(area));
+  EXPECT_EQ(payload.settingChange.areaLength, 17);
+
+  DecodePayload(kSettingChange, 0x2F, 0, &payload);
+  ASSERT_EQ(payload.kind, PayloadKind::kSettingChange);
+  EXPECT_EQ(payload.settingChange.areaLength, -1);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,118 @@
+#include "../core/message_trace.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "../core/dispatcher.h"
+#include "fake_dart_api.h"
+#include "fake_window_proc_registrar.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kNcHitTest = 0x0084;
+constexpr uint32_t kMouseMove = 0x0200;
+// An application-defined message beyond the 16-bit range.
+constexpr uint32_t kAppMessage = 0x12345;
+
+void HandleHitTests(WindowsMessage* message) {
+  if (message->message == kNcHitTest) {
+    message->lResult = 2;
+    message->handled = true;
+  }
+}
+
+class MessageTraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = std::string(::testing::UnitTest::GetInstance()
+                            ->current_test_info()
+                            ->name()) +
+            ".wpdtrace";
+  }
+
+  void TearDown() override { std::remove(path_.c_str()); }
+
+  std::string path_;
+};
+
+TEST_F(MessageTraceTest, WritesAndReadsBackRecords) {
+  auto recorder =
+      TraceRecorder::Start(std::fopen(path_.c_str(), "wb"), 16, 1000);
+  ASSERT_NE(recorder, nullptr);
+  for (uint16_t i = 0; i < 100; i++) {
+    TraceRecord record = {};
+    record.timestamp_ns = i * 10u;
+    record.message = i;
+    record.lparam = -i;
+    record.flags = i % 2 ? kTraceHandled : 0;
+    recorder->Append(record);
+  }
+  const uint64_t written = recorder->Stop();
+  EXPECT_EQ(written + recorder->dropped(), 100u);
+  EXPECT_EQ(recorder->Stop(), written);
+
+  Trace trace;
+  std::string error;
+  ASSERT_TRUE(ReadTrace(path_, &trace, &error)) << error;
+  EXPECT_EQ(trace.header.start_ns, 1000u);
+  EXPECT_EQ(trace.header.dropped, recorder->dropped());
+  ASSERT_EQ(trace.records.size(), written);
+  // Whatever was dropped, records keep their order.
+  for (size_t i = 1; i < trace.records.size(); i++) {
+    EXPECT_GT(trace.records[i].message, trace.records[i - 1].message);
+    EXPECT_EQ(trace.records[i].lparam,
+              -static_cast<int64_t>(trace.records[i].message));
+  }
+}
+
+TEST_F(MessageTraceTest, RejectsFilesThatAreNotTraces) {
+  std::FILE* file = std::fopen(path_.c_str(), "wb");
+  std::fputs("not a trace, but long enough to hold a trace header......", file);
+  std::fclose(file);
+
+  Trace trace;
+  std::string error;
+  EXPECT_FALSE(ReadTrace(path_, &trace, &error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_FALSE(ReadTrace(path_ + ".missing", &trace, &error));
+}
+
+TEST_F(MessageTraceTest, DispatcherTracesOutcomeAndTiming) {
+  testing::InstallFakeDartApi();
+  testing::FakeWindowProcRegistrar registrar;
+  registrar.set_clock(5000, 100);
+  Dispatcher dispatcher(&registrar);
+  dispatcher.SetCallback(&HandleHitTests, testing::FakeIsolate(1));
+
+  EXPECT_EQ(dispatcher.StopTrace(), -1);
+  registrar.Send({1, kMouseMove, 0, 0});
+  dispatcher.StartTrace(TraceRecorder::Start(
+      std::fopen(path_.c_str(), "wb"), 16, dispatcher.NowNanoseconds()));
+  registrar.Send({1, kNcHitTest, 3, 4});
+  registrar.Send({1, kMouseMove, 5, 6});
+  registrar.Send({1, kAppMessage, 7, 8});
+  EXPECT_EQ(dispatcher.StopTrace(), 3);
+  registrar.Send({1, kMouseMove, 0, 0});
+
+  Trace trace;
+  std::string error;
+  ASSERT_TRUE(ReadTrace(path_, &trace, &error)) << error;
+  ASSERT_EQ(trace.records.size(), 3u);
+  EXPECT_EQ(trace.records[0].message, kNcHitTest);
+  EXPECT_EQ(trace.records[0].flags, kTraceHandled);
+  EXPECT_EQ(trace.records[0].lresult, 2);
+  EXPECT_EQ(trace.records[0].wparam, 3u);
+  EXPECT_EQ(trace.records[0].lparam, 4);
+  EXPECT_EQ(trace.records[0].dispatch_ns, 100u);
+  EXPECT_EQ(trace.records[1].message, kMouseMove);
+  EXPECT_EQ(trace.records[1].flags, 0u);
+  EXPECT_GT(trace.records[1].timestamp_ns, trace.records[0].timestamp_ns);
+  // Message identifiers are not truncated to 16 bits.
+  EXPECT_EQ(trace.records[2].message, kAppMessage);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,107 @@
+#include "../core/native_handlers.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kSize = 0x0005;
+constexpr uint32_t kPaint = 0x000F;
+constexpr uint32_t kMouseMove = 0x0200;
+constexpr uint32_t kDpiChanged = 0x02E0;
+
+using Messages = MessageList<kDpiChanged, kSize, kMouseMove>;
+
+static_assert(Messages::kCount == 3);
+static_assert(Messages::kSorted[0] == kSize);
+static_assert(Messages::kSorted[1] == kMouseMove);
+static_assert(Messages::kSorted[2] == kDpiChanged);
+static_assert(Messages::IndexOf(kMouseMove) == 1);
+static_assert(Messages::IndexOf(kPaint) == Messages::kCount);
+static_assert(Messages::Contains(kDpiChanged));
+static_assert(!Messages::Contains(kDpiChanged + 1));
+
+// Replies to WM_SIZE with its wParam and passes everything else on.
+struct SizeHandler {
+  using Messages = MessageList<kSize, kMouseMove>;
+
+  std::optional<int64_t> operator()(const NativeMessage& message) {
+    calls++;
+    if (message.message == kSize) {
+      return static_cast<int64_t>(message.wparam);
+    }
+    return std::nullopt;
+  }
+
+  int calls = 0;
+};
+
+// Appends its tag to |g_calls| and leaves the message unhandled.
+std::vector<int> g_calls;
+
+bool RecordingHandler(void* user_data,
+                      const WindowProcDelegateNativeMessage*,
+                      int64_t*) {
+  g_calls.push_back(static_cast<int>(reinterpret_cast<intptr_t>(user_data)));
+  return false;
+}
+
+void* Tag(intptr_t tag) {
+  return reinterpret_cast<void*>(tag);
+}
+
+void CallAll(const NativeHandlerTable& table, uint32_t message) {
+  const NativeHandlerTable::Handlers handlers = table.Find(message);
+  const NativeMessage native = {1, message, 0, 0};
+  for (size_t i = 0; i < handlers.count; i++) {
+    int64_t result = 0;
+    handlers.handlers[i].function(handlers.handlers[i].user_data, &native,
+                                  &result);
+  }
+}
+
+TEST(NativeHandlersTest, BindsHandlerClasses) {
+  constexpr NativeHandlerBinding binding = BindNativeHandler<SizeHandler>();
+  static_assert(binding.message_count == 2);
+  ASSERT_EQ(binding.messages[0], kSize);
+  ASSERT_EQ(binding.messages[1], kMouseMove);
+
+  SizeHandler handler;
+  const NativeMessage size = {1, kSize, 42, 0};
+  const NativeMessage mouse_move = {1, kMouseMove, 0, 0};
+  int64_t result = 0;
+  EXPECT_TRUE(binding.function(&handler, &size, &result));
+  EXPECT_EQ(result, 42);
+  result = 0;
+  EXPECT_FALSE(binding.function(&handler, &mouse_move, &result));
+  EXPECT_EQ(result, 0);
+  EXPECT_EQ(handler.calls, 2);
+}
+
+TEST(NativeHandlersTest, OrdersHandlersByPriorityThenAddition) {
+  std::vector<NativeHandlerTable::Registration> registrations = {
+      {1, 0, &RecordingHandler, Tag(1), {kSize, kPaint}},
+      {2, 5, &RecordingHandler, Tag(2), {kPaint}},
+      {3, 0, &RecordingHandler, Tag(3), {kPaint, kDpiChanged}},
+      {4, -1, &RecordingHandler, Tag(4), {kPaint}},
+  };
+  auto table = NativeHandlerTable::Build(registrations);
+
+  g_calls.clear();
+  CallAll(*table, kPaint);
+  EXPECT_EQ(g_calls, (std::vector<int>{2, 1, 3, 4}));
+
+  g_calls.clear();
+  CallAll(*table, kSize);
+  CallAll(*table, kDpiChanged);
+  EXPECT_EQ(g_calls, (std::vector<int>{1, 3}));
+
+  EXPECT_TRUE(table->filter().Accepts(kDpiChanged));
+  EXPECT_FALSE(table->filter().Accepts(kMouseMove));
+  EXPECT_EQ(table->Find(kMouseMove).count, 0u);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
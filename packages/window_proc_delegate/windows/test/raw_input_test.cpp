@@ -0,0 +1,203 @@
+#include "../core/raw_input.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "fake_dart_api.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr Dart_Port_DL kWakePort = 41;
+constexpr intptr_t kMouse = 0x100;
+constexpr intptr_t kOtherMouse = 0x200;
+// An 8 kHz mouse reports every 125 us.
+constexpr uint64_t kReportInterval = 125000;
+constexpr uint16_t kLeftButtonDown = 0x0001;  // RI_MOUSE_LEFT_BUTTON_DOWN
+constexpr uint16_t kLeftButtonUp = 0x0002;    // RI_MOUSE_LEFT_BUTTON_UP
+
+// Reports of one device at 8 kHz, starting at |start_ns|.
+class SyntheticMouse {
+ public:
+  SyntheticMouse(intptr_t device, uint64_t start_ns)
+      : device_(device), now_(start_ns) {}
+
+  RawMouseReport Move(int32_t dx, int32_t dy) {
+    return Next(dx, dy, 0, 0);
+  }
+
+  RawMouseReport Buttons(uint16_t button_flags, int16_t button_data = 0) {
+    return Next(0, 0, button_flags, button_data);
+  }
+
+ private:
+  RawMouseReport Next(int32_t dx,
+                      int32_t dy,
+                      uint16_t button_flags,
+                      int16_t button_data) {
+    const RawMouseReport report = {device_, now_, dx, dy, 0, button_flags,
+                                   button_data};
+    now_ += kReportInterval;
+    return report;
+  }
+
+  const intptr_t device_;
+  uint64_t now_;
+};
+
+class RawInputTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testing::InstallFakeDartApi();
+    testing::TakeFakePostedMessages();
+  }
+
+  std::vector<RawMouseRecord> Take(RawInputAccumulator& accumulator) {
+    std::vector<RawMouseRecord> records(accumulator.capacity());
+    records.resize(accumulator.Take(records.data()));
+    return records;
+  }
+};
+
+TEST_F(RawInputTest, MergesEachFrameOfMotionPerDevice) {
+  RawInputAccumulator accumulator(kWakePort, 16);
+  SyntheticMouse mouse(kMouse, 1000);
+  SyntheticMouse other(kOtherMouse, 1050);
+  // One 60 Hz frame of two 8 kHz mice, interleaved.
+  for (int i = 0; i < 133; i++) {
+    accumulator.Add(mouse.Move(1, -2));
+    accumulator.Add(other.Move(-3, i % 2));
+  }
+
+  // A single wake-up, however many reports arrived.
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].port, kWakePort);
+
+  const std::vector<RawMouseRecord> records = Take(accumulator);
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].device, kMouse);
+  EXPECT_EQ(records[0].reports, 133);
+  EXPECT_EQ(records[0].x, 133);
+  EXPECT_EQ(records[0].y, -266);
+  EXPECT_EQ(records[0].first_timestamp_ns, 1000);
+  EXPECT_EQ(records[0].last_timestamp_ns,
+            static_cast<int64_t>(1000 + 132 * kReportInterval));
+  EXPECT_EQ(records[0].flags, 0);
+  EXPECT_EQ(records[1].device, kOtherMouse);
+  EXPECT_EQ(records[1].x, -399);
+  EXPECT_EQ(records[1].y, 66);
+
+  // Taking re-arms the wake-up and starts new records.
+  EXPECT_TRUE(Take(accumulator).empty());
+  accumulator.Add(mouse.Move(5, 5));
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+  ASSERT_EQ(Take(accumulator).size(), 1u);
+}
+
+TEST_F(RawInputTest, KeepsButtonTransitionsInPlace) {
+  RawInputAccumulator accumulator(kWakePort, 16);
+  SyntheticMouse mouse(kMouse, 0);
+  for (int i = 0; i < 10; i++) {
+    accumulator.Add(mouse.Move(2, 0));
+  }
+  accumulator.Add(mouse.Buttons(kLeftButtonDown));
+  for (int i = 0; i < 20; i++) {
+    accumulator.Add(mouse.Move(0, 1));
+  }
+  accumulator.Add(mouse.Buttons(kLeftButtonUp));
+  // Wheel notches are summed, not split on.
+  accumulator.Add(mouse.Buttons(kRawMouseWheel, 120));
+  accumulator.Add(mouse.Buttons(kRawMouseWheel, -240));
+  accumulator.Add(mouse.Buttons(kRawMouseHorizontalWheel, 120));
+
+  const std::vector<RawMouseRecord> records = Take(accumulator);
+  ASSERT_EQ(records.size(), 3u);
+  // The press happened after 20 px of motion, the release after 20 more.
+  EXPECT_EQ(records[0].reports, 11);
+  EXPECT_EQ(records[0].x, 20);
+  EXPECT_EQ(records[0].flags, kLeftButtonDown);
+  EXPECT_EQ(records[1].reports, 21);
+  EXPECT_EQ(records[1].y, 20);
+  EXPECT_EQ(records[1].flags, kLeftButtonUp);
+  EXPECT_EQ(records[2].reports, 3);
+  EXPECT_EQ(records[2].wheel, -120);
+  EXPECT_EQ(records[2].horizontal_wheel, 120);
+  EXPECT_EQ(records[2].flags, 0);
+}
+
+TEST_F(RawInputTest, KeepsLastAbsolutePosition) {
+  RawInputAccumulator accumulator(kWakePort, 16);
+  RawMouseReport report = {kMouse, 10, 4, 4, 0, 0, 0};
+  accumulator.Add(report);
+  report.flags = kRawMouseAbsolute;
+  report.x = 30000;
+  accumulator.Add(report);
+  report.x = 31000;
+  report.y = 500;
+  accumulator.Add(report);
+
+  const std::vector<RawMouseRecord> records = Take(accumulator);
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].x, 4);
+  EXPECT_EQ(records[0].flags, 0);
+  EXPECT_EQ(records[1].reports, 2);
+  EXPECT_EQ(records[1].x, 31000);
+  EXPECT_EQ(records[1].y, 500);
+  EXPECT_EQ(records[1].flags, kRawMouseRecordAbsolute);
+}
+
+TEST_F(RawInputTest, DropsReportsWhenFull) {
+  RawInputAccumulator accumulator(kWakePort, 2);
+  SyntheticMouse mouse(kMouse, 0);
+  for (int i = 0; i < 4; i++) {
+    accumulator.Add(mouse.Buttons(i % 2 ? kLeftButtonUp : kLeftButtonDown));
+  }
+  EXPECT_EQ(accumulator.dropped(), 2u);
+  const std::vector<RawMouseRecord> records = Take(accumulator);
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[1].flags, kLeftButtonUp);
+}
+
+TEST(RawInputStressTest, ConservesReportsAcrossConcurrentTakes) {
+  testing::InstallFakeDartApi();
+  constexpr int kReports = 200000;
+  RawInputAccumulator accumulator(kWakePort, 64);
+  std::atomic<bool> done{false};
+
+  std::thread window([&] {
+    SyntheticMouse mouse(kMouse, 0);
+    for (int i = 0; i < kReports; i++) {
+      accumulator.Add(i % 1000 == 999 ? mouse.Buttons(kLeftButtonDown)
+                                      : mouse.Move(1, 0));
+    }
+    done = true;
+  });
+
+  std::vector<RawMouseRecord> records(accumulator.capacity());
+  int64_t reports = 0;
+  int64_t x = 0;
+  int64_t last_timestamp = -1;
+  bool finished = false;
+  while (!finished) {
+    finished = done.load();
+    const size_t count = accumulator.Take(records.data());
+    for (size_t i = 0; i < count; i++) {
+      reports += records[i].reports;
+      x += records[i].x;
+      EXPECT_GT(records[i].first_timestamp_ns, last_timestamp);
+      last_timestamp = records[i].last_timestamp_ns;
+    }
+  }
+  window.join();
+  testing::TakeFakePostedMessages();
+
+  EXPECT_EQ(reports + static_cast<int64_t>(accumulator.dropped()), kReports);
+  EXPECT_LE(x, kReports - kReports / 1000);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
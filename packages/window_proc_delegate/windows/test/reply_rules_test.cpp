@@ -0,0 +1,158 @@
+#include "../core/reply_rules.h"
+
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kEraseBackground = 0x0014;
+constexpr uint32_t kGetMinMaxInfo = 0x0024;
+constexpr uint32_t kSysCommand = 0x0112;
+constexpr uint64_t kScKeyMenu = 0xF100;
+constexpr uint64_t kScClose = 0xF060;
+
+using Kind = ReplyDecision::Kind;
+
+// Appends a rule to |program|. |writes| holds (offset, value) pairs.
+void AddRule(std::vector<int64_t>* program, uint32_t message,
+             ReplyAction action, int64_t result, int64_t hwnd = 0,
+             uint64_t wparam_mask = 0, uint64_t wparam_value = 0,
+             std::initializer_list<std::pair<int32_t, int32_t>> writes = {}) {
+  program->insert(program->end(),
+                  {static_cast<int64_t>(message), hwnd,
+                   static_cast<int64_t>(wparam_mask),
+                   static_cast<int64_t>(wparam_value), 0, 0,
+                   static_cast<int64_t>(action), result,
+                   static_cast<int64_t>(writes.size())});
+  for (const auto& write : writes) {
+    program->push_back(write.first);
+    program->push_back(write.second);
+  }
+}
+
+std::unique_ptr<ReplyRuleTable> Compile(const std::vector<int64_t>& program) {
+  return ReplyRuleTable::Compile(program.data(), program.size());
+}
+
+TEST(ReplyRulesTest, EmptyProgramMatchesNothing) {
+  auto table = Compile({});
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table->rule_count(), 0u);
+  EXPECT_EQ(table->Evaluate(1, kEraseBackground, 0, 0).kind, Kind::kNoMatch);
+}
+
+TEST(ReplyRulesTest, RepliesWithConstant) {
+  std::vector<int64_t> program;
+  AddRule(&program, kEraseBackground, ReplyAction::kReply, 1);
+  auto table = Compile(program);
+  ASSERT_NE(table, nullptr);
+
+  const ReplyDecision decision = table->Evaluate(1, kEraseBackground, 0, 0);
+  EXPECT_EQ(decision.kind, Kind::kReply);
+  EXPECT_EQ(decision.result, 1);
+  EXPECT_EQ(table->Evaluate(1, kSysCommand, 0, 0).kind, Kind::kNoMatch);
+}
+
+TEST(ReplyRulesTest, MatchesMaskedWParam) {
+  std::vector<int64_t> program;
+  // The low four bits of SC_* values are used internally by the system.
+  AddRule(&program, kSysCommand, ReplyAction::kReply, 0, 0, 0xFFF0,
+          kScKeyMenu);
+  auto table = Compile(program);
+  ASSERT_NE(table, nullptr);
+
+  EXPECT_EQ(table->Evaluate(1, kSysCommand, kScKeyMenu | 0x3, 0).kind,
+            Kind::kReply);
+  EXPECT_EQ(table->Evaluate(1, kSysCommand, kScClose, 0).kind,
+            Kind::kNoMatch);
+}
+
+TEST(ReplyRulesTest, FirstDeclaredRuleWinsPerMessage) {
+  std::vector<int64_t> program;
+  AddRule(&program, kSysCommand, ReplyAction::kForward, 0, 0, 0xFFF0,
+          kScClose);
+  AddRule(&program, kEraseBackground, ReplyAction::kReply, 1);
+  AddRule(&program, kSysCommand, ReplyAction::kReply, 0);
+  auto table = Compile(program);
+  ASSERT_NE(table, nullptr);
+
+  EXPECT_EQ(table->Evaluate(1, kSysCommand, kScClose, 0).kind,
+            Kind::kForward);
+  EXPECT_EQ(table->Evaluate(1, kSysCommand, kScKeyMenu, 0).kind,
+            Kind::kReply);
+  EXPECT_EQ(table->Evaluate(1, kEraseBackground, 0, 0).kind, Kind::kReply);
+}
+
+TEST(ReplyRulesTest, MatchesWindowHandle) {
+  std::vector<int64_t> program;
+  AddRule(&program, kEraseBackground, ReplyAction::kReply, 1, 0x100);
+  auto table = Compile(program);
+  ASSERT_NE(table, nullptr);
+
+  EXPECT_EQ(table->Evaluate(0x100, kEraseBackground, 0, 0).kind,
+            Kind::kReply);
+  EXPECT_EQ(table->Evaluate(0x200, kEraseBackground, 0, 0).kind,
+            Kind::kNoMatch);
+}
+
+TEST(ReplyRulesTest, WritesFieldsIntoLParamStruct) {
+  // MINMAXINFO: ptReserved, ptMaxSize, ptMaxPosition, ptMinTrackSize,
+  // ptMaxTrackSize, each two int32 values.
+  int32_t min_max_info[10] = {};
+  std::vector<int64_t> program;
+  AddRule(&program, kGetMinMaxInfo, ReplyAction::kWriteAndReply, 0, 0, 0, 0,
+          {{24, 640}, {28, 480}});
+  auto table = Compile(program);
+  ASSERT_NE(table, nullptr);
+
+  const ReplyDecision decision = table->Evaluate(
+      1, kGetMinMaxInfo, 0, reinterpret_cast<uintptr_t>(min_max_info));
+  EXPECT_EQ(decision.kind, Kind::kReply);
+  EXPECT_EQ(min_max_info[6], 640);
+  EXPECT_EQ(min_max_info[7], 480);
+  EXPECT_EQ(min_max_info[8], 0);
+}
+
+TEST(ReplyRulesTest, ForwardsWriteRuleWithoutLParam) {
+  std::vector<int64_t> program;
+  AddRule(&program, kGetMinMaxInfo, ReplyAction::kWriteAndReply, 0, 0, 0, 0,
+          {{24, 640}});
+  auto table = Compile(program);
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table->Evaluate(1, kGetMinMaxInfo, 0, 0).kind, Kind::kForward);
+}
+
+TEST(ReplyRulesTest, RejectsMalformedPrograms) {
+  std::vector<int64_t> truncated;
+  AddRule(&truncated, kEraseBackground, ReplyAction::kReply, 1);
+  truncated.pop_back();
+  EXPECT_EQ(Compile(truncated), nullptr);
+
+  std::vector<int64_t> unknown_action;
+  AddRule(&unknown_action, kEraseBackground, static_cast<ReplyAction>(7), 1);
+  EXPECT_EQ(Compile(unknown_action), nullptr);
+
+  std::vector<int64_t> large_message;
+  AddRule(&large_message, 0x10000, ReplyAction::kReply, 1);
+  EXPECT_EQ(Compile(large_message), nullptr);
+
+  std::vector<int64_t> missing_writes;
+  AddRule(&missing_writes, kGetMinMaxInfo, ReplyAction::kWriteAndReply, 0, 0,
+          0, 0, {{24, 640}});
+  missing_writes.pop_back();
+  EXPECT_EQ(Compile(missing_writes), nullptr);
+
+  for (int32_t offset :
+       {int32_t{-4},
+        static_cast<int32_t>(ReplyRuleTable::kMaxWriteExtent - 2)}) {
+    std::vector<int64_t> out_of_range;
+    AddRule(&out_of_range, kGetMinMaxInfo, ReplyAction::kWriteAndReply, 0, 0,
+            0, 0, {{offset, 1}});
+    EXPECT_EQ(Compile(out_of_range), nullptr) << offset;
+  }
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
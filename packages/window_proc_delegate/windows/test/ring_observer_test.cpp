@@ -0,0 +1,56 @@
+#include "../core/ring_observer.h"
+
+#include <gtest/gtest.h>
+
+#include "fake_dart_api.h"
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr Dart_Port_DL kWakePort = 42;
+
+class RingObserverTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    testing::InstallFakeDartApi();
+    testing::TakeFakePostedMessages();
+  }
+
+  RingObserver observer_{7, kWakePort, MessageFilter::AcceptAll(), 8,
+                         RingDropPolicy::kDropNewest};
+};
+
+TEST_F(RingObserverTest, PostsOneWakeUpUntilDrained) {
+  observer_.Add(ObservedMessage{1, 2, 3, 4, 1});
+  observer_.Add(ObservedMessage{1, 2, 3, 4, 1});
+
+  auto posted = testing::TakeFakePostedMessages();
+  ASSERT_EQ(posted.size(), 1u);
+  EXPECT_EQ(posted[0].port, kWakePort);
+  EXPECT_EQ(posted[0].integer, 7);
+
+  ObservedMessage out[8];
+  EXPECT_EQ(observer_.ring().Pop(out, 8), 2u);
+  EXPECT_FALSE(observer_.FinishDrain());
+
+  observer_.Add(ObservedMessage{1, 2, 3, 4, 1});
+  EXPECT_EQ(testing::TakeFakePostedMessages().size(), 1u);
+}
+
+TEST_F(RingObserverTest, FinishDrainReportsRecordsMissedByWakeUp) {
+  observer_.Add(ObservedMessage{1, 2, 3, 4, 1});
+  testing::TakeFakePostedMessages();
+
+  ObservedMessage out[8];
+  observer_.ring().Pop(out, 8);
+  // Arrives after the drain but before the wake-up is re-armed.
+  observer_.Add(ObservedMessage{5, 6, 7, 8, 1});
+  EXPECT_TRUE(testing::TakeFakePostedMessages().empty());
+
+  EXPECT_TRUE(observer_.FinishDrain());
+  ASSERT_EQ(observer_.ring().Pop(out, 8), 1u);
+  EXPECT_EQ(out[0].windowHandle, 5);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,133 @@
+#include "../core/seqlock.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+// Every word is derived from the first, so a value assembled from two
+// different writes is detectable.
+struct TestValue {
+  uint64_t version;
+  uint64_t check[4];
+};
+
+TestValue MakeValue(uint64_t version) {
+  return TestValue{
+      version,
+      {version * 3 + 1, ~version, version ^ 0x5555, version << 7}};
+}
+
+bool IsIntact(const TestValue& value) {
+  const TestValue expected = MakeValue(value.version);
+  for (int i = 0; i < 4; i++) {
+    if (value.check[i] != expected.check[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+using TestLock = SeqLock<TestValue>;
+
+TEST(SeqLockTest, ReadsLatestWrite) {
+  TestLock lock(MakeValue(1));
+  EXPECT_EQ(lock.sequence(), 0u);
+  EXPECT_EQ(lock.Read().version, 1u);
+
+  lock.Write(MakeValue(2));
+  uint64_t sequence = 0;
+  const TestValue value = lock.Read(&sequence);
+  EXPECT_EQ(value.version, 2u);
+  EXPECT_TRUE(IsIntact(value));
+  EXPECT_EQ(sequence, 2u);
+}
+
+TEST(SeqLockTest, WordsMirrorCounterAndValue) {
+  TestLock lock(MakeValue(7));
+  lock.Write(MakeValue(8));
+  const std::atomic<uint64_t>* words = lock.words();
+  EXPECT_EQ(words[0].load(), 2u);
+  EXPECT_EQ(words[1].load(), 8u);
+  EXPECT_EQ(words[2].load(), MakeValue(8).check[0]);
+}
+
+TEST(SeqLockTest, UnchangedUpdateKeepsCounter) {
+  TestLock lock(MakeValue(1));
+  EXPECT_FALSE(lock.Update([](TestValue* value) { return false; }));
+  EXPECT_EQ(lock.sequence(), 0u);
+
+  EXPECT_TRUE(lock.Update([](TestValue* value) {
+    *value = MakeValue(value->version + 1);
+    return true;
+  }));
+  EXPECT_EQ(lock.sequence(), 2u);
+  EXPECT_EQ(lock.Read().version, 2u);
+}
+
+// Runs two writers and two readers concurrently. Readers must only see
+// intact values, with versions and counters that never go backwards, and
+// no increment may be lost between the writers. Meant to be run under
+// ThreadSanitizer as well (see WINDOW_PROC_DELEGATE_SANITIZER).
+TEST(SeqLockStressTest, ConcurrentWritersAndReaders) {
+  constexpr uint64_t kWritesPerWriter = 100000;
+  TestLock lock(MakeValue(0));
+  std::atomic<int> writers_left{2};
+
+  std::vector<std::thread> writers;
+  for (int w = 0; w < 2; w++) {
+    writers.emplace_back([&] {
+      for (uint64_t i = 0; i < kWritesPerWriter; i++) {
+        lock.Update([](TestValue* value) {
+          *value = MakeValue(value->version + 1);
+          return true;
+        });
+      }
+      writers_left.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  std::atomic<bool> intact{true};
+  std::atomic<bool> ordered{true};
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 2; r++) {
+    readers.emplace_back([&] {
+      uint64_t last_version = 0;
+      uint64_t last_sequence = 0;
+      while (writers_left.load(std::memory_order_acquire) > 0) {
+        uint64_t sequence = 0;
+        TestValue value;
+        if (!lock.TryRead(&value, &sequence)) {
+          continue;
+        }
+        if (!IsIntact(value)) {
+          intact = false;
+        }
+        if (value.version < last_version || sequence < last_sequence ||
+            sequence != value.version * 2) {
+          ordered = false;
+        }
+        last_version = value.version;
+        last_sequence = sequence;
+      }
+    });
+  }
+
+  for (auto& thread : writers) {
+    thread.join();
+  }
+  for (auto& thread : readers) {
+    thread.join();
+  }
+  EXPECT_TRUE(intact);
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(lock.Read().version, 2 * kWritesPerWriter);
+  EXPECT_EQ(lock.sequence(), 4 * kWritesPerWriter);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
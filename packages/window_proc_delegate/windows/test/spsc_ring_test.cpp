@@ -0,0 +1,184 @@
+#include "../core/spsc_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace window_proc_delegate {
+namespace {
+
+// Every word is derived from the sequence number, so a record assembled
+// from two different writes is detectable.
+struct TestRecord {
+  uint64_t sequence;
+  uint64_t check[3];
+};
+
+TestRecord MakeRecord(uint64_t sequence) {
+  return TestRecord{sequence,
+                    {sequence * 3 + 1, ~sequence, sequence ^ 0x5555}};
+}
+
+bool IsIntact(const TestRecord& record) {
+  const TestRecord expected = MakeRecord(record.sequence);
+  return record.check[0] == expected.check[0] &&
+         record.check[1] == expected.check[1] &&
+         record.check[2] == expected.check[2];
+}
+
+using TestRing = SpscRing<TestRecord>;
+
+TEST(SpscRingTest, RoundsCapacityUpToPowerOfTwo) {
+  EXPECT_EQ(TestRing(5, RingDropPolicy::kDropNewest).capacity(), 8u);
+  EXPECT_EQ(TestRing(8, RingDropPolicy::kDropNewest).capacity(), 8u);
+  EXPECT_EQ(TestRing(0, RingDropPolicy::kDropNewest).capacity(), 2u);
+}
+
+TEST(SpscRingTest, PopsInOrder) {
+  TestRing ring(4, RingDropPolicy::kDropNewest);
+  for (uint64_t i = 0; i < 3; i++) {
+    EXPECT_TRUE(ring.Push(MakeRecord(i)));
+  }
+
+  TestRecord out[4];
+  ASSERT_EQ(ring.Pop(out, 4), 3u);
+  for (uint64_t i = 0; i < 3; i++) {
+    EXPECT_EQ(out[i].sequence, i);
+  }
+  EXPECT_EQ(ring.Pop(out, 4), 0u);
+}
+
+TEST(SpscRingTest, IndicesWrapAroundStorage) {
+  TestRing ring(4, RingDropPolicy::kDropNewest);
+  TestRecord out[4];
+  for (uint64_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(ring.Push(MakeRecord(i)));
+    ASSERT_EQ(ring.Pop(out, 4), 1u);
+    EXPECT_EQ(out[0].sequence, i);
+  }
+}
+
+TEST(SpscRingTest, DropNewestRejectsWhenFull) {
+  TestRing ring(4, RingDropPolicy::kDropNewest);
+  for (uint64_t i = 0; i < 6; i++) {
+    EXPECT_EQ(ring.Push(MakeRecord(i)), i < 4);
+  }
+  EXPECT_EQ(ring.dropped_newest(), 2u);
+  EXPECT_EQ(ring.dropped_oldest(), 0u);
+
+  TestRecord out[4];
+  ASSERT_EQ(ring.Pop(out, 4), 4u);
+  EXPECT_EQ(out[0].sequence, 0u);
+  EXPECT_EQ(out[3].sequence, 3u);
+}
+
+TEST(SpscRingTest, DropOldestKeepsLatest) {
+  TestRing ring(4, RingDropPolicy::kDropOldest);
+  for (uint64_t i = 0; i < 6; i++) {
+    EXPECT_TRUE(ring.Push(MakeRecord(i)));
+  }
+  EXPECT_EQ(ring.dropped_oldest(), 2u);
+  EXPECT_EQ(ring.dropped_newest(), 0u);
+
+  TestRecord out[4];
+  ASSERT_EQ(ring.Pop(out, 4), 4u);
+  EXPECT_EQ(out[0].sequence, 2u);
+  EXPECT_EQ(out[3].sequence, 5u);
+}
+
+TEST(SpscRingTest, EndReadReportsRecordsOverwrittenDuringRead) {
+  TestRing ring(4, RingDropPolicy::kDropOldest);
+  for (uint64_t i = 0; i < 4; i++) {
+    ring.Push(MakeRecord(i));
+  }
+
+  const TestRing::ReadRange range = ring.BeginRead();
+  ASSERT_EQ(range.end - range.begin, 4u);
+  // The producer laps the reader twice before it finishes.
+  ring.Push(MakeRecord(4));
+  ring.Push(MakeRecord(5));
+
+  EXPECT_EQ(ring.EndRead(range.begin, 4), 2u);
+  TestRecord out[4];
+  ASSERT_EQ(ring.Pop(out, 4), 2u);
+  EXPECT_EQ(out[0].sequence, 4u);
+  EXPECT_EQ(out[1].sequence, 5u);
+}
+
+TEST(SpscRingTest, CountsEachRecordOnceWhenDroppedDuringRead) {
+  TestRing ring(4, RingDropPolicy::kDropOldest);
+  for (uint64_t i = 0; i < 4; i++) {
+    ring.Push(MakeRecord(i));
+  }
+
+  // The reader copies the first two records, then the producer drops the
+  // oldest one before the reader marks them consumed.
+  const TestRing::ReadRange range = ring.BeginRead();
+  EXPECT_EQ(ring.Read(range.begin).sequence, 0u);
+  EXPECT_EQ(ring.Read(range.begin + 1).sequence, 1u);
+  ring.Push(MakeRecord(4));
+  const uint64_t overwritten = ring.EndRead(range.begin, 2);
+  EXPECT_EQ(overwritten, 1u);
+
+  TestRecord out[4];
+  const size_t popped = ring.Pop(out, 4);
+  ASSERT_EQ(popped, 3u);
+  EXPECT_EQ(out[0].sequence, 2u);
+  EXPECT_EQ(out[2].sequence, 4u);
+  // Each of the five records is either consumed or dropped, never both.
+  EXPECT_EQ((2 - overwritten) + popped + ring.dropped_oldest(), 5u);
+}
+
+// Runs a producer and a consumer concurrently and checks that the consumer
+// sees an increasing sequence of intact records, and that every record is
+// either consumed or counted as dropped. Meant to be run under
+// ThreadSanitizer as well (see WINDOW_PROC_DELEGATE_SANITIZER).
+void RunStress(RingDropPolicy policy) {
+  constexpr uint64_t kRecords = 200000;
+  TestRing ring(64, policy);
+  std::atomic<bool> done{false};
+
+  std::thread producer([&] {
+    for (uint64_t i = 0; i < kRecords; i++) {
+      ring.Push(MakeRecord(i));
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint64_t consumed = 0;
+  uint64_t next_min = 0;
+  bool intact = true;
+  bool ordered = true;
+  TestRecord out[16];
+  while (true) {
+    const bool finished = done.load(std::memory_order_acquire);
+    const size_t count = ring.Pop(out, 16);
+    for (size_t i = 0; i < count; i++) {
+      intact &= IsIntact(out[i]);
+      ordered &= out[i].sequence >= next_min;
+      next_min = out[i].sequence + 1;
+    }
+    consumed += count;
+    if (finished && count == 0) {
+      break;
+    }
+  }
+  producer.join();
+
+  EXPECT_TRUE(intact);
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(consumed + ring.dropped_newest() + ring.dropped_oldest(),
+            kRecords);
+}
+
+TEST(SpscRingStressTest, DropNewest) {
+  RunStress(RingDropPolicy::kDropNewest);
+}
+
+TEST(SpscRingStressTest, DropOldest) {
+  RunStress(RingDropPolicy::kDropOldest);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
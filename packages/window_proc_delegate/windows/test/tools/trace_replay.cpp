@@ -0,0 +1,212 @@
+// Replays a binary message trace recorded by the plugin through the
+// portable Dispatcher and reports per-message latency distributions, next to
+// the ones recorded in the field.
+//
+//   trace_replay <trace> [--speed=max|recorded] [--busy]
+//   trace_replay --synthetic=<messages>
+//
+// --speed=recorded reproduces the recorded message timing; the default
+// replays as fast as possible. The stand-in Dart callback answers each
+// message the way it was answered when recorded; with --busy it also spins
+// for the recorded handling time. --synthetic records a window-drag storm
+// to a temporary trace first, then replays it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../core/dispatcher.h"
+#include "../../core/latency_histogram.h"
+#include "../../core/message_trace.h"
+#include "../fake_dart_api.h"
+#include "../fake_window_proc_registrar.h"
+
+namespace window_proc_delegate {
+namespace {
+
+uint64_t SteadyNanoseconds() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+// FakeWindowProcRegistrar on the real clock.
+class ReplayRegistrar : public testing::FakeWindowProcRegistrar {
+ public:
+  uint64_t NowNanoseconds() override { return SteadyNanoseconds(); }
+};
+
+// The record being replayed, for the stand-in Dart callback.
+const TraceRecord* g_current = nullptr;
+bool g_busy = false;
+
+void ReplayCallback(WindowsMessage* message) {
+  if (g_busy) {
+    const uint64_t until = SteadyNanoseconds() + g_current->dispatch_ns;
+    while (SteadyNanoseconds() < until) {
+    }
+  }
+  message->handled = (g_current->flags & kTraceHandled) != 0;
+  message->lResult = g_current->lresult;
+}
+
+// Records a synthetic drag: bursts of WM_NCHITTEST, WM_SETCURSOR,
+// WM_MOUSEMOVE and WM_MOVING at 1 kHz, with occasional paints.
+bool RecordSynthetic(const std::string& path, int64_t messages) {
+  auto recorder = TraceRecorder::Start(std::fopen(path.c_str(), "wb"),
+                                       TraceRecorder::kDefaultCapacity, 0);
+  if (!recorder) {
+    return false;
+  }
+  const uint16_t kinds[] = {0x0084, 0x0020, 0x0200, 0x0216, 0x000F};
+  for (int64_t i = 0; i < messages; i++) {
+    TraceRecord record = {};
+    record.timestamp_ns = static_cast<uint64_t>(i) * 250000;
+    record.window = 0x1234;
+    record.message = kinds[i % 4 == 3 && i % 64 == 3 ? 4 : i % 4];
+    record.lparam = ((i % 800) << 16) | (i % 600);
+    record.flags = record.message == 0x0084 ? kTraceHandled : 0;
+    record.lresult = record.message == 0x0084 ? 2 : 0;
+    record.dispatch_ns = static_cast<uint32_t>(2000 + (i * 7919) % 50000);
+    recorder->Append(record);
+    if (i % 4096 == 4095) {
+      // Give the writer a chance, like the gaps between real bursts.
+      std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    }
+  }
+  const uint64_t written = recorder->Stop();
+  std::printf("recorded %llu synthetic messages (%llu dropped)\n",
+              static_cast<unsigned long long>(written),
+              static_cast<unsigned long long>(recorder->dropped()));
+  return written > 0;
+}
+
+void PrintTable(const LatencyTable& recorded, const LatencyTable& replayed) {
+  std::vector<LatencySummary> recorded_rows(
+      recorded.Snapshot(nullptr, 0));
+  recorded.Snapshot(recorded_rows.data(), recorded_rows.size());
+  std::vector<LatencySummary> replayed_rows(replayed.Snapshot(nullptr, 0));
+  replayed.Snapshot(replayed_rows.data(), replayed_rows.size());
+
+  std::printf("%-8s %10s | %-30s | %-30s\n", "message", "count",
+              "recorded p50 / p99 / max (ns)", "replayed p50 / p99 / max (ns)");
+  for (const LatencySummary& row : recorded_rows) {
+    auto replay = std::find_if(
+        replayed_rows.begin(), replayed_rows.end(),
+        [&row](const LatencySummary& r) { return r.message == row.message; });
+    LatencySummary replayed_row = {};
+    if (replay != replayed_rows.end()) {
+      replayed_row = *replay;
+    }
+    std::printf("0x%04llx %10lld | %8lld %10lld %10lld | %8lld %10lld %10lld\n",
+                static_cast<unsigned long long>(row.message),
+                static_cast<long long>(row.count),
+                static_cast<long long>(row.p50),
+                static_cast<long long>(row.p99),
+                static_cast<long long>(row.max),
+                static_cast<long long>(replayed_row.p50),
+                static_cast<long long>(replayed_row.p99),
+                static_cast<long long>(replayed_row.max));
+  }
+}
+
+int Replay(const std::string& path, bool recorded_speed) {
+  Trace trace;
+  std::string error;
+  if (!ReadTrace(path, &trace, &error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  std::printf("%s: %zu records, %llu dropped while recording\n", path.c_str(),
+              trace.records.size(),
+              static_cast<unsigned long long>(trace.header.dropped));
+  if (trace.records.empty()) {
+    return 0;
+  }
+
+  testing::InstallFakeDartApi();
+  Dart_EnterIsolate_DL(testing::FakeIsolate(0));
+  ReplayRegistrar registrar;
+  Dispatcher dispatcher(&registrar);
+  dispatcher.SetCallback(&ReplayCallback, testing::FakeIsolate(0));
+
+  LatencyTable recorded;
+  LatencyTable replayed;
+  const uint64_t origin = trace.records.front().timestamp_ns;
+  const uint64_t start = SteadyNanoseconds();
+  for (const TraceRecord& record : trace.records) {
+    if (recorded_speed) {
+      const uint64_t due = start + (record.timestamp_ns - origin);
+      while (SteadyNanoseconds() < due) {
+      }
+    }
+    g_current = &record;
+    const uint64_t before = SteadyNanoseconds();
+    registrar.Send({record.window, record.message, record.wparam,
+                    record.lparam});
+    const uint64_t after = SteadyNanoseconds();
+    registrar.PumpFlushes();
+    recorded.Record(record.message, record.dispatch_ns);
+    replayed.Record(record.message, after - before);
+  }
+  const double seconds =
+      static_cast<double>(SteadyNanoseconds() - start) / 1e9;
+  std::printf("replayed in %.3f s (%.0f msg/s)\n", seconds,
+              static_cast<double>(trace.records.size()) / seconds);
+  PrintTable(recorded, replayed);
+  return 0;
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
+
+int main(int argc, char** argv) {
+  using namespace window_proc_delegate;
+  std::string path;
+  bool recorded_speed = false;
+  int64_t synthetic = 0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--speed=recorded") == 0) {
+      recorded_speed = true;
+    } else if (std::strcmp(argv[i], "--speed=max") == 0) {
+      recorded_speed = false;
+    } else if (std::strcmp(argv[i], "--busy") == 0) {
+      g_busy = true;
+    } else if (std::strncmp(argv[i], "--synthetic=", 12) == 0) {
+      synthetic = std::atoll(argv[i] + 12);
+    } else if (argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      std::fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  if (synthetic > 0) {
+    std::error_code error;
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path(error);
+    path = (directory / "trace_replay_synthetic.wpdtrace").string();
+    if (!RecordSynthetic(path, synthetic)) {
+      std::fprintf(stderr, "cannot record %s\n", path.c_str());
+      return 1;
+    }
+    const int result = Replay(path, recorded_speed);
+    std::filesystem::remove(path, error);
+    return result;
+  }
+  if (path.empty()) {
+    std::fprintf(stderr,
+                 "usage: trace_replay <trace> [--speed=max|recorded] "
+                 "[--busy]\n       trace_replay --synthetic=<messages>\n");
+    return 2;
+  }
+  return Replay(path, recorded_speed);
+}
@@ -0,0 +1,66 @@
+#include "../core/window_state.h"
+
+#include <gtest/gtest.h>
+
+namespace window_proc_delegate {
+namespace {
+
+constexpr uint32_t kMove = 0x0003;
+constexpr uint32_t kSize = 0x0005;
+constexpr uint32_t kActivate = 0x0006;
+constexpr uint32_t kDpiChanged = 0x02E0;
+
+int64_t MakeLParam(int32_t low, int32_t high) {
+  return static_cast<int64_t>(static_cast<uint32_t>(
+      (static_cast<uint32_t>(high) & 0xFFFF) << 16 |
+      (static_cast<uint32_t>(low) & 0xFFFF)));
+}
+
+TEST(WindowStateTest, TracksMoveWithSignedCoordinates) {
+  WindowState state = {};
+  EXPECT_TRUE(
+      ApplyWindowStateMessage({1, kMove, 0, MakeLParam(-1200, 40)}, &state));
+  EXPECT_EQ(state.x, -1200);
+  EXPECT_EQ(state.y, 40);
+}
+
+TEST(WindowStateTest, KeepsSizeWhileMinimized) {
+  WindowState state = {};
+  ApplyWindowStateMessage({1, kSize, 0, MakeLParam(800, 600)}, &state);
+  EXPECT_EQ(state.width, 800);
+  EXPECT_EQ(state.height, 600);
+  EXPECT_EQ(state.flags, 0);
+
+  ApplyWindowStateMessage({1, kSize, 1, 0}, &state);  // SIZE_MINIMIZED
+  EXPECT_EQ(state.flags, kWindowMinimized);
+  EXPECT_EQ(state.width, 800);
+
+  ApplyWindowStateMessage({1, kSize, 2, MakeLParam(1920, 1040)}, &state);
+  EXPECT_EQ(state.flags, kWindowMaximized);
+  EXPECT_EQ(state.width, 1920);
+  EXPECT_EQ(state.height, 1040);
+}
+
+TEST(WindowStateTest, TracksActivationAndDpi) {
+  WindowState state = {};
+  // WA_CLICKACTIVE, then WA_INACTIVE with the minimized bit.
+  EXPECT_FALSE(ApplyWindowStateMessage({1, kActivate, 2, 0}, &state));
+  EXPECT_EQ(state.flags, kWindowActive);
+  ApplyWindowStateMessage({1, kActivate, 0x10000, 0}, &state);
+  EXPECT_EQ(state.flags, 0);
+
+  EXPECT_TRUE(ApplyWindowStateMessage(
+      {1, kDpiChanged, 144 << 16 | 144, 0x1234}, &state));
+  EXPECT_EQ(state.dpi, 144);
+}
+
+TEST(WindowStateTest, IgnoresOtherMessages) {
+  WindowState state = {};
+  EXPECT_FALSE(IsWindowStateMessage(0x0200));
+  EXPECT_FALSE(ApplyWindowStateMessage({1, 0x0200, 1, 2}, &state));
+  EXPECT_EQ(state.x, 0);
+  EXPECT_EQ(state.flags, 0);
+}
+
+}  // namespace
+}  // namespace window_proc_delegate
@@ -0,0 +1,180 @@
+#include "win32_window_proc_registrar.h"
+
+#include <optional>
+
+#include "core/chord_table.h"
+#include "core/raw_input.h"
+#include "core/window_state.h"
+
+namespace window_proc_delegate {
+
+Win32WindowProcRegistrar::Win32WindowProcRegistrar(
+    flutter::PluginRegistrarWindows* registrar)
+    : registrar_(registrar),
+      flush_message_(
+          RegisterWindowMessage(L"WindowProcDelegate.FlushObservers")) {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  performance_frequency_ = frequency.QuadPart;
+}
+
+Win32WindowProcRegistrar::~Win32WindowProcRegistrar() {
+  SetHandler(nullptr);
+  if (raw_mouse_input_) {
+    SetRawMouseInput(false);
+  }
+}
+
+void Win32WindowProcRegistrar::SetHandler(Handler* handler) {
+  handler_ = handler;
+  if (handler_ && window_proc_delegate_id_ < 0) {
+    window_proc_delegate_id_ = registrar_->RegisterTopLevelWindowProcDelegate(
+        [this](HWND hwnd, UINT message, WPARAM wparam,
+               LPARAM lparam) -> std::optional<LRESULT> {
+          if (message == flush_message_) {
+            handler_->OnFlush();
+            return 0;
+          }
+          auto result = handler_->HandleWindowProc(
+              {reinterpret_cast<intptr_t>(hwnd), message,
+               static_cast<uint64_t>(wparam), static_cast<int64_t>(lparam)});
+          if (!result) {
+            return std::nullopt;
+          }
+          return static_cast<LRESULT>(*result);
+        });
+  } else if (!handler_ && window_proc_delegate_id_ >= 0) {
+    registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_delegate_id_);
+    window_proc_delegate_id_ = -1;
+  }
+}
+
+bool Win32WindowProcRegistrar::PostFlush(intptr_t window) {
+  return PostMessage(reinterpret_cast<HWND>(window), flush_message_, 0, 0) !=
+         0;
+}
+
+void Win32WindowProcRegistrar::ScreenToClient(intptr_t window,
+                                              int32_t* x,
+                                              int32_t* y) {
+  POINT point = {*x, *y};
+  ::ScreenToClient(reinterpret_cast<HWND>(window), &point);
+  *x = point.x;
+  *y = point.y;
+}
+
+uint64_t Win32WindowProcRegistrar::NowNanoseconds() {
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  const int64_t ticks = counter.QuadPart;
+  // Split the conversion so it cannot overflow.
+  return static_cast<uint64_t>(
+      ticks / performance_frequency_ * 1000000000 +
+      ticks % performance_frequency_ * 1000000000 / performance_frequency_);
+}
+
+uint64_t Win32WindowProcRegistrar::PostedNanoseconds() {
+  // GetMessageTime() is on the GetTickCount() clock, with its resolution of
+  // a timer tick. Unsigned arithmetic handles the 49.7-day wraparound.
+  const DWORD age = GetTickCount() - static_cast<DWORD>(GetMessageTime());
+  const uint64_t now = NowNanoseconds();
+  const uint64_t age_ns = static_cast<uint64_t>(age) * 1000000;
+  return now > age_ns ? now - age_ns : 0;
+}
+
+uint32_t Win32WindowProcRegistrar::ModifierState() {
+  // GetKeyState reflects the keyboard as of the message being handled.
+  const auto held = [](int key) { return GetKeyState(key) < 0; };
+  uint32_t modifiers = 0;
+  if (held(VK_SHIFT)) {
+    modifiers |= kChordShift;
+  }
+  if (held(VK_CONTROL)) {
+    modifiers |= kChordControl;
+  }
+  if (held(VK_MENU)) {
+    modifiers |= kChordAlt;
+  }
+  if (held(VK_LWIN) || held(VK_RWIN)) {
+    modifiers |= kChordWin;
+  }
+  return modifiers;
+}
+
+void Win32WindowProcRegistrar::QueryWindowState(intptr_t window,
+                                                WindowState* state) {
+  const HWND hwnd = reinterpret_cast<HWND>(window);
+  RECT client = {};
+  GetClientRect(hwnd, &client);
+  POINT origin = {0, 0};
+  ClientToScreen(hwnd, &origin);
+  state->x = origin.x;
+  state->y = origin.y;
+  // Zero while minimized; the next WM_SIZE restores it.
+  state->width = client.right;
+  state->height = client.bottom;
+  state->dpi = GetDpiForWindow(hwnd);
+  state->flags = 0;
+  // GetActiveWindow() only sees the calling thread's windows.
+  if (GetForegroundWindow() == hwnd) {
+    state->flags |= kWindowActive;
+  }
+  if (IsIconic(hwnd)) {
+    state->flags |= kWindowMinimized;
+  }
+  if (IsZoomed(hwnd)) {
+    state->flags |= kWindowMaximized;
+  }
+  state->monitor = MonitorFromWindow(window);
+}
+
+intptr_t Win32WindowProcRegistrar::MonitorFromWindow(intptr_t window) {
+  return reinterpret_cast<intptr_t>(::MonitorFromWindow(
+      reinterpret_cast<HWND>(window), MONITOR_DEFAULTTONEAREST));
+}
+
+bool Win32WindowProcRegistrar::SetRawMouseInput(bool enabled) {
+  // Raw input is registered per process and device class, so the last
+  // engine to enable it gets the input. Without RIDEV_INPUTSINK, input only
+  // arrives while the window is in the foreground.
+  RAWINPUTDEVICE device = {};
+  device.usUsagePage = 0x01;  // HID_USAGE_PAGE_GENERIC
+  device.usUsage = 0x02;      // HID_USAGE_GENERIC_MOUSE
+  if (enabled) {
+    flutter::FlutterView* view = registrar_->GetView();
+    if (!view) {
+      return false;
+    }
+    device.hwndTarget = GetAncestor(view->GetNativeWindow(), GA_ROOT);
+  } else {
+    device.dwFlags = RIDEV_REMOVE;
+  }
+  if (!RegisterRawInputDevices(&device, 1, sizeof(device))) {
+    return false;
+  }
+  raw_mouse_input_ = enabled;
+  return true;
+}
+
+bool Win32WindowProcRegistrar::ReadRawMouseInput(int64_t lparam,
+                                                 RawMouseReport* report) {
+  // A mouse report fits in a RAWINPUT; larger HID reports fail to read and
+  // are left to the delegates.
+  RAWINPUT input;
+  UINT size = sizeof(input);
+  if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lparam), RID_INPUT, &input,
+                      &size, sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1) ||
+      input.header.dwType != RIM_TYPEMOUSE) {
+    return false;
+  }
+  const RAWMOUSE& mouse = input.data.mouse;
+  report->device = reinterpret_cast<intptr_t>(input.header.hDevice);
+  report->x = mouse.lLastX;
+  report->y = mouse.lLastY;
+  report->flags = mouse.usFlags;
+  report->button_flags = mouse.usButtonFlags;
+  report->button_data = static_cast<int16_t>(mouse.usButtonData);
+  return true;
+}
+
+}  // namespace window_proc_delegate
@@ -0,0 +1,57 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_WIN32_WINDOW_PROC_REGISTRAR_H_
+#define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_WIN32_WINDOW_PROC_REGISTRAR_H_
+
+#include <flutter/plugin_registrar_windows.h>
+#include <windows.h>
+
+#include <cstdint>
+
+#include "core/window_proc_registrar.h"
+
+namespace window_proc_delegate {
+
+// WindowProcRegistrar backed by a Flutter Windows plugin registrar's
+// top-level window procedure delegates.
+class Win32WindowProcRegistrar : public WindowProcRegistrar {
+ public:
+  explicit Win32WindowProcRegistrar(
+      flutter::PluginRegistrarWindows* registrar);
+  ~Win32WindowProcRegistrar() override;
+
+  // Disallow copy and assign.
+  Win32WindowProcRegistrar(const Win32WindowProcRegistrar&) = delete;
+  Win32WindowProcRegistrar& operator=(const Win32WindowProcRegistrar&) =
+      delete;
+
+  // WindowProcRegistrar:
+  void SetHandler(Handler* handler) override;
+  bool PostFlush(intptr_t window) override;
+  void ScreenToClient(intptr_t window, int32_t* x, int32_t* y) override;
+  uint64_t NowNanoseconds() override;
+  uint64_t PostedNanoseconds() override;
+  uint32_t ModifierState() override;
+  void QueryWindowState(intptr_t window, WindowState* state) override;
+  intptr_t MonitorFromWindow(intptr_t window) override;
+  bool SetRawMouseInput(bool enabled) override;
+  bool ReadRawMouseInput(int64_t lparam, RawMouseReport* report) override;
+
+ private:
+  flutter::PluginRegistrarWindows* registrar_;
+  Handler* handler_ = nullptr;
+  int window_proc_delegate_id_ = -1;
+
+  // Private message posted to the window to flush observer batches once per
+  // message pump iteration.
+  UINT flush_message_;
+
+  // Whether this registered the mice for raw input, which is undone on
+  // destruction.
+  bool raw_mouse_input_ = false;
+
+  // QueryPerformanceCounter ticks per second.
+  int64_t performance_frequency_;
+};
+
+}  // namespace window_proc_delegate
+
+#endif  // FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_WIN32_WINDOW_PROC_REGISTRAR_H_
@@ -1,175 +1,526 @@
 #include "window_proc_delegate_plugin.h"
 
+#include "core/copy_data.h"
+#include "core/engine_registry.h"
+#include "core/message_payload.h"
+#include "core/window_state.h"
 #include "dart/dart_api_dl.h"
 #include "include/window_proc_delegate/window_proc_delegate_plugin_c_api.h"
 // This must be included before many other Windows headers.
-#include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
-#include <flutter/standard_method_codec.h>
+#include <flutter_windows.h>
 #include <windows.h>
 
-#include <map>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <memory>
-#include <optional>
-#include <sstream>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace window_proc_delegate {
 
-// static
-void WindowProcDelegatePlugin::RegisterWithRegistrar(
-    flutter::PluginRegistrarWindows* registrar) {
-  auto channel =
-      std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-          registrar->messenger(), "window_proc_delegate",
-          &flutter::StandardMethodCodec::GetInstance());
+// CopyDataObserver and the WindowsMessage view read COPYDATASTRUCT through
+// its portable mirror.
+static_assert(sizeof(CopyDataStruct) == sizeof(COPYDATASTRUCT) &&
+                  offsetof(CopyDataStruct, dwData) ==
+                      offsetof(COPYDATASTRUCT, dwData) &&
+                  offsetof(CopyDataStruct, cbData) ==
+                      offsetof(COPYDATASTRUCT, cbData) &&
+                  offsetof(CopyDataStruct, lpData) ==
+                      offsetof(COPYDATASTRUCT, lpData),
+              "CopyDataStruct must match COPYDATASTRUCT");
+static_assert(kCopyData == WM_COPYDATA, "kCopyData must be WM_COPYDATA");
+
+// The payload schema decodes lParam through portable mirrors of the Win32
+// structs; check every mirrored field and message against windows.h.
+#define CHECK_FIELD(Mirror, Win32, field)                            \
+  static_assert(offsetof(Mirror, field) == offsetof(Win32, field) && \
+                    sizeof(Mirror::field) == sizeof(Win32::field),   \
+                #Win32 "::" #field " must match its mirror");
+#define CHECK_WINDOW_POS_FIELD(field, win32_field, writable) \
+  CHECK_FIELD(win32::WindowPos, WINDOWPOS, win32_field)
+#define CHECK_MIN_MAX_INFO_FIELD(field, win32_field, writable) \
+  CHECK_FIELD(win32::MinMaxInfo, MINMAXINFO, win32_field)
+WINDOW_PROC_DELEGATE_WINDOW_POS_FIELDS(CHECK_WINDOW_POS_FIELD)
+WINDOW_PROC_DELEGATE_MIN_MAX_INFO_FIELDS(CHECK_MIN_MAX_INFO_FIELD)
+CHECK_FIELD(win32::NcCalcSizeParams, NCCALCSIZE_PARAMS, rgrc)
+CHECK_FIELD(win32::NcCalcSizeParams, NCCALCSIZE_PARAMS, lppos)
+CHECK_FIELD(win32::Rect, RECT, left)
+CHECK_FIELD(win32::Rect, RECT, bottom)
+#undef CHECK_MIN_MAX_INFO_FIELD
+#undef CHECK_WINDOW_POS_FIELD
+#undef CHECK_FIELD
+static_assert(sizeof(win32::WindowPos) == sizeof(WINDOWPOS) &&
+                  sizeof(win32::MinMaxInfo) == sizeof(MINMAXINFO) &&
+                  sizeof(win32::NcCalcSizeParams) ==
+                      sizeof(NCCALCSIZE_PARAMS) &&
+                  sizeof(win32::Rect) == sizeof(RECT) &&
+                  sizeof(win32::Point) == sizeof(POINT),
+              "Win32 struct mirrors must match windows.h");
+static_assert(sizeof(char16_t) == sizeof(WCHAR),
+              "Setting names are read as UTF-16");
 
-  auto plugin = std::make_unique<WindowProcDelegatePlugin>(registrar);
+namespace {
+constexpr uint32_t kPayloadMessages[] = {
+#define PAYLOAD_MESSAGE(kind, message, member, writable) message,
+    WINDOW_PROC_DELEGATE_MESSAGE_PAYLOADS(PAYLOAD_MESSAGE)
+#undef PAYLOAD_MESSAGE
+};
+static_assert(kPayloadMessages[0] == WM_WINDOWPOSCHANGING &&
+                  kPayloadMessages[1] == WM_WINDOWPOSCHANGED &&
+                  kPayloadMessages[2] == WM_NCCALCSIZE &&
+                  kPayloadMessages[3] == WM_GETMINMAXINFO &&
+                  kPayloadMessages[4] == WM_DPICHANGED &&
+                  kPayloadMessages[5] == WM_SETTINGCHANGE,
+              "Payload schema messages must match windows.h");
+
+// An engine hands the same registrar to all of its plugins, so the
+// registrar keys the plugin of an engine. Dart names engines by
+// PlatformDispatcher.engineId, which the embedder maps back to the engine.
+intptr_t LocateEngine(int64_t engine_id) {
+  FlutterDesktopEngineRef engine = FlutterDesktopEngineForId(engine_id);
+  if (!engine) {
+    return 0;
+  }
+  return reinterpret_cast<intptr_t>(FlutterDesktopEngineGetPluginRegistrar(
+      engine, "WindowProcDelegatePlugin"));
+}
 
-  channel->SetMethodCallHandler(
-      [plugin_pointer = plugin.get()](const auto& call, auto result) {
-        plugin_pointer->HandleMethodCall(call, std::move(result));
-      });
+}  // namespace
 
-  registrar->AddPlugin(std::move(plugin));
+// static
+void WindowProcDelegatePlugin::RegisterWithRegistrar(
+    flutter::PluginRegistrarWindows* registrar) {
+  registrar->AddPlugin(std::make_unique<WindowProcDelegatePlugin>(registrar));
 }
 
 WindowProcDelegatePlugin::WindowProcDelegatePlugin(
     flutter::PluginRegistrarWindows* registrar)
-    : registrar_(registrar) {
-  window_proc_delegate_id_ = registrar->RegisterTopLevelWindowProcDelegate(
-      [this](HWND hwnd, UINT message, WPARAM wparam,
-             LPARAM lparam) -> std::optional<LRESULT> {
-        auto callback = GetCallback();
-        if (callback) {
-          WindowsMessage msg = {};
-          msg.windowHandle = reinterpret_cast<intptr_t>(hwnd);
-          msg.message = static_cast<int32_t>(message);
-          msg.wParam = static_cast<int64_t>(wparam);
-          msg.lParam = static_cast<int64_t>(lparam);
-          msg.lResult = 0;
-          msg.handled = false;
-
-          callback(&msg);
-
-          if (msg.handled) {
-            return static_cast<LRESULT>(msg.lResult);
-          }
-        }
-        return std::nullopt;
-      });
+    : key_(reinterpret_cast<intptr_t>(registrar->registrar())),
+      window_proc_registrar_(registrar),
+      dispatcher_(&window_proc_registrar_) {
+  // Attached right away, so the first call from Dart can bind the engine
+  // without a method channel round trip.
+  static std::once_flag locator_installed;
+  std::call_once(locator_installed, [] {
+    EngineRegistry::Global().SetEngineLocator(&LocateEngine);
+  });
+  EngineRegistry::Global().Attach(key_, &dispatcher_);
 }
 
 WindowProcDelegatePlugin::~WindowProcDelegatePlugin() {
-  if (engine_id_.has_value()) {
-    UnregisterPlugin(*engine_id_);
+  EngineRegistry::Global().Detach(key_);
+}
+
+}  // namespace window_proc_delegate
+
+namespace {
+window_proc_delegate::EngineRegistry& Registry() {
+  return window_proc_delegate::EngineRegistry::Global();
+}
+
+// Opens |path|, given in UTF-8, for writing.
+std::FILE* OpenForWriting(const char* path) {
+  const int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+  if (length <= 0) {
+    return nullptr;
   }
-  registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_delegate_id_);
-}
-
-void WindowProcDelegatePlugin::HandleMethodCall(
-    const flutter::MethodCall<flutter::EncodableValue>& method_call,
-    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  if (method_call.method_name().compare("setEngineId") == 0) {
-    const auto* arguments = method_call.arguments();
-    auto engine_id = arguments->LongValue();
-    engine_id_ = engine_id;
-    RegisterPlugin(engine_id, this);
-    result->Success();
-  } else {
-    result->NotImplemented();
+  std::wstring wide_path(static_cast<size_t>(length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path, -1, wide_path.data(), length);
+  return _wfopen(wide_path.c_str(), L"wb");
+}
+
+// Looks |name| up in |module| as a function of the type of |function|.
+template <typename Function>
+void Resolve(HMODULE module, const char* name, Function* function) {
+  *function = reinterpret_cast<Function>(
+      reinterpret_cast<void*>(GetProcAddress(module, name)));
+}
+
+// The Dart tools API is not part of the API DL table; look its timeline
+// entry points up in the engine, which exports the Dart API. Returns null
+// if it does not.
+const window_proc_delegate::TimelineApi* ResolveTimelineApi() {
+  static const window_proc_delegate::TimelineApi api = [] {
+    window_proc_delegate::TimelineApi resolved = {};
+    HMODULE engine = GetModuleHandleW(L"flutter_windows.dll");
+    if (engine) {
+      Resolve(engine, "Dart_RecordTimelineEvent", &resolved.record_event);
+      Resolve(engine, "Dart_TimelineGetMicros", &resolved.now_micros);
+    }
+    return resolved;
+  }();
+  return api.record_event && api.now_micros ? &api : nullptr;
+}
+
+std::unique_ptr<window_proc_delegate::MessageFilter> FilterFromRanges(
+    const uint32_t* ranges, int32_t range_count) {
+  return range_count < 0
+             ? window_proc_delegate::MessageFilter::AcceptAll()
+             : window_proc_delegate::MessageFilter::FromRanges(
+                   ranges, static_cast<size_t>(range_count));
+}
+}  // namespace
+
+void WindowProcDelegateSetCallback(int64_t engineId,
+                                   DartWindowProcCallbackC callback) {
+  Registry().SetCallback(engineId, callback, Dart_CurrentIsolate_DL());
+}
+
+bool WindowProcDelegateSetDelegateRoutes(int64_t engineId,
+                                         const uint32_t* program,
+                                         int32_t wordCount) {
+  using window_proc_delegate::DelegateRouteTable;
+  auto routes = DelegateRouteTable::Compile(
+      program, static_cast<size_t>(wordCount > 0 ? wordCount : 0));
+  if (!routes) {
+    return false;
   }
+  return Registry().SetDelegateRoutes(engineId, std::move(routes));
 }
 
-void WindowProcDelegatePlugin::SetCallback(DartWindowProcCallbackC callback,
-                                           Dart_Isolate isolate) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  callback_ = callback;
-  isolate_ = isolate;
+int64_t WindowProcDelegateGetEngineHandle(int64_t engineId) {
+  return Registry().Bind(engineId);
 }
 
-DartWindowProcCallback WindowProcDelegatePlugin::GetCallback() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (!callback_ || !isolate_) {
-    return nullptr;
+int64_t WindowProcDelegateBindEngineOrNotify(int64_t engineId,
+                                             Dart_Port_DL port) {
+  return Registry().BindOrNotify(engineId, port);
+}
+
+int64_t WindowProcDelegateAddObserver(int64_t engineHandle,
+                                      Dart_Port_DL port,
+                                      const uint32_t* ranges,
+                                      int32_t rangeCount,
+                                      const int32_t* policies,
+                                      int32_t policyCount) {
+  using window_proc_delegate::CoalescePolicy;
+  std::vector<std::pair<uint32_t, CoalescePolicy>> coalescing;
+  for (int32_t i = 0; i < policyCount; i++) {
+    const int32_t policy = policies[i * 2 + 1];
+    if (policy == static_cast<int32_t>(CoalescePolicy::kKeepLatest) ||
+        policy == static_cast<int32_t>(CoalescePolicy::kAccumulate)) {
+      coalescing.emplace_back(static_cast<uint32_t>(policies[i * 2]),
+                              static_cast<CoalescePolicy>(policy));
+    }
   }
+  return Registry().AddObserver(
+      engineHandle, port, FilterFromRanges(ranges, rangeCount), coalescing);
+}
+
+int64_t WindowProcDelegateAddCopyDataObserver(int64_t engineHandle,
+                                              Dart_Port_DL port,
+                                              intptr_t windowHandle) {
+  return Registry().AddCopyDataObserver(engineHandle, port, windowHandle);
+}
+
+void WindowProcDelegateRemoveObserver(int64_t engineHandle,
+                                      int64_t observerId) {
+  Registry().RemoveObserver(engineHandle, observerId);
+}
+
+int64_t WindowProcDelegateSubscribeBroadcast(Dart_Port_DL port,
+                                             const uint32_t* ranges,
+                                             int32_t rangeCount) {
+  return Registry().SubscribeBroadcast(port,
+                                       FilterFromRanges(ranges, rangeCount));
+}
+
+void WindowProcDelegateUnsubscribeBroadcast(int64_t subscriptionId) {
+  Registry().UnsubscribeBroadcast(subscriptionId);
+}
+
+void* WindowProcDelegateAddRingObserver(int64_t engineHandle,
+                                        Dart_Port_DL wakePort,
+                                        const uint32_t* ranges,
+                                        int32_t rangeCount,
+                                        int32_t capacity,
+                                        int32_t dropPolicy,
+                                        int64_t* observerId) {
+  using window_proc_delegate::RingDropPolicy;
+  auto* observer = Registry().AddRingObserver(
+      engineHandle, wakePort, FilterFromRanges(ranges, rangeCount),
+      static_cast<size_t>(capacity > 0 ? capacity : 1),
+      dropPolicy == static_cast<int32_t>(RingDropPolicy::kDropOldest)
+          ? RingDropPolicy::kDropOldest
+          : RingDropPolicy::kDropNewest);
+  *observerId = observer ? observer->id() : 0;
+  return observer;
+}
+
+const int64_t* WindowProcDelegateRingRecords(void* ring) {
+  return reinterpret_cast<const int64_t*>(
+      static_cast<window_proc_delegate::RingObserver*>(ring)->ring().words());
+}
+
+int64_t WindowProcDelegateRingCapacity(void* ring) {
+  return static_cast<int64_t>(
+      static_cast<window_proc_delegate::RingObserver*>(ring)
+          ->ring()
+          .capacity());
+}
+
+void WindowProcDelegateRingBeginRead(void* ring, int64_t* range) {
+  const auto read_range = static_cast<window_proc_delegate::RingObserver*>(ring)
+                              ->ring()
+                              .BeginRead();
+  range[0] = static_cast<int64_t>(read_range.begin);
+  range[1] = static_cast<int64_t>(read_range.end);
+}
 
-  return [callback = callback_, isolate = isolate_](WindowsMessage* message) {
-    // Enter the Dart isolate before calling the callback
-    Dart_Isolate previous = Dart_CurrentIsolate_DL();
-    if (previous != isolate) {
-      if (previous) {
-        Dart_ExitIsolate_DL();
-      }
-      Dart_EnterIsolate_DL(isolate);
+int64_t WindowProcDelegateRingEndRead(void* ring,
+                                      int64_t begin,
+                                      int64_t count) {
+  return static_cast<int64_t>(
+      static_cast<window_proc_delegate::RingObserver*>(ring)->ring().EndRead(
+          static_cast<uint64_t>(begin), static_cast<uint64_t>(count)));
+}
+
+bool WindowProcDelegateRingFinishDrain(void* ring) {
+  return static_cast<window_proc_delegate::RingObserver*>(ring)->FinishDrain();
+}
+
+void WindowProcDelegateRingDropCounts(void* ring, int64_t* counts) {
+  const auto& message_ring =
+      static_cast<window_proc_delegate::RingObserver*>(ring)->ring();
+  counts[0] = static_cast<int64_t>(message_ring.dropped_newest());
+  counts[1] = static_cast<int64_t>(message_ring.dropped_oldest());
+}
+
+void* WindowProcDelegateStartRawInput(int64_t engineHandle,
+                                      Dart_Port_DL wakePort,
+                                      int32_t capacity) {
+  return Registry().StartRawInput(
+      engineHandle, wakePort, static_cast<size_t>(capacity > 0 ? capacity : 1));
+}
+
+int32_t WindowProcDelegateTakeRawInput(void* accumulator, int64_t* records) {
+  return static_cast<int32_t>(
+      static_cast<window_proc_delegate::RawInputAccumulator*>(accumulator)
+          ->Take(reinterpret_cast<window_proc_delegate::RawMouseRecord*>(
+              records)));
+}
+
+int64_t WindowProcDelegateRawInputDropped(void* accumulator) {
+  return static_cast<int64_t>(
+      static_cast<const window_proc_delegate::RawInputAccumulator*>(
+          accumulator)
+          ->dropped());
+}
+
+bool WindowProcDelegateStopRawInput(int64_t engineHandle, void* accumulator) {
+  return Registry().StopRawInput(
+      engineHandle,
+      static_cast<window_proc_delegate::RawInputAccumulator*>(accumulator));
+}
+
+bool WindowProcDelegateSetHitTestRegions(int64_t engineHandle,
+                                         intptr_t windowHandle,
+                                         const int32_t* regions,
+                                         int32_t regionCount) {
+  using window_proc_delegate::HitTestIndex;
+  using window_proc_delegate::HitTestRegion;
+  std::shared_ptr<const HitTestIndex> index;
+  if (regionCount > 0) {
+    // Build the index here, on the calling thread, so the window procedure
+    // only ever swaps in a finished one.
+    const auto* packed = reinterpret_cast<const HitTestRegion*>(regions);
+    index = std::make_shared<const HitTestIndex>(
+        std::vector<HitTestRegion>(packed, packed + regionCount));
+  }
+  return Registry().SetHitTestIndex(engineHandle, windowHandle,
+                                    std::move(index));
+}
+
+bool WindowProcDelegateSetReplyRules(int64_t engineHandle,
+                                     const int64_t* program,
+                                     int32_t wordCount) {
+  using window_proc_delegate::ReplyRuleTable;
+  std::unique_ptr<const ReplyRuleTable> rules;
+  if (wordCount > 0) {
+    rules = ReplyRuleTable::Compile(program, static_cast<size_t>(wordCount));
+    if (!rules) {
+      return false;
     }
+  }
+  return Registry().SetReplyRules(engineHandle, std::move(rules));
+}
 
-    callback(message);
-
-    // Restore previous isolate
-    Dart_Isolate current = Dart_CurrentIsolate_DL();
-    if (previous != isolate) {
-      if (current) {
-        Dart_ExitIsolate_DL();
-      }
-      if (previous) {
-        Dart_EnterIsolate_DL(previous);
-      }
+bool WindowProcDelegateSetChords(int64_t engineHandle,
+                                 Dart_Port_DL port,
+                                 const uint32_t* program,
+                                 int32_t wordCount) {
+  using window_proc_delegate::ChordTable;
+  std::unique_ptr<const ChordTable> chords;
+  if (wordCount > 0) {
+    chords = ChordTable::Compile(program, static_cast<size_t>(wordCount));
+    if (!chords) {
+      return false;
     }
-  };
+  }
+  return Registry().SetChords(engineHandle, std::move(chords), port);
 }
 
-// Global state for plugin registration
-namespace {
-std::map<int64_t, WindowProcDelegatePlugin*> g_plugins;
-std::map<int64_t, std::pair<DartWindowProcCallbackC, Dart_Isolate>>
-    g_pending_callbacks;
-std::mutex g_mutex;
-}  // namespace
+const int64_t* WindowProcDelegateWatchWindowState(int64_t engineHandle,
+                                                  intptr_t window) {
+  const window_proc_delegate::WindowStateBlock* block =
+      Registry().WatchWindowState(engineHandle, window);
+  return block ? reinterpret_cast<const int64_t*>(block->words()) : nullptr;
+}
 
-// static
-void WindowProcDelegatePlugin::RegisterPlugin(
-    int64_t engine_id, WindowProcDelegatePlugin* plugin) {
-  std::lock_guard<std::mutex> lock(g_mutex);
-  g_plugins[engine_id] = plugin;
-
-  // Check for pending callbacks
-  auto it = g_pending_callbacks.find(engine_id);
-  if (it != g_pending_callbacks.end()) {
-    plugin->SetCallback(it->second.first, it->second.second);
-    g_pending_callbacks.erase(it);
+int64_t WindowProcDelegateReadWindowState(const int64_t* block,
+                                          int64_t* state) {
+  // The words are the first and only member of the block.
+  static_assert(
+      std::is_standard_layout<window_proc_delegate::WindowStateBlock>::value,
+      "A WindowStateBlock must start with its words");
+  uint64_t sequence;
+  const window_proc_delegate::WindowState value =
+      reinterpret_cast<const window_proc_delegate::WindowStateBlock*>(block)
+          ->Read(&sequence);
+  std::memcpy(state, &value, sizeof(value));
+  return static_cast<int64_t>(sequence);
+}
+
+void* WindowProcDelegateSetLatencyTracking(int64_t engineHandle,
+                                           bool enabled) {
+  return Registry().SetLatencyTracking(engineHandle, enabled);
+}
+
+void WindowProcDelegateRecordDelegateLatency(void* latency,
+                                             int64_t delegateId,
+                                             int32_t message,
+                                             int64_t nanoseconds) {
+  static_cast<window_proc_delegate::DispatchLatency*>(latency)->RecordDelegate(
+      delegateId, static_cast<uint32_t>(message),
+      static_cast<uint64_t>(nanoseconds > 0 ? nanoseconds : 0));
+}
+
+int32_t WindowProcDelegateLatencySnapshot(void* latency,
+                                          int64_t delegateId,
+                                          int64_t* summaries,
+                                          int32_t capacity) {
+  using window_proc_delegate::LatencySummary;
+  const auto* dispatch_latency =
+      static_cast<window_proc_delegate::DispatchLatency*>(latency);
+  const window_proc_delegate::LatencyTable* table =
+      delegateId < 0 ? &dispatch_latency->dispatch()
+                     : dispatch_latency->delegate(delegateId);
+  if (!table) {
+    return 0;
   }
+  return static_cast<int32_t>(
+      table->Snapshot(reinterpret_cast<LatencySummary*>(summaries),
+                      static_cast<size_t>(capacity > 0 ? capacity : 0)));
 }
 
-// static
-void WindowProcDelegatePlugin::UnregisterPlugin(int64_t engine_id) {
-  std::lock_guard<std::mutex> lock(g_mutex);
-  g_plugins.erase(engine_id);
-  g_pending_callbacks.erase(engine_id);
+int32_t WindowProcDelegateStageLatencySnapshot(void* latency,
+                                               int32_t stage,
+                                               int64_t* summaries,
+                                               int32_t capacity) {
+  using window_proc_delegate::LatencyStage;
+  using window_proc_delegate::LatencySummary;
+  if (stage < 0 ||
+      static_cast<size_t>(stage) >= window_proc_delegate::kLatencyStageCount) {
+    return 0;
+  }
+  return static_cast<int32_t>(
+      static_cast<window_proc_delegate::DispatchLatency*>(latency)
+          ->stage(static_cast<LatencyStage>(stage))
+          .Snapshot(reinterpret_cast<LatencySummary*>(summaries),
+                    static_cast<size_t>(capacity > 0 ? capacity : 0)));
 }
 
-// static
-void WindowProcDelegatePlugin::SetCallbackForEngine(
-    int64_t engine_id, DartWindowProcCallbackC callback, Dart_Isolate isolate) {
-  std::lock_guard<std::mutex> lock(g_mutex);
-  if (g_plugins.find(engine_id) != g_plugins.end()) {
-    // Plugin already registered, set callback directly
-    g_plugins[engine_id]->SetCallback(callback, isolate);
-  } else {
-    // Plugin not yet registered, store as pending
-    if (callback) {
-      g_pending_callbacks[engine_id] = std::make_pair(callback, isolate);
-    } else {
-      g_pending_callbacks.erase(engine_id);
+void WindowProcDelegateRecordDelivered(void* latency,
+                                       int32_t message,
+                                       int64_t queuedNs) {
+  static_cast<window_proc_delegate::DispatchLatency*>(latency)
+      ->RecordDelivered(static_cast<uint32_t>(message),
+                        static_cast<uint64_t>(queuedNs > 0 ? queuedNs : 0));
+}
+
+void WindowProcDelegateResetLatency(void* latency) {
+  static_cast<window_proc_delegate::DispatchLatency*>(latency)->Reset();
+}
+
+void WindowProcDelegateResetDelegateLatency(void* latency,
+                                            int64_t delegateId) {
+  static_cast<window_proc_delegate::DispatchLatency*>(latency)->ResetDelegate(
+      delegateId);
+}
+
+void* WindowProcDelegateSetWatchdog(int64_t engineHandle,
+                                    int64_t budgetNs,
+                                    int32_t strikes,
+                                    int32_t window) {
+  if (strikes < 0 || window < 0) {
+    return nullptr;
+  }
+  return Registry().SetWatchdog(
+      engineHandle, static_cast<uint64_t>(budgetNs > 0 ? budgetNs : 0),
+      static_cast<uint32_t>(strikes), static_cast<uint32_t>(window));
+}
+
+bool WindowProcDelegateRecordDelegateTime(void* watchdog,
+                                          int64_t delegateId,
+                                          int32_t message,
+                                          int64_t nanoseconds,
+                                          bool handled) {
+  return static_cast<window_proc_delegate::DelegateWatchdog*>(watchdog)
+      ->Record(delegateId, static_cast<uint32_t>(message),
+               static_cast<uint64_t>(nanoseconds > 0 ? nanoseconds : 0),
+               handled);
+}
+
+int32_t WindowProcDelegateDelegateOffenses(void* watchdog,
+                                           int64_t delegateId,
+                                           int64_t* offenses,
+                                           int32_t capacity) {
+  return static_cast<int32_t>(
+      static_cast<const window_proc_delegate::DelegateWatchdog*>(watchdog)
+          ->Offenses(delegateId,
+                     reinterpret_cast<window_proc_delegate::DelegateOffense*>(
+                         offenses),
+                     static_cast<size_t>(capacity > 0 ? capacity : 0)));
+}
+
+void WindowProcDelegateResetDelegateWatchdog(void* watchdog,
+                                             int64_t delegateId,
+                                             bool exempt) {
+  static_cast<window_proc_delegate::DelegateWatchdog*>(watchdog)
+      ->ResetDelegate(delegateId, exempt);
+}
+
+bool WindowProcDelegateSetTimeline(int64_t engineHandle, bool enabled) {
+  const window_proc_delegate::TimelineApi* api = nullptr;
+  if (enabled) {
+    api = ResolveTimelineApi();
+    if (!api) {
+      return false;
     }
   }
+  return Registry().SetTimeline(engineHandle, api);
 }
 
-}  // namespace window_proc_delegate
+bool WindowProcDelegateStartTrace(int64_t engineHandle,
+                                  const char* path,
+                                  int32_t capacity) {
+  std::FILE* file = OpenForWriting(path);
+  if (!file) {
+    return false;
+  }
+  return Registry().StartTrace(
+      engineHandle, file,
+      capacity > 0 ? static_cast<size_t>(capacity)
+                   : window_proc_delegate::TraceRecorder::kDefaultCapacity);
+}
 
-void WindowProcDelegateSetCallback(int64_t engineId,
-                                   DartWindowProcCallbackC callback) {
-  window_proc_delegate::WindowProcDelegatePlugin::SetCallbackForEngine(
-      engineId, callback, Dart_CurrentIsolate_DL());
+int64_t WindowProcDelegateStopTrace(int64_t engineHandle) {
+  return Registry().StopTrace(engineHandle);
 }
 
 intptr_t WindowProcDelegateInitDartApi(void* data) {
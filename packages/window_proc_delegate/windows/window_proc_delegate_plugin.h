@@ -1,38 +1,247 @@
 #ifndef FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_PLUGIN_H_
 #define FLUTTER_PLUGIN_WINDOW_PROC_DELEGATE_PLUGIN_H_
-#include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
 
+#include <cstdint>
 #include <memory>
-#include <mutex>
-#include <optional>
 
+#include "core/dispatcher.h"
+#include "core/windows_message.h"
 #include "dart/dart_api_dl.h"
 #include "include/window_proc_delegate/window_proc_delegate_plugin_c_api.h"
-
-namespace window_proc_delegate {
-
-struct WindowsMessage {
-  intptr_t windowHandle;
-  int32_t message;
-  int64_t wParam;
-  int64_t lParam;
-  int64_t lResult;
-  bool handled;
-};
-
-}  // namespace window_proc_delegate
+#include "win32_window_proc_registrar.h"
 
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
-typedef void (*DartWindowProcCallbackC)(
-    window_proc_delegate::WindowsMessage* message);
-
+// Installs |callback| for |engineId|, or detaches Dart from its window
+// procedure if |callback| is null. The engine's plugin is bound on the first
+// call naming |engineId|, so the callback is live when this returns.
 FLUTTER_PLUGIN_EXPORT void WindowProcDelegateSetCallback(
     int64_t engineId, DartWindowProcCallbackC callback);
 
+// Replaces the message routes of |engineId| with the DelegateRouteTable
+// program of |wordCount| uint32 words in |program|: only messages some
+// delegate subscribed to are forwarded, each with the IDs of those
+// delegates in call order. Returns false if the program is malformed or
+// |engineId| has no plugin.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateSetDelegateRoutes(
+    int64_t engineId, const uint32_t* program, int32_t wordCount);
+
+// Returns the handle the functions below take to address the plugin of
+// |engineId|, binding it if needed, or 0 if it has no plugin. Handles of an
+// engine that went away are rejected rather than reaching another engine.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateGetEngineHandle(
+    int64_t engineId);
+
+// Like WindowProcDelegateGetEngineHandle, but if |engineId| has no plugin
+// yet, posts 0 to |port| once another plugin attaches; call again then.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateBindEngineOrNotify(
+    int64_t engineId, Dart_Port_DL port);
+
+// Posts batches of the messages within the union of |rangeCount| inclusive
+// [first, last] pairs in |ranges|, or of every message if |rangeCount| is
+// negative, to |port| without blocking the window procedure. |policies|
+// holds |policyCount| (message, CoalescePolicy) pairs. Returns an observer
+// ID, or 0 if |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateAddObserver(
+    int64_t engineHandle, Dart_Port_DL port, const uint32_t* ranges,
+    int32_t rangeCount, const int32_t* policies, int32_t policyCount);
+
+// Posts each WM_COPYDATA payload sent to |windowHandle|, or to any window if
+// it is 0, to |port| as [hwnd, dwData, Uint8List]. The bytes are a pooled
+// native copy that Dart's finalizer releases. Returns an observer ID for
+// WindowProcDelegateRemoveObserver, or 0 if |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateAddCopyDataObserver(
+    int64_t engineHandle, Dart_Port_DL port, intptr_t windowHandle);
+
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateRemoveObserver(
+    int64_t engineHandle, int64_t observerId);
+
+// Posts the messages matching |ranges| that reach the top-level window of
+// any engine using this plugin to |port|, as single ObservedMessage records
+// and once per broadcast however many windows receive it. Returns a
+// subscription ID for WindowProcDelegateUnsubscribeBroadcast.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateSubscribeBroadcast(
+    Dart_Port_DL port, const uint32_t* ranges, int32_t rangeCount);
+
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateUnsubscribeBroadcast(
+    int64_t subscriptionId);
+
+// Like WindowProcDelegateAddObserver, but appends messages to a ring of
+// |capacity| records that Dart drains in place. |dropPolicy| is a
+// RingDropPolicy. Stores the observer ID in |observerId| and returns an
+// opaque ring handle, valid until the observer is removed, or null if
+// |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT void* WindowProcDelegateAddRingObserver(
+    int64_t engineHandle, Dart_Port_DL wakePort, const uint32_t* ranges,
+    int32_t rangeCount, int32_t capacity, int32_t dropPolicy,
+    int64_t* observerId);
+
+// Ring storage, viewed by Dart as capacity * kObservedMessageFields int64
+// words.
+FLUTTER_PLUGIN_EXPORT const int64_t* WindowProcDelegateRingRecords(void* ring);
+
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateRingCapacity(void* ring);
+
+// Stores the readable [begin, end) index range in |range|.
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateRingBeginRead(void* ring,
+                                                           int64_t* range);
+
+// Consumes |count| records from |begin|. Returns how many leading records
+// were overwritten while being read and must be discarded.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateRingEndRead(void* ring,
+                                                            int64_t begin,
+                                                            int64_t count);
+
+// Re-arms the wake-up. Returns true if another drain must be scheduled.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateRingFinishDrain(void* ring);
+
+// Stores the dropped-newest and dropped-oldest counters in |counts|.
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateRingDropCounts(void* ring,
+                                                            int64_t* counts);
+
+// Starts batching the raw input of every mouse for |engineHandle| natively,
+// into up to |capacity| per-device records, and stops passing WM_INPUT mouse
+// reports to Dart. 0 is posted to |wakePort| when a batch is ready to take.
+// Returns an opaque accumulator handle, valid until
+// WindowProcDelegateStopRawInput(), or null if |engineHandle| is not valid,
+// raw input is already started for it, or the mice could not be registered.
+FLUTTER_PLUGIN_EXPORT void* WindowProcDelegateStartRawInput(
+    int64_t engineHandle, Dart_Port_DL wakePort, int32_t capacity);
+
+// Moves the batch to |records|, capacity * kRawMouseRecordFields int64
+// words, and re-arms the wake-up. Returns the number of records.
+FLUTTER_PLUGIN_EXPORT int32_t WindowProcDelegateTakeRawInput(
+    void* accumulator, int64_t* records);
+
+// Number of reports dropped because the batch was full.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateRawInputDropped(
+    void* accumulator);
+
+// Unregisters the mice and releases |accumulator|. Returns false if
+// |engineHandle| is not valid or |accumulator| is not its current one.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateStopRawInput(
+    int64_t engineHandle, void* accumulator);
+
+// Answers WM_NCHITTEST for |windowHandle| natively from |regionCount|
+// regions packed as [left, top, right, bottom, code] int32 values in client
+// coordinates, later regions on top. Points outside every region fall
+// through to the Dart callback. A |regionCount| of 0 removes the regions.
+// Returns false if |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateSetHitTestRegions(
+    int64_t engineHandle, intptr_t windowHandle, const int32_t* regions,
+    int32_t regionCount);
+
+// Replaces the reply rules of |engineHandle| with the ReplyRuleTable program of
+// |wordCount| int64 words in |program|. Rules are evaluated natively before
+// the Dart callback. An empty program removes the rules. Returns false if
+// the program is malformed or |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateSetReplyRules(
+    int64_t engineHandle, const int64_t* program, int32_t wordCount);
+
+// Replaces the keyboard chords of |engineHandle| with the ChordTable
+// program of |wordCount| uint32 words in |program|. Key presses matching a
+// chord are posted to |port| as [chord ID, hwnd, repeat] Int64Lists instead
+// of entering Dart synchronously. An empty program removes the chords.
+// Returns false if the program is malformed or |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateSetChords(
+    int64_t engineHandle, Dart_Port_DL port, const uint32_t* program,
+    int32_t wordCount);
+
+// Starts caching the state of |window|, updated from its messages, and
+// returns the cache block: a sequence counter followed by the WindowState
+// in windows/core/window_state.h. The block stays valid until the engine's
+// plugin is destroyed. Returns null if |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT const int64_t* WindowProcDelegateWatchWindowState(
+    int64_t engineHandle, intptr_t window);
+
+// Copies a consistent WindowState out of |block|, as returned by
+// WindowProcDelegateWatchWindowState, into |state|, which holds 8 values.
+// Returns the block's sequence counter for the copy.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateReadWindowState(
+    const int64_t* block, int64_t* state);
+
+// Switches dispatch latency tracking of |engineHandle| on or off. Returns an
+// opaque handle to its histograms, valid until the engine's plugin is
+// destroyed, or null if |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT void* WindowProcDelegateSetLatencyTracking(
+    int64_t engineHandle, bool enabled);
+
+// Records the time delegate |delegateId| spent handling |message|.
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateRecordDelegateLatency(
+    void* latency, int64_t delegateId, int32_t message, int64_t nanoseconds);
+
+// Writes up to |capacity| LatencySummary records, kLatencySummaryFields
+// int64 values each, for delegate |delegateId|, or for the whole dispatch
+// if |delegateId| is negative. Returns the number of records available,
+// which may exceed |capacity|.
+FLUTTER_PLUGIN_EXPORT int32_t WindowProcDelegateLatencySnapshot(
+    void* latency, int64_t delegateId, int64_t* summaries, int32_t capacity);
+
+// Writes up to |capacity| LatencySummary records for LatencyStage |stage|,
+// as WindowProcDelegateLatencySnapshot does. Returns 0 for an unknown
+// stage.
+FLUTTER_PLUGIN_EXPORT int32_t WindowProcDelegateStageLatencySnapshot(
+    void* latency, int32_t stage, int64_t* summaries, int32_t capacity);
+
+// Records that Dart drained a batch whose QueueStamp named |message|,
+// queued at |queuedNs|.
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateRecordDelivered(
+    void* latency, int32_t message, int64_t queuedNs);
+
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateResetLatency(void* latency);
+
+// Clears the histograms of delegate |delegateId| before its ID is reused.
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateResetDelegateLatency(
+    void* latency, int64_t delegateId);
+
+// Sets the time budget of the delegates of |engineHandle|, or switches the
+// watchdog off if |budgetNs| is 0; a delegate is demoted after |strikes|
+// calls over budget among its last |window|. Returns an opaque handle to
+// the watchdog, valid until the engine's plugin is destroyed, or null if
+// |engineHandle| is not valid or the policy is invalid.
+FLUTTER_PLUGIN_EXPORT void* WindowProcDelegateSetWatchdog(
+    int64_t engineHandle, int64_t budgetNs, int32_t strikes, int32_t window);
+
+// Accounts a call of delegate |delegateId| on |message|. Returns true if
+// the call demoted the delegate.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateRecordDelegateTime(
+    void* watchdog, int64_t delegateId, int32_t message, int64_t nanoseconds,
+    bool handled);
+
+// Writes up to |capacity| DelegateOffense records, kDelegateOffenseFields
+// int64 values each, for delegate |delegateId|, oldest first. Returns the
+// number of records available, which may exceed |capacity|.
+FLUTTER_PLUGIN_EXPORT int32_t WindowProcDelegateDelegateOffenses(
+    void* watchdog, int64_t delegateId, int64_t* offenses, int32_t capacity);
+
+// Clears the accounting of delegate |delegateId| before its ID is reused.
+// An |exempt| delegate is never demoted.
+FLUTTER_PLUGIN_EXPORT void WindowProcDelegateResetDelegateWatchdog(
+    void* watchdog, int64_t delegateId, bool exempt);
+
+// Starts or stops recording the calls of |engineHandle| into Dart and its
+// observer flushes to the Dart timeline, on the Embedder stream. Returns
+// false if |engineHandle| is not valid, or, when starting, if the engine
+// does not export the Dart timeline API.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateSetTimeline(int64_t engineHandle,
+                                                         bool enabled);
+
+// Starts recording the messages of |engineHandle| to a binary trace at
+// |path| (UTF-8), replacing any trace in progress. |capacity| is the number
+// of records buffered for the writer thread, or 0 for the default. Returns
+// false if the file cannot be created or |engineHandle| is not valid.
+FLUTTER_PLUGIN_EXPORT bool WindowProcDelegateStartTrace(int64_t engineHandle,
+                                                        const char* path,
+                                                        int32_t capacity);
+
+// Stops the trace of |engineHandle|. Returns the number of records written,
+// or -1 if no trace was running.
+FLUTTER_PLUGIN_EXPORT int64_t WindowProcDelegateStopTrace(
+    int64_t engineHandle);
+
 FLUTTER_PLUGIN_EXPORT intptr_t WindowProcDelegateInitDartApi(void* data);
 
 #if defined(__cplusplus)
@@ -41,8 +250,6 @@ FLUTTER_PLUGIN_EXPORT intptr_t WindowProcDelegateInitDartApi(void* data);
 
 namespace window_proc_delegate {
 
-typedef std::function<void(WindowsMessage*)> DartWindowProcCallback;
-
 class WindowProcDelegatePlugin : public flutter::Plugin {
  public:
   static void RegisterWithRegistrar(flutter::PluginRegistrarWindows* registrar);
@@ -55,29 +262,15 @@ class WindowProcDelegatePlugin : public flutter::Plugin {
   WindowProcDelegatePlugin(const WindowProcDelegatePlugin&) = delete;
   WindowProcDelegatePlugin& operator=(const WindowProcDelegatePlugin&) = delete;
 
-  // Called when a method is called on this plugin's channel from Dart.
-  void HandleMethodCall(
-      const flutter::MethodCall<flutter::EncodableValue>& method_call,
-      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
-
-  void SetCallback(DartWindowProcCallbackC callback, Dart_Isolate isolate);
-  DartWindowProcCallback GetCallback();
-
-  // Static methods for global registration
-  static void RegisterPlugin(int64_t engine_id,
-                             WindowProcDelegatePlugin* plugin);
-  static void UnregisterPlugin(int64_t engine_id);
-  static void SetCallbackForEngine(int64_t engine_id,
-                                   DartWindowProcCallbackC callback,
-                                   Dart_Isolate isolate);
-
  private:
-  flutter::PluginRegistrarWindows* registrar_;
-  int window_proc_delegate_id_;
-  std::optional<int64_t> engine_id_;
-  DartWindowProcCallbackC callback_ = nullptr;
-  Dart_Isolate isolate_ = nullptr;
-  std::mutex mutex_;
+  // The engine's plugin registrar, which the plugin is attached to the
+  // EngineRegistry under.
+  const intptr_t key_;
+
+  // Declared in this order so the dispatcher detaches from the window
+  // procedure before the registrar goes away.
+  Win32WindowProcRegistrar window_proc_registrar_;
+  Dispatcher dispatcher_;
 };
 
 }  // namespace window_proc_delegate
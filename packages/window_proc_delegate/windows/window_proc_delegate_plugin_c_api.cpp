@@ -2,6 +2,7 @@
 
 #include <flutter/plugin_registrar_windows.h>
 
+#include "core/engine_registry.h"
 #include "window_proc_delegate_plugin.h"
 
 void WindowProcDelegatePluginCApiRegisterWithRegistrar(
@@ -10,3 +11,24 @@ void WindowProcDelegatePluginCApiRegisterWithRegistrar(
       flutter::PluginRegistrarManager::GetInstance()
           ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar));
 }
+
+int64_t WindowProcDelegateAddNativeHandler(
+    FlutterDesktopPluginRegistrarRef registrar,
+    const uint32_t* messages,
+    size_t message_count,
+    int32_t priority,
+    WindowProcDelegateNativeHandlerFunction function,
+    void* user_data) {
+  // The engine's plugins share its registrar, which this plugin attaches
+  // under.
+  return window_proc_delegate::EngineRegistry::Global().AddNativeHandler(
+      reinterpret_cast<intptr_t>(registrar), messages, message_count,
+      priority, function, user_data);
+}
+
+void WindowProcDelegateRemoveNativeHandler(
+    FlutterDesktopPluginRegistrarRef registrar,
+    int64_t handler_id) {
+  window_proc_delegate::EngineRegistry::Global().RemoveNativeHandler(
+      reinterpret_cast<intptr_t>(registrar), handler_id);
+}